@@ -23,13 +23,17 @@
 file(GLOB donut_core_src
     include/donut/core/chunk/*.h
     include/donut/core/math/*.h
+    include/donut/core/vfs/CachingFileSystem.h
     include/donut/core/vfs/Compression.h
+    include/donut/core/vfs/PathTable.h
     include/donut/core/vfs/TarFile.h
     include/donut/core/vfs/VFS.h
     include/donut/core/*.h
     src/core/chunk/*.cpp
     src/core/math/*.cpp
+    src/core/vfs/CachingFileSystem.cpp
     src/core/vfs/Compression.cpp
+    src/core/vfs/PathTable.cpp
     src/core/vfs/TarFile.cpp
     src/core/vfs/VFS.cpp
     src/core/*.cpp
@@ -56,6 +60,11 @@ if(DONUT_WITH_LZ4)
     target_compile_definitions(donut_core PUBLIC DONUT_WITH_LZ4)
 endif()
 
+if(DONUT_WITH_TASKFLOW)
+    target_link_libraries(donut_core taskflow)
+    target_compile_definitions(donut_core PUBLIC DONUT_WITH_TASKFLOW)
+endif()
+
 if(DONUT_WITH_MINIZ)
     target_link_libraries(donut_core miniz)
     target_sources(donut_core PRIVATE
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace donut::math
@@ -43,6 +44,31 @@ namespace donut::math
         constexpr bool isempty();
     };
 
+    // Bounding boxes stored as separate arrays of coordinates (structure of arrays), for batch processing.
+    // All arrays must hold at least 'count' elements.
+    struct box3_soa
+    {
+        const float* minX = nullptr;
+        const float* minY = nullptr;
+        const float* minZ = nullptr;
+        const float* maxX = nullptr;
+        const float* maxY = nullptr;
+        const float* maxZ = nullptr;
+        size_t count = 0;
+    };
+
+    // Instruction sets that the batch frustum tests can use; 'best' picks the best one supported by the CPU at runtime.
+    enum class simd_level
+    {
+        scalar,
+        sse,
+        avx2,
+        best
+    };
+
+    // Returns the best instruction set supported by the CPU (and the build) for the batch tests.
+    simd_level get_supported_simd_level();
+
     // six planes, normals pointing outside of the volume
     struct frustum
     {
@@ -77,6 +103,11 @@ namespace donut::math
         bool intersectsWith(const float3 &point) const;
         bool intersectsWith(const box3 &box) const;
 
+        // Tests all boxes like intersectsWith(box3) and stores the results as bits in 'visibilityMask':
+        // box i is visible if bit (i % 32) of visibilityMask[i / 32] is set. The mask must hold (count + 31) / 32 words.
+        // The results are exactly the same for all SIMD levels; unsupported levels fall back to the best supported one.
+        void intersectsWith(const box3_soa& boxes, uint32_t* visibilityMask, simd_level level = simd_level::best) const;
+
         static constexpr uint32_t numCorners = 8;
         float3 getCorner(int index) const;
 
@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/vfs/VFS.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace donut::vfs
+{
+    /*
+    A read-through cache for another file system, typically one that decompresses files, such as CompressionLayer.
+
+    The blobs returned by readFile are kept in memory, keyed by their normalized path, until the total size
+    of the cached blobs exceeds the budget; then the least recently used blobs are evicted. Blobs larger
+    than the budget are not cached. Reading a cached file again returns the same blob without accessing
+    the underlying file system, which makes reloading the same scene, or switching between scenes that share
+    assets, mostly free of I/O and decompression.
+
+    When validation is enabled, every cache hit compares the file size and modification time reported by
+    the underlying getFileInfo with the values recorded when the file was cached, and re-reads changed files.
+    Files for which the underlying file system provides no information are never validated.
+
+    Writing a file through the cache invalidates its cached blob. Other operations are passed through.
+    */
+    class CachingFileSystem : public IFileSystem
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+            uint64_t invalidations = 0;
+            size_t cachedFiles = 0;
+            size_t cachedBytes = 0;
+        };
+
+    private:
+        struct CacheEntry
+        {
+            std::string name;
+            std::shared_ptr<IBlob> blob;
+            FileInfo info;
+            bool hasInfo = false;
+        };
+
+        std::shared_ptr<IFileSystem> m_fs;
+        size_t m_Budget;
+        bool m_ValidateFiles = false;
+
+        mutable std::mutex m_Mutex;
+        // most recently used entries first
+        std::list<CacheEntry> m_Entries;
+        std::unordered_map<std::string, std::list<CacheEntry>::iterator> m_EntryMap;
+        Statistics m_Statistics;
+
+        std::shared_ptr<IBlob> findInCache(const std::string& name, bool validate, bool hasInfo, const FileInfo& info);
+        void addToCache(const std::string& name, const std::shared_ptr<IBlob>& blob, bool hasInfo, const FileInfo& info);
+        void removeFromCache(const std::string& name);
+        void evict(size_t budget);
+
+    public:
+        CachingFileSystem(std::shared_ptr<IFileSystem> fs, size_t budgetBytes);
+
+        // Changes the budget, evicting blobs if necessary.
+        void setBudget(size_t budgetBytes);
+        [[nodiscard]] size_t getBudget() const { return m_Budget; }
+
+        void setValidateFiles(bool validate) { m_ValidateFiles = validate; }
+        [[nodiscard]] bool getValidateFiles() const { return m_ValidateFiles; }
+
+        // Removes all blobs from the cache. The counters are not reset.
+        void clear();
+        [[nodiscard]] Statistics getStatistics() const;
+        void resetCounters();
+
+        bool folderExists(const std::filesystem::path& name) override;
+        bool fileExists(const std::filesystem::path& name) override;
+        std::shared_ptr<IBlob> readFile(const std::filesystem::path& name) override;
+        bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override;
+        int enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates = false) override;
+        int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) override;
+        std::shared_ptr<AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority = 0, read_callback_t callback = nullptr) override;
+        bool getFileInfo(const std::filesystem::path& name, FileInfo& info) override;
+    };
+}
@@ -25,6 +25,13 @@
 #include <donut/core/vfs/VFS.h>
 #include <utility>
 
+#ifdef DONUT_WITH_TASKFLOW
+namespace tf
+{
+    class Executor;
+}
+#endif
+
 namespace donut::vfs
 {
     /* 
@@ -40,7 +47,12 @@ namespace donut::vfs
 
     The writeFile function will compress the input data if the provided file name
     has an '.lz4' extension. If no such extension is present, the file will be 
-    written uncompressed.
+    written uncompressed. By default, the frame is written with independent blocks
+    and the uncompressed size in the header, see 'Parallel decompression' below.
+
+    The readFileAsync function works like readFile: if the '.lz4' file exists, it is read asynchronously
+    by the underlying file system, and the thread that completes the read also decompresses the data,
+    without using the executor.
 
     The enumerateFiles function will search for files with the requested extensions
     and with extra '.lz4' extensions. The .lz4 extensions will be removed from 
@@ -55,6 +67,16 @@ namespace donut::vfs
     very fast decompression of individual .lz4 compressed files within a tar archive.
     To create such an archive, one can use the existing tar and lz4 Unix utilities,
     or the 'scripts/lz4_tar.py' Python script provided with Donut.
+
+    Parallel decompression:
+
+    When a frame stores its content size and uses independent blocks (lz4 -BI --content-size,
+    or what writeFile and lz4_tar.py produce), every block decompresses to a known offset
+    in an output buffer of the exact size. Such frames are decoded block by block without
+    the streaming decompressor, and when an executor is set, the blocks are decoded in parallel.
+    Calls made from a worker thread of that executor decode the blocks on the calling thread
+    to avoid waiting on tasks that may need the same worker.
+    Other frames are decompressed serially with the streaming decompressor.
     */
     
     class CompressionLayer : public IFileSystem
@@ -62,6 +84,14 @@ namespace donut::vfs
     private:
         std::shared_ptr<IFileSystem> m_fs;
         int m_CompressionLevel = 5;
+        size_t m_BlockSize = 1024 * 1024;
+#ifdef DONUT_WITH_TASKFLOW
+        tf::Executor* m_Executor = nullptr;
+#endif
+
+#ifdef DONUT_WITH_LZ4
+        std::shared_ptr<IBlob> decompress(const std::filesystem::path& name, const std::shared_ptr<IBlob>& compressedBlob, bool useExecutor);
+#endif
 
     public:
         explicit CompressionLayer(std::shared_ptr<IFileSystem> fs)
@@ -69,6 +99,17 @@ namespace donut::vfs
         { }
 
         void setCompressionLevel(int level) { m_CompressionLevel = level; }
+
+        // Sets the block size used by writeFile. Supported sizes are 64 KB, 256 KB, 1 MB and 4 MB,
+        // other values are rounded up to the nearest supported size. Zero writes linked blocks
+        // that compress slightly better but can only be decompressed serially.
+        void setBlockSize(size_t size) { m_BlockSize = size; }
+        [[nodiscard]] size_t getBlockSize() const { return m_BlockSize; }
+
+#ifdef DONUT_WITH_TASKFLOW
+        // Sets the executor used to decompress independent blocks in parallel, or nullptr to decompress serially.
+        void setExecutor(tf::Executor* executor) { m_Executor = executor; }
+#endif
         
         bool folderExists(const std::filesystem::path& name) override;
         bool fileExists(const std::filesystem::path& name) override;
@@ -76,5 +117,7 @@ namespace donut::vfs
         bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override;
         int enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates = false) override;
         int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) override;
+        std::shared_ptr<AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority = 0, read_callback_t callback = nullptr) override;
+        bool getFileInfo(const std::filesystem::path& name, FileInfo& info) override;
     };
 }
@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace donut::vfs
+{
+    // Returns true if the string is already in the form produced by lexically_normal().generic_string(),
+    // i.e. it has no '.' or empty components and no '..' components other than a leading run in a relative path.
+    bool isNormalPath(std::string_view path);
+
+    // Returns the same string as std::filesystem::path(path).lexically_normal().generic_string()
+    // for paths without a root name, without creating a path object for every component.
+    std::string normalizePath(std::string_view path);
+
+    /*
+    A path in normal generic form, as used for lookups in the file systems.
+    Paths that are already normal, which is the common case when the path has passed through another
+    file system layer, are referenced without copying, so the source path must outlive the NormalizedPath.
+    */
+    class NormalizedPath
+    {
+    private:
+        std::string_view m_Path;
+        std::string m_Storage;
+
+    public:
+        explicit NormalizedPath(const std::filesystem::path& path);
+        explicit NormalizedPath(std::string_view path);
+
+        // m_Path may point into m_Storage
+        NormalizedPath(const NormalizedPath&) = delete;
+        NormalizedPath& operator=(const NormalizedPath&) = delete;
+
+        [[nodiscard]] std::string_view view() const { return m_Path; }
+
+        // The path without the leading '/', the form in which archives store their file names
+        [[nodiscard]] std::string_view relative() const;
+    };
+
+    /*
+    A set of interned paths, each stored once and identified by a dense index in the order of insertion.
+    Used by the archive file systems for their file and directory lists, and by RootFileSystem for the mount points.
+    Lookups take a string_view and don't allocate. The paths are expected to be normalized by the caller.
+    */
+    class PathTable
+    {
+    public:
+        static constexpr uint32_t InvalidIndex = ~0u;
+
+        // Adds the path if it's not in the table yet, returns its index
+        uint32_t insert(std::string_view path);
+
+        [[nodiscard]] uint32_t find(std::string_view path) const;
+        [[nodiscard]] bool contains(std::string_view path) const { return find(path) != InvalidIndex; }
+
+        // The returned view is invalidated by the next insert
+        [[nodiscard]] std::string_view getPath(uint32_t index) const;
+        [[nodiscard]] uint32_t size() const { return uint32_t(m_Entries.size()); }
+        [[nodiscard]] bool empty() const { return m_Entries.empty(); }
+
+        void clear();
+
+    private:
+        struct Entry
+        {
+            size_t hash;
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        std::string m_Storage;
+        std::vector<Entry> m_Entries;
+        std::vector<uint32_t> m_Slots; // entry index + 1, or 0 for an empty slot; the size is a power of 2
+
+        [[nodiscard]] uint32_t findSlot(std::string_view path, size_t hash) const;
+        void rehash(size_t slotCount);
+    };
+}
@@ -24,8 +24,6 @@
 
 #include <donut/core/vfs/VFS.h>
 #include <mutex>
-#include <unordered_map>
-#include <unordered_set>
 
 namespace donut::vfs
 {
@@ -37,10 +35,30 @@ namespace donut::vfs
     */
     class TarFile : public IFileSystem
     {
+    public:
+        enum class ReadMode
+        {
+            // Seek and read through the C runtime under a mutex, one file at a time.
+            Buffered,
+
+            // Read with positional reads (pread / ReadFile at an offset) that need no locking,
+            // so that any number of threads can read files concurrently. Each file is copied into a new buffer.
+            Positional,
+
+            // Map the whole archive into memory. The blobs returned by readFile point into the mapping
+            // without copying and keep it alive after the TarFile is destroyed.
+            MemoryMapped
+        };
+
     private:
+        struct NativeArchive;
+
         std::string m_ArchivePath;
+        ReadMode m_ReadMode;
         std::mutex m_Mutex;
         FILE* m_ArchiveFile = nullptr;
+        std::unique_ptr<NativeArchive> m_NativeArchive;
+        std::shared_ptr<MappedFileBlob> m_ArchiveMapping;
 
         struct FileEntry
         {
@@ -48,14 +66,16 @@ namespace donut::vfs
             size_t size = 0;
         };
 
-        std::unordered_map<std::string, FileEntry> m_Files;
-        std::unordered_set<std::string> m_Directories;
+        PathTable m_Files; // indices into m_FileEntries
+        std::vector<FileEntry> m_FileEntries;
+        PathTable m_Directories;
         
     public:
-        TarFile(const std::filesystem::path& archivePath);
+        TarFile(const std::filesystem::path& archivePath, ReadMode readMode = ReadMode::Buffered);
         ~TarFile() override;
 
         [[nodiscard]] bool isOpen() const;
+        [[nodiscard]] ReadMode getReadMode() const { return m_ReadMode; }
         
         bool folderExists(const std::filesystem::path& name) override;
         bool fileExists(const std::filesystem::path& name) override;
@@ -63,5 +83,9 @@ namespace donut::vfs
         bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override;
         int enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates = false) override;
         int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) override;
+
+        // In the MemoryMapped mode, the request completes immediately because no data is read,
+        // in the other modes the reads happen on the default IoThreadPool.
+        std::shared_ptr<AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority = 0, read_callback_t callback = nullptr) override;
     };
 }
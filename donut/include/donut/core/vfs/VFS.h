@@ -22,12 +22,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <filesystem>
 #include <functional>
+#include <future>
+#include <queue>
+#include <thread>
 #include <vector>
 
+#include <donut/core/vfs/PathTable.h>
+
 /* 
 Donut Virtual File System (VFS) main classes.
 
@@ -80,6 +88,144 @@ namespace donut::vfs
         [[nodiscard]] size_t size() const override;
     };
 
+    // A blob that refers to a range of another blob, such as one file in a memory-mapped archive,
+    // without copying it. Keeps the parent blob alive.
+    class BufferRegionBlob : public IBlob
+    {
+    private:
+        std::shared_ptr<IBlob> m_parent;
+        const void* m_data;
+        size_t m_size;
+
+    public:
+        BufferRegionBlob(const std::shared_ptr<IBlob>& parent, size_t offset, size_t size);
+        [[nodiscard]] const void* data() const override;
+        [[nodiscard]] size_t size() const override;
+    };
+
+    // A blob with the contents of a native file mapped into memory read-only.
+    // Pages are loaded by the OS when first accessed, and the mapping is released when the blob is deleted.
+    class MappedFileBlob : public IBlob
+    {
+    private:
+        void* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_isOpen = false;
+
+    public:
+        explicit MappedFileBlob(const std::filesystem::path& path);
+        ~MappedFileBlob() override;
+
+        // Returns false if the file cannot be opened or mapped. Empty files are open but have no data.
+        [[nodiscard]] bool isOpen() const { return m_isOpen; }
+        [[nodiscard]] const void* data() const override;
+        [[nodiscard]] size_t size() const override;
+    };
+
+    typedef std::function<void(const std::shared_ptr<IBlob>&)> read_callback_t;
+
+    // The state of a read started with IFileSystem::readFileAsync.
+    // The file system calls begin() when it starts reading and complete() with the result,
+    // the caller can wait for the blob, use the future, or cancel the read before it starts.
+    class AsyncReadRequest
+    {
+    private:
+        enum class State
+        {
+            Pending,
+            Running,
+            Completed,
+            Cancelled
+        };
+
+        std::atomic<State> m_State = State::Pending;
+        read_callback_t m_Callback;
+        std::promise<std::shared_ptr<IBlob>> m_Promise;
+        std::shared_future<std::shared_ptr<IBlob>> m_Future;
+        std::mutex m_DependencyMutex;
+        std::shared_ptr<AsyncReadRequest> m_Dependency;
+
+    public:
+        explicit AsyncReadRequest(read_callback_t callback = nullptr);
+
+        // Marks the request as started. Returns false if it has been cancelled and must not be processed.
+        bool begin();
+
+        // Calls the callback with the result, nullptr if the read failed, and then makes the result available to waiters.
+        void complete(const std::shared_ptr<IBlob>& blob);
+
+        // Sets another request that this one is waiting for, such as the read of the compressed file
+        // in CompressionLayer. Cancelling this request then cancels the dependency.
+        void setDependency(std::shared_ptr<AsyncReadRequest> dependency);
+
+        // Cancels the read if it hasn't started yet. Returns true if the request was cancelled:
+        // its callback will not be called, and wait() returns nullptr.
+        bool cancel();
+
+        [[nodiscard]] bool isDone() const;
+        [[nodiscard]] bool isCancelled() const { return m_State == State::Cancelled; }
+
+        // Blocks until the read is complete or cancelled and returns the blob.
+        [[nodiscard]] std::shared_ptr<IBlob> wait() const { return m_Future.get(); }
+        [[nodiscard]] const std::shared_future<std::shared_ptr<IBlob>>& getFuture() const { return m_Future; }
+
+        // Creates a request that has already completed with the provided blob, after calling the callback.
+        static std::shared_ptr<AsyncReadRequest> createCompleted(const std::shared_ptr<IBlob>& blob, read_callback_t callback);
+    };
+
+    // A pool of threads that perform blocking reads for readFileAsync.
+    // Reads with higher priority start first, reads with equal priority start in submission order.
+    class IoThreadPool
+    {
+    private:
+        struct Job
+        {
+            int priority;
+            uint64_t sequence;
+            std::shared_ptr<AsyncReadRequest> request;
+            std::function<std::shared_ptr<IBlob>()> read;
+
+            bool operator<(const Job& other) const
+            {
+                return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+            }
+        };
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::priority_queue<Job> m_Jobs;
+        std::vector<std::thread> m_Threads;
+        uint64_t m_NextSequence = 0;
+        bool m_Terminate = false;
+
+        void threadProc();
+
+    public:
+        explicit IoThreadPool(uint32_t threadCount);
+
+        // Cancels the reads that haven't started and waits for the running ones.
+        ~IoThreadPool();
+
+        // Queues a read function and returns the request that receives its result.
+        std::shared_ptr<AsyncReadRequest> submit(int priority, read_callback_t callback, std::function<std::shared_ptr<IBlob>()> read);
+
+        [[nodiscard]] size_t getThreadCount() const { return m_Threads.size(); }
+
+        // The pool used by the default readFileAsync implementation.
+        static IoThreadPool& getDefault();
+    };
+
+    // Size and modification time of a file, used to find out if a file has changed.
+    struct FileInfo
+    {
+        uint64_t size = 0;
+        // In the units of std::filesystem::file_time_type, or 0 if unknown.
+        int64_t modificationTime = 0;
+
+        bool operator==(const FileInfo& other) const { return size == other.size && modificationTime == other.modificationTime; }
+        bool operator!=(const FileInfo& other) const { return !(*this == other); }
+    };
+
     // Basic interface for the virtual file system.
     class IFileSystem
     {
@@ -110,18 +256,39 @@ namespace donut::vfs
         // Returns the number of directories found, or a negative number on errors - see donut::vfs::status.
         // The directory names, relative to the 'path', are passed to 'callback' in no particular order.
         virtual int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) = 0;
+
+        // Start reading the entire file in the background.
+        // The callback, if provided, is called with the blob, or nullptr if the file cannot be read,
+        // on the thread that completes the read. Reads with higher priority are started first.
+        // The file system must stay alive until the request is complete.
+        // The default implementation calls readFile on the default IoThreadPool.
+        virtual std::shared_ptr<AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority = 0, read_callback_t callback = nullptr);
+
+        // Get the size and modification time of a file.
+        // Returns false if the file doesn't exist or the file system can't provide the information.
+        virtual bool getFileInfo(const std::filesystem::path& name, FileInfo& info) { return false; }
     };
 
     // An implementation of virtual file system that directly maps to the OS files.
+    // Files of at least the memory mapping threshold are returned as MappedFileBlob objects instead of being
+    // copied into memory. On Windows, such files cannot be overwritten while their blobs exist.
     class NativeFileSystem : public IFileSystem
     {
+    private:
+        size_t m_MemoryMappingThreshold = 64 * 1024;
+
     public:
+        // Sets the smallest file size that is memory mapped, SIZE_MAX disables memory mapping.
+        void setMemoryMappingThreshold(size_t size) { m_MemoryMappingThreshold = size; }
+        [[nodiscard]] size_t getMemoryMappingThreshold() const { return m_MemoryMappingThreshold; }
+
 		bool folderExists(const std::filesystem::path& name) override;
         bool fileExists(const std::filesystem::path& name) override;
         std::shared_ptr<IBlob> readFile(const std::filesystem::path& name) override;
         bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override;
         int enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates = false) override;
         int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) override;
+        bool getFileInfo(const std::filesystem::path& name, FileInfo& info) override;
     };
 
     // A layer that represents some path in the underlying file system as an entire FS.
@@ -132,6 +299,9 @@ namespace donut::vfs
     private:
         std::shared_ptr<IFileSystem> m_UnderlyingFS;
         std::filesystem::path m_BasePath;
+        std::string m_BasePathString; // generic form, for appending normalized names without path operations
+
+        [[nodiscard]] std::filesystem::path resolve(const std::filesystem::path& name) const;
     public:
         RelativeFileSystem(std::shared_ptr<IFileSystem> fs, const std::filesystem::path& basePath);
 
@@ -143,6 +313,8 @@ namespace donut::vfs
         bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override;
         int enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates = false) override;
         int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) override;
+        std::shared_ptr<AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority = 0, read_callback_t callback = nullptr) override;
+        bool getFileInfo(const std::filesystem::path& name, FileInfo& info) override;
     };
 
     // A virtual file system that allows mounting, or attaching, other VFS objects to paths.
@@ -152,6 +324,13 @@ namespace donut::vfs
     private:
         std::vector<std::pair<std::string, std::shared_ptr<IFileSystem>>> m_MountPoints;
 
+        // Indexed mount point paths, m_MountTable.getPath(i) == m_MountPoints[i].first.
+        // A lookup tries the prefixes of the path that have the length of some mount point, longest first,
+        // and there are usually only a few distinct lengths.
+        PathTable m_MountTable;
+        std::vector<size_t> m_MountPathLengths;
+
+        void updateMountTable();
         bool findMountPoint(const std::filesystem::path& path, std::filesystem::path* pRelativePath, IFileSystem** ppFS);
     public:
         void mount(const std::filesystem::path& path, std::shared_ptr<IFileSystem> fs);
@@ -164,7 +343,9 @@ namespace donut::vfs
         bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override;
         int enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates = false) override;
         int enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates = false) override;
+        std::shared_ptr<AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority = 0, read_callback_t callback = nullptr) override;
+        bool getFileInfo(const std::filesystem::path& name, FileInfo& info) override;
     };
 
     std::string getFileSearchRegex(const std::filesystem::path& path, const std::vector<std::string>& extensions);
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -24,8 +24,6 @@
 
 #include <donut/core/vfs/VFS.h>
 #include <mutex>
-#include <unordered_map>
-#include <unordered_set>
 
 namespace donut::vfs
 {
@@ -37,6 +35,9 @@ namespace donut::vfs
     from zip files is very slow compared to other storage methods. Donut supports reading assets
     compressed with LZ4 and stored in tar archives, which is significantly faster, in part because 
     such files can be decompressed in parallel. See the TarFile and CompressionLayer classes.
+
+    The archive is memory mapped when possible. Files stored in it without compression are then
+    returned as blobs that point into the mapping, without copying or CRC validation.
     */
     class ZipFile : public IFileSystem
     {
@@ -47,9 +48,11 @@ namespace donut::vfs
         // mz_zip_archive* really
         // void* because we don't want to include miniz here and can't forward declare the mz_aip_archive struct
         void* m_ZipArchive = nullptr;
+        std::shared_ptr<MappedFileBlob> m_ArchiveMapping;
         
-        std::unordered_map<std::string, uint32_t> m_Files; // name -> index in zip file
-        std::unordered_set<std::string> m_Directories;
+        PathTable m_Files;
+        std::vector<uint32_t> m_FileIndices; // m_Files index -> index in zip file
+        PathTable m_Directories;
 
         void close();
         
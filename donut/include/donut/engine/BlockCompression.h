@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <cstdint>
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace donut::engine
+{
+    struct TextureData;
+
+    // True for the formats that CompressImage produces: the UNORM and UNORM_SRGB variants of BC1, BC3, BC4, BC5 and BC7
+    [[nodiscard]] bool IsBlockCompressionSupported(nvrhi::Format format);
+
+    // Compresses an image of 8-bit pixels with 1 to 4 channels into 4x4 blocks. Missing channels read as 0,
+    // and missing alpha as 255. BC4 uses the first channel and BC5 the first two. Blocks that cross the right or
+    // bottom edge repeat the edge pixels. The rows of blocks are written to 'blocks' tightly packed.
+    // BC1 and BC3 endpoints are fitted along the principal axis of the block colors and refined by least squares.
+    // BC7 uses only mode 6, one subset with 4-bit indices, which is fast to search and handles alpha.
+    // With an executor, the rows of blocks are compressed in parallel, unless called from one of its workers.
+    bool CompressImage(nvrhi::Format format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+        uint32_t channels, uint8_t* blocks, tf::Executor* executor = nullptr);
+
+    // Decodes tightly packed blocks into RGBA8 pixels, with the missing channels of BC4 and BC5 set to 0, and alpha to 255.
+    // Only BC7 blocks in mode 6 are supported, the mode that CompressImage uses. Returns false for other formats or modes.
+    bool DecompressImage(nvrhi::Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* pixels);
+
+    // Picks the compressed format for a decoded 2D texture with the size of the first level a multiple of 4:
+    // BC4 for 1 channel, BC5 for 2 channels, and for RGBA either BC7 or BC1, which becomes BC3 when any pixel of the
+    // first level isn't opaque. The sRGB-ness of the format is kept. Returns UNKNOWN for the other textures.
+    [[nodiscard]] nvrhi::Format ChooseBlockCompressedFormat(const TextureData& texture, bool preferBC7);
+
+    // Compresses all mip levels of a texture chosen by ChooseBlockCompressedFormat, replacing its data, layout and format.
+    // The layout matches the DDS loader's. Returns false and leaves the texture unchanged when it isn't supported.
+    bool CompressTextureData(TextureData& texture, nvrhi::Format format, tf::Executor* executor = nullptr);
+}
@@ -42,4 +42,8 @@ namespace donut::engine
     nvrhi::TextureHandle CreateDDSTextureFromMemory(nvrhi::IDevice* device, nvrhi::ICommandList* commandList, std::shared_ptr<vfs::IBlob> data, const char* debugName = nullptr, bool forceSRGB = false);
 
     std::shared_ptr<vfs::IBlob> SaveStagingTextureAsDDS(nvrhi::IDevice* device, nvrhi::IStagingTexture* stagingTexture);
+
+    // Writes the CPU data of a 2D texture, such as a decoded and processed image, into DDS data in memory
+    // that LoadDDSTextureFromMemory reads back with the same format and mip levels.
+    std::shared_ptr<vfs::IBlob> SaveTextureDataAsDDS(const TextureData& texture);
 }
\ No newline at end of file
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <donut/engine/MeshLods.h>
 #include <memory>
 #include <filesystem>
 
@@ -35,6 +36,7 @@ namespace donut::engine
 {
     struct SceneImportResult;
     struct SceneLoadingStats;
+    class SceneCache;
     class TextureCache;
     class SceneGraphNode;
     class SceneTypeFactory;
@@ -53,6 +55,9 @@ namespace donut::engine
     protected:
         std::shared_ptr<vfs::IFileSystem> m_fs;
         std::shared_ptr<SceneTypeFactory> m_SceneTypeFactory;
+        std::shared_ptr<SceneCache> m_SceneCache;
+        bool m_OptimizeMeshes = false;
+        MeshLodSettings m_LodSettings;
         
     public:
         explicit GltfImporter(std::shared_ptr<vfs::IFileSystem> fs, std::shared_ptr<SceneTypeFactory> sceneTypeFactory);
@@ -63,5 +68,15 @@ namespace donut::engine
             SceneLoadingStats& stats,
             tf::Executor* executor,
             SceneImportResult& result) const;
+
+        // When a scene cache is set, models are loaded from it if possible, and saved into it after importing.
+        void SetSceneCache(std::shared_ptr<SceneCache> sceneCache) { m_SceneCache = std::move(sceneCache); }
+
+        // Reorders the triangles and vertices of every geometry for the vertex cache, overdraw and vertex fetch
+        // after importing, see OptimizeGeometryBuffers, and logs the ACMR and ATVR of each mesh before and after.
+        void SetMeshOptimizationEnabled(bool enable) { m_OptimizeMeshes = enable; }
+
+        // Simplifies every geometry into levels of detail after importing, see SimplifyGeometryLods.
+        void SetMeshLodSettings(const MeshLodSettings& settings) { m_LodSettings = settings; }
     };
 }
@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/math/math.h>
+#include <memory>
+#include <vector>
+
+namespace donut::engine
+{
+    class IView;
+    class MeshInstance;
+    class SceneGraph;
+    class SceneGraphNode;
+
+    // Bounding volume hierarchy over the world-space bounds of the mesh instances in a scene graph,
+    // used to find the instances visible in a view without walking the scene graph hierarchy.
+    // The tree is built with the binned surface area heuristic and refitted when the transforms change;
+    // it is rebuilt when refitting degrades its quality too much.
+    class InstanceBvh
+    {
+    public:
+        struct Node
+        {
+            dm::box3 bounds = dm::box3::empty();
+            uint32_t first = 0; // index of the first child node (the second one follows it), or of the first instance in leaves
+            uint32_t instanceCount = 0; // 0 for interior nodes
+        };
+
+    private:
+        struct StackEntry
+        {
+            uint32_t node;
+            uint32_t planeMask; // planes that the parent node was not fully inside of
+        };
+
+        std::vector<Node> m_Nodes;
+        std::vector<MeshInstance*> m_Instances; // ordered so that each leaf references a contiguous range
+        std::vector<SceneGraphNode*> m_InstanceNodes;
+        std::vector<dm::box3> m_InstanceBounds;
+        std::vector<uint32_t> m_InstanceSlots; // position in m_Instances for each mesh instance index, or ~0u
+        std::vector<StackEntry> m_StackScratch;
+        float m_BuildCost = 0.f;
+        float m_RebuildThreshold = 1.5f;
+        uint32_t m_MaxLeafSize = 4;
+
+        void RefitNodes();
+
+    public:
+        // Builds the tree from scratch over the instances' current global transforms.
+        void Build(const std::vector<std::shared_ptr<MeshInstance>>& instances);
+
+        // Recomputes the bounds of the listed instances (by mesh instance index), or all of them if the list is empty,
+        // and propagates the new bounds up the tree. The tree topology is not changed.
+        void Refit(const std::vector<int>& updatedInstanceIndices);
+
+        // Builds or refits the tree after SceneGraph::Refresh. A refit that makes the tree much less efficient
+        // than it was after the build, as estimated by its SAH cost, triggers a rebuild.
+        void Update(const SceneGraph& sceneGraph, bool structureChanged, bool transformsChanged);
+
+        // Appends the instances whose bounds intersect the frustum to 'visibleInstances'.
+        // Subtrees that are fully inside the frustum are accepted without testing their children.
+        void Cull(const dm::frustum& frustum, std::vector<MeshInstance*>& visibleInstances);
+        void Cull(const IView& view, std::vector<MeshInstance*>& visibleInstances);
+
+        // The SAH cost of the tree, relative to testing every instance individually.
+        [[nodiscard]] float ComputeCost() const;
+
+        // A refit increasing the SAH cost by more than this factor over the cost after the last build causes a rebuild.
+        void SetRebuildThreshold(float factor) { m_RebuildThreshold = factor; }
+        void SetMaxLeafSize(uint32_t size) { m_MaxLeafSize = std::max(size, 1u); }
+
+        [[nodiscard]] const std::vector<Node>& GetNodes() const { return m_Nodes; }
+        [[nodiscard]] size_t GetInstanceCount() const { return m_Instances.size(); }
+        [[nodiscard]] bool IsEmpty() const { return m_Nodes.empty(); }
+    };
+}
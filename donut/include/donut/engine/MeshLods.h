@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/math/math.h>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+namespace donut::engine
+{
+    struct BufferGroup;
+    struct MeshInfo;
+    class IView;
+
+    struct MeshLodSettings
+    {
+        // The number of levels including the full detail geometry, so 1 disables the simplification
+        uint32_t lodCount = 1;
+
+        // The target triangle count of every level relative to the previous one
+        float reduction = 0.5f;
+
+        // How much differences in texture coordinates and normals cost compared to squared geometric error,
+        // with the mesh scaled to a unit box
+        float attributeWeight = 0.01f;
+
+        [[nodiscard]] bool IsEnabled() const { return lodCount > 1; }
+    };
+
+    // Simplifies a triangle mesh with edge collapses ordered by quadric error metrics (Garland and Heckbert,
+    // "Surface simplification using quadric error metrics", 1997). Every collapse moves a vertex onto one of its
+    // neighbors, so the simplified indices use the original vertices and the LODs can share the vertex buffer.
+    // Differences in texture coordinates and normals add to the cost of a collapse. Vertices on open borders
+    // only move along the border, and vertices that are split into several vertices with different attributes,
+    // such as on texture seams, or that have non-manifold edges, don't move at all.
+    class MeshSimplifier
+    {
+    private:
+        struct Quadric
+        {
+            float a00 = 0.f, a01 = 0.f, a02 = 0.f, a11 = 0.f, a12 = 0.f, a22 = 0.f;
+            float b0 = 0.f, b1 = 0.f, b2 = 0.f, c = 0.f;
+            float weight = 0.f;
+
+            void Add(const Quadric& other);
+            [[nodiscard]] float Evaluate(const dm::float3& v) const;
+        };
+
+        enum class VertexKind : uint8_t
+        {
+            Manifold,
+            Border,
+            Locked
+        };
+
+        const dm::float2* m_Texcoords;
+        const uint32_t* m_Normals;
+        std::vector<dm::float3> m_Positions; // scaled into a unit box
+        std::vector<uint32_t> m_PositionIds; // the first vertex with the same position
+        std::vector<VertexKind> m_Kinds;
+        std::vector<Quadric> m_Quadrics;     // by position id
+        std::vector<uint32_t> m_Indices;
+        float m_Scale = 1.f;
+        float m_AttributeWeight;
+        float m_Error = 0.f;
+
+        [[nodiscard]] float GetAttributeDistance(uint32_t a, uint32_t b) const;
+        void AddPlane(uint32_t positionId, const dm::float3& normal, const dm::float3& point, float weight);
+        bool CollapsePass(size_t targetIndexCount, float maxError);
+
+    public:
+        MeshSimplifier(const uint32_t* indices, size_t indexCount, const dm::float3* positions, size_t vertexCount,
+            const dm::float2* texcoords = nullptr, const uint32_t* normals = nullptr, float attributeWeight = MeshLodSettings().attributeWeight);
+
+        // Collapses edges until at most 'targetIndexCount' indices are left, or until every remaining collapse
+        // would make the error larger than 'maxError', and continues from the result of the previous call.
+        // Degenerate and out-of-range triangles of the input are dropped. Returns the new error.
+        float Simplify(size_t targetIndexCount, float maxError = FLT_MAX);
+
+        [[nodiscard]] const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+        // The largest distance between the simplified surface and the original, approximately, in object space
+        [[nodiscard]] float GetError() const { return m_Error; }
+    };
+
+    struct MeshLodLevel
+    {
+        std::vector<uint32_t> indices;
+        float error = 0.f;
+    };
+
+    // Simplifies one geometry of a buffer group into levels 1 and coarser. The indices of the levels are relative
+    // to 'vertexOffset', like the indices of the geometry, and optimized for the vertex cache. The chain stops early
+    // when a level can't be made much smaller than the previous one.
+    std::vector<MeshLodLevel> SimplifyGeometryLods(const BufferGroup& buffers, size_t indexOffset, size_t indexCount,
+        size_t vertexOffset, size_t vertexCount, const MeshLodSettings& settings);
+
+    // Appends the indices of the levels of every geometry of the mesh to the index data of its buffer group, sets
+    // the LOD ranges of the geometries, and the error of every level of the mesh as the largest over the geometries.
+    // The ranges stay relative to mesh.indexOffset but start at or past mesh.totalIndices.
+    void AddMeshLods(MeshInfo& mesh, const std::vector<std::vector<MeshLodLevel>>& geometryLods);
+
+    // SimplifyGeometryLods and AddMeshLods for all geometries of the mesh
+    void GenerateMeshLods(MeshInfo& mesh, const MeshLodSettings& settings);
+
+    // Picks the level of detail of mesh instances in a view from the projected size of their bounding spheres:
+    // the coarsest level whose error, relative to the bounding sphere, covers at most 'pixelThreshold' pixels.
+    class MeshLodSelector
+    {
+    private:
+        dm::float3 m_ViewOrigin = 0.f;
+        float m_PixelsPerUnit = 0.f; // at a distance of 1 for perspective projections
+        float m_PixelThreshold = 0.f;
+        bool m_Orthographic = false;
+
+    public:
+        // A threshold of 0 or less always selects the full detail level
+        void SetView(const IView& view, float pixelThreshold);
+
+        [[nodiscard]] uint32_t SelectLod(const MeshInfo& mesh, const dm::affine3& objectToWorld) const;
+
+        // The diameter in pixels of the bounding sphere of a world space box, or FLT_MAX when the camera is inside it
+        [[nodiscard]] float GetProjectedSize(const dm::box3& worldBounds) const;
+    };
+}
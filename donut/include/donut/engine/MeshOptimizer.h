@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/math/math.h>
+#include <cstdint>
+#include <vector>
+
+namespace donut::engine
+{
+    struct BufferGroup;
+
+    // The FIFO post-transform cache size that the optimizations and statistics assume by default
+    constexpr uint32_t c_DefaultVertexCacheSize = 16;
+
+    // Vertex shader invocations of an index buffer on a FIFO post-transform cache.
+    struct VertexCacheStatistics
+    {
+        size_t triangles = 0;
+        size_t vertices = 0;   // distinct vertices referenced by the indices
+        size_t transforms = 0; // cache misses
+
+        // Average cache miss ratio: transforms per triangle, 0.5 at best for large regular meshes, 3 at worst
+        [[nodiscard]] float GetACMR() const { return triangles ? float(transforms) / float(triangles) : 0.f; }
+
+        // Average transform to vertex ratio: 1 when every vertex is transformed only once
+        [[nodiscard]] float GetATVR() const { return vertices ? float(transforms) / float(vertices) : 0.f; }
+
+        VertexCacheStatistics& operator+=(const VertexCacheStatistics& other)
+        {
+            triangles += other.triangles;
+            vertices += other.vertices;
+            transforms += other.transforms;
+            return *this;
+        }
+    };
+
+    struct MeshOptimizationStatistics
+    {
+        VertexCacheStatistics before;
+        VertexCacheStatistics after;
+    };
+
+    [[nodiscard]] VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+        uint32_t cacheSize = c_DefaultVertexCacheSize);
+
+    // Reorders the triangles for the post-transform cache with Tipsify (Sander, Nehab and Barczak, "Fast triangle
+    // reordering for vertex locality and reduced overdraw", 2007). If 'clusters' is provided, it receives the
+    // first triangle of every run that starts at a cache discontinuity, for OptimizeOverdraw.
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount,
+        uint32_t cacheSize = c_DefaultVertexCacheSize, std::vector<uint32_t>* clusters = nullptr);
+
+    // Splits the clusters from OptimizeVertexCache further where that costs at most 'threshold' times their ACMR,
+    // and sorts the clusters so that the ones facing away from the mesh center are drawn first, which
+    // lets them occlude the rest of the mesh from most directions.
+    void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const dm::float3* positions, size_t vertexCount,
+        const std::vector<uint32_t>& clusters, float threshold = 1.05f, uint32_t cacheSize = c_DefaultVertexCacheSize);
+
+    // Renumbers the vertices in the order in which the indices first reference them, so that the vertex fetches
+    // walk the streams linearly. Unreferenced vertices move to the end. Returns the new index of every vertex.
+    std::vector<uint32_t> OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // Runs the three optimizations on one geometry of a buffer group and applies the vertex remapping to all
+    // of its non-empty vertex streams. The indices are relative to 'vertexOffset', like the importer stores them.
+    MeshOptimizationStatistics OptimizeGeometryBuffers(BufferGroup& buffers,
+        size_t indexOffset, size_t indexCount, size_t vertexOffset, size_t vertexCount,
+        uint32_t cacheSize = c_DefaultVertexCacheSize);
+}
@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/math/math.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace donut::vfs
+{
+    class IBlob;
+}
+
+namespace donut::engine
+{
+    struct Meshlet;
+    struct MeshInfo;
+
+    // Limits that fit the mesh shader output recommendations of most GPUs
+    constexpr uint32_t c_DefaultMeshletMaxVertices = 64;
+    constexpr uint32_t c_DefaultMeshletMaxTriangles = 124;
+
+    // Hard limits: the triangles index the vertex list of their meshlet with 8 bits
+    constexpr uint32_t c_MeshletMaxVertices = 256;
+    constexpr uint32_t c_MeshletMaxTriangles = 512;
+
+    // Splits the triangles into meshlets of at most 'maxVertices' vertices and 'maxTriangles' triangles. Each meshlet
+    // grows from a seed triangle over the adjacent triangles, so that it stays compact, and the seeds are taken in
+    // index order. Computes a bounding sphere and a normal cone for every meshlet.
+    // Degenerate and out-of-range triangles are dropped.
+    // The results are appended to the three arrays, and the offsets in the meshlets refer to them.
+    // Returns the number of meshlets added.
+    size_t BuildMeshlets(const uint32_t* indices, size_t indexCount, const dm::float3* positions, size_t vertexCount,
+        uint32_t maxVertices, uint32_t maxTriangles, std::vector<Meshlet>& meshlets,
+        std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles);
+
+    // Builds the meshlets of every geometry of the mesh from the index and position data of its buffer group,
+    // appends them to the meshlet arrays of the buffer group and sets the meshlet range of each geometry.
+    void BuildMeshlets(MeshInfo& mesh, uint32_t maxVertices = c_DefaultMeshletMaxVertices,
+        uint32_t maxTriangles = c_DefaultMeshletMaxTriangles);
+
+    // Returns true if all triangles of the meshlet face away from the camera, according to its normal cone.
+    // The camera position is in the object space of the meshlet.
+    [[nodiscard]] bool IsMeshletBackfacing(const Meshlet& meshlet, const dm::float3& cameraPosition);
+
+    // Tests the meshlets against a view frustum and, if 'cullBackfaces' is set, their normal cones against the camera,
+    // and appends the indices of the meshlets that can be visible to 'visibleMeshlets'. The frustum and the camera
+    // position are in world space. The tests run in the object space of the meshlets, so they are exact for any
+    // transform, but instances with a mirroring transform skip the cone test because their winding is reversed.
+    // Returns the number of visible meshlets.
+    size_t CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const dm::affine3& objectToWorld,
+        const dm::frustum& frustum, const dm::float3& cameraPosition, bool cullBackfaces,
+        std::vector<uint32_t>& visibleMeshlets);
+
+    // Packs the vertex streams and the meshlets of a mesh into a chunk file with a MESHLET set, see chunk.h.
+    // Every geometry becomes one MeshletInfo with one instance. Returns nullptr if the mesh has no meshlets.
+    std::shared_ptr<vfs::IBlob const> SerializeMeshlets(const MeshInfo& mesh);
+
+    // Loads a mesh written by SerializeMeshlets into a new buffer group. The geometries get placeholder materials
+    // with the names of the original ones, and an index buffer rebuilt from the meshlets.
+    std::shared_ptr<MeshInfo> DeserializeMeshlets(const std::shared_ptr<vfs::IBlob const>& blob, const char* assetPath);
+}
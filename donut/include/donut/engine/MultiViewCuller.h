@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <vector>
+
+namespace donut::engine
+{
+    // Culls the scene graph against several views in a single traversal, testing each node against
+    // the frustums of all views that can still see its parent, and keeps the visible mesh instances per view.
+    // Typical use: cull once per frame for the shadow map cascades and the main view, then pass the culler
+    // to RenderCompositeView for each of them.
+    class MultiViewCuller
+    {
+    public:
+        struct Stats
+        {
+            uint32_t viewCount = 0;
+            uint32_t traversals = 0; // one per 32 views
+            uint32_t nodesVisited = 0;
+            uint32_t boxTests = 0;
+            // the number of nodes that culling each view with a separate traversal would have visited
+            uint32_t nodesVisitedWithSeparateTraversals = 0;
+        };
+
+    private:
+        std::vector<const IView*> m_Views;
+        std::vector<dm::frustum> m_Frustums;
+        std::vector<std::vector<MeshInstance*>> m_VisibleInstances;
+        std::vector<uint32_t> m_MaskStack;
+        SceneContentFlags m_RelevantContent = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes | SceneContentFlags::BlendedMeshes;
+        Stats m_Stats;
+
+    public:
+        // Finds the visible mesh instances for all views. The results are valid until the next call,
+        // or until the scene graph or the views change.
+        void Cull(SceneGraphNode* rootNode, const std::vector<const IView*>& views);
+
+        // Appends the child views of the composite view that match the view types to 'views'.
+        static void AddChildViews(const ICompositeView& compositeView, ViewType::Enum supportedTypes, std::vector<const IView*>& views);
+
+        // Returns the visible instances for a view passed to the last Cull call, or nullptr if it wasn't passed.
+        [[nodiscard]] const std::vector<MeshInstance*>* GetVisibleInstances(const IView* view) const;
+        [[nodiscard]] const std::vector<MeshInstance*>& GetVisibleInstances(uint32_t viewIndex) const { return m_VisibleInstances[viewIndex]; }
+
+        // Only the subgraphs that contain this content are traversed, and only mesh instances with it are kept.
+        void SetRelevantContent(SceneContentFlags flags) { m_RelevantContent = flags; }
+
+        [[nodiscard]] const Stats& GetStats() const { return m_Stats; }
+    };
+}
@@ -51,6 +51,23 @@ namespace donut::engine
     class TextureCache;
     class DescriptorTableManager;
     class GltfImporter;
+    class InstanceBvh;
+    class SceneCache;
+    struct MeshLodSettings;
+
+    // Writes the elements listed in 'dirtyElements' (sorted) from the 'data' array into 'buffer' using as few
+    // writeBuffer calls as possible. Dirty elements separated by at most 'maxGap' clean elements are merged into
+    // one range. If the merged ranges cover more than 'fullUploadFraction' of the array, the first 'elementCount'
+    // elements are written with a single call instead. Returns the number of bytes written.
+    size_t WriteBufferElementRanges(
+        nvrhi::ICommandList* commandList,
+        nvrhi::IBuffer* buffer,
+        const void* data,
+        size_t elementSize,
+        size_t elementCount,
+        const std::vector<int>& dirtyElements,
+        size_t maxGap,
+        float fullUploadFraction);
     
     class Scene
     {
@@ -61,6 +78,8 @@ namespace donut::engine
         std::shared_ptr<DescriptorTableManager> m_DescriptorTable;
         std::shared_ptr<SceneGraph> m_SceneGraph;
         std::shared_ptr<GltfImporter> m_GltfImporter;
+        std::shared_ptr<InstanceBvh> m_InstanceBvh;
+        tf::Executor* m_RefreshExecutor = nullptr;
         std::vector<SceneImportResult> m_Models;
         bool m_EnableBindlessResources = false;
         
@@ -76,6 +95,9 @@ namespace donut::engine
         bool m_RayTracingSupported = false;
         bool m_SceneTransformsChanged = false;
         bool m_SceneStructureChanged = false;
+        float m_InstanceUploadThreshold = 0.5f;
+        size_t m_InstanceBufferBytesUploaded = 0;
+        std::vector<int> m_UpdatedInstanceIndices; // Sorted, accumulated by RefreshSceneGraph until RefreshBuffers
 
         struct Resources; // Hide the implementation to avoid including <material_cb.h> and <bindless.h> here
         std::shared_ptr<Resources> m_Resources;
@@ -144,5 +166,28 @@ namespace donut::engine
         [[nodiscard]] nvrhi::IBuffer* GetMaterialBuffer() const { return m_MaterialBuffer; }
         [[nodiscard]] nvrhi::IBuffer* GetGeometryBuffer() const { return m_GeometryBuffer; }
         [[nodiscard]] nvrhi::IBuffer* GetInstanceBuffer() const { return m_InstanceBuffer; }
+
+        // Number of bytes written into the instance buffer by the last RefreshBuffers call.
+        [[nodiscard]] size_t GetInstanceBufferBytesUploaded() const { return m_InstanceBufferBytesUploaded; }
+
+        // When transform updates touch more than this fraction of all instances, the whole instance buffer is uploaded at once.
+        void SetInstanceUploadThreshold(float fraction) { m_InstanceUploadThreshold = fraction; }
+
+        // Enables maintaining a BVH over the mesh instance bounds in RefreshSceneGraph, for culling.
+        void SetInstanceBvhEnabled(bool enable);
+        [[nodiscard]] std::shared_ptr<InstanceBvh> GetInstanceBvh() const { return m_InstanceBvh; }
+
+        // RefreshSceneGraph processes large scene graphs on this executor, see SceneGraph::Refresh.
+        // The executor is not owned by the scene and must stay alive while it is set.
+        void SetRefreshExecutor(tf::Executor* executor);
+
+        // Loads the glTF models through the scene cache, see GltfImporter::SetSceneCache. Call before Load.
+        void SetSceneCache(std::shared_ptr<SceneCache> sceneCache);
+
+        // Optimizes the vertex and index order of the glTF models, see GltfImporter::SetMeshOptimizationEnabled. Call before Load.
+        void SetMeshOptimizationEnabled(bool enable);
+
+        // Generates levels of detail for the glTF models, see GltfImporter::SetMeshLodSettings. Call before Load.
+        void SetMeshLodSettings(const MeshLodSettings& settings);
     };
 }
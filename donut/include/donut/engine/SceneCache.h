@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace donut::vfs
+{
+    class IBlob;
+    class IFileSystem;
+}
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace donut::engine
+{
+    struct LoadedTexture;
+    struct Material;
+    struct MeshInfo;
+    struct SceneImportResult;
+    class SceneGraphNode;
+    class SceneTypeFactory;
+    class TextureCache;
+
+    // How a texture referenced by a cached model is requested from the TextureCache again.
+    struct SceneCacheTexture
+    {
+        std::shared_ptr<LoadedTexture> texture;
+        std::string path;            // file path, or the name of an embedded image
+        std::string mimeType;        // embedded images only
+        uint32_t sourceFileIndex = ~0u; // embedded images only: the source file that contains the image data
+        uint64_t dataOffset = 0;
+        uint64_t dataSize = 0;
+        bool sRGB = false;
+    };
+
+    // Everything GltfImporter produces for a model, in the form the cache stores it.
+    struct SceneCacheContents
+    {
+        // The files that the model was imported from, in the order they were read, with their contents.
+        // The cache is keyed by a hash of these contents.
+        std::vector<std::string> sourceFiles;
+        std::vector<std::shared_ptr<vfs::IBlob>> sourceBlobs;
+
+        // Importer settings that change the imported data; an entry is only used with the same settings.
+        uint32_t importOptions = 0;
+
+        std::vector<SceneCacheTexture> textures;
+        std::vector<std::shared_ptr<Material>> materials;
+        std::vector<std::shared_ptr<MeshInfo>> meshes; // all meshes use the same BufferGroup
+        std::shared_ptr<SceneGraphNode> rootNode;
+    };
+
+    /*
+    A versioned binary cache of imported models, so that startup can skip glTF parsing, attribute conversion and
+    tangent generation. Each model is stored in a ChunkFile with the vertex and index arrays in separate chunks,
+    and the materials, meshes, node hierarchy, skins and animations in a description chunk.
+
+    A cache entry is valid while the contents of all its source files hash to the same value, so a hit still reads
+    the glTF file and its buffers, but doesn't parse or convert them. Cache files are read through the VFS;
+    large files are memory mapped by NativeFileSystem and the vertex arrays are copied into the BufferGroup
+    straight from the mapping.
+    */
+    class SceneCache
+    {
+    private:
+        std::shared_ptr<vfs::IFileSystem> m_fs;
+        std::filesystem::path m_CacheDirectory;
+        std::atomic<uint32_t> m_Hits = 0;
+        std::atomic<uint32_t> m_Misses = 0;
+
+    public:
+        SceneCache(std::shared_ptr<vfs::IFileSystem> fs, const std::filesystem::path& cacheDirectory);
+
+        // A 64-bit hash of the contents of the blobs, in order
+        [[nodiscard]] static uint64_t HashSourceFiles(const std::vector<std::shared_ptr<vfs::IBlob>>& blobs);
+
+        // A 64-bit hash of the normalized file name, so that files with the same name in different directories differ
+        [[nodiscard]] static uint64_t HashFileName(const std::filesystem::path& fileName);
+
+        [[nodiscard]] std::filesystem::path GetCacheFileName(const std::filesystem::path& modelFileName) const;
+
+        // Writes the cache file for the model. Returns false if the contents can't be cached or the file can't be written.
+        bool Save(const std::filesystem::path& modelFileName, const SceneCacheContents& contents) const;
+
+        // Recreates the model from its cache file if the file exists, has the current version and import options,
+        // and the source files read through 'sourceFs' still have the same contents. Textures are requested from
+        // the texture cache like GltfImporter does, asynchronously if an executor is provided.
+        bool Load(
+            const std::filesystem::path& modelFileName,
+            vfs::IFileSystem& sourceFs,
+            uint32_t importOptions,
+            const std::shared_ptr<SceneTypeFactory>& sceneTypeFactory,
+            TextureCache& textureCache,
+            tf::Executor* executor,
+            SceneImportResult& result);
+
+        [[nodiscard]] uint32_t GetHitCount() const { return m_Hits; }
+        [[nodiscard]] uint32_t GetMissCount() const { return m_Misses; }
+    };
+}
@@ -31,6 +31,11 @@
 #include <functional>
 #include <filesystem>
 
+namespace tf
+{
+    class Executor;
+}
+
 namespace donut::engine
 {
     class SceneGraph;
@@ -48,18 +53,51 @@ namespace donut::engine
         Animations = 0x20
     };
 
+    // Identifies the leaf classes that the scene graph and the renderers handle specially,
+    // so that they can be told apart without RTTI. Leaves derived from these classes keep the tag of their base.
+    enum struct SceneGraphLeafKind : uint8_t
+    {
+        Other,
+        MeshInstance,
+        SkinnedMeshInstance,
+        SkinnedMeshReference,
+        Camera,
+        Light,
+        Animation
+    };
+
+    class MeshInstance;
+    class SkinnedMeshInstance;
+    class SkinnedMeshReference;
+    class SceneCamera;
+    class Light;
+    class SceneGraphAnimation;
+
     class SceneGraphLeaf
     {
     private:
         friend class SceneGraphNode;
         std::weak_ptr<SceneGraphNode> m_Node;
+        SceneGraphLeafKind m_LeafKind = SceneGraphLeafKind::Other;
 
     protected:
         SceneGraphLeaf() = default;
+        explicit SceneGraphLeaf(SceneGraphLeafKind kind) : m_LeafKind(kind) { }
 
     public:
         virtual ~SceneGraphLeaf() = default;
 
+        [[nodiscard]] SceneGraphLeafKind GetLeafKind() const { return m_LeafKind; }
+
+        // Replacements for dynamic_cast to the tagged leaf classes, return nullptr if the leaf is of another kind.
+        // AsMeshInstance also returns skinned mesh instances.
+        [[nodiscard]] MeshInstance* AsMeshInstance();
+        [[nodiscard]] SkinnedMeshInstance* AsSkinnedMeshInstance();
+        [[nodiscard]] SkinnedMeshReference* AsSkinnedMeshReference();
+        [[nodiscard]] SceneCamera* AsCamera();
+        [[nodiscard]] Light* AsLight();
+        [[nodiscard]] SceneGraphAnimation* AsAnimation();
+
         [[nodiscard]] SceneGraphNode* GetNode() const { return m_Node.lock().get(); }
         [[nodiscard]] std::shared_ptr<SceneGraphNode> GetNodeSharedPtr() const { return m_Node.lock(); }
         [[nodiscard]] virtual dm::box3 GetLocalBoundingBox() { return dm::box3::empty(); }
@@ -87,9 +125,14 @@ namespace donut::engine
     protected:
         std::shared_ptr<MeshInfo> m_Mesh;
 
+        MeshInstance(std::shared_ptr<MeshInfo> mesh, SceneGraphLeafKind kind)
+            : SceneGraphLeaf(kind)
+            , m_Mesh(std::move(mesh))
+        { }
+
     public:
         explicit MeshInstance(std::shared_ptr<MeshInfo> mesh)
-            : m_Mesh(std::move(mesh))
+            : MeshInstance(std::move(mesh), SceneGraphLeafKind::MeshInstance)
         { }
 
         [[nodiscard]] const std::shared_ptr<MeshInfo>& GetMesh() const { return m_Mesh; }
@@ -137,13 +180,18 @@ namespace donut::engine
         friend class SceneGraph;
         std::weak_ptr<SkinnedMeshInstance> m_Instance;
     public:
-        explicit SkinnedMeshReference(std::shared_ptr<SkinnedMeshInstance> instance) : m_Instance(instance) { }
+        explicit SkinnedMeshReference(std::shared_ptr<SkinnedMeshInstance> instance)
+            : SceneGraphLeaf(SceneGraphLeafKind::SkinnedMeshReference)
+            , m_Instance(instance)
+        { }
         [[nodiscard]] std::shared_ptr<SceneGraphLeaf> Clone() override;
     };
 
     class SceneCamera : public SceneGraphLeaf
     {
     public:
+        SceneCamera() : SceneGraphLeaf(SceneGraphLeafKind::Camera) { }
+
         [[nodiscard]] SceneContentFlags GetContentFlags() const override { return SceneContentFlags::Cameras; }
 
         [[nodiscard]] dm::affine3 GetViewToWorldMatrix() const;
@@ -185,6 +233,8 @@ namespace donut::engine
         int shadowChannel = -1;
         dm::float3 color = dm::colors::white;
 
+        Light() : SceneGraphLeaf(SceneGraphLeafKind::Light) { }
+
         [[nodiscard]] SceneContentFlags GetContentFlags() const override { return SceneContentFlags::Lights; }
 
         [[nodiscard]] virtual int GetLightType() const = 0;
@@ -246,6 +296,42 @@ namespace donut::engine
         bool SetProperty(const std::string& name, const dm::float4& value) override;
     };
     
+    // Compact copy of the scene graph transform hierarchy, stored in depth-first order.
+    // When enabled on a SceneGraph, Refresh propagates transforms and bounding boxes by iterating these arrays
+    // instead of walking the linked nodes, and the nodes read their global transforms and bounds from here.
+    struct FlatTransformHierarchy
+    {
+        enum StateBits : uint8_t
+        {
+            LocalTransformDirty = 0x01, // the node's own transform was changed
+            SubtreeDirty        = 0x02, // this node or some of its descendants need processing
+            TransformUpdated    = 0x04, // the global transform was updated on the current frame
+            PrevTransformDirty  = 0x08, // the global transform was updated on the previous frame
+            HasLocalTransform   = 0x10,
+            SkinnedMeshJoint    = 0x20,
+            PrevLocalTransformDirty = 0x40, // the local transform was updated on the previous frame
+            LeafDirty           = 0x80  // the leaf was invalidated, its local bounding box needs to be read again
+        };
+
+        std::vector<SceneGraphNode*> nodes;
+        std::vector<MeshInstance*> meshInstances; // nullptr for nodes that do not have a mesh instance leaf
+        std::vector<int> parents; // -1 for the root
+        std::vector<uint32_t> subtreeEnds; // index of the first node after the subtree
+        std::vector<uint8_t> states;
+        std::vector<dm::daffine3> localTransforms;
+        std::vector<dm::daffine3> globalTransforms;
+        std::vector<dm::affine3> globalTransformsFloat;
+        std::vector<dm::daffine3> prevGlobalTransforms;
+        std::vector<dm::affine3> prevGlobalTransformsFloat;
+        std::vector<dm::box3> localBoundingBoxes;
+        std::vector<dm::box3> globalBoundingBoxes;
+
+        [[nodiscard]] size_t size() const { return nodes.size(); }
+        void Clear();
+        void Reserve(size_t count);
+        void MarkDirty(uint32_t index, StateBits bits = LocalTransformDirty);
+    };
+
     class SceneGraphNode final : public std::enable_shared_from_this<SceneGraphNode>
     {
     public:
@@ -285,8 +371,11 @@ namespace donut::engine
         DirtyFlags m_Dirty = DirtyFlags::None;
         SceneContentFlags m_LeafContent = SceneContentFlags::None;
         SceneContentFlags m_SubgraphContent = SceneContentFlags::None;
+        FlatTransformHierarchy* m_Flat = nullptr;
+        uint32_t m_FlatIndex = 0;
 
         void UpdateLocalTransform();
+        void ReleaseFlatHierarchy();
         void PropagateDirtyFlags(SceneGraphNode::DirtyFlags flags);
 
     public:
@@ -298,12 +387,12 @@ namespace donut::engine
         [[nodiscard]] const dm::double3& GetTranslation() const { return m_Translation; }
 
         [[nodiscard]] const dm::daffine3& GetLocalToParentTransform() const { return m_LocalTransform; }
-        [[nodiscard]] const dm::daffine3& GetLocalToWorldTransform() const { return m_GlobalTransform; }
-        [[nodiscard]] const dm::affine3& GetLocalToWorldTransformFloat() const { return m_GlobalTransformFloat; }
+        [[nodiscard]] const dm::daffine3& GetLocalToWorldTransform() const { return m_Flat ? m_Flat->globalTransforms[m_FlatIndex] : m_GlobalTransform; }
+        [[nodiscard]] const dm::affine3& GetLocalToWorldTransformFloat() const { return m_Flat ? m_Flat->globalTransformsFloat[m_FlatIndex] : m_GlobalTransformFloat; }
         [[nodiscard]] const dm::daffine3& GetPrevLocalToParentTransform() const { return m_PrevLocalTransform; }
-        [[nodiscard]] const dm::daffine3& GetPrevLocalToWorldTransform() const { return m_PrevGlobalTransform; }
-        [[nodiscard]] const dm::affine3& GetPrevLocalToWorldTransformFloat() const { return m_PrevGlobalTransformFloat; }
-        [[nodiscard]] const dm::box3& GetGlobalBoundingBox() const { return m_GlobalBoundingBox; }
+        [[nodiscard]] const dm::daffine3& GetPrevLocalToWorldTransform() const { return m_Flat ? m_Flat->prevGlobalTransforms[m_FlatIndex] : m_PrevGlobalTransform; }
+        [[nodiscard]] const dm::affine3& GetPrevLocalToWorldTransformFloat() const { return m_Flat ? m_Flat->prevGlobalTransformsFloat[m_FlatIndex] : m_PrevGlobalTransformFloat; }
+        [[nodiscard]] const dm::box3& GetGlobalBoundingBox() const { return m_Flat ? m_Flat->globalBoundingBoxes[m_FlatIndex] : m_GlobalBoundingBox; }
         [[nodiscard]] DirtyFlags GetDirtyFlags() const { return m_Dirty; }
         [[nodiscard]] SceneContentFlags GetLeafContentFlags() const { return m_LeafContent; }
         [[nodiscard]] SceneContentFlags GetSubgraphContentFlags() const { return m_SubgraphContent; }
@@ -318,6 +407,7 @@ namespace donut::engine
 
         [[nodiscard]] std::filesystem::path GetPath() const;
 
+        // Call when the leaf's content flags or local bounding box change.
         void InvalidateContent();
 
         void SetTransform(const dm::double3* translation, const dm::dquat* rotation, const dm::double3* scaling);
@@ -438,7 +528,7 @@ namespace donut::engine
         float m_Duration = 0.f;
 
     public:
-        SceneGraphAnimation() = default;
+        SceneGraphAnimation() : SceneGraphLeaf(SceneGraphLeafKind::Animation) { }
 
         [[nodiscard]] std::shared_ptr<SceneGraphLeaf> Clone() override;
         [[nodiscard]] SceneContentFlags GetContentFlags() const override { return SceneContentFlags::Animations; }
@@ -449,6 +539,37 @@ namespace donut::engine
         void AddChannel(const std::shared_ptr<SceneGraphAnimationChannel>& channel);
     };
 
+    inline MeshInstance* SceneGraphLeaf::AsMeshInstance()
+    {
+        return (m_LeafKind == SceneGraphLeafKind::MeshInstance || m_LeafKind == SceneGraphLeafKind::SkinnedMeshInstance)
+            ? static_cast<MeshInstance*>(this) : nullptr;
+    }
+
+    inline SkinnedMeshInstance* SceneGraphLeaf::AsSkinnedMeshInstance()
+    {
+        return (m_LeafKind == SceneGraphLeafKind::SkinnedMeshInstance) ? static_cast<SkinnedMeshInstance*>(this) : nullptr;
+    }
+
+    inline SkinnedMeshReference* SceneGraphLeaf::AsSkinnedMeshReference()
+    {
+        return (m_LeafKind == SceneGraphLeafKind::SkinnedMeshReference) ? static_cast<SkinnedMeshReference*>(this) : nullptr;
+    }
+
+    inline SceneCamera* SceneGraphLeaf::AsCamera()
+    {
+        return (m_LeafKind == SceneGraphLeafKind::Camera) ? static_cast<SceneCamera*>(this) : nullptr;
+    }
+
+    inline Light* SceneGraphLeaf::AsLight()
+    {
+        return (m_LeafKind == SceneGraphLeafKind::Light) ? static_cast<Light*>(this) : nullptr;
+    }
+
+    inline SceneGraphAnimation* SceneGraphLeaf::AsAnimation()
+    {
+        return (m_LeafKind == SceneGraphLeafKind::Animation) ? static_cast<SceneGraphAnimation*>(this) : nullptr;
+    }
+
     // A container that tracks unique resources of the same type used by some entity, for example unique meshes used in a scene graph.
     // It works by putting the resource shared pointers into a map and associating a reference count with each resource.
     // When the resource is added and released an equal number of times, its refrence count reaches zero, and it's removed from the container.
@@ -531,6 +652,37 @@ namespace donut::engine
         std::vector<std::shared_ptr<SceneGraphAnimation>> m_Animations;
         std::vector<std::shared_ptr<SceneCamera>> m_Cameras;
         std::vector<std::shared_ptr<Light>> m_Lights;
+        std::vector<int> m_UpdatedMeshInstanceIndices;
+        FlatTransformHierarchy m_FlatHierarchy;
+        std::vector<uint32_t> m_FlatVisitedNodes;
+        bool m_FlatHierarchyEnabled = false;
+        bool m_FlatHierarchyValid = false;
+        size_t m_ParallelRefreshThreshold = 4096;
+
+        struct RefreshContext
+        {
+            bool supergraphTransformUpdated = false;
+            bool supergraphContentUpdate = false;
+        };
+
+        struct RefreshOutput
+        {
+            std::vector<MeshInstance*> transformedMeshInstances;
+            std::vector<SkinnedMeshInstance*> updatedSkinnedMeshInstances;
+        };
+
+        RefreshOutput m_RefreshOutput;
+        std::vector<RefreshOutput> m_RefreshTaskOutputs;
+
+        // Updates one node and returns the context for its children.
+        static RefreshContext RefreshNode(SceneGraphNode* current, const RefreshContext& context, RefreshOutput& output);
+        static void MergeIntoParent(SceneGraphNode* node);
+        // Updates the subgraph, except merging the subgraph root's bounds and flags into its parent.
+        static void RefreshSubgraph(SceneGraphNode* subgraphRoot, RefreshContext context, RefreshOutput& output);
+        void RefreshSubgraphsParallel(tf::Executor& executor);
+        void RefreshFlatHierarchy(bool structureDirty);
+        void BuildFlatHierarchy();
+        void ReleaseFlatHierarchy();
         
     protected:
         virtual void RegisterLeaf(const std::shared_ptr<SceneGraphLeaf>& leaf);
@@ -538,7 +690,7 @@ namespace donut::engine
 
     public:
         SceneGraph() = default;
-        virtual ~SceneGraph() = default;
+        virtual ~SceneGraph();
 
         SceneResourceCallback<MeshInfo> OnMeshAdded;
         SceneResourceCallback<MeshInfo> OnMeshRemoved;
@@ -555,6 +707,9 @@ namespace donut::engine
         [[nodiscard]] const std::vector<std::shared_ptr<SceneGraphAnimation>>& GetAnimations() const { return m_Animations; }
         [[nodiscard]] const std::vector<std::shared_ptr<SceneCamera>>& GetCameras() const { return m_Cameras; }
         [[nodiscard]] const std::vector<std::shared_ptr<Light>>& GetLights() const { return m_Lights; }
+        // Sorted indices of the mesh instances whose current or previous transforms were changed by the last Refresh call.
+        // When the graph structure changes, instance indices are reassigned and all instances should be treated as updated.
+        [[nodiscard]] const std::vector<int>& GetUpdatedMeshInstanceIndices() const { return m_UpdatedMeshInstanceIndices; }
         [[nodiscard]] bool HasPendingStructureChanges() const { return m_Root && (m_Root->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphStructure) != 0; }
         [[nodiscard]] bool HasPendingTransformChanges() const { return m_Root && (m_Root->m_Dirty & (SceneGraphNode::DirtyFlags::SubgraphTransforms | SceneGraphNode::DirtyFlags::SubgraphPrevTransforms)) != 0; }
 
@@ -564,8 +719,19 @@ namespace donut::engine
         std::shared_ptr<SceneGraphNode> Detach(const std::shared_ptr<SceneGraphNode>& node);
 
         [[nodiscard]] std::shared_ptr<SceneGraphNode> FindNode(const std::filesystem::path& path, SceneGraphNode* context = nullptr) const;
+
+        // Switches the graph between walking the linked nodes on Refresh (default) and storing the transform
+        // hierarchy in flat arrays, see FlatTransformHierarchy. The arrays are rebuilt when the structure changes.
+        void SetFlatHierarchyEnabled(bool enable);
+        [[nodiscard]] bool IsFlatHierarchyEnabled() const { return m_FlatHierarchyEnabled; }
         
+        // When Refresh is called with an executor and the graph has at least this many mesh instances,
+        // the subgraphs under the first node with multiple children are processed in parallel.
+        void SetParallelRefreshThreshold(size_t meshInstanceCount) { m_ParallelRefreshThreshold = meshInstanceCount; }
+
         void Refresh(uint32_t frameIndex);
+        // The results are identical to the serial Refresh. The executor is only used by the walker, not the flat hierarchy.
+        void Refresh(uint32_t frameIndex, tf::Executor* executor);
     };
 
     struct SceneImportResult
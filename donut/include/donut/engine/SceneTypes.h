@@ -158,6 +158,22 @@ namespace donut::engine
         uint32_t numVertexBuffers;
     };
 
+    // A small cluster of triangles with its own list of vertices, for mesh shaders and cluster culling.
+    // See Meshlets.h for how they are built and culled.
+    struct Meshlet
+    {
+        uint32_t vertexOffset = 0;   // first entry in BufferGroup::meshletVertexData
+        uint32_t vertexCount = 0;
+        uint32_t triangleOffset = 0; // first entry in BufferGroup::meshletTriangleData, 3 entries per triangle
+        uint32_t triangleCount = 0;
+        dm::float3 boundsCenter = 0.f;
+        float boundsRadius = 0.f;
+        dm::float3 coneApex = 0.f;
+        float coneCutoff = 0.f;      // sine of the cone half-angle, or more than 1 when the meshlet can't be cone culled
+        dm::float3 coneAxis = 0.f;
+        uint32_t padding = 0;
+    };
+
     struct BufferGroup
     {
         nvrhi::BufferHandle indexBuffer;
@@ -175,12 +191,22 @@ namespace donut::engine
         std::vector<uint32_t> tangentData;
         std::vector<dm::vector<uint16_t, 4>> jointData;
         std::vector<dm::float4> weightData;
+        std::vector<Meshlet> meshletData;
+        std::vector<uint32_t> meshletVertexData;  // vertex indices relative to the first vertex of the geometry
+        std::vector<uint8_t> meshletTriangleData; // indices into the vertex list of the meshlet
 
         [[nodiscard]] bool hasAttribute(VertexAttribute attr) const { return vertexBufferRanges[int(attr)].byteSize != 0; }
         nvrhi::BufferRange& getVertexBufferRange(VertexAttribute attr) { return vertexBufferRanges[int(attr)]; }
         [[nodiscard]] const nvrhi::BufferRange& getVertexBufferRange(VertexAttribute attr) const { return vertexBufferRanges[int(attr)]; }
     };
 
+    // An index range of a simplified version of a geometry, see MeshLods.h
+    struct MeshGeometryLod
+    {
+        uint32_t indexOffsetInMesh = 0;
+        uint32_t numIndices = 0;
+    };
+
     struct MeshGeometry
     {
         std::shared_ptr<Material> material;
@@ -189,8 +215,22 @@ namespace donut::engine
         uint32_t vertexOffsetInMesh = 0;
         uint32_t numIndices = 0;
         uint32_t numVertices = 0;
+        uint32_t meshletOffset = 0; // first meshlet in BufferGroup::meshletData
+        uint32_t numMeshlets = 0;
         int globalGeometryIndex = 0;
 
+        // Levels of detail 1 and coarser, which use the vertices of the geometry. AddMeshLods appends their
+        // indices to the end of BufferGroup::indexData, so they lie outside the mesh's totalIndices range.
+        std::vector<MeshGeometryLod> lods;
+
+        // The index range of a level of detail, where 0 is the full detail geometry; clamps to the coarsest level
+        [[nodiscard]] MeshGeometryLod GetLod(uint32_t lod) const
+        {
+            if (lod == 0 || lods.empty())
+                return MeshGeometryLod{ indexOffsetInMesh, numIndices };
+            return lods[std::min(size_t(lod), lods.size()) - 1];
+        }
+
         virtual ~MeshGeometry() = default;
     };
 
@@ -203,9 +243,10 @@ namespace donut::engine
         dm::box3 objectSpaceBounds;
         uint32_t indexOffset = 0;
         uint32_t vertexOffset = 0;
-        uint32_t totalIndices = 0;
+        uint32_t totalIndices = 0; // full detail geometries only, see MeshGeometry::lods
         uint32_t totalVertices = 0;
         int globalMeshIndex = 0;
+        std::vector<float> lodErrors; // object space error of levels of detail 1 and coarser
         nvrhi::rt::AccelStructHandle accelStruct; // for use by applications
 
         virtual ~MeshInfo() = default;
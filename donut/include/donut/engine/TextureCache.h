@@ -23,14 +23,17 @@
 #pragma once
 
 #include <donut/engine/SceneTypes.h>
+#include <donut/engine/TextureMips.h>
 #include <donut/core/log.h>
 
 #include <nvrhi/nvrhi.h>
 #include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <unordered_map>
 #include <memory>
 #include <shared_mutex>
+#include <deque>
 #include <queue>
 
 #ifdef DONUT_WITH_TASKFLOW
@@ -43,6 +46,7 @@ namespace tf
 namespace donut::vfs
 {
     class IBlob;
+    class AsyncReadRequest;
     class IFileSystem;
 }
 
@@ -76,9 +80,101 @@ namespace donut::engine
         std::vector<std::vector<TextureSubresourceData>> dataLayout;
     };
 
+    // What the last call to TextureCache::ProcessRenderingThreadCommands did
+    struct TextureUploadStats
+    {
+        uint32_t textures = 0;    // textures finalized
+        uint64_t bytes = 0;       // texture data uploaded
+        uint32_t submissions = 0; // command lists executed
+    };
+
+    struct TextureStreamingSettings
+    {
+        // The GPU memory for all streamed textures, including the mips that are always resident
+        uint64_t budgetBytes = 512ull * 1024 * 1024;
+
+        // Mips of this size and smaller are uploaded with the texture and never evicted
+        uint32_t minResidentSize = 64;
+
+        // Limits the texture data uploaded by one UpdateStreaming call, 0 for no limit
+        uint64_t maxUploadBytesPerUpdate = 32ull * 1024 * 1024;
+
+        // Added to the mip levels computed from the reported screen sizes;
+        // negative values keep finer mips, e.g. for texture coordinates that repeat over an object
+        float mipBias = 0.f;
+
+        // The number of UpdateStreaming calls after which the GPU no longer uses a texture replaced in a call,
+        // at least the number of frames that the application renders ahead of the GPU
+        uint32_t framesInFlight = 3;
+    };
+
+    struct TextureStreamingStats
+    {
+        uint32_t streamedTextures = 0;
+        uint64_t residentBytes = 0;    // all resident mips of the streamed textures
+
+        // in the last UpdateStreaming call
+        uint32_t texturesUpgraded = 0;
+        uint32_t texturesEvicted = 0;
+        uint64_t bytesUploaded = 0;
+    };
+
+    struct TextureCompressionSettings
+    {
+        // RGBA textures loaded with sRGB = true, usually base color and emissive maps, use BC1, or BC3 when they
+        // aren't opaque. BC7 has fewer artifacts than BC3 at the same size, but takes longer to encode.
+        bool useBC7ForColor = false;
+
+        // RGBA textures loaded with sRGB = false, usually normal and metal-roughness maps, where the BC1 color
+        // quantization that ties the channels together shows more. One- and two-channel textures use BC4 and BC5.
+        bool useBC7ForData = true;
+    };
+
+    struct ProcessedTextureCacheStats
+    {
+        uint32_t hits = 0;            // textures loaded from the cache
+        uint32_t misses = 0;          // textures decoded and processed, and written to the cache
+
+        // The time spent on the misses, summed over the loading threads, so it can exceed the wall time of a load
+        double processingThreadSeconds = 0;
+    };
+
     class TextureCache
     {
     protected:
+        struct StreamedTexture
+        {
+            std::shared_ptr<TextureData> texture;
+            std::vector<uint64_t> mipChainSizes; // [mip] = size of the mips from 'mip' to the last one, in all array slices
+            uint32_t residentMip = 0;  // the finest mip level on the GPU
+            uint32_t tailMip = 0;      // the finest mip level that is always resident
+            uint32_t requestedMip = 0; // the finest mip level reported since the last update
+            uint64_t lastUseFrame = 0;
+            uint64_t replacedFrame = 0;
+        };
+
+        // A texture and descriptor replaced by a resident mip change, which frames in flight may still read
+        struct RetiredTexture
+        {
+            nvrhi::TextureHandle texture;
+            DescriptorHandle bindlessDescriptor;
+            uint64_t frame = 0;
+        };
+
+        // The location of a texture in the processed texture cache and the record of its source from an earlier load
+        struct ProcessedTextureEntry
+        {
+            std::filesystem::path ddsPath; // empty if the cache is disabled
+            std::filesystem::path recordPath;
+            uint64_t sourceSize = 0;
+            int64_t sourceModificationTime = 0; // 0 if unknown, e.g. for textures loaded from memory
+
+            bool hasRecord = false;
+            uint64_t recordedSize = 0;
+            int64_t recordedModificationTime = 0;
+            uint64_t recordedHash = 0;
+        };
+
         nvrhi::DeviceHandle m_Device;
         nvrhi::CommandListHandle m_CommandList;
         std::unordered_map<std::string, std::shared_ptr<TextureData>> m_LoadedTextures;
@@ -93,6 +189,8 @@ namespace donut::engine
         uint32_t m_MaxTextureSize = 0;
 
         bool m_GenerateMipmaps = true;
+        bool m_CpuMipGeneration = false;
+        MipFilter m_CpuMipFilter = MipFilter::Kaiser;
 
         log::Severity m_InfoLogSeverity = log::Severity::Info;
         log::Severity m_ErrorLogSeverity = log::Severity::Warning;
@@ -101,10 +199,40 @@ namespace donut::engine
         std::atomic<uint32_t> m_TexturesLoaded = 0;
         uint32_t m_TexturesFinalized = 0;
 
+        size_t m_UploadBudgetBytes = 32 * 1024 * 1024;
+        TextureUploadStats m_LastUploadStats;
+
+        bool m_StreamingEnabled = false;
+        TextureStreamingSettings m_StreamingSettings;
+        TextureStreamingStats m_StreamingStats;
+        std::vector<StreamedTexture> m_StreamedTextures;
+        std::unordered_map<const LoadedTexture*, size_t> m_StreamedTextureIndices;
+        std::deque<RetiredTexture> m_RetiredTextures;
+        uint64_t m_StreamingFrame = 1;
+
+        bool m_CompressionEnabled = false;
+        TextureCompressionSettings m_CompressionSettings;
+
+        std::filesystem::path m_ProcessedTextureCacheFolder;
+        mutable std::atomic<uint32_t> m_ProcessedTextureHits = 0;
+        mutable std::atomic<uint32_t> m_ProcessedTextureMisses = 0;
+        mutable std::atomic<uint64_t> m_ProcessingMicroseconds = 0;
+
         bool FindTextureInCache(const std::filesystem::path& path, std::shared_ptr<TextureData>& texture);
         std::shared_ptr<vfs::IBlob> ReadTextureFile(const std::filesystem::path& path) const;
-        bool FillTextureData(const std::shared_ptr<vfs::IBlob>& fileData, const std::shared_ptr<TextureData>& texture, const std::string& extension, const std::string& mimeType) const;
+        std::shared_ptr<vfs::AsyncReadRequest> ReadTextureFileAsync(const std::filesystem::path& path) const;
+        bool ReadAndFillTextureData(const std::filesystem::path& path, const std::shared_ptr<TextureData>& texture) const;
+        bool FillTextureData(const std::shared_ptr<vfs::IBlob>& fileData, const std::shared_ptr<TextureData>& texture, const std::string& extension, const std::string& mimeType, ProcessedTextureEntry* processedEntry = nullptr) const;
         void FinalizeTexture(std::shared_ptr<TextureData> texture, CommonRenderPasses* passes, nvrhi::ICommandList* commandList);
+        bool FinalizeStreamedTexture(const std::shared_ptr<TextureData>& texture, bool isBlockCompressed, nvrhi::ICommandList* commandList);
+        void SetResidentMip(StreamedTexture& streamed, uint32_t mipLevel, nvrhi::ICommandList* commandList);
+        void RemoveStreamedTexture(const LoadedTexture* texture);
+        void CompressTexture(TextureData& texture) const;
+        void ReadProcessedTextureRecord(const std::string& name, uint64_t key, bool sRGB, ProcessedTextureEntry& entry) const;
+        bool FindProcessedTexture(const std::filesystem::path& path, bool sRGB, ProcessedTextureEntry& entry) const;
+        bool LoadProcessedTexture(const std::shared_ptr<vfs::IBlob>& ddsData, TextureData& texture) const;
+        void WriteProcessedTextureRecord(const ProcessedTextureEntry& entry, uint64_t sourceHash) const;
+        void SaveProcessedTexture(const TextureData& texture, const ProcessedTextureEntry& entry, uint64_t sourceHash, std::chrono::steady_clock::time_point startTime) const;
         virtual void TextureLoaded(std::shared_ptr<TextureData> texture);
         virtual std::shared_ptr<TextureData> CreateTextureData();
 
@@ -139,7 +267,8 @@ namespace donut::engine
 #endif
 
         // Tells if the texture has been loaded from file successfully and its data is available in the texture object.
-        // After the texture is finalized and uploaded to the GPU, the data is no longer available on the CPU, and this function returns false.
+        // After the texture is finalized and uploaded to the GPU, the data is no longer available on the CPU, and this function returns false,
+        // except for streamed textures, which keep their data.
         bool IsTextureLoaded(const std::shared_ptr<LoadedTexture>& texture);
 
         // Tells if the texture has been uploaded to the GPU
@@ -153,9 +282,59 @@ namespace donut::engine
 
         // Process a portion of the upload queue, taking up to `timeLimitMilliseconds` CPU time.
         // If `timeLimitMilliseconds` is 0, processes the entire queue.
+        // The textures are uploaded in batches of up to the upload budget, with one command list submission per batch.
+        // With a time limit, one batch is processed at most.
         // Returns true if any textures have been processed.
         bool ProcessRenderingThreadCommands(CommonRenderPasses& passes, float timeLimitMilliseconds);
 
+        // Same as above, with mip generation and resizing disabled if `passes` is NULL.
+        bool ProcessRenderingThreadCommands(CommonRenderPasses* passes, float timeLimitMilliseconds);
+
+        // Sets how much texture data ProcessRenderingThreadCommands uploads in one command list, 0 for no limit.
+        // The command list uses upload chunks of this size, so a batch is staged in one buffer that NVRHI
+        // reuses once the GPU is done with it. A texture larger than the budget makes a batch of its own.
+        void SetUploadBudget(size_t bytes);
+        [[nodiscard]] size_t GetUploadBudget() const { return m_UploadBudgetBytes; }
+
+        [[nodiscard]] const TextureUploadStats& GetLastUploadStats() const { return m_LastUploadStats; }
+
+        // Enables texture streaming, or changes its settings. Must be enabled before the textures are finalized.
+        // Textures whose files contain all their mips, such as DDS files, are then created with only the mips up to
+        // the minimum resident size, and keep their data on the CPU. UpdateStreaming makes finer mips resident for
+        // the textures reported with ReportTextureUse, within the memory budget, evicting the mips of the least
+        // recently used textures first. Other textures are uploaded completely and don't count towards the budget.
+        void EnableStreaming(const TextureStreamingSettings& settings);
+        [[nodiscard]] bool IsStreamingEnabled() const { return m_StreamingEnabled; }
+
+        // Requests the mips of a streamed texture needed to draw an object covering 'screenSize' pixels, e.g. the projected
+        // diameter of its bounding sphere, with the texture mapped over it once. Textures that aren't streamed are ignored.
+        // Must be called on the rendering thread.
+        void ReportTextureUse(const LoadedTexture* texture, float screenSize);
+
+        // ReportTextureUse for all textures of the material
+        void ReportMaterialUse(const Material& material, float screenSize);
+
+        // Changes the resident mips of the streamed textures based on the uses reported since the previous call.
+        // Call once per frame on the rendering thread, with an open command list.
+        // Textures whose resident mips change get a new texture object and a new bindless descriptor, while the old ones
+        // are kept for the frames in flight set in the streaming settings. When the returned stats show any upgraded or
+        // evicted textures, the constants of the materials for which MaterialTexturesReplaced returns true must be
+        // refilled, which Scene::RefreshBuffers does, and binding sets that contain the textures directly must be
+        // recreated, e.g. with MaterialBindingCache::Clear.
+        TextureStreamingStats UpdateStreaming(nvrhi::ICommandList* commandList);
+
+        // Returns true if the texture object and bindless descriptor of a streamed texture changed in the last
+        // UpdateStreaming call
+        [[nodiscard]] bool TextureReplaced(const LoadedTexture* texture) const;
+
+        // TextureReplaced for all textures of the material
+        [[nodiscard]] bool MaterialTexturesReplaced(const Material& material) const;
+
+        [[nodiscard]] const TextureStreamingStats& GetStreamingStats() const { return m_StreamingStats; }
+
+        // The finest resident mip level of a streamed texture, 0 for other textures
+        [[nodiscard]] uint32_t GetResidentMip(const LoadedTexture* texture) const;
+
         // Destroys the internal command list in order to release the upload buffers used in it.
         void LoadingFinished();
 
@@ -166,6 +345,36 @@ namespace donut::engine
         // Enables or disables automatic mip generation for loaded textures.
         void SetGenerateMipmaps(bool generateMipmaps);
 
+        // When enabled, textures decoded with stb_image, such as PNG, JPG and HDR files, are downscaled to the max
+        // texture size and get their mip chains on the loading thread, with GenerateTextureMips, instead of on
+        // the GPU when they are finalized. The GPU then only receives the final data, which can also be streamed.
+        void SetCpuMipGeneration(bool enable, MipFilter filter = MipFilter::Kaiser);
+        [[nodiscard]] bool IsCpuMipGenerationEnabled() const { return m_CpuMipGeneration; }
+
+        // Enables block compression of the textures decoded with stb_image, on the loading threads, after their mips
+        // are generated on the CPU like with SetCpuMipGeneration. The format is chosen by ChooseBlockCompressedFormat,
+        // from the sRGB flag the texture is loaded with and its channels. Textures whose size isn't a multiple of 4
+        // are not compressed. Use it with EnableProcessedTextureCache to compress each texture only once.
+        void EnableTextureCompression(const TextureCompressionSettings& settings);
+        [[nodiscard]] bool IsTextureCompressionEnabled() const { return m_CompressionEnabled; }
+
+        // Stores the textures decoded with stb_image as DDS files in 'folder', an existing folder in the texture cache's
+        // file system, after their mips are generated on the CPU like with SetCpuMipGeneration and they are compressed
+        // if EnableTextureCompression is used. Later loads read the DDS files instead of decoding the sources again.
+        // Files are found by name, and their cache entries are valid while the size and modification time are the same,
+        // or else while the contents hash to the same value. Textures loaded from memory are found by their contents.
+        // Entries depend on the processing settings, which must be set before the textures are loaded.
+        void EnableProcessedTextureCache(const std::filesystem::path& folder);
+        [[nodiscard]] bool IsProcessedTextureCacheEnabled() const { return !m_ProcessedTextureCacheFolder.empty(); }
+        [[nodiscard]] const std::filesystem::path& GetProcessedTextureCacheFolder() const { return m_ProcessedTextureCacheFolder; }
+
+        [[nodiscard]] ProcessedTextureCacheStats GetProcessedTextureCacheStats() const;
+
+        // Keeps the wall time of a scene load that processed all its textures in the processed texture cache folder,
+        // so that later loads using the cache can be compared with it. Read returns 0 when there is no recorded time.
+        void WriteUncachedLoadTime(const std::filesystem::path& sceneFileName, double seconds) const;
+        [[nodiscard]] double ReadUncachedLoadTime(const std::filesystem::path& sceneFileName) const;
+
         // Sets the Severity of log messages about textures being loaded.
         void SetInfoLogSeverity(log::Severity value) { m_InfoLogSeverity = value; }
 
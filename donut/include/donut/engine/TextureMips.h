@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/math/math.h>
+#include <cstdint>
+
+namespace donut::engine
+{
+    struct TextureData;
+
+    enum class MipFilter : uint8_t
+    {
+        // Averages the source pixels covered by every output pixel
+        Box,
+        // Windowed sinc, 3 output pixels wide with a Kaiser window (alpha = 4), sharper than Box
+        Kaiser
+    };
+
+    // Resamples a linear image with 'channels' floats per pixel and tightly packed rows to a smaller size,
+    // with clamped addressing at the edges. The filter weights are computed once per row and column.
+    // The vertical pass, and the horizontal pass of box filtering to half the width, use SSE or AVX2 up to 'level'
+    // when the CPU supports them, with results identical to the scalar code.
+    void ResampleImage(const float* src, uint32_t srcWidth, uint32_t srcHeight,
+        float* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels, MipFilter filter,
+        math::simd_level level = math::simd_level::best);
+
+    // Replaces the single mip level of a decoded 2D texture with a full mip chain computed on the CPU,
+    // down to 1x1, in one new data blob. When 'maxSize' is not 0 and the texture is larger, the first level is
+    // downscaled to fit it first, keeping the aspect ratio. With 'generateMips' false, only the downscaling is done.
+    // Supports the 8-bit UNORM and 32-bit float formats with 1, 2 and 4 channels that the image decoders produce.
+    // Color channels of SRGBA8 textures are filtered in linear space, alpha always is. Every level is computed
+    // from the unquantized previous one. Filter ringing is clamped to [0, 1] for UNORM and to >= 0 for float formats.
+    // Returns false and leaves the texture unchanged when its format or layout is not supported.
+    // The resampling uses SIMD up to 'level', as in ResampleImage.
+    bool GenerateTextureMips(TextureData& texture, MipFilter filter, uint32_t maxSize = 0, bool generateMips = true,
+        math::simd_level level = math::simd_level::best);
+}
@@ -23,12 +23,17 @@
 #pragma once
 
 #include <donut/engine/SceneGraph.h>
+#include <donut/engine/MeshLods.h>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace donut::engine
 {
     class IView;
+    class InstanceBvh;
+    class TextureCache;
+    struct BufferGroup;
 }
 
 namespace donut::render
@@ -42,6 +47,13 @@ namespace donut::render
             const std::shared_ptr<engine::SceneGraphNode>& rootNode,
             const engine::IView& view) = 0;
 
+        // Same as PrepareForView, with the mesh instances visible in the view already found by the caller,
+        // for example with MultiViewCuller. Strategies that don't override it ignore the list and cull the scene themselves.
+        virtual void PrepareForVisibleInstances(
+            const std::shared_ptr<engine::SceneGraphNode>& rootNode,
+            const engine::IView& view,
+            const std::vector<engine::MeshInstance*>& visibleInstances) { PrepareForView(rootNode, view); }
+
         virtual const DrawItem* GetNextItem() = 0;
 
         virtual ~IDrawStrategy() = default;
@@ -67,13 +79,21 @@ namespace donut::render
     {
     private:
         dm::frustum m_ViewFrustum;
+        engine::MeshLodSelector m_LodSelector;
+        float m_LodPixelThreshold = 1.f;
+        std::shared_ptr<engine::TextureCache> m_TextureFeedback;
         engine::SceneGraphWalker m_Walker;
+        std::shared_ptr<engine::InstanceBvh> m_InstanceBvh;
+        std::vector<engine::MeshInstance*> m_VisibleInstances;
+        size_t m_VisibleInstanceReadPtr = 0;
+        bool m_UseVisibleInstances = false;
         std::vector<DrawItem> m_InstanceChunk;
         std::vector<const DrawItem*> m_InstancePtrChunk;
         size_t m_ReadPtr = 0;
         size_t m_ChunkSize = 128;
 
         void FillChunk();
+        void AddInstanceItems(engine::MeshInstance* meshInstance, const dm::affine3& transform, size_t& itemCount);
 
     public:
 
@@ -81,10 +101,84 @@ namespace donut::render
             const std::shared_ptr<engine::SceneGraphNode>& rootNode,
             const engine::IView& view) override;
 
+        void PrepareForVisibleInstances(
+            const std::shared_ptr<engine::SceneGraphNode>& rootNode,
+            const engine::IView& view,
+            const std::vector<engine::MeshInstance*>& visibleInstances) override;
+
         const DrawItem* GetNextItem() override;
 
         [[nodiscard]] size_t GetChunkSize() const { return m_ChunkSize; }
         void SetChunkSize(size_t size) { m_ChunkSize = std::max<size_t>(size, 1u); }
+
+        // When a BVH is set, the visible instances are found with it instead of walking the scene graph.
+        // The BVH covers the whole scene, so the root node passed to PrepareForView is ignored in that case.
+        void SetInstanceBvh(std::shared_ptr<engine::InstanceBvh> bvh) { m_InstanceBvh = std::move(bvh); }
+
+        // Meshes with levels of detail are drawn at the coarsest level whose error covers at most this many pixels,
+        // see MeshLodSelector. 0 always draws the full detail.
+        [[nodiscard]] float GetLodPixelThreshold() const { return m_LodPixelThreshold; }
+        void SetLodPixelThreshold(float pixels) { m_LodPixelThreshold = pixels; }
+
+        // When a texture cache is set, the screen size of every drawn instance is reported for the textures of its
+        // materials, see TextureCache::ReportTextureUse.
+        void SetTextureFeedback(std::shared_ptr<engine::TextureCache> textureCache) { m_TextureFeedback = std::move(textureCache); }
+    };
+
+    // Collects all visible opaque and alpha-tested draw items of the view and sorts them together, instead of
+    // in chunks, by a 64-bit key packed from the material, buffer group, geometry and instance indices.
+    // RenderView then changes the material and buffer state once per group and draws every run of
+    // consecutive instances of a geometry with one instanced draw.
+    // The key uses the indices assigned by SceneGraph::Refresh, so the graph must be refreshed before drawing.
+    class SortedOpaqueDrawStrategy : public IDrawStrategy
+    {
+    private:
+        struct SortEntry
+        {
+            uint64_t key;
+            uint32_t itemIndex;
+        };
+
+        dm::frustum m_ViewFrustum;
+        engine::MeshLodSelector m_LodSelector;
+        float m_LodPixelThreshold = 1.f;
+        std::shared_ptr<engine::TextureCache> m_TextureFeedback;
+        std::vector<DrawItem> m_Items;
+        size_t m_ItemCount = 0;
+        std::vector<SortEntry> m_SortEntries;
+        std::vector<SortEntry> m_SortScratch;
+        std::vector<uint32_t> m_BufferGroupIndices;
+        std::unordered_map<const engine::BufferGroup*, uint32_t> m_BufferGroupIds;
+        std::vector<uint32_t> m_MaterialKeys;
+        std::unordered_map<const engine::Material*, uint32_t> m_UnassignedMaterialIds;
+        std::vector<const DrawItem*> m_SortedItems;
+        size_t m_ReadPtr = 0;
+
+        void Reset(const engine::IView& view);
+        void AddInstanceItems(engine::MeshInstance* meshInstance, const dm::affine3& transform);
+        void SortItems();
+
+    public:
+        void PrepareForView(
+            const std::shared_ptr<engine::SceneGraphNode>& rootNode,
+            const engine::IView& view) override;
+
+        void PrepareForVisibleInstances(
+            const std::shared_ptr<engine::SceneGraphNode>& rootNode,
+            const engine::IView& view,
+            const std::vector<engine::MeshInstance*>& visibleInstances) override;
+
+        const DrawItem* GetNextItem() override;
+
+        // The number of items collected for the current view
+        [[nodiscard]] size_t GetItemCount() const { return m_SortedItems.size(); }
+
+        // See InstancedOpaqueDrawStrategy::SetLodPixelThreshold
+        [[nodiscard]] float GetLodPixelThreshold() const { return m_LodPixelThreshold; }
+        void SetLodPixelThreshold(float pixels) { m_LodPixelThreshold = pixels; }
+
+        // See InstancedOpaqueDrawStrategy::SetTextureFeedback
+        void SetTextureFeedback(std::shared_ptr<engine::TextureCache> textureCache) { m_TextureFeedback = std::move(textureCache); }
     };
 
     class TransparentDrawStrategy : public IDrawStrategy
@@ -96,6 +190,12 @@ namespace donut::render
 
     public:
         bool DrawDoubleSidedMaterialsSeparately = true;
+
+        // See InstancedOpaqueDrawStrategy::SetLodPixelThreshold
+        float LodPixelThreshold = 1.f;
+
+        // See InstancedOpaqueDrawStrategy::SetTextureFeedback
+        std::shared_ptr<engine::TextureCache> TextureFeedback;
         
         void PrepareForView(
             const std::shared_ptr<engine::SceneGraphNode>& rootNode,
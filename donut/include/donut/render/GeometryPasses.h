@@ -34,6 +34,7 @@ namespace donut::engine
     struct Material;
     struct BufferGroup;
     class FramebufferFactory;
+    class MultiViewCuller;
 }
 
 namespace donut::render
@@ -49,6 +50,7 @@ namespace donut::render
         const engine::BufferGroup* buffers;
         float distanceToCamera;
         nvrhi::RasterCullMode cullMode;
+        uint32_t lod = 0; // level of detail of the geometry, see MeshGeometry::GetLod
     };
 
     class GeometryPassContext
@@ -76,6 +78,8 @@ namespace donut::render
         GeometryPassContext& passContext,
         bool materialEvents = false);
 
+    // When a culler is provided, the child views that it has culled use its visibility lists
+    // instead of culling the scene graph again in the draw strategy.
     void RenderCompositeView(
         nvrhi::ICommandList* commandList,
         const engine::ICompositeView* compositeView,
@@ -86,5 +90,6 @@ namespace donut::render
         IGeometryPass& pass,
         GeometryPassContext& passContext,
         const char* passEvent = nullptr,
-        bool materialEvents = false);
+        bool materialEvents = false,
+        const engine::MultiViewCuller* culler = nullptr);
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/engine/View.h>
+#include <nvrhi/nvrhi.h>
+#include <vector>
+
+namespace donut::engine
+{
+    struct Material;
+    struct BufferGroup;
+}
+
+namespace donut::render
+{
+    struct DrawItem;
+    class IDrawStrategy;
+    class IGeometryPass;
+    class GeometryPassContext;
+
+    // Packs draw items into indirect draw arguments, one record per run of consecutive instances of a geometry,
+    // and groups the records into buckets of consecutive items that share the material, buffers and cull mode.
+    // Feed it with a strategy that sorts by material, such as SortedOpaqueDrawStrategy, to get few buckets.
+    // The packing uses no device, so it can run and be tested without a GPU.
+    class IndirectDrawPacker
+    {
+    public:
+        struct Bucket
+        {
+            const engine::Material* material;
+            const engine::BufferGroup* buffers;
+            nvrhi::RasterCullMode cullMode;
+            uint32_t firstDraw;
+            uint32_t drawCount;
+        };
+
+    private:
+        std::vector<nvrhi::DrawIndexedIndirectArguments> m_Arguments;
+        std::vector<Bucket> m_Buckets;
+        nvrhi::BufferHandle m_ArgumentBuffer;
+
+    public:
+        void Clear();
+        void AddItem(const DrawItem& item);
+
+        // Adds all remaining items of a strategy that has been prepared for a view.
+        void AddItems(IDrawStrategy& drawStrategy);
+
+        // Writes the packed arguments into the argument buffer, creating or growing it first if necessary.
+        // The buffer persists between frames.
+        void Upload(nvrhi::ICommandList* commandList);
+
+        // Uses an existing buffer for the arguments, for example one shared between passes.
+        // It must be created with isDrawIndirectArgs; Upload replaces it when it is too small.
+        void SetArgumentBuffer(nvrhi::IBuffer* buffer) { m_ArgumentBuffer = buffer; }
+
+        [[nodiscard]] const std::vector<nvrhi::DrawIndexedIndirectArguments>& GetArguments() const { return m_Arguments; }
+        [[nodiscard]] const std::vector<Bucket>& GetBuckets() const { return m_Buckets; }
+        [[nodiscard]] nvrhi::IBuffer* GetArgumentBuffer() const { return m_ArgumentBuffer; }
+    };
+
+    // Renders the items packed and uploaded by an IndirectDrawPacker with one drawIndexedIndirect call per bucket.
+    // The pass push constants are set once per bucket, from the first record, so passes that need
+    // per-draw push constants (like MaterialIDPass) must use RenderView instead.
+    void RenderViewIndirect(
+        nvrhi::ICommandList* commandList,
+        const engine::IView* view,
+        const engine::IView* viewPrev,
+        nvrhi::IFramebuffer* framebuffer,
+        const IndirectDrawPacker& packer,
+        IGeometryPass& pass,
+        GeometryPassContext& passContext,
+        bool materialEvents = false);
+}
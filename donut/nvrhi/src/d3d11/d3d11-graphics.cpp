@@ -367,6 +367,21 @@ namespace nvrhi::d3d11
         }
     }
 
+    void CommandList::drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount)
+    {
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentIndirectBuffer.Get());
+        
+        if (indirectParams) // validation layer will issue an error otherwise
+        {
+            // D3D11 has no multi-draw, issue the draws one by one
+            for (uint32_t drawIndex = 0; drawIndex < drawCount; drawIndex++)
+            {
+                m_Context.immediateContext->DrawIndexedInstancedIndirect(indirectParams->resource,
+                    offsetBytes + drawIndex * uint32_t(sizeof(DrawIndexedIndirectArguments)));
+            }
+        }
+    }
+
     namespace
     {
         //Unfortunately we can't memcmp the structs since they have padding bytes in them
@@ -704,6 +704,39 @@ namespace nvrhi::validation
         m_CommandList->drawIndirect(offsetBytes);
     }
 
+    void CommandListWrapper::drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "drawIndexedIndirect"))
+            return;
+
+        if (!m_GraphicsStateSet)
+        {
+            error("Graphics state is not set before a drawIndexedIndirect call.\n"
+                "Note that setting compute state invalidates the graphics state.");
+            return;
+        }
+
+        if (m_CurrentGraphicsState.indexBuffer.buffer == nullptr)
+        {
+            error("Index buffer is not set before a drawIndexedIndirect call");
+            return;
+        }
+
+        if (!m_CurrentGraphicsState.indirectParams)
+        {
+            error("Indirect params buffer is not set before a drawIndexedIndirect call.");
+            return;
+        }
+
+        if (!validatePushConstants("graphics", "setGraphicsState"))
+            return;
+
+        m_CommandList->drawIndexedIndirect(offsetBytes, drawCount);
+    }
+
     void CommandListWrapper::setComputeState(const ComputeState& state)
     {
         if (!requireOpenState())
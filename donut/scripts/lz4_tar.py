@@ -34,10 +34,20 @@ parser.add_argument('--output', '-o', required = True, help = "Output file name"
 parser.add_argument('--compress', '-c', default = 0, type = int, help = "LZ4 compression level, 0 = uncompressed")
 parser.add_argument('--prefix', '-p', default = '', help="Path prefix for archive files")
 parser.add_argument('--no-compress', '-n', action = 'append', default = [], help="File types to skip compression for")
+parser.add_argument('--block-size', '-b', default = 1024, type = int, choices = [0, 64, 256, 1024, 4096],
+    help = "LZ4 block size in KB for independent blocks that can be decompressed in parallel, 0 = linked blocks")
 
 
 args = parser.parse_args()
 
+block_sizes = {
+    0: lz4.frame.BLOCKSIZE_DEFAULT,
+    64: lz4.frame.BLOCKSIZE_MAX64KB,
+    256: lz4.frame.BLOCKSIZE_MAX256KB,
+    1024: lz4.frame.BLOCKSIZE_MAX1MB,
+    4096: lz4.frame.BLOCKSIZE_MAX4MB
+}
+
 original_size = 0
 compressed_size = 0
 
@@ -66,7 +76,8 @@ def process_file(path, tar):
     extension = os.path.splitext(path)[1]
 
     if args.compress and (extension not in args.no_compress):
-        contents = lz4.frame.compress(contents, compression_level = args.compress, store_size = True, return_bytearray = True)
+        contents = lz4.frame.compress(contents, compression_level = args.compress, store_size = True, return_bytearray = True,
+            block_size = block_sizes[args.block_size], block_linked = args.block_size == 0, block_checksum = True)
         archive_path += '.lz4'
 
     compressed_size += len(contents)
@@ -89,4 +100,4 @@ with tarfile.open(args.output, mode = 'w', format = tarfile.USTAR_FORMAT) as tar
 
 if args.compress:
     print("Original size: {0:,} bytes, compressed size: {1:,} bytes (ratio = {2:.2f}x)"
-        .format(original_size, compressed_size, float(original_size) / float(compressed_size)))
\ No newline at end of file
+        .format(original_size, compressed_size, float(original_size) / float(compressed_size)))
\ No newline at end of file
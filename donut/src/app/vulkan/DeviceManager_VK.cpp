@@ -736,7 +736,9 @@ bool DeviceManager_VK::createDevice()
         .setTextureCompressionBC(true)
         .setGeometryShader(true)
         .setImageCubeArray(true)
-        .setDualSrcBlend(true);
+        .setDualSrcBlend(true)
+        .setMultiDrawIndirect(true)
+        .setDrawIndirectFirstInstance(true);
 
     auto vulkan12features = vk::PhysicalDeviceVulkan12Features()
         .setDescriptorIndexing(true)
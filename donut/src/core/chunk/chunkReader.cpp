@@ -360,6 +360,8 @@ std::shared_ptr<MeshSetBase> ChunkReader::loadMeshSetChunk_0x100(Chunk const * c
         std::shared_ptr<MeshletSet> set = std::static_pointer_cast<MeshletSet>(mset);
 
         set->meshInfos=nullptr;
+        set->maxVerts = desc.meshletMaxVerts;
+        set->maxPrims = desc.meshletMaxPrims;
 
         handle = {"Indices32", UINT32, VARY_NONE, INDEX, 0, sizeof(uint32_t), nullptr};
         if (loadStreamChunk_0x100(desc.streamChunkIds[Desc::MESHLET_INDICES32], &handle))
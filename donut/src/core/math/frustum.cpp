@@ -21,6 +21,23 @@
 */
 
 #include <donut/core/math/math.h>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DONUT_FRUSTUM_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need the target attribute to compile AVX intrinsics without enabling AVX for the whole file.
+// FMA is deliberately not enabled, so that the results match the scalar code exactly.
+#if defined(__GNUC__) || defined(__clang__)
+#define DONUT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DONUT_TARGET_AVX2
+#endif
 
 namespace donut::math
 {
@@ -98,6 +115,164 @@ namespace donut::math
         return true;
     }
 
+    static simd_level detect_simd_level()
+    {
+#if DONUT_FRUSTUM_X64
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        bool avx2 = false;
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+
+        // the OS must also save the YMM registers
+        if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6)
+            return simd_level::avx2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return simd_level::avx2;
+#endif
+        return simd_level::sse; // always available on x64
+#else
+        return simd_level::scalar;
+#endif
+    }
+
+    simd_level get_supported_simd_level()
+    {
+        static const simd_level level = detect_simd_level();
+        return level;
+    }
+
+    // For each plane, the coordinate arrays of the box corner that is the farthest inside the plane,
+    // same as the corner selection in intersectsWith(box3).
+    struct plane_corner_arrays
+    {
+        const float* x;
+        const float* y;
+        const float* z;
+    };
+
+    static void select_corner_arrays(const frustum& f, const box3_soa& boxes, plane_corner_arrays* corners)
+    {
+        for (int i = 0; i < frustum::PLANES_COUNT; ++i)
+        {
+            const plane& p = f.planes[i];
+            corners[i].x = p.normal.x > 0 ? boxes.minX : boxes.maxX;
+            corners[i].y = p.normal.y > 0 ? boxes.minY : boxes.maxY;
+            corners[i].z = p.normal.z > 0 ? boxes.minZ : boxes.maxZ;
+        }
+    }
+
+    static void intersects_scalar(const frustum& f, const box3_soa& boxes, size_t begin, uint32_t* visibilityMask)
+    {
+        for (size_t i = begin; i < boxes.count; i++)
+        {
+            box3 box(float3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), float3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+            if (f.intersectsWith(box))
+                visibilityMask[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+#if DONUT_FRUSTUM_X64
+    // Both SIMD versions evaluate the plane distance with the same operations in the same order as the scalar code,
+    // and return the number of boxes processed, a multiple of the vector width.
+    static size_t intersects_sse(const frustum& f, const box3_soa& boxes, uint32_t* visibilityMask)
+    {
+        plane_corner_arrays corners[frustum::PLANES_COUNT];
+        select_corner_arrays(f, boxes, corners);
+
+        const __m128 zero = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 4 <= boxes.count; i += 4)
+        {
+            __m128 outside = zero;
+            for (int p = 0; p < frustum::PLANES_COUNT; ++p)
+            {
+                const plane& pl = f.planes[p];
+                __m128 x = _mm_loadu_ps(corners[p].x + i);
+                __m128 y = _mm_loadu_ps(corners[p].y + i);
+                __m128 z = _mm_loadu_ps(corners[p].z + i);
+
+                __m128 distance = _mm_mul_ps(_mm_set1_ps(pl.normal.x), x);
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(pl.normal.y), y));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(pl.normal.z), z));
+                distance = _mm_sub_ps(distance, _mm_set1_ps(pl.distance));
+
+                outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, zero));
+            }
+
+            uint32_t visible = ~uint32_t(_mm_movemask_ps(outside)) & 0xf;
+            visibilityMask[i / 32] |= visible << (i % 32);
+        }
+
+        return i;
+    }
+
+    DONUT_TARGET_AVX2
+    static size_t intersects_avx2(const frustum& f, const box3_soa& boxes, uint32_t* visibilityMask)
+    {
+        plane_corner_arrays corners[frustum::PLANES_COUNT];
+        select_corner_arrays(f, boxes, corners);
+
+        const __m256 zero = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= boxes.count; i += 8)
+        {
+            __m256 outside = zero;
+            for (int p = 0; p < frustum::PLANES_COUNT; ++p)
+            {
+                const plane& pl = f.planes[p];
+                __m256 x = _mm256_loadu_ps(corners[p].x + i);
+                __m256 y = _mm256_loadu_ps(corners[p].y + i);
+                __m256 z = _mm256_loadu_ps(corners[p].z + i);
+
+                __m256 distance = _mm256_mul_ps(_mm256_set1_ps(pl.normal.x), x);
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(pl.normal.y), y));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(pl.normal.z), z));
+                distance = _mm256_sub_ps(distance, _mm256_set1_ps(pl.distance));
+
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+            }
+
+            uint32_t visible = ~uint32_t(_mm256_movemask_ps(outside)) & 0xff;
+            visibilityMask[i / 32] |= visible << (i % 32);
+        }
+
+        return i;
+    }
+#endif
+
+    void frustum::intersectsWith(const box3_soa& boxes, uint32_t* visibilityMask, simd_level level) const
+    {
+        memset(visibilityMask, 0, ((boxes.count + 31) / 32) * sizeof(uint32_t));
+
+        simd_level supported = get_supported_simd_level();
+        if (level == simd_level::best || level > supported)
+            level = supported;
+
+        size_t processed = 0;
+#if DONUT_FRUSTUM_X64
+        if (level == simd_level::avx2)
+            processed = intersects_avx2(*this, boxes, visibilityMask);
+        else if (level == simd_level::sse)
+            processed = intersects_sse(*this, boxes, visibilityMask);
+#endif
+
+        // the remaining boxes that don't fill a vector
+        intersects_scalar(*this, boxes, processed, visibilityMask);
+    }
+
     dm::float3 frustum::getCorner(int index) const
     {
         const plane& a = (index & 1) ? planes[RIGHT_PLANE] : planes[LEFT_PLANE];
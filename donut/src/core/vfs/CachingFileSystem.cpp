@@ -0,0 +1,221 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/CachingFileSystem.h>
+
+using namespace donut::vfs;
+
+CachingFileSystem::CachingFileSystem(std::shared_ptr<IFileSystem> fs, size_t budgetBytes)
+    : m_fs(std::move(fs))
+    , m_Budget(budgetBytes)
+{
+}
+
+std::shared_ptr<IBlob> CachingFileSystem::findInCache(const std::string& name, bool validate, bool hasInfo, const FileInfo& info)
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    auto it = m_EntryMap.find(name);
+    if (it == m_EntryMap.end())
+    {
+        ++m_Statistics.misses;
+        return nullptr;
+    }
+
+    // the file has changed or disappeared since it was cached
+    if (validate && it->second->hasInfo && (!hasInfo || it->second->info != info))
+    {
+        m_Statistics.cachedBytes -= it->second->blob->size();
+        m_Entries.erase(it->second);
+        m_EntryMap.erase(it);
+        ++m_Statistics.invalidations;
+        ++m_Statistics.misses;
+        return nullptr;
+    }
+
+    // move the entry to the front of the LRU list
+    m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+    ++m_Statistics.hits;
+    return it->second->blob;
+}
+
+void CachingFileSystem::addToCache(const std::string& name, const std::shared_ptr<IBlob>& blob, bool hasInfo, const FileInfo& info)
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    if (blob->size() > m_Budget)
+        return;
+
+    // another thread may have read and cached the same file in the meantime
+    auto it = m_EntryMap.find(name);
+    if (it != m_EntryMap.end())
+    {
+        m_Statistics.cachedBytes -= it->second->blob->size();
+        m_Entries.erase(it->second);
+        m_EntryMap.erase(it);
+    }
+
+    CacheEntry entry;
+    entry.name = name;
+    entry.blob = blob;
+    entry.info = info;
+    entry.hasInfo = hasInfo;
+    m_Entries.push_front(std::move(entry));
+    m_EntryMap[name] = m_Entries.begin();
+    m_Statistics.cachedBytes += blob->size();
+
+    evict(m_Budget);
+}
+
+void CachingFileSystem::removeFromCache(const std::string& name)
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    auto it = m_EntryMap.find(name);
+    if (it == m_EntryMap.end())
+        return;
+
+    m_Statistics.cachedBytes -= it->second->blob->size();
+    m_Entries.erase(it->second);
+    m_EntryMap.erase(it);
+    ++m_Statistics.invalidations;
+}
+
+void CachingFileSystem::evict(size_t budget)
+{
+    // the caller holds the mutex
+    while (m_Statistics.cachedBytes > budget && !m_Entries.empty())
+    {
+        const CacheEntry& entry = m_Entries.back();
+        m_Statistics.cachedBytes -= entry.blob->size();
+        m_EntryMap.erase(entry.name);
+        m_Entries.pop_back();
+        ++m_Statistics.evictions;
+    }
+}
+
+void CachingFileSystem::setBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    m_Budget = budgetBytes;
+    evict(m_Budget);
+}
+
+void CachingFileSystem::clear()
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    m_Entries.clear();
+    m_EntryMap.clear();
+    m_Statistics.cachedBytes = 0;
+}
+
+CachingFileSystem::Statistics CachingFileSystem::getStatistics() const
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    Statistics statistics = m_Statistics;
+    statistics.cachedFiles = m_Entries.size();
+    return statistics;
+}
+
+void CachingFileSystem::resetCounters()
+{
+    std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+    m_Statistics.hits = 0;
+    m_Statistics.misses = 0;
+    m_Statistics.evictions = 0;
+    m_Statistics.invalidations = 0;
+}
+
+bool CachingFileSystem::folderExists(const std::filesystem::path& name)
+{
+    return m_fs->folderExists(name);
+}
+
+bool CachingFileSystem::fileExists(const std::filesystem::path& name)
+{
+    return m_fs->fileExists(name);
+}
+
+std::shared_ptr<IBlob> CachingFileSystem::readFile(const std::filesystem::path& name)
+{
+    const std::string normalizedName = name.lexically_normal().generic_string();
+
+    FileInfo info;
+    const bool hasInfo = m_ValidateFiles && m_fs->getFileInfo(name, info);
+
+    if (auto blob = findInCache(normalizedName, m_ValidateFiles, hasInfo, info))
+        return blob;
+
+    auto blob = m_fs->readFile(name);
+
+    if (blob)
+        addToCache(normalizedName, blob, hasInfo, info);
+
+    return blob;
+}
+
+bool CachingFileSystem::writeFile(const std::filesystem::path& name, const void* data, size_t size)
+{
+    removeFromCache(name.lexically_normal().generic_string());
+
+    return m_fs->writeFile(name, data, size);
+}
+
+int CachingFileSystem::enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates)
+{
+    return m_fs->enumerateFiles(path, extensions, callback, allowDuplicates);
+}
+
+int CachingFileSystem::enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates)
+{
+    return m_fs->enumerateDirectories(path, callback, allowDuplicates);
+}
+
+std::shared_ptr<AsyncReadRequest> CachingFileSystem::readFileAsync(const std::filesystem::path& name, int priority, read_callback_t callback)
+{
+    std::string normalizedName = name.lexically_normal().generic_string();
+
+    FileInfo info;
+    const bool hasInfo = m_ValidateFiles && m_fs->getFileInfo(name, info);
+
+    if (auto blob = findInCache(normalizedName, m_ValidateFiles, hasInfo, info))
+        return AsyncReadRequest::createCompleted(blob, std::move(callback));
+
+    return m_fs->readFileAsync(name, priority,
+        [this, normalizedName = std::move(normalizedName), hasInfo, info, callback = std::move(callback)](const std::shared_ptr<IBlob>& blob)
+        {
+            if (blob)
+                addToCache(normalizedName, blob, hasInfo, info);
+
+            if (callback)
+                callback(blob);
+        });
+}
+
+bool CachingFileSystem::getFileInfo(const std::filesystem::path& name, FileInfo& info)
+{
+    return m_fs->getFileInfo(name, info);
+}
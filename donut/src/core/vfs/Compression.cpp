@@ -23,14 +23,139 @@
 #include <donut/core/vfs/Compression.h>
 #include <donut/core/log.h>
 #include <donut/core/string_utils.h>
+#include <atomic>
+#include <cstring>
 #include <unordered_set>
 
 #ifdef DONUT_WITH_LZ4
+#include <lz4.h>
 #include <lz4frame.h>
+#include <xxhash.h>
+#endif
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
 #endif
 
 using namespace donut::vfs;
 
+#ifdef DONUT_WITH_LZ4
+namespace
+{
+    // One block of an LZ4 frame with independent blocks, located by FindIndependentBlocks
+    struct IndependentBlock
+    {
+        const uint8_t* data;
+        size_t compressedSize;
+        size_t decompressedOffset;
+        size_t decompressedSize;
+        bool compressed;
+    };
+
+    uint32_t ReadLittleEndian32(const uint8_t* data)
+    {
+        return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+    }
+
+    size_t GetMaxBlockSize(LZ4F_blockSizeID_t blockSizeID)
+    {
+        switch (blockSizeID)
+        {
+        case LZ4F_max256KB: return 256 * 1024;
+        case LZ4F_max1MB: return 1024 * 1024;
+        case LZ4F_max4MB: return 4 * 1024 * 1024;
+        default: return 64 * 1024;
+        }
+    }
+
+    LZ4F_blockSizeID_t GetBlockSizeID(size_t blockSize)
+    {
+        if (blockSize <= 64 * 1024)
+            return LZ4F_max64KB;
+        if (blockSize <= 256 * 1024)
+            return LZ4F_max256KB;
+        if (blockSize <= 1024 * 1024)
+            return LZ4F_max1MB;
+        return LZ4F_max4MB;
+    }
+
+    // Walks the block headers that follow the frame header and records where each block's data is
+    // and where it decompresses to. Returns false if the frame doesn't have the simple layout that
+    // the block decoder expects, such as when it's truncated or followed by another frame;
+    // such frames are left to the streaming decompressor, which also reports the errors.
+    bool FindIndependentBlocks(const LZ4F_frameInfo_t& frameInfo, const uint8_t* data, size_t size,
+        std::vector<IndependentBlock>& blocks)
+    {
+        const size_t maxBlockSize = GetMaxBlockSize(frameInfo.blockSizeID);
+        const size_t contentSize = size_t(frameInfo.contentSize);
+        const size_t blockChecksumSize = (frameInfo.blockChecksumFlag == LZ4F_blockChecksumEnabled) ? 4 : 0;
+        const size_t contentChecksumSize = (frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled) ? 4 : 0;
+
+        blocks.reserve((contentSize + maxBlockSize - 1) / maxBlockSize);
+
+        size_t readPtr = 0;
+        size_t decompressedOffset = 0;
+
+        while (true)
+        {
+            if (size - readPtr < 4)
+                return false;
+
+            const uint32_t blockHeader = ReadLittleEndian32(data + readPtr);
+            readPtr += 4;
+
+            // end mark
+            if (blockHeader == 0)
+                break;
+
+            IndependentBlock block;
+            block.data = data + readPtr;
+            block.compressedSize = blockHeader & 0x7fffffffu;
+            block.compressed = (blockHeader & 0x80000000u) == 0;
+            block.decompressedOffset = decompressedOffset;
+
+            if (block.compressedSize > maxBlockSize || size - readPtr < block.compressedSize + blockChecksumSize)
+                return false;
+
+            // every block except the last one decompresses to the full block size
+            if (decompressedOffset >= contentSize)
+                return false;
+            block.decompressedSize = std::min(maxBlockSize, contentSize - decompressedOffset);
+
+            if (!block.compressed && block.compressedSize != block.decompressedSize)
+                return false;
+
+            blocks.push_back(block);
+            readPtr += block.compressedSize + blockChecksumSize;
+            decompressedOffset += block.decompressedSize;
+        }
+
+        return decompressedOffset == contentSize && size - readPtr == contentChecksumSize;
+    }
+
+    bool DecompressIndependentBlock(const IndependentBlock& block, uint8_t* output, bool verifyChecksum)
+    {
+        if (verifyChecksum)
+        {
+            const uint32_t storedChecksum = ReadLittleEndian32(block.data + block.compressedSize);
+            if (XXH32(block.data, block.compressedSize, 0) != storedChecksum)
+                return false;
+        }
+
+        if (!block.compressed)
+        {
+            memcpy(output + block.decompressedOffset, block.data, block.decompressedSize);
+            return true;
+        }
+
+        const int decompressedSize = LZ4_decompress_safe((const char*)block.data, (char*)output + block.decompressedOffset,
+            int(block.compressedSize), int(block.decompressedSize));
+
+        return decompressedSize == int(block.decompressedSize);
+    }
+}
+#endif
+
 bool CompressionLayer::folderExists(const std::filesystem::path& name)
 {
     return m_fs->folderExists(name);
@@ -50,7 +175,44 @@ std::shared_ptr<IBlob> CompressionLayer::readFile(const std::filesystem::path& n
 
     if (!compressedBlob)
         return m_fs->readFile(name);
-    
+
+    return decompress(name, compressedBlob, true);
+#else // DONUT_WITH_LZ4
+    return m_fs->readFile(name);
+#endif
+}
+
+std::shared_ptr<AsyncReadRequest> CompressionLayer::readFileAsync(const std::filesystem::path& name, int priority, read_callback_t callback)
+{
+#ifdef DONUT_WITH_LZ4
+    std::filesystem::path nameWithExt = name;
+    nameWithExt += ".lz4";
+
+    if (!m_fs->fileExists(nameWithExt))
+        return m_fs->readFileAsync(name, priority, std::move(callback));
+
+    // read the compressed file asynchronously and decompress it on the thread that completes the read.
+    // That thread decompresses without the executor: the executor's workers may be blocked waiting for
+    // this very request, and the I/O threads already decompress different files in parallel.
+    auto request = std::make_shared<AsyncReadRequest>(std::move(callback));
+    request->begin();
+
+    auto compressedRequest = m_fs->readFileAsync(nameWithExt, priority,
+        [this, request, name](const std::shared_ptr<IBlob>& compressedBlob)
+        {
+            request->complete(compressedBlob ? decompress(name, compressedBlob, false) : nullptr);
+        });
+
+    request->setDependency(compressedRequest);
+    return request;
+#else // DONUT_WITH_LZ4
+    return m_fs->readFileAsync(name, priority, std::move(callback));
+#endif
+}
+
+#ifdef DONUT_WITH_LZ4
+std::shared_ptr<IBlob> CompressionLayer::decompress(const std::filesystem::path& name, const std::shared_ptr<IBlob>& compressedBlob, bool useExecutor)
+{
     if (compressedBlob->size() == 0)
         return compressedBlob;
 
@@ -89,6 +251,82 @@ std::shared_ptr<IBlob> CompressionLayer::readFile(const std::filesystem::path& n
         readPtr += srcSize;
     }
 
+    // frames with independent blocks and a known size are decoded block by block, possibly in parallel,
+    // straight into a buffer of the right size
+    std::vector<IndependentBlock> blocks;
+    if (frameInfo.blockMode == LZ4F_blockIndependent && frameInfo.contentSize != 0 &&
+        FindIndependentBlocks(frameInfo, compressedData + readPtr, compressedSize - readPtr, blocks))
+    {
+        LZ4F_freeDecompressionContext(context);
+
+        const size_t decompressedSize = size_t(frameInfo.contentSize);
+        uint8_t* decompressedData = (uint8_t*)malloc(decompressedSize);
+
+        if (!decompressedData)
+        {
+            log::warning("Failed to decompress LZ4 frame for file '%s': couldn't allocate %llu bytes of memory",
+                name.generic_string().c_str(), decompressedSize);
+
+            return nullptr;
+        }
+
+        const bool verifyBlockChecksums = frameInfo.blockChecksumFlag == LZ4F_blockChecksumEnabled;
+        std::atomic<bool> blocksValid = true;
+        
+#ifdef DONUT_WITH_TASKFLOW
+        // don't wait for other tasks when called from one of the executor's workers, they might be waiting for us
+        if (useExecutor && m_Executor && blocks.size() > 1 && m_Executor->this_worker_id() < 0)
+        {
+            // the blocks are taken from a shared counter to keep all tasks busy until the end
+            std::atomic<size_t> nextBlock = 0;
+            const size_t numTasks = std::min(blocks.size(), m_Executor->num_workers());
+
+            tf::Taskflow taskflow;
+            for (size_t taskIndex = 0; taskIndex < numTasks; taskIndex++)
+            {
+                taskflow.emplace([&blocks, &nextBlock, &blocksValid, decompressedData, verifyBlockChecksums]()
+                {
+                    for (size_t blockIndex = nextBlock++; blockIndex < blocks.size(); blockIndex = nextBlock++)
+                    {
+                        if (!DecompressIndependentBlock(blocks[blockIndex], decompressedData, verifyBlockChecksums))
+                            blocksValid = false;
+                    }
+                });
+            }
+
+            m_Executor->run(taskflow).wait();
+        }
+        else
+#endif
+        {
+            for (const IndependentBlock& block : blocks)
+            {
+                if (!DecompressIndependentBlock(block, decompressedData, verifyBlockChecksums))
+                {
+                    blocksValid = false;
+                    break;
+                }
+            }
+        }
+
+        if (blocksValid && frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled)
+        {
+            const uint32_t storedChecksum = ReadLittleEndian32(compressedData + compressedSize - 4);
+            blocksValid = XXH32(decompressedData, decompressedSize, 0) == storedChecksum;
+        }
+
+        if (!blocksValid)
+        {
+            log::warning("Failed to decompress LZ4 frame for file '%s': corrupted block data",
+                name.generic_string().c_str());
+
+            free(decompressedData);
+            return nullptr;
+        }
+
+        return std::make_shared<Blob>(decompressedData, decompressedSize);
+    }
+
     // get or guess the decompressed data size
     size_t decompressedSize = frameInfo.contentSize;
     size_t decompressionFactor;
@@ -129,6 +367,17 @@ std::shared_ptr<IBlob> CompressionLayer::readFile(const std::filesystem::path& n
         writePtr += dstSize;
         readPtr += srcSize;
 
+        // the input has ended before the frame did
+        if (readPtr == compressedSize && err != 0 && writePtr < decompressedSize)
+        {
+            log::warning("Failed to decompress LZ4 frame for file '%s': unexpected end of data",
+                name.generic_string().c_str());
+
+            free(decompressedData);
+            LZ4F_freeDecompressionContext(context);
+            return nullptr;
+        }
+
         // see if the decopmressor has filled the entire output buffer but there is still more data to process
         if (writePtr == decompressedSize && err != 0)
         {
@@ -164,11 +413,8 @@ std::shared_ptr<IBlob> CompressionLayer::readFile(const std::filesystem::path& n
     auto blob = std::make_shared<Blob>(decompressedData, writePtr);
 
     return std::static_pointer_cast<IBlob>(blob);
-
-#else // DONUT_WITH_LZ4
-    return m_fs->readFile(name);
-#endif
 }
+#endif
 
 bool CompressionLayer::writeFile(const std::filesystem::path& name, const void* data, size_t size)
 {
@@ -198,6 +444,11 @@ bool CompressionLayer::writeFile(const std::filesystem::path& name, const void*
     LZ4F_preferences_t preferences{};
     preferences.frameInfo.contentSize = uncompressedSize;
     preferences.frameInfo.blockChecksumFlag = LZ4F_blockChecksumEnabled;
+    if (m_BlockSize != 0)
+    {
+        preferences.frameInfo.blockMode = LZ4F_blockIndependent;
+        preferences.frameInfo.blockSizeID = GetBlockSizeID(m_BlockSize);
+    }
     preferences.compressionLevel = m_CompressionLevel;
 
     // get the maximum size 
@@ -243,6 +494,20 @@ bool CompressionLayer::writeFile(const std::filesystem::path& name, const void*
 #endif
 }
 
+bool CompressionLayer::getFileInfo(const std::filesystem::path& name, FileInfo& info)
+{
+#ifdef DONUT_WITH_LZ4
+    // the information describes the file that readFile would read, i.e. the compressed one if it exists
+    std::filesystem::path nameWithExt = name;
+    nameWithExt += ".lz4";
+
+    if (m_fs->getFileInfo(nameWithExt, info))
+        return true;
+#endif
+
+    return m_fs->getFileInfo(name, info);
+}
+
 int CompressionLayer::enumerateFiles(const std::filesystem::path& path,
     const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates)
 {
@@ -0,0 +1,275 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/PathTable.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace donut::vfs;
+
+bool donut::vfs::isNormalPath(std::string_view path)
+{
+    if (path.empty() || path == "." || path == "/")
+        return true;
+
+    const bool rooted = path[0] == '/';
+    size_t pos = rooted ? 1 : 0;
+    bool seenName = false;
+
+    while (pos < path.size())
+    {
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos)
+            end = path.size();
+
+        std::string_view component = path.substr(pos, end - pos);
+
+        // empty components come from repeated separators
+        if (component.empty() || component == ".")
+            return false;
+
+        if (component == "..")
+        {
+            // '..' is only kept at the start of a relative path, and never followed by a trailing separator
+            if (rooted || seenName || end + 1 == path.size())
+                return false;
+        }
+        else
+            seenName = true;
+
+        pos = end + 1;
+    }
+
+    return true;
+}
+
+std::string donut::vfs::normalizePath(std::string_view path)
+{
+    if (path.empty())
+        return std::string();
+
+    const bool rooted = path[0] == '/';
+    std::vector<std::string_view> components;
+    bool trailingSeparator = false;
+    size_t pos = 0;
+
+    while (pos < path.size())
+    {
+        if (path[pos] == '/')
+        {
+            ++pos;
+            continue;
+        }
+
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos)
+            end = path.size();
+
+        std::string_view component = path.substr(pos, end - pos);
+
+        // removing a '.' or a 'name/..' pair leaves a separator at the end of the path
+        if (component == ".")
+        {
+            trailingSeparator = true;
+        }
+        else if (component == "..")
+        {
+            if (!components.empty() && components.back() != "..")
+            {
+                components.pop_back();
+                trailingSeparator = true;
+            }
+            else if (!rooted)
+            {
+                components.push_back(component);
+                trailingSeparator = false;
+            }
+        }
+        else
+        {
+            components.push_back(component);
+            trailingSeparator = false;
+        }
+
+        if (end < path.size())
+            trailingSeparator = true;
+
+        pos = end;
+    }
+
+    std::string result;
+    result.reserve(path.size());
+
+    if (rooted)
+        result.push_back('/');
+
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        if (i > 0)
+            result.push_back('/');
+        result.append(components[i]);
+    }
+
+    if (components.empty())
+    {
+        if (!rooted)
+            result = ".";
+    }
+    else if (trailingSeparator && components.back() != "..")
+        result.push_back('/');
+
+    return result;
+}
+
+NormalizedPath::NormalizedPath(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+    // drive letters and UNC prefixes are rare in the VFS, let the standard library deal with them
+    if (path.has_root_name())
+    {
+        m_Storage = path.lexically_normal().generic_string();
+        m_Path = m_Storage;
+        return;
+    }
+
+    m_Storage = path.generic_string();
+    if (!isNormalPath(m_Storage))
+        m_Storage = normalizePath(m_Storage);
+    m_Path = m_Storage;
+#else
+    const std::string& native = path.native();
+    if (isNormalPath(native))
+    {
+        m_Path = native;
+    }
+    else
+    {
+        m_Storage = normalizePath(native);
+        m_Path = m_Storage;
+    }
+#endif
+}
+
+NormalizedPath::NormalizedPath(std::string_view path)
+{
+    if (isNormalPath(path))
+    {
+        m_Path = path;
+    }
+    else
+    {
+        m_Storage = normalizePath(path);
+        m_Path = m_Storage;
+    }
+}
+
+std::string_view NormalizedPath::relative() const
+{
+    if (!m_Path.empty() && m_Path[0] == '/')
+        return m_Path.substr(1);
+
+    return m_Path;
+}
+
+uint32_t PathTable::insert(std::string_view path)
+{
+    const size_t hash = std::hash<std::string_view>()(path);
+
+    if (!m_Slots.empty())
+    {
+        uint32_t slot = findSlot(path, hash);
+        if (m_Slots[slot] != 0)
+            return m_Slots[slot] - 1;
+    }
+
+    // keep the load factor under 1/2
+    if ((m_Entries.size() + 1) * 2 > m_Slots.size())
+        rehash(std::max<size_t>(m_Slots.size() * 2, 16));
+
+    Entry entry;
+    entry.hash = hash;
+    entry.offset = uint32_t(m_Storage.size());
+    entry.length = uint32_t(path.size());
+    m_Storage.append(path);
+
+    const uint32_t index = uint32_t(m_Entries.size());
+    m_Entries.push_back(entry);
+    m_Slots[findSlot(path, hash)] = index + 1;
+
+    return index;
+}
+
+uint32_t PathTable::find(std::string_view path) const
+{
+    if (m_Slots.empty())
+        return InvalidIndex;
+
+    uint32_t slot = findSlot(path, std::hash<std::string_view>()(path));
+
+    return m_Slots[slot] - 1;
+}
+
+std::string_view PathTable::getPath(uint32_t index) const
+{
+    assert(index < m_Entries.size());
+    const Entry& entry = m_Entries[index];
+    return std::string_view(m_Storage).substr(entry.offset, entry.length);
+}
+
+void PathTable::clear()
+{
+    m_Storage.clear();
+    m_Entries.clear();
+    m_Slots.clear();
+}
+
+uint32_t PathTable::findSlot(std::string_view path, size_t hash) const
+{
+    const size_t mask = m_Slots.size() - 1;
+
+    // linear probing, the table always has empty slots
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+        const uint32_t entryIndex = m_Slots[slot];
+        if (entryIndex == 0)
+            return uint32_t(slot);
+
+        const Entry& entry = m_Entries[entryIndex - 1];
+        if (entry.hash == hash && getPath(entryIndex - 1) == path)
+            return uint32_t(slot);
+    }
+}
+
+void PathTable::rehash(size_t slotCount)
+{
+    m_Slots.assign(slotCount, 0);
+
+    const size_t mask = slotCount - 1;
+    for (uint32_t index = 0; index < uint32_t(m_Entries.size()); index++)
+    {
+        size_t slot = m_Entries[index].hash & mask;
+        while (m_Slots[slot] != 0)
+            slot = (slot + 1) & mask;
+
+        m_Slots[slot] = index + 1;
+    }
+}
@@ -24,14 +24,84 @@
 #include <donut/core/log.h>
 #include <sstream>
 #include <regex>
+#include <algorithm>
 
 #ifdef WIN32
+#include <Windows.h>
 #define fseeko _fseeki64
 #define ftello _ftelli64
+#else
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 using namespace donut::vfs;
 
+// The archive file opened through the OS for positional reads that don't need locking.
+struct TarFile::NativeArchive
+{
+#ifdef WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int file = -1;
+#endif
+
+    bool open(const std::string& path);
+    bool read(void* dest, size_t offset, size_t size) const;
+    ~NativeArchive();
+};
+
+bool TarFile::NativeArchive::open(const std::string& path)
+{
+#ifdef WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return file != INVALID_HANDLE_VALUE;
+#else
+    file = ::open(path.c_str(), O_RDONLY);
+    return file >= 0;
+#endif
+}
+
+bool TarFile::NativeArchive::read(void* dest, size_t offset, size_t size) const
+{
+    uint8_t* destBytes = static_cast<uint8_t*>(dest);
+
+    // the OS may return less data than requested, keep reading until done
+    while (size > 0)
+    {
+#ifdef WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset = DWORD(offset);
+        overlapped.OffsetHigh = DWORD(uint64_t(offset) >> 32);
+
+        DWORD bytesRead = 0;
+        DWORD bytesToRead = DWORD(std::min<size_t>(size, 0x40000000));
+        if (!ReadFile(file, destBytes, bytesToRead, &bytesRead, &overlapped) || bytesRead == 0)
+            return false;
+#else
+        ssize_t bytesRead = pread(file, destBytes, size, off_t(offset));
+        if (bytesRead <= 0)
+            return false;
+#endif
+        destBytes += bytesRead;
+        offset += size_t(bytesRead);
+        size -= size_t(bytesRead);
+    }
+
+    return true;
+}
+
+TarFile::NativeArchive::~NativeArchive()
+{
+#ifdef WIN32
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+#else
+    if (file >= 0)
+        close(file);
+#endif
+}
+
 struct header_posix_ustar
 {
     char name[100];
@@ -55,7 +125,8 @@ struct header_posix_ustar
 
 static_assert(sizeof(header_posix_ustar) == 512);
 
-TarFile::TarFile(const std::filesystem::path& archivePath)
+TarFile::TarFile(const std::filesystem::path& archivePath, ReadMode readMode)
+    : m_ReadMode(readMode)
 {
     m_ArchivePath = archivePath.lexically_normal().generic_string();
     m_ArchiveFile = fopen(m_ArchivePath.c_str(), "rb");
@@ -128,11 +199,19 @@ TarFile::TarFile(const std::filesystem::path& archivePath)
             FileEntry entry;
             entry.offset = currentPosition;
             entry.size = fileSize;
-            m_Files[fileName] = entry;
+            NormalizedPath normalizedName((std::string_view(fileName)));
+            std::string_view relativeName = normalizedName.relative();
 
-            std::filesystem::path filePath = fileName;
-            if (filePath.has_parent_path())
-                m_Directories.insert(filePath.parent_path().generic_string());
+            // a later entry with the same name replaces the earlier one
+            uint32_t fileIndex = m_Files.insert(relativeName);
+            if (fileIndex < m_FileEntries.size())
+                m_FileEntries[fileIndex] = entry;
+            else
+                m_FileEntries.push_back(entry);
+
+            size_t separator = relativeName.rfind('/');
+            if (separator != std::string_view::npos)
+                m_Directories.insert(relativeName.substr(0, separator));
 
             // advance to the next file
             currentPosition += (fileSize + 511) & ~511;
@@ -143,9 +222,46 @@ TarFile::TarFile(const std::filesystem::path& archivePath)
             fclose(m_ArchiveFile);
             m_ArchiveFile = nullptr;
             m_Files.clear();
+            m_FileEntries.clear();
             m_Directories.clear();
         }
     }
+
+    if (m_ArchiveFile && m_ReadMode != ReadMode::Buffered)
+    {
+        bool opened = false;
+        if (m_ReadMode == ReadMode::MemoryMapped)
+        {
+            auto mapping = std::make_shared<MappedFileBlob>(m_ArchivePath);
+            if (mapping->isOpen())
+            {
+                m_ArchiveMapping = mapping;
+                opened = true;
+            }
+        }
+        else
+        {
+            auto nativeArchive = std::make_unique<NativeArchive>();
+            if (nativeArchive->open(m_ArchivePath))
+            {
+                m_NativeArchive = std::move(nativeArchive);
+                opened = true;
+            }
+        }
+
+        if (opened)
+        {
+            // the C runtime file was only needed to enumerate the contents
+            fclose(m_ArchiveFile);
+            m_ArchiveFile = nullptr;
+        }
+        else
+        {
+            log::warning("Cannot open tar archive '%s' for %s reads, falling back to buffered reads",
+                m_ArchivePath.c_str(), m_ReadMode == ReadMode::MemoryMapped ? "memory-mapped" : "positional");
+            m_ReadMode = ReadMode::Buffered;
+        }
+    }
 }
 
 TarFile::~TarFile()
@@ -162,65 +278,98 @@ TarFile::~TarFile()
 
 bool TarFile::isOpen() const
 {
-    return m_ArchiveFile != nullptr;
+    return m_ArchiveFile != nullptr || m_NativeArchive != nullptr || m_ArchiveMapping != nullptr;
 }
 
 bool TarFile::folderExists(const std::filesystem::path& name)
 {
-    std::string normalizedName = name.lexically_normal().relative_path().generic_string();
+    NormalizedPath normalizedName(name);
 
-    return m_Directories.find(normalizedName) != m_Directories.end();
+    return m_Directories.contains(normalizedName.relative());
 }
 
 bool TarFile::fileExists(const std::filesystem::path& name)
 {
-    std::string normalizedName = name.lexically_normal().relative_path().generic_string();
+    NormalizedPath normalizedName(name);
 
-    return m_Files.find(normalizedName) != m_Files.end();
+    return m_Files.contains(normalizedName.relative());
 }
 
 std::shared_ptr<IBlob> TarFile::readFile(const std::filesystem::path& name)
 {
-    std::string normalizedName = name.lexically_normal().relative_path().generic_string();
+    NormalizedPath normalizedName(name);
     
-    if (normalizedName.empty())
+    if (normalizedName.relative().empty())
         return nullptr;
     
-    auto entry = m_Files.find(normalizedName);
+    uint32_t fileIndex = m_Files.find(normalizedName.relative());
 
-    if (entry == m_Files.end())
+    if (fileIndex == PathTable::InvalidIndex)
         return nullptr;
 
+    const FileEntry& entry = m_FileEntries[fileIndex];
+
+    if (m_ReadMode == ReadMode::MemoryMapped)
+    {
+        return std::make_shared<BufferRegionBlob>(m_ArchiveMapping, entry.offset, entry.size);
+    }
+
+    if (m_ReadMode == ReadMode::Positional)
+    {
+        void* data = malloc(entry.size);
+
+        if (!data)
+            return nullptr;
+
+        if (!m_NativeArchive->read(data, entry.offset, entry.size))
+        {
+            log::warning("Error reading file '%s' (%zu bytes) from tar archive '%s'",
+                name.generic_string().c_str(), entry.size, m_ArchivePath.c_str());
+            free(data);
+            return nullptr;
+        }
+
+        return std::make_shared<Blob>(data, entry.size);
+    }
+
     // prevent concurrent file operations from multiple threads from this point on
     std::lock_guard<std::mutex> lockGuard(m_Mutex);
     
-    if (fseeko(m_ArchiveFile, entry->second.offset, SEEK_SET) != 0)
+    if (fseeko(m_ArchiveFile, entry.offset, SEEK_SET) != 0)
     {
         log::warning("Error seeking to offset %ull for file '%s' in tar archive '%s'",
-            entry->second.offset, normalizedName.c_str(), m_ArchivePath.c_str());
+            entry.offset, name.generic_string().c_str(), m_ArchivePath.c_str());
         return nullptr;
     }
 
-    void* data = malloc(entry->second.size);
+    void* data = malloc(entry.size);
 
     if (!data)
         return nullptr;
 
-    size_t sizeRead = fread(data, 1, entry->second.size, m_ArchiveFile);
+    size_t sizeRead = fread(data, 1, entry.size, m_ArchiveFile);
 
-    if (sizeRead != entry->second.size)
+    if (sizeRead != entry.size)
     {
         log::warning("Error reading file '%s' (%ull bytes) from tar archive '%s'", 
-            entry->second.size, normalizedName.c_str(), m_ArchivePath.c_str());
+            entry.size, name.generic_string().c_str(), m_ArchivePath.c_str());
         free(data);
         return nullptr;
     }
 
-    std::shared_ptr<Blob> blob = std::make_shared<Blob>(data, entry->second.size);
+    std::shared_ptr<Blob> blob = std::make_shared<Blob>(data, entry.size);
 
     return std::static_pointer_cast<IBlob>(blob);
 }
 
+std::shared_ptr<AsyncReadRequest> TarFile::readFileAsync(const std::filesystem::path& name, int priority, read_callback_t callback)
+{
+    if (m_ReadMode == ReadMode::MemoryMapped)
+        return AsyncReadRequest::createCompleted(readFile(name), std::move(callback));
+
+    return IFileSystem::readFileAsync(name, priority, std::move(callback));
+}
+
 bool TarFile::writeFile(const std::filesystem::path&, const void*, size_t)
 {
     // tar files are mounted read-only
@@ -233,12 +382,13 @@ int TarFile::enumerateFiles(const std::filesystem::path& path, const std::vector
     std::basic_regex<char> regex(getFileSearchRegex(path.relative_path(), extensions));
 
     int numEntries = 0;
-    for (const auto& [name, record] : m_Files)
+    for (uint32_t index = 0; index < m_Files.size(); index++)
     {
-        if (std::regex_match(name, regex))
+        std::string_view name = m_Files.getPath(index);
+        if (std::regex_match(name.begin(), name.end(), regex))
         {
-            std::filesystem::path filePath = name;
-            callback(filePath.filename().generic_string());
+            size_t separator = name.rfind('/');
+            callback(std::string(separator == std::string_view::npos ? name : name.substr(separator + 1)));
             ++numEntries;
         }
     }
@@ -252,9 +402,9 @@ int TarFile::enumerateDirectories(const std::filesystem::path& path, enumerate_c
     std::filesystem::path normalizedPath = path.relative_path().lexically_normal();
 
     int numEntries = 0;
-    for (const auto& name : m_Directories)
+    for (uint32_t index = 0; index < m_Directories.size(); index++)
     {
-        std::filesystem::path dirPath = name;
+        std::filesystem::path dirPath = m_Directories.getPath(index);
         if (dirPath.parent_path() == normalizedPath)
             callback(dirPath.filename().generic_string());
         ++numEntries;
@@ -26,15 +26,21 @@
 #include <fstream>
 #include <cassert>
 #include <algorithm>
+#include <limits>
 #include <utility>
 #include <sstream>
 
 #ifdef WIN32
+#include <Windows.h>
 #include <Shlwapi.h>
 #else
 extern "C" {
 #include <glob.h>
 }
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif // _WIN32
 
 using namespace donut::vfs;
@@ -67,6 +73,245 @@ Blob::~Blob()
     m_size = 0;
 }
 
+BufferRegionBlob::BufferRegionBlob(const std::shared_ptr<IBlob>& parent, size_t offset, size_t size)
+    : m_parent(parent)
+    , m_data(static_cast<const uint8_t*>(parent->data()) + offset)
+    , m_size(size)
+{
+    assert(offset + size <= parent->size());
+}
+
+const void* BufferRegionBlob::data() const
+{
+    return m_data;
+}
+
+size_t BufferRegionBlob::size() const
+{
+    return m_size;
+}
+
+MappedFileBlob::MappedFileBlob(const std::filesystem::path& path)
+{
+    // the mapping stays valid after the file is closed, so no handles are kept
+#ifdef WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && uint64_t(fileSize.QuadPart) <= uint64_t(std::numeric_limits<size_t>::max()))
+    {
+        if (fileSize.QuadPart == 0)
+        {
+            m_isOpen = true;
+        }
+        else if (HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+        {
+            m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (m_data)
+            {
+                m_size = size_t(fileSize.QuadPart);
+                m_isOpen = true;
+            }
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+
+    struct stat fileStat{};
+    if (fstat(file, &fileStat) == 0 && uint64_t(fileStat.st_size) <= uint64_t(std::numeric_limits<size_t>::max()))
+    {
+        if (fileStat.st_size == 0)
+        {
+            m_isOpen = true;
+        }
+        else
+        {
+            void* data = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_SHARED, file, 0);
+            if (data != MAP_FAILED)
+            {
+                m_data = data;
+                m_size = size_t(fileStat.st_size);
+                m_isOpen = true;
+            }
+        }
+    }
+
+    close(file);
+#endif
+}
+
+MappedFileBlob::~MappedFileBlob()
+{
+    if (m_data)
+    {
+#ifdef WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(m_data, m_size);
+#endif
+        m_data = nullptr;
+    }
+
+    m_size = 0;
+}
+
+const void* MappedFileBlob::data() const
+{
+    return m_data;
+}
+
+size_t MappedFileBlob::size() const
+{
+    return m_size;
+}
+
+AsyncReadRequest::AsyncReadRequest(read_callback_t callback)
+    : m_Callback(std::move(callback))
+    , m_Future(m_Promise.get_future().share())
+{
+}
+
+bool AsyncReadRequest::begin()
+{
+    State expected = State::Pending;
+    return m_State.compare_exchange_strong(expected, State::Running);
+}
+
+void AsyncReadRequest::complete(const std::shared_ptr<IBlob>& blob)
+{
+    if (m_Callback)
+        m_Callback(blob);
+
+    // the state is set first, so that isDone() is true for the threads that return from wait()
+    m_State = State::Completed;
+    m_Promise.set_value(blob);
+}
+
+void AsyncReadRequest::setDependency(std::shared_ptr<AsyncReadRequest> dependency)
+{
+    std::lock_guard<std::mutex> lockGuard(m_DependencyMutex);
+    m_Dependency = std::move(dependency);
+}
+
+bool AsyncReadRequest::cancel()
+{
+    State expected = State::Pending;
+    if (m_State.compare_exchange_strong(expected, State::Cancelled))
+    {
+        m_Promise.set_value(nullptr);
+        return true;
+    }
+
+    std::shared_ptr<AsyncReadRequest> dependency;
+    {
+        std::lock_guard<std::mutex> lockGuard(m_DependencyMutex);
+        dependency = m_Dependency;
+    }
+
+    // a cancelled dependency never completes, so this request won't be completed by it either
+    if (dependency && dependency->cancel())
+    {
+        m_State = State::Cancelled;
+        m_Promise.set_value(nullptr);
+        return true;
+    }
+
+    return false;
+}
+
+bool AsyncReadRequest::isDone() const
+{
+    State state = m_State;
+    return state == State::Completed || state == State::Cancelled;
+}
+
+std::shared_ptr<AsyncReadRequest> AsyncReadRequest::createCompleted(const std::shared_ptr<IBlob>& blob, read_callback_t callback)
+{
+    auto request = std::make_shared<AsyncReadRequest>(std::move(callback));
+    request->begin();
+    request->complete(blob);
+    return request;
+}
+
+IoThreadPool::IoThreadPool(uint32_t threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; i++)
+        m_Threads.emplace_back(&IoThreadPool::threadProc, this);
+}
+
+IoThreadPool::~IoThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lockGuard(m_Mutex);
+        m_Terminate = true;
+
+        while (!m_Jobs.empty())
+        {
+            m_Jobs.top().request->cancel();
+            m_Jobs.pop();
+        }
+    }
+
+    m_Condition.notify_all();
+
+    for (auto& thread : m_Threads)
+        thread.join();
+}
+
+void IoThreadPool::threadProc()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_Terminate || !m_Jobs.empty(); });
+
+            if (m_Terminate)
+                return;
+
+            job = m_Jobs.top();
+            m_Jobs.pop();
+        }
+
+        // skip requests cancelled while they were queued
+        if (job.request->begin())
+            job.request->complete(job.read());
+    }
+}
+
+std::shared_ptr<AsyncReadRequest> IoThreadPool::submit(int priority, read_callback_t callback, std::function<std::shared_ptr<IBlob>()> read)
+{
+    auto request = std::make_shared<AsyncReadRequest>(std::move(callback));
+    {
+        std::lock_guard<std::mutex> lockGuard(m_Mutex);
+        m_Jobs.push(Job{ priority, m_NextSequence++, request, std::move(read) });
+    }
+
+    m_Condition.notify_one();
+    return request;
+}
+
+IoThreadPool& IoThreadPool::getDefault()
+{
+    // I/O threads spend most of their time waiting, so use a few even on small machines
+    static IoThreadPool pool(std::clamp(std::thread::hardware_concurrency(), 2u, 8u));
+    return pool;
+}
+
+std::shared_ptr<AsyncReadRequest> IFileSystem::readFileAsync(const std::filesystem::path& name, int priority, read_callback_t callback)
+{
+    return IoThreadPool::getDefault().submit(priority, std::move(callback), [this, name]() { return readFile(name); });
+}
+
 bool NativeFileSystem::folderExists(const std::filesystem::path& name)
 {
 	return std::filesystem::exists(name) && std::filesystem::is_directory(name);
@@ -81,6 +326,21 @@ std::shared_ptr<IBlob> NativeFileSystem::readFile(const std::filesystem::path& n
 {
     // TODO: better error reporting
 
+    if (m_MemoryMappingThreshold != std::numeric_limits<size_t>::max())
+    {
+        std::error_code error;
+        uintmax_t fileSize = std::filesystem::file_size(name, error);
+
+        if (!error && fileSize >= m_MemoryMappingThreshold)
+        {
+            auto blob = std::make_shared<MappedFileBlob>(name);
+            if (blob->isOpen())
+                return blob;
+
+            // mapping failed, try reading the file normally
+        }
+    }
+
     std::ifstream file(name, std::ios::binary);
 
     if (!file.is_open())
@@ -121,30 +381,91 @@ std::shared_ptr<IBlob> NativeFileSystem::readFile(const std::filesystem::path& n
     return std::make_shared<Blob>(data, size);
 }
 
+bool NativeFileSystem::getFileInfo(const std::filesystem::path& name, FileInfo& info)
+{
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(name, error);
+    if (error)
+        return false;
+
+    std::filesystem::file_time_type modificationTime = std::filesystem::last_write_time(name, error);
+    if (error)
+        return false;
+
+    info.size = uint64_t(size);
+    info.modificationTime = int64_t(modificationTime.time_since_epoch().count());
+    return true;
+}
+
+static bool WriteNativeFile(std::ofstream& file, const void* data, size_t size)
+{
+    if (size > 0)
+    {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    file.close();
+
+    // writing error
+    return !file.fail();
+}
+
 bool NativeFileSystem::writeFile(const std::filesystem::path& name, const void* data, size_t size)
 {
     // TODO: better error reporting
 
-    std::ofstream file(name, std::ios::binary);
-
-    if (!file.is_open())
+    // write a link's target, not the link
+    std::error_code error;
+    std::filesystem::path target = name;
+    if (std::filesystem::is_symlink(name, error))
     {
-        // file does not exist or is locked
-        return false;
+        std::filesystem::path linkTarget = std::filesystem::canonical(name, error);
+        if (!error)
+            target = linkTarget;
     }
 
-    if (size > 0)
+    // Write a new file next to the target and move it over the target, so that the target stays intact if
+    // the write fails, and blobs that map the old file keep their contents; a truncated mapping would crash.
+    static std::atomic<uint32_t> tempFileCounter = 0;
+#ifdef WIN32
+    const unsigned long processId = GetCurrentProcessId();
+#else
+    const unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+    std::filesystem::path tempPath = target;
+    tempPath += ".tmp" + std::to_string(processId) + "_" + std::to_string(tempFileCounter++);
+
+    std::ofstream tempFile(tempPath, std::ios::binary);
+    if (tempFile.is_open())
     {
-        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!WriteNativeFile(tempFile, data, size))
+        {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+
+        const std::filesystem::file_status targetStatus = std::filesystem::status(target, error);
+        if (std::filesystem::exists(targetStatus))
+            std::filesystem::permissions(tempPath, targetStatus.permissions(), error);
+
+        std::filesystem::rename(tempPath, target, error);
+        if (!error)
+            return true;
+
+        std::filesystem::remove(tempPath, error);
     }
 
-    if (!file.good())
+    // Write into the target when it can't be replaced: the folder may not be writable,
+    // or on Windows, the target may be open
+    std::ofstream file(target, std::ios::binary);
+
+    if (!file.is_open())
     {
-        // writing error
+        // file does not exist or is locked
         return false;
     }
 
-    return true;
+    return WriteNativeFile(file, data, size);
 }
 
 static int enumerateNativeFiles(const char* pattern, bool directories, enumerate_callback_t callback)
@@ -253,37 +574,69 @@ int NativeFileSystem::enumerateDirectories(const std::filesystem::path& path, en
 RelativeFileSystem::RelativeFileSystem(std::shared_ptr<IFileSystem> fs, const std::filesystem::path& basePath)
     : m_UnderlyingFS(std::move(fs))
     , m_BasePath(basePath.lexically_normal())
+    , m_BasePathString(m_BasePath.generic_string())
 {
 }
 
+std::filesystem::path RelativeFileSystem::resolve(const std::filesystem::path& name) const
+{
+    NormalizedPath normalizedName(name);
+    std::string_view relativeName = normalizedName.relative();
+
+    if (relativeName.empty())
+        return m_BasePath;
+
+    if (m_BasePathString.empty())
+        return std::filesystem::path(relativeName);
+
+    std::string result;
+    result.reserve(m_BasePathString.size() + relativeName.size() + 1);
+    result.append(m_BasePathString);
+    if (result.back() != '/')
+        result.push_back('/');
+    result.append(relativeName);
+
+    return std::filesystem::path(std::move(result));
+}
+
 bool RelativeFileSystem::folderExists(const std::filesystem::path& name)
 {
-	return m_UnderlyingFS->folderExists(m_BasePath / name.relative_path());
+	return m_UnderlyingFS->folderExists(resolve(name));
 }
 
 bool RelativeFileSystem::fileExists(const std::filesystem::path& name)
 {
-    return m_UnderlyingFS->fileExists(m_BasePath / name.relative_path());
+    return m_UnderlyingFS->fileExists(resolve(name));
 }
 
 std::shared_ptr<IBlob> RelativeFileSystem::readFile(const std::filesystem::path& name)
 {
-    return m_UnderlyingFS->readFile(m_BasePath / name.relative_path());
+    return m_UnderlyingFS->readFile(resolve(name));
+}
+
+std::shared_ptr<AsyncReadRequest> RelativeFileSystem::readFileAsync(const std::filesystem::path& name, int priority, read_callback_t callback)
+{
+    return m_UnderlyingFS->readFileAsync(resolve(name), priority, std::move(callback));
+}
+
+bool RelativeFileSystem::getFileInfo(const std::filesystem::path& name, FileInfo& info)
+{
+    return m_UnderlyingFS->getFileInfo(resolve(name), info);
 }
 
 bool RelativeFileSystem::writeFile(const std::filesystem::path& name, const void* data, size_t size)
 {
-    return m_UnderlyingFS->writeFile(m_BasePath / name.relative_path(), data, size);
+    return m_UnderlyingFS->writeFile(resolve(name), data, size);
 }
 
 int RelativeFileSystem::enumerateFiles(const std::filesystem::path& path, const std::vector<std::string>& extensions, enumerate_callback_t callback, bool allowDuplicates)
 {
-    return m_UnderlyingFS->enumerateFiles(m_BasePath / path.relative_path(), extensions, callback, allowDuplicates);
+    return m_UnderlyingFS->enumerateFiles(resolve(path), extensions, callback, allowDuplicates);
 }
 
 int RelativeFileSystem::enumerateDirectories(const std::filesystem::path& path, enumerate_callback_t callback, bool allowDuplicates)
 {
-    return m_UnderlyingFS->enumerateDirectories(m_BasePath / path.relative_path(), callback, allowDuplicates);
+    return m_UnderlyingFS->enumerateDirectories(resolve(path), callback, allowDuplicates);
 }
 
 void RootFileSystem::mount(const std::filesystem::path& path, std::shared_ptr<IFileSystem> fs)
@@ -294,7 +647,8 @@ void RootFileSystem::mount(const std::filesystem::path& path, std::shared_ptr<IF
         return;
     }
 
-    m_MountPoints.push_back(std::make_pair(path.lexically_normal().generic_string(), fs));
+    m_MountPoints.push_back(std::make_pair(std::string(NormalizedPath(path).view()), fs));
+    updateMountTable();
 }
 
 void donut::vfs::RootFileSystem::mount(const std::filesystem::path& path, const std::filesystem::path& nativePath)
@@ -304,41 +658,60 @@ void donut::vfs::RootFileSystem::mount(const std::filesystem::path& path, const
 
 bool RootFileSystem::unmount(const std::filesystem::path& path)
 {
-    std::string spath = path.lexically_normal().generic_string();
+    NormalizedPath normalizedPath(path);
+
+    uint32_t index = m_MountTable.find(normalizedPath.view());
+    if (index == PathTable::InvalidIndex)
+        return false;
+
+    m_MountPoints.erase(m_MountPoints.begin() + index);
+    updateMountTable();
+
+    return true;
+}
+
+void RootFileSystem::updateMountTable()
+{
+    // mounting is rare, rebuild everything to keep the indices in sync with m_MountPoints
+    m_MountTable.clear();
+    m_MountPathLengths.clear();
 
-    for (size_t index = 0; index < m_MountPoints.size(); index++)
+    for (const auto& [mountPath, fs] : m_MountPoints)
     {
-        if (m_MountPoints[index].first == spath)
-        {
-            m_MountPoints.erase(m_MountPoints.begin() + index);
-            return true;
-        }
+        m_MountTable.insert(mountPath);
+        m_MountPathLengths.push_back(mountPath.size());
     }
 
-    return false;
+    std::sort(m_MountPathLengths.begin(), m_MountPathLengths.end(), std::greater<size_t>());
+    m_MountPathLengths.erase(std::unique(m_MountPathLengths.begin(), m_MountPathLengths.end()), m_MountPathLengths.end());
 }
 
 bool RootFileSystem::findMountPoint(const std::filesystem::path& path, std::filesystem::path* pRelativePath, IFileSystem** ppFS)
 {
-    std::string spath = path.lexically_normal().generic_string();
+    NormalizedPath normalizedPath(path);
+    std::string_view spath = normalizedPath.view();
 
-    for (auto it : m_MountPoints)
+    // mount points can't be nested, so the longest matching prefix is the only one
+    for (size_t length : m_MountPathLengths)
     {
-        if (spath.find(it.first, 0) == 0 && ((spath.length() == it.first.length()) || (spath[it.first.length()] == '/')))
-        {
-            if (pRelativePath)
-            {
-                std::string relative = spath.substr(it.first.size() + 1);
-                *pRelativePath = relative;
-            }
+        if (length > spath.size() || (length < spath.size() && spath[length] != '/'))
+            continue;
 
-            if (ppFS)
-            {
-                *ppFS = it.second.get();
-            }
+        uint32_t index = m_MountTable.find(spath.substr(0, length));
+        if (index == PathTable::InvalidIndex)
+            continue;
 
-            return true;
+        if (pRelativePath)
+        {
+            *pRelativePath = (length < spath.size()) ? std::filesystem::path(spath.substr(length + 1)) : std::filesystem::path();
         }
+
+        if (ppFS)
+        {
+            *ppFS = m_MountPoints[index].second.get();
+        }
+
+        return true;
     }
 
     return false;
@@ -383,6 +756,32 @@ std::shared_ptr<IBlob> RootFileSystem::readFile(const std::filesystem::path& nam
     return nullptr;
 }
 
+std::shared_ptr<AsyncReadRequest> RootFileSystem::readFileAsync(const std::filesystem::path& name, int priority, read_callback_t callback)
+{
+    std::filesystem::path relativePath;
+    IFileSystem* fs = nullptr;
+
+    if (findMountPoint(name, &relativePath, &fs))
+    {
+        return fs->readFileAsync(relativePath, priority, std::move(callback));
+    }
+
+    return AsyncReadRequest::createCompleted(nullptr, std::move(callback));
+}
+
+bool RootFileSystem::getFileInfo(const std::filesystem::path& name, FileInfo& info)
+{
+    std::filesystem::path relativePath;
+    IFileSystem* fs = nullptr;
+
+    if (findMountPoint(name, &relativePath, &fs))
+    {
+        return fs->getFileInfo(relativePath, info);
+    }
+
+    return false;
+}
+
 bool RootFileSystem::writeFile(const std::filesystem::path& name, const void* data, size_t size)
 {
     std::filesystem::path relativePath;
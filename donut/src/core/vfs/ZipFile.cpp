@@ -36,8 +36,22 @@ ZipFile::ZipFile(const std::filesystem::path& archivePath)
     m_ZipArchive = malloc(sizeof(mz_zip_archive));
     memset(m_ZipArchive, 0, sizeof(mz_zip_archive));
 
-    if (!mz_zip_reader_init_file((mz_zip_archive*)m_ZipArchive, m_ArchivePath.c_str(), 
-        MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY | MZ_ZIP_FLAG_VALIDATE_HEADERS_ONLY))
+    // read the archive from a mapping if possible, so that stored files can be returned without copying
+    const mz_uint flags = MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY | MZ_ZIP_FLAG_VALIDATE_HEADERS_ONLY;
+    auto mapping = std::make_shared<MappedFileBlob>(archivePath);
+    bool initialized;
+    if (mapping->isOpen() && mapping->size() != 0)
+    {
+        initialized = mz_zip_reader_init_mem((mz_zip_archive*)m_ZipArchive, mapping->data(), mapping->size(), flags);
+        if (initialized)
+            m_ArchiveMapping = mapping;
+    }
+    else
+    {
+        initialized = mz_zip_reader_init_file((mz_zip_archive*)m_ZipArchive, m_ArchivePath.c_str(), flags);
+    }
+
+    if (!initialized)
     {
         const char* errorString = mz_zip_get_error_string(mz_zip_get_last_error((mz_zip_archive*)m_ZipArchive));
         log::warning("Cannot open zip archive '%s': ", m_ArchivePath.c_str(), errorString);
@@ -56,10 +70,20 @@ ZipFile::ZipFile(const std::filesystem::path& archivePath)
         if (string_utils::ends_with(name, "/"))
             name.erase(name.size() - 1);
 
+        NormalizedPath normalizedName((std::string_view(name)));
+
         if (mz_zip_reader_is_file_a_directory((mz_zip_archive*)m_ZipArchive, i))
-            m_Directories.insert(name);
+        {
+            m_Directories.insert(normalizedName.relative());
+        }
         else
-            m_Files[name] = i;
+        {
+            uint32_t fileIndex = m_Files.insert(normalizedName.relative());
+            if (fileIndex < m_FileIndices.size())
+                m_FileIndices[fileIndex] = i;
+            else
+                m_FileIndices.push_back(i);
+        }
     }
 ;}
 
@@ -79,6 +103,8 @@ void ZipFile::close()
         free(m_ZipArchive);
         m_ZipArchive = nullptr;
     }
+
+    m_ArchiveMapping.reset();
 }
 
 bool ZipFile::isOpen() const
@@ -88,9 +114,9 @@ bool ZipFile::isOpen() const
 
 bool ZipFile::folderExists(const std::filesystem::path& name)
 {
-    std::string normalizedName = name.lexically_normal().relative_path().generic_string();
+    NormalizedPath normalizedName(name);
 
-    return m_Directories.find(normalizedName) != m_Directories.end();
+    return m_Directories.contains(normalizedName.relative());
 }
 
 bool ZipFile::fileExists(const std::filesystem::path& name)
@@ -98,9 +124,9 @@ bool ZipFile::fileExists(const std::filesystem::path& name)
     if (!isOpen())
         return false;
 
-    std::string normalizedName = name.lexically_normal().relative_path().generic_string();
+    NormalizedPath normalizedName(name);
 
-    return m_Files.find(normalizedName) != m_Files.end();
+    return m_Files.contains(normalizedName.relative());
 }
 
 std::shared_ptr<IBlob> ZipFile::readFile(const std::filesystem::path& name)
@@ -108,17 +134,17 @@ std::shared_ptr<IBlob> ZipFile::readFile(const std::filesystem::path& name)
     if (!isOpen())
         return nullptr;
 
-    std::string normalizedName = name.lexically_normal().relative_path().generic_string();
+    NormalizedPath normalizedName(name);
     
-    if (normalizedName.empty())
+    if (normalizedName.relative().empty())
         return nullptr;
     
-    auto entry = m_Files.find(normalizedName);
+    uint32_t entry = m_Files.find(normalizedName.relative());
 
-    if (entry == m_Files.end())
+    if (entry == PathTable::InvalidIndex)
         return nullptr;
 
-    uint32_t fileIndex = entry->second;
+    uint32_t fileIndex = m_FileIndices[entry];
 
     // working with the archive from now on, requires synchronous access
     std::lock_guard<std::mutex> lockGuard(m_Mutex);
@@ -129,7 +155,7 @@ std::shared_ptr<IBlob> ZipFile::readFile(const std::filesystem::path& name)
     {
         const char* errorString = mz_zip_get_error_string(mz_zip_get_last_error((mz_zip_archive*)m_ZipArchive));
         log::warning("Cannot stat file '%s' in zip archive '%s': %s",
-            normalizedName.c_str(), m_ArchivePath.c_str(), errorString);
+            name.generic_string().c_str(), m_ArchivePath.c_str(), errorString);
 
         return nullptr;
     }
@@ -137,6 +163,30 @@ std::shared_ptr<IBlob> ZipFile::readFile(const std::filesystem::path& name)
     if (stat.m_uncomp_size == 0)
         return nullptr;
 
+    // stored files in a mapped archive are returned as a region of the mapping
+    if (m_ArchiveMapping && stat.m_method == 0 && !stat.m_is_encrypted && stat.m_comp_size == stat.m_uncomp_size)
+    {
+        // the file data follows the local header and its variable size fields
+        const uint8_t* archiveData = static_cast<const uint8_t*>(m_ArchiveMapping->data());
+        const size_t archiveSize = m_ArchiveMapping->size();
+        const size_t localHeaderOffset = size_t(stat.m_local_header_ofs);
+        const size_t localHeaderSize = 30;
+        const uint32_t localHeaderSignature = 0x04034b50;
+
+        if (localHeaderOffset + localHeaderSize <= archiveSize &&
+            MZ_READ_LE32(archiveData + localHeaderOffset) == localHeaderSignature)
+        {
+            const size_t nameLength = MZ_READ_LE16(archiveData + localHeaderOffset + 26);
+            const size_t extraLength = MZ_READ_LE16(archiveData + localHeaderOffset + 28);
+            const size_t dataOffset = localHeaderOffset + localHeaderSize + nameLength + extraLength;
+
+            if (dataOffset + stat.m_uncomp_size <= archiveSize)
+                return std::make_shared<BufferRegionBlob>(m_ArchiveMapping, dataOffset, size_t(stat.m_uncomp_size));
+        }
+
+        // malformed local header, let miniz report the error below
+    }
+
     // extract the file
     void* uncompressedData = malloc(stat.m_uncomp_size);
     if (!mz_zip_reader_extract_to_mem((mz_zip_archive*)m_ZipArchive, fileIndex, uncompressedData, stat.m_uncomp_size, 0))
@@ -145,7 +195,7 @@ std::shared_ptr<IBlob> ZipFile::readFile(const std::filesystem::path& name)
 
         const char* errorString = mz_zip_get_error_string(mz_zip_get_last_error((mz_zip_archive*)m_ZipArchive));
         log::warning("Cannot extract file '%s' from zip archive '%s': %s",
-            normalizedName.c_str(), m_ArchivePath.c_str(), errorString);
+            name.generic_string().c_str(), m_ArchivePath.c_str(), errorString);
 
         return nullptr;
     }
@@ -168,12 +218,13 @@ int ZipFile::enumerateFiles(const std::filesystem::path& path, const std::vector
     std::basic_regex<char> regex(getFileSearchRegex(path.relative_path(), extensions));
 
     int numEntries = 0;
-    for (const auto& [name, record] : m_Files)
+    for (uint32_t index = 0; index < m_Files.size(); index++)
     {
-        if (std::regex_match(name, regex))
+        std::string_view name = m_Files.getPath(index);
+        if (std::regex_match(name.begin(), name.end(), regex))
         {
-            std::filesystem::path filePath = name;
-            callback(filePath.filename().generic_string());
+            size_t separator = name.rfind('/');
+            callback(std::string(separator == std::string_view::npos ? name : name.substr(separator + 1)));
             ++numEntries;
         }
     }
@@ -187,9 +238,9 @@ int ZipFile::enumerateDirectories(const std::filesystem::path& path, enumerate_c
     std::filesystem::path normalizedPath = path.relative_path().lexically_normal();
 
     int numEntries = 0;
-    for (const auto& name : m_Directories)
+    for (uint32_t index = 0; index < m_Directories.size(); index++)
     {
-        std::filesystem::path dirPath = name;
+        std::filesystem::path dirPath = m_Directories.getPath(index);
         if (dirPath.parent_path() == normalizedPath)
             callback(dirPath.filename().generic_string());
         ++numEntries;
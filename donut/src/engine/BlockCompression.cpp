@@ -0,0 +1,907 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/BlockCompression.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut::engine;
+
+namespace
+{
+    // 16 RGBA pixels in rows
+    typedef uint8_t BlockPixels[16][4];
+
+    void LoadBlock(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, uint32_t channels,
+        uint32_t blockX, uint32_t blockY, BlockPixels& block)
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            const uint8_t* row = pixels + std::min(blockY * 4 + y, height - 1) * rowPitch;
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint8_t* pixel = row + std::min(blockX * 4 + x, width - 1) * channels;
+                uint8_t* out = block[y * 4 + x];
+                out[0] = pixel[0];
+                out[1] = channels > 1 ? pixel[1] : 0;
+                out[2] = channels > 2 ? pixel[2] : 0;
+                out[3] = channels > 3 ? pixel[3] : 255;
+            }
+        }
+    }
+
+    // The principal axis of the first 'N' channels of the block, by power iteration on the covariance matrix
+    template<int N>
+    void ComputePrincipalAxis(const BlockPixels& block, float mean[N], float axis[N])
+    {
+        for (int c = 0; c < N; c++)
+            mean[c] = 0.f;
+
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < N; c++)
+                mean[c] += float(block[i][c]);
+        }
+
+        float covariance[N][N] = {};
+        for (int c = 0; c < N; c++)
+            mean[c] *= 1.f / 16.f;
+
+        for (int i = 0; i < 16; i++)
+        {
+            float d[N];
+            for (int c = 0; c < N; c++)
+                d[c] = float(block[i][c]) - mean[c];
+            for (int a = 0; a < N; a++)
+                for (int b = 0; b < N; b++)
+                    covariance[a][b] += d[a] * d[b];
+        }
+
+        // start from the covariance row of the channel with the largest variance, which is never orthogonal
+        // to the principal axis, unlike the diagonal with anticorrelated channels
+        int largest = 0;
+        for (int c = 1; c < N; c++)
+        {
+            if (covariance[c][c] > covariance[largest][largest])
+                largest = c;
+        }
+
+        for (int c = 0; c < N; c++)
+            axis[c] = covariance[largest][c];
+
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[N] = {};
+            float length = 0.f;
+            for (int a = 0; a < N; a++)
+            {
+                for (int b = 0; b < N; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length = std::max(length, fabsf(next[a]));
+            }
+
+            if (length == 0.f)
+                break;
+
+            for (int c = 0; c < N; c++)
+                axis[c] = next[c] / length;
+        }
+
+        float length = 0.f;
+        for (int c = 0; c < N; c++)
+            length += axis[c] * axis[c];
+
+        if (length > 0.f)
+        {
+            length = 1.f / sqrtf(length);
+            for (int c = 0; c < N; c++)
+                axis[c] *= length;
+        }
+    }
+
+    // The range of the projections of the block pixels onto the axis, relative to the mean
+    template<int N>
+    void ProjectOntoAxis(const BlockPixels& block, const float mean[N], const float axis[N], float& minT, float& maxT)
+    {
+        minT = FLT_MAX;
+        maxT = -FLT_MAX;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.f;
+            for (int c = 0; c < N; c++)
+                t += (float(block[i][c]) - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+    }
+
+    void WriteBits(uint8_t* block, uint32_t& position, uint32_t value, uint32_t count)
+    {
+        for (uint32_t bit = 0; bit < count; bit++, position++)
+            block[position >> 3] |= uint8_t(((value >> bit) & 1) << (position & 7));
+    }
+
+    uint32_t ReadBits(const uint8_t* block, uint32_t& position, uint32_t count)
+    {
+        uint32_t value = 0;
+        for (uint32_t bit = 0; bit < count; bit++, position++)
+            value |= uint32_t((block[position >> 3] >> (position & 7)) & 1) << bit;
+        return value;
+    }
+
+    // BC1
+
+    uint16_t PackRgb565(const float color[3])
+    {
+        const int r = std::clamp(int(color[0] * (31.f / 255.f) + 0.5f), 0, 31);
+        const int g = std::clamp(int(color[1] * (63.f / 255.f) + 0.5f), 0, 63);
+        const int b = std::clamp(int(color[2] * (31.f / 255.f) + 0.5f), 0, 31);
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    void UnpackRgb565(uint16_t packed, int color[3])
+    {
+        const int r = packed >> 11;
+        const int g = (packed >> 5) & 63;
+        const int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    void GetBC1Palette(uint16_t c0, uint16_t c1, bool fourColors, int palette[4][4])
+    {
+        UnpackRgb565(c0, palette[0]);
+        UnpackRgb565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+
+        for (int c = 0; c < 3; c++)
+        {
+            if (fourColors)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = fourColors ? 255 : 0;
+    }
+
+    // The squared RGB error of the block with the best 4-color mode indices for the endpoints
+    int ComputeBC1Indices(const BlockPixels& block, uint16_t c0, uint16_t c1, uint32_t& indices)
+    {
+        int palette[4][4];
+        GetBC1Palette(c0, c1, true, palette);
+
+        int error = 0;
+        indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int bestError = INT_MAX;
+            uint32_t bestIndex = 0;
+            for (uint32_t index = 0; index < 4; index++)
+            {
+                const int dr = int(block[i][0]) - palette[index][0];
+                const int dg = int(block[i][1]) - palette[index][1];
+                const int db = int(block[i][2]) - palette[index][2];
+                const int e = dr * dr + dg * dg + db * db;
+                if (e < bestError)
+                {
+                    bestError = e;
+                    bestIndex = index;
+                }
+            }
+            indices |= bestIndex << (i * 2);
+            error += bestError;
+        }
+        return error;
+    }
+
+    // Writes an 8-byte BC1 color block in the 4-color mode, which BC3 always uses
+    void EncodeBC1Block(const BlockPixels& block, uint8_t* output)
+    {
+        float mean[3], axis[3];
+        ComputePrincipalAxis<3>(block, mean, axis);
+
+        float minT, maxT;
+        ProjectOntoAxis<3>(block, mean, axis, minT, maxT);
+
+        // inset the endpoints a little, the interpolated colors cover the range better than the extremes
+        const float inset = (maxT - minT) / 16.f;
+        minT += inset;
+        maxT -= inset;
+
+        float endpoint0[3], endpoint1[3];
+        for (int c = 0; c < 3; c++)
+        {
+            endpoint0[c] = mean[c] + axis[c] * maxT;
+            endpoint1[c] = mean[c] + axis[c] * minT;
+        }
+
+        uint16_t c0 = PackRgb565(endpoint0);
+        uint16_t c1 = PackRgb565(endpoint1);
+        uint32_t indices = 0;
+        int error = ComputeBC1Indices(block, c0, c1, indices);
+
+        // least squares fit of the endpoints to the chosen indices
+        static const float weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+        for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+        {
+            float aa = 0.f, bb = 0.f, ab = 0.f;
+            float ax[3] = {}, bx[3] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                const float a = weights[(indices >> (i * 2)) & 3];
+                const float b = 1.f - a;
+                aa += a * a;
+                bb += b * b;
+                ab += a * b;
+                for (int c = 0; c < 3; c++)
+                {
+                    ax[c] += a * float(block[i][c]);
+                    bx[c] += b * float(block[i][c]);
+                }
+            }
+
+            const float determinant = aa * bb - ab * ab;
+            if (fabsf(determinant) < 1e-6f)
+                break;
+
+            for (int c = 0; c < 3; c++)
+            {
+                endpoint0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                endpoint1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+
+            const uint16_t newC0 = PackRgb565(endpoint0);
+            const uint16_t newC1 = PackRgb565(endpoint1);
+            uint32_t newIndices = 0;
+            const int newError = ComputeBC1Indices(block, newC0, newC1, newIndices);
+            if (newError >= error)
+                break;
+
+            c0 = newC0;
+            c1 = newC1;
+            indices = newIndices;
+            error = newError;
+        }
+
+        // c0 > c1 selects the 4-color mode; swapping the endpoints swaps indices 0 and 1, and 2 and 3.
+        // Equal endpoints would select the 3-color mode where index 3 is transparent, so all pixels use index 0.
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+            indices ^= 0x55555555;
+        }
+        else if (c0 == c1)
+        {
+            indices = 0;
+        }
+
+        output[0] = uint8_t(c0);
+        output[1] = uint8_t(c0 >> 8);
+        output[2] = uint8_t(c1);
+        output[3] = uint8_t(c1 >> 8);
+        memcpy(output + 4, &indices, 4);
+    }
+
+    void DecodeBC1Block(const uint8_t* input, bool alwaysFourColors, BlockPixels& block)
+    {
+        const uint16_t c0 = uint16_t(input[0] | (input[1] << 8));
+        const uint16_t c1 = uint16_t(input[2] | (input[3] << 8));
+        uint32_t indices;
+        memcpy(&indices, input + 4, 4);
+
+        int palette[4][4];
+        GetBC1Palette(c0, c1, alwaysFourColors || c0 > c1, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int* color = palette[(indices >> (i * 2)) & 3];
+            for (int c = 0; c < 4; c++)
+                block[i][c] = uint8_t(color[c]);
+        }
+    }
+
+    // BC4
+
+    void GetBC4Palette(int e0, int e1, int palette[8])
+    {
+        palette[0] = e0;
+        palette[1] = e1;
+        if (e0 > e1)
+        {
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+        }
+        else
+        {
+            for (int i = 2; i < 6; i++)
+                palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    int ComputeBC4Indices(const uint8_t values[16], int e0, int e1, uint64_t& indices)
+    {
+        int palette[8];
+        GetBC4Palette(e0, e1, palette);
+
+        int error = 0;
+        indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int bestError = INT_MAX;
+            uint64_t bestIndex = 0;
+            for (uint64_t index = 0; index < 8; index++)
+            {
+                const int d = int(values[i]) - palette[index];
+                if (d * d < bestError)
+                {
+                    bestError = d * d;
+                    bestIndex = index;
+                }
+            }
+            indices |= bestIndex << (i * 3);
+            error += bestError;
+        }
+        return error;
+    }
+
+    // Writes an 8-byte BC4 block, also used for the alpha of BC3 and the channels of BC5
+    void EncodeBC4Block(const uint8_t values[16], uint8_t* output)
+    {
+        int minValue = 255, maxValue = 0;
+        int minInner = 255, maxInner = 0; // without the values 0 and 255
+        for (int i = 0; i < 16; i++)
+        {
+            const int value = values[i];
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+            if (value != 0 && value != 255)
+            {
+                minInner = std::min(minInner, value);
+                maxInner = std::max(maxInner, value);
+            }
+        }
+
+        // 8 interpolated values between the extremes
+        int e0 = maxValue;
+        int e1 = minValue;
+        uint64_t indices = 0;
+        int error = ComputeBC4Indices(values, e0, e1, indices);
+
+        // 6 interpolated values between the inner extremes, plus exact 0 and 255
+        if (error > 0 && (minValue == 0 || maxValue == 255))
+        {
+            if (minInner > maxInner)
+                minInner = maxInner = minValue == 0 ? 0 : 255;
+
+            uint64_t innerIndices = 0;
+            const int innerError = ComputeBC4Indices(values, minInner, maxInner, innerIndices);
+            if (innerError < error)
+            {
+                e0 = minInner;
+                e1 = maxInner;
+                indices = innerIndices;
+            }
+        }
+
+        output[0] = uint8_t(e0);
+        output[1] = uint8_t(e1);
+        for (int i = 0; i < 6; i++)
+            output[2 + i] = uint8_t(indices >> (i * 8));
+    }
+
+    void DecodeBC4Block(const uint8_t* input, uint8_t values[16])
+    {
+        int palette[8];
+        GetBC4Palette(input[0], input[1], palette);
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+            indices |= uint64_t(input[2 + i]) << (i * 8);
+
+        for (int i = 0; i < 16; i++)
+            values[i] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+    }
+
+    void EncodeBC4Channel(const BlockPixels& block, int channel, uint8_t* output)
+    {
+        uint8_t values[16];
+        for (int i = 0; i < 16; i++)
+            values[i] = block[i][channel];
+        EncodeBC4Block(values, output);
+    }
+
+    void DecodeBC4Channel(const uint8_t* input, int channel, BlockPixels& block)
+    {
+        uint8_t values[16];
+        DecodeBC4Block(input, values);
+        for (int i = 0; i < 16; i++)
+            block[i][channel] = values[i];
+    }
+
+    // BC7 mode 6: 7-bit RGBA endpoints with one p-bit each, and 4-bit indices
+
+    const int c_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct BC7Endpoint
+    {
+        int value[4]; // 7 bits
+        int pBit;
+
+        [[nodiscard]] int Decode(int channel) const { return (value[channel] << 1) | pBit; }
+    };
+
+    BC7Endpoint QuantizeBC7Endpoint(const float color[4])
+    {
+        BC7Endpoint best = {};
+        float bestError = FLT_MAX;
+        for (int pBit = 0; pBit < 2; pBit++)
+        {
+            BC7Endpoint endpoint;
+            endpoint.pBit = pBit;
+            float error = 0.f;
+            for (int c = 0; c < 4; c++)
+            {
+                endpoint.value[c] = std::clamp(int((color[c] - float(pBit)) * 0.5f + 0.5f), 0, 127);
+                const float d = float(endpoint.Decode(c)) - color[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = endpoint;
+            }
+        }
+        return best;
+    }
+
+    int ComputeBC7Indices(const BlockPixels& block, const BC7Endpoint& endpoint0, const BC7Endpoint& endpoint1, uint8_t indices[16])
+    {
+        int palette[16][4];
+        float direction[4];
+        float lengthSquared = 0.f;
+        for (int c = 0; c < 4; c++)
+        {
+            const int e0 = endpoint0.Decode(c);
+            const int e1 = endpoint1.Decode(c);
+            for (int index = 0; index < 16; index++)
+                palette[index][c] = ((64 - c_BC7Weights[index]) * e0 + c_BC7Weights[index] * e1 + 32) >> 6;
+            direction[c] = float(e1 - e0);
+            lengthSquared += direction[c] * direction[c];
+        }
+
+        // project onto the endpoint line for a first guess, then check its neighbors
+        const float scale = lengthSquared > 0.f ? 15.f / lengthSquared : 0.f;
+        int error = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.f;
+            for (int c = 0; c < 4; c++)
+                t += (float(block[i][c]) - float(endpoint0.Decode(c))) * direction[c];
+            const int guess = std::clamp(int(t * scale + 0.5f), 0, 15);
+
+            int bestError = INT_MAX;
+            int bestIndex = guess;
+            for (int index = std::max(guess - 1, 0); index <= std::min(guess + 1, 15); index++)
+            {
+                int e = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    const int d = int(block[i][c]) - palette[index][c];
+                    e += d * d;
+                }
+                if (e < bestError)
+                {
+                    bestError = e;
+                    bestIndex = index;
+                }
+            }
+            indices[i] = uint8_t(bestIndex);
+            error += bestError;
+        }
+        return error;
+    }
+
+    void EncodeBC7Block(const BlockPixels& block, uint8_t* output)
+    {
+        float mean[4], axis[4];
+        ComputePrincipalAxis<4>(block, mean, axis);
+
+        float minT, maxT;
+        ProjectOntoAxis<4>(block, mean, axis, minT, maxT);
+
+        float color0[4], color1[4];
+        for (int c = 0; c < 4; c++)
+        {
+            color0[c] = mean[c] + axis[c] * minT;
+            color1[c] = mean[c] + axis[c] * maxT;
+        }
+
+        BC7Endpoint endpoint0 = QuantizeBC7Endpoint(color0);
+        BC7Endpoint endpoint1 = QuantizeBC7Endpoint(color1);
+        uint8_t indices[16];
+        int error = ComputeBC7Indices(block, endpoint0, endpoint1, indices);
+
+        for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+        {
+            float aa = 0.f, bb = 0.f, ab = 0.f;
+            float ax[4] = {}, bx[4] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                const float b = float(c_BC7Weights[indices[i]]) / 64.f;
+                const float a = 1.f - b;
+                aa += a * a;
+                bb += b * b;
+                ab += a * b;
+                for (int c = 0; c < 4; c++)
+                {
+                    ax[c] += a * float(block[i][c]);
+                    bx[c] += b * float(block[i][c]);
+                }
+            }
+
+            const float determinant = aa * bb - ab * ab;
+            if (fabsf(determinant) < 1e-6f)
+                break;
+
+            for (int c = 0; c < 4; c++)
+            {
+                color0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                color1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+
+            const BC7Endpoint newEndpoint0 = QuantizeBC7Endpoint(color0);
+            const BC7Endpoint newEndpoint1 = QuantizeBC7Endpoint(color1);
+            uint8_t newIndices[16];
+            const int newError = ComputeBC7Indices(block, newEndpoint0, newEndpoint1, newIndices);
+            if (newError >= error)
+                break;
+
+            endpoint0 = newEndpoint0;
+            endpoint1 = newEndpoint1;
+            memcpy(indices, newIndices, sizeof(indices));
+            error = newError;
+        }
+
+        // the most significant bit of the first index is implicitly 0
+        if (indices[0] & 8)
+        {
+            std::swap(endpoint0, endpoint1);
+            for (uint8_t& index : indices)
+                index = uint8_t(15 - index);
+        }
+
+        memset(output, 0, 16);
+        uint32_t position = 0;
+        WriteBits(output, position, 1 << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            WriteBits(output, position, uint32_t(endpoint0.value[c]), 7);
+            WriteBits(output, position, uint32_t(endpoint1.value[c]), 7);
+        }
+        WriteBits(output, position, uint32_t(endpoint0.pBit), 1);
+        WriteBits(output, position, uint32_t(endpoint1.pBit), 1);
+        WriteBits(output, position, indices[0], 3);
+        for (int i = 1; i < 16; i++)
+            WriteBits(output, position, indices[i], 4);
+    }
+
+    bool DecodeBC7Block(const uint8_t* input, BlockPixels& block)
+    {
+        uint32_t position = 0;
+        if (ReadBits(input, position, 7) != (1 << 6))
+            return false;
+
+        BC7Endpoint endpoints[2];
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0].value[c] = int(ReadBits(input, position, 7));
+            endpoints[1].value[c] = int(ReadBits(input, position, 7));
+        }
+        endpoints[0].pBit = int(ReadBits(input, position, 1));
+        endpoints[1].pBit = int(ReadBits(input, position, 1));
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int weight = c_BC7Weights[ReadBits(input, position, i == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; c++)
+                block[i][c] = uint8_t(((64 - weight) * endpoints[0].Decode(c) + weight * endpoints[1].Decode(c) + 32) >> 6);
+        }
+        return true;
+    }
+
+    uint32_t GetBlockSize(nvrhi::Format format)
+    {
+        switch (format)
+        {
+        case nvrhi::Format::BC1_UNORM:
+        case nvrhi::Format::BC1_UNORM_SRGB:
+        case nvrhi::Format::BC4_UNORM:
+            return 8;
+        case nvrhi::Format::BC3_UNORM:
+        case nvrhi::Format::BC3_UNORM_SRGB:
+        case nvrhi::Format::BC5_UNORM:
+        case nvrhi::Format::BC7_UNORM:
+        case nvrhi::Format::BC7_UNORM_SRGB:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    void EncodeBlock(nvrhi::Format format, const BlockPixels& block, uint8_t* output)
+    {
+        switch (format)
+        {
+        case nvrhi::Format::BC1_UNORM:
+        case nvrhi::Format::BC1_UNORM_SRGB:
+            EncodeBC1Block(block, output);
+            break;
+        case nvrhi::Format::BC3_UNORM:
+        case nvrhi::Format::BC3_UNORM_SRGB:
+            EncodeBC4Channel(block, 3, output);
+            EncodeBC1Block(block, output + 8);
+            break;
+        case nvrhi::Format::BC4_UNORM:
+            EncodeBC4Channel(block, 0, output);
+            break;
+        case nvrhi::Format::BC5_UNORM:
+            EncodeBC4Channel(block, 0, output);
+            EncodeBC4Channel(block, 1, output + 8);
+            break;
+        case nvrhi::Format::BC7_UNORM:
+        case nvrhi::Format::BC7_UNORM_SRGB:
+            EncodeBC7Block(block, output);
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool DecodeBlock(nvrhi::Format format, const uint8_t* input, BlockPixels& block)
+    {
+        switch (format)
+        {
+        case nvrhi::Format::BC1_UNORM:
+        case nvrhi::Format::BC1_UNORM_SRGB:
+            DecodeBC1Block(input, false, block);
+            return true;
+        case nvrhi::Format::BC3_UNORM:
+        case nvrhi::Format::BC3_UNORM_SRGB:
+            DecodeBC1Block(input + 8, true, block);
+            DecodeBC4Channel(input, 3, block);
+            return true;
+        case nvrhi::Format::BC4_UNORM:
+        case nvrhi::Format::BC5_UNORM:
+            for (int i = 0; i < 16; i++)
+            {
+                block[i][1] = 0;
+                block[i][2] = 0;
+                block[i][3] = 255;
+            }
+            DecodeBC4Channel(input, 0, block);
+            if (format == nvrhi::Format::BC5_UNORM)
+                DecodeBC4Channel(input + 8, 1, block);
+            return true;
+        case nvrhi::Format::BC7_UNORM:
+        case nvrhi::Format::BC7_UNORM_SRGB:
+            return DecodeBC7Block(input, block);
+        default:
+            return false;
+        }
+    }
+}
+
+bool donut::engine::IsBlockCompressionSupported(nvrhi::Format format)
+{
+    return GetBlockSize(format) != 0;
+}
+
+bool donut::engine::CompressImage(nvrhi::Format format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+    uint32_t channels, uint8_t* blocks, tf::Executor* executor)
+{
+    const uint32_t blockSize = GetBlockSize(format);
+    if (blockSize == 0 || channels < 1 || channels > 4 || width == 0 || height == 0)
+        return false;
+
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    auto compressRow = [=](uint32_t blockY)
+    {
+        BlockPixels block;
+        uint8_t* output = blocks + size_t(blockY) * blocksX * blockSize;
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            LoadBlock(pixels, width, height, rowPitch, channels, blockX, blockY, block);
+            EncodeBlock(format, block, output + size_t(blockX) * blockSize);
+        }
+    };
+
+#ifdef DONUT_WITH_TASKFLOW
+    // don't wait for other tasks when called from one of the executor's workers, they might be waiting for us
+    if (executor && blocksY > 1 && executor->this_worker_id() < 0)
+    {
+        // the rows are taken from a shared counter to keep all tasks busy until the end
+        std::atomic<uint32_t> nextRow = 0;
+        const size_t numTasks = std::min<size_t>(blocksY, executor->num_workers());
+
+        tf::Taskflow taskflow;
+        for (size_t taskIndex = 0; taskIndex < numTasks; taskIndex++)
+        {
+            taskflow.emplace([&nextRow, &compressRow, blocksY]()
+            {
+                for (uint32_t blockY = nextRow++; blockY < blocksY; blockY = nextRow++)
+                    compressRow(blockY);
+            });
+        }
+
+        executor->run(taskflow).wait();
+        return true;
+    }
+#endif
+
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+        compressRow(blockY);
+
+    return true;
+}
+
+bool donut::engine::DecompressImage(nvrhi::Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* pixels)
+{
+    const uint32_t blockSize = GetBlockSize(format);
+    if (blockSize == 0)
+        return false;
+
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    BlockPixels block;
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            if (!DecodeBlock(format, blocks + (size_t(blockY) * blocksX + blockX) * blockSize, block))
+                return false;
+
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+                    memcpy(pixels + (size_t(blockY * 4 + y) * width + blockX * 4 + x) * 4, block[y * 4 + x], 4);
+            }
+        }
+    }
+
+    return true;
+}
+
+nvrhi::Format donut::engine::ChooseBlockCompressedFormat(const TextureData& texture, bool preferBC7)
+{
+    if (!texture.data || texture.dimension != nvrhi::TextureDimension::Texture2D || texture.arraySize != 1 ||
+        texture.dataLayout.size() != 1 || texture.dataLayout[0].size() != texture.mipLevels ||
+        texture.width % 4 != 0 || texture.height % 4 != 0)
+        return nvrhi::Format::UNKNOWN;
+
+    switch (texture.format)
+    {
+    case nvrhi::Format::R8_UNORM:
+        return nvrhi::Format::BC4_UNORM;
+    case nvrhi::Format::RG8_UNORM:
+        return nvrhi::Format::BC5_UNORM;
+    case nvrhi::Format::RGBA8_UNORM:
+    case nvrhi::Format::SRGBA8_UNORM:
+        break;
+    default:
+        return nvrhi::Format::UNKNOWN;
+    }
+
+    const bool sRGB = texture.format == nvrhi::Format::SRGBA8_UNORM;
+    if (preferBC7)
+        return sRGB ? nvrhi::Format::BC7_UNORM_SRGB : nvrhi::Format::BC7_UNORM;
+
+    const TextureSubresourceData& layout = texture.dataLayout[0][0];
+    const uint8_t* data = static_cast<const uint8_t*>(texture.data->data()) + layout.dataOffset;
+    for (uint32_t y = 0; y < texture.height; y++)
+    {
+        const uint8_t* row = data + y * layout.rowPitch;
+        for (uint32_t x = 0; x < texture.width; x++)
+        {
+            if (row[x * 4 + 3] != 255)
+                return sRGB ? nvrhi::Format::BC3_UNORM_SRGB : nvrhi::Format::BC3_UNORM;
+        }
+    }
+
+    return sRGB ? nvrhi::Format::BC1_UNORM_SRGB : nvrhi::Format::BC1_UNORM;
+}
+
+bool donut::engine::CompressTextureData(TextureData& texture, nvrhi::Format format, tf::Executor* executor)
+{
+    const uint32_t blockSize = GetBlockSize(format);
+    uint32_t channels = 0;
+    switch (texture.format)
+    {
+    case nvrhi::Format::R8_UNORM: channels = 1; break;
+    case nvrhi::Format::RG8_UNORM: channels = 2; break;
+    case nvrhi::Format::RGBA8_UNORM:
+    case nvrhi::Format::SRGBA8_UNORM: channels = 4; break;
+    default: break;
+    }
+
+    if (blockSize == 0 || channels == 0 || !texture.data || texture.dimension != nvrhi::TextureDimension::Texture2D ||
+        texture.arraySize != 1 || texture.dataLayout.size() != 1 || texture.dataLayout[0].size() != texture.mipLevels ||
+        texture.width % 4 != 0 || texture.height % 4 != 0)
+        return false;
+
+    // one row of blocks per 4 rows of pixels, at least one in the mips smaller than a block
+    std::vector<TextureSubresourceData> layout(texture.mipLevels);
+    size_t dataSize = 0;
+    for (uint32_t mipLevel = 0; mipLevel < texture.mipLevels; mipLevel++)
+    {
+        const uint32_t blocksX = std::max((texture.width >> mipLevel) + 3, 4u) / 4;
+        const uint32_t blocksY = std::max((texture.height >> mipLevel) + 3, 4u) / 4;
+
+        layout[mipLevel].dataOffset = ptrdiff_t(dataSize);
+        layout[mipLevel].rowPitch = size_t(blocksX) * blockSize;
+        layout[mipLevel].depthPitch = layout[mipLevel].rowPitch * blocksY;
+        layout[mipLevel].dataSize = layout[mipLevel].depthPitch;
+        dataSize += layout[mipLevel].dataSize;
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(malloc(dataSize));
+    if (!data)
+        return false;
+
+    const uint8_t* source = static_cast<const uint8_t*>(texture.data->data());
+    for (uint32_t mipLevel = 0; mipLevel < texture.mipLevels; mipLevel++)
+    {
+        const TextureSubresourceData& sourceLayout = texture.dataLayout[0][mipLevel];
+        CompressImage(format, source + sourceLayout.dataOffset,
+            std::max(texture.width >> mipLevel, 1u), std::max(texture.height >> mipLevel, 1u),
+            sourceLayout.rowPitch, channels, data + layout[mipLevel].dataOffset, executor);
+    }
+
+    texture.data = std::make_shared<vfs::Blob>(data, dataSize);
+    texture.dataLayout[0] = std::move(layout);
+    texture.format = format;
+
+    return true;
+}
@@ -921,4 +921,90 @@ namespace donut::engine
 
         return std::make_shared<Blob>(data, dataSize);
     }
+
+    std::shared_ptr<IBlob> SaveTextureDataAsDDS(const TextureData& texture)
+    {
+        if (!texture.data || (texture.dimension != nvrhi::TextureDimension::Texture2D && texture.dimension != nvrhi::TextureDimension::Texture2DArray))
+            return nullptr;
+
+        if (texture.dataLayout.size() != texture.arraySize)
+            return nullptr;
+
+        DDS_HEADER header = {};
+        DDS_HEADER_DXT10 dx10header = {};
+
+        header.size = sizeof(DDS_HEADER);
+        header.flags = DDS_HEADER_FLAGS_TEXTURE;
+        header.width = texture.width;
+        header.height = texture.height;
+        header.depth = 1;
+        header.mipMapCount = texture.mipLevels;
+        header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+        header.ddspf.flags = DDS_FOURCC;
+        header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+
+        dx10header.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+        dx10header.arraySize = texture.arraySize;
+
+        for (const FormatMapping& mapping : g_FormatMappings)
+        {
+            if (mapping.nvrhiFormat == texture.format)
+            {
+                dx10header.dxgiFormat = mapping.dxgiFormat;
+                break;
+            }
+        }
+
+        if (dx10header.dxgiFormat == DXGI_FORMAT_UNKNOWN)
+        {
+            // Unsupported
+            return nullptr;
+        }
+
+        TextureData textureInfo = {};
+        textureInfo.format = texture.format;
+        textureInfo.arraySize = texture.arraySize;
+        textureInfo.width = texture.width;
+        textureInfo.height = texture.height;
+        textureInfo.depth = 1;
+        textureInfo.dimension = texture.dimension;
+        textureInfo.mipLevels = texture.mipLevels;
+
+        ptrdiff_t dataOffset = sizeof(uint32_t)
+            + sizeof(DDS_HEADER)
+            + sizeof(DDS_HEADER_DXT10);
+
+        size_t dataSize = FillTextureInfoOffsets(textureInfo, 0, dataOffset);
+
+        char* data = reinterpret_cast<char*>(malloc(dataSize));
+        *reinterpret_cast<uint32_t*>(data) = DDS_MAGIC;
+        *reinterpret_cast<DDS_HEADER*>(data + sizeof(uint32_t)) = header;
+        *reinterpret_cast<DDS_HEADER_DXT10*>(data + sizeof(uint32_t) + sizeof(DDS_HEADER)) = dx10header;
+
+        const char* sourceData = static_cast<const char*>(texture.data->data());
+
+        for (uint32_t arraySlice = 0; arraySlice < texture.arraySize; arraySlice++)
+        {
+            if (texture.dataLayout[arraySlice].size() < texture.mipLevels)
+            {
+                free(data);
+                return nullptr;
+            }
+
+            for (uint32_t mipLevel = 0; mipLevel < texture.mipLevels; mipLevel++)
+            {
+                const TextureSubresourceData& source = texture.dataLayout[arraySlice][mipLevel];
+                const TextureSubresourceData& dest = textureInfo.dataLayout[arraySlice][mipLevel];
+
+                // the rows of the source can be padded
+                const size_t numRows = dest.dataSize / dest.rowPitch;
+                for (size_t row = 0; row < numRows; row++)
+                {
+                    memcpy(data + dest.dataOffset + dest.rowPitch * row, sourceData + source.dataOffset + source.rowPitch * row, dest.rowPitch);
+                }
+            }
+        }
+
+        return std::make_shared<Blob>(data, dataSize);
+    }
 }
\ No newline at end of file
@@ -24,6 +24,9 @@
 #include <cgltf.h>
 
 #include <donut/engine/GltfImporter.h>
+#include <donut/engine/MeshLods.h>
+#include <donut/engine/MeshOptimizer.h>
+#include <donut/engine/SceneCache.h>
 #include <donut/engine/TextureCache.h>
 #include <donut/engine/SceneGraph.h>
 #include <donut/core/vfs/VFS.h>
@@ -31,39 +34,18 @@
 
 #include "nvrhi/common/misc.h"
 
+#include <atomic>
+#include <thread>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
 using namespace donut::math;
 using namespace donut::vfs;
 using namespace donut::engine;
 
 
-class BufferRegionBlob : public IBlob
-{
-private:
-    std::shared_ptr<IBlob> m_parent;
-    const void* m_data;
-    size_t m_size;
-
-public:
-    BufferRegionBlob(const std::shared_ptr<IBlob>& parent, size_t offset, size_t size)
-        : m_parent(parent)
-        , m_data(static_cast<const uint8_t*>(parent->data()) + offset)
-        , m_size(size)
-    {
-    }
-
-    [[nodiscard]] const void* data() const override
-    {
-        return m_data;
-    }
-
-    [[nodiscard]] size_t size() const override
-    {
-        return m_size;
-    }
-};
-
-
-
 GltfImporter::GltfImporter(std::shared_ptr<vfs::IFileSystem> fs, std::shared_ptr<SceneTypeFactory> sceneTypeFactory)
     : m_fs(std::move(fs))
     , m_SceneTypeFactory(std::move(sceneTypeFactory))
@@ -75,6 +57,7 @@ struct cgltf_vfs_context
 {
     std::shared_ptr<donut::vfs::IFileSystem> fs;
     std::vector<std::shared_ptr<IBlob>> blobs;
+    std::vector<std::string> paths;
 };
 
 static cgltf_result cgltf_read_file_vfs(const struct cgltf_memory_options* memory_options,
@@ -88,6 +71,7 @@ static cgltf_result cgltf_read_file_vfs(const struct cgltf_memory_options* memor
         return cgltf_result_file_not_found;
 
     context->blobs.push_back(blob);
+    context->paths.push_back(path);
 
     if (size) *size = blob->size();
     if (data) *data = (void*)blob->data();  // NOLINT(clang-diagnostic-cast-qual)
@@ -208,6 +192,390 @@ static std::pair<const uint8_t*, size_t> cgltf_buffer_iterator(const cgltf_acces
     return std::make_pair(data, stride);
 }
 
+// Temporary storage for tangent generation, reused between the primitives converted on one thread
+struct TangentScratch
+{
+    std::vector<float3> tangents;
+    std::vector<float3> bitangents;
+};
+
+// Converts the vertex attributes and indices of a triangle primitive into the buffer group arrays at the given offsets.
+// Primitives write disjoint ranges of the arrays, so they can be converted in parallel.
+static dm::box3 ConvertPrimitive(const cgltf_primitive& prim, BufferGroup& buffers, size_t indexOffset, size_t vertexOffset,
+    bool forceRebuildTangents, TangentScratch& scratch)
+{
+    if (prim.indices)
+    {
+        assert(prim.indices->component_type == cgltf_component_type_r_32u ||
+            prim.indices->component_type == cgltf_component_type_r_16u ||
+            prim.indices->component_type == cgltf_component_type_r_8u);
+        assert(prim.indices->type == cgltf_type_scalar);
+    }
+
+    const cgltf_accessor* positions = nullptr;
+    const cgltf_accessor* normals = nullptr;
+    const cgltf_accessor* tangents = nullptr;
+    const cgltf_accessor* texcoords = nullptr;
+    const cgltf_accessor* joint_weights = nullptr;
+    const cgltf_accessor* joint_indices = nullptr;
+    
+    for (size_t attr_idx = 0; attr_idx < prim.attributes_count; attr_idx++)
+    {
+        const cgltf_attribute& attr = prim.attributes[attr_idx];
+
+        // ReSharper disable once CppIncompleteSwitchStatement
+        // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+        switch(attr.type)  // NOLINT(clang-diagnostic-switch)
+        {
+        case cgltf_attribute_type_position:
+            assert(attr.data->type == cgltf_type_vec3);
+            assert(attr.data->component_type == cgltf_component_type_r_32f);
+            positions = attr.data;
+            break;
+        case cgltf_attribute_type_normal:
+            assert(attr.data->type == cgltf_type_vec3);
+            assert(attr.data->component_type == cgltf_component_type_r_32f);
+            normals = attr.data;
+            break;
+        case cgltf_attribute_type_tangent:
+            assert(attr.data->type == cgltf_type_vec4);
+            assert(attr.data->component_type == cgltf_component_type_r_32f);
+            tangents = attr.data;
+            break;
+        case cgltf_attribute_type_texcoord:
+            assert(attr.data->type == cgltf_type_vec2);
+            assert(attr.data->component_type == cgltf_component_type_r_32f);
+            if (attr.index == 0)
+                texcoords = attr.data;
+            break;
+        case cgltf_attribute_type_joints:
+            assert(attr.data->type == cgltf_type_vec4);
+            assert(attr.data->component_type == cgltf_component_type_r_8u || attr.data->component_type == cgltf_component_type_r_16u);
+            joint_indices = attr.data;
+            break;
+        case cgltf_attribute_type_weights:
+            assert(attr.data->type == cgltf_type_vec4);
+            assert(attr.data->component_type == cgltf_component_type_r_8u || attr.data->component_type == cgltf_component_type_r_16u || attr.data->component_type == cgltf_component_type_r_32f);
+            joint_weights = attr.data;
+            break;
+        }
+    }
+
+    assert(positions);
+
+    size_t indexCount = 0;
+
+    if (prim.indices)
+    {
+        indexCount = prim.indices->count;
+
+        // copy the indices
+        auto [indexSrc, indexStride] = cgltf_buffer_iterator(prim.indices, 0);
+
+        uint32_t* indexDst = buffers.indexData.data() + indexOffset;
+
+        switch(prim.indices->component_type)
+        {
+        case cgltf_component_type_r_8u:
+            if (!indexStride) indexStride = sizeof(uint8_t);
+            for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
+            {
+                *indexDst = *(const uint8_t*)indexSrc;
+
+                indexSrc += indexStride;
+                indexDst++;
+            }
+            break;
+        case cgltf_component_type_r_16u:
+            if (!indexStride) indexStride = sizeof(uint16_t);
+            for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
+            {
+                *indexDst = *(const uint16_t*)indexSrc;
+
+                indexSrc += indexStride;
+                indexDst++;
+            }
+            break;
+        case cgltf_component_type_r_32u:
+            if (!indexStride) indexStride = sizeof(uint32_t);
+            for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
+            {
+                *indexDst = *(const uint32_t*)indexSrc;
+
+                indexSrc += indexStride;
+                indexDst++;
+            }
+            break;
+        default: 
+            assert(false);
+        }
+    }
+    else
+    {
+        indexCount = positions->count;
+
+        // generate the indices
+        uint32_t* indexDst = buffers.indexData.data() + indexOffset;
+        for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
+        {
+            *indexDst = (uint32_t)i_idx;
+            indexDst++;
+        }
+    }
+
+    dm::box3 bounds = dm::box3::empty();
+
+    if (positions)
+    {
+        auto [positionSrc, positionStride] = cgltf_buffer_iterator(positions, sizeof(float) * 3);
+        float3* positionDst = buffers.positionData.data() + vertexOffset;
+
+        for (size_t v_idx = 0; v_idx < positions->count; v_idx++)
+        {
+            *positionDst = (const float*)positionSrc;
+
+            bounds |= *positionDst;
+
+            positionSrc += positionStride;
+            ++positionDst;
+        }
+    }
+
+    if (normals)
+    {
+        assert(normals->count == positions->count);
+
+        auto [normalSrc, normalStride] = cgltf_buffer_iterator(normals, sizeof(float) * 3);
+        uint32_t* normalDst = buffers.normalData.data() + vertexOffset;
+
+        for (size_t v_idx = 0; v_idx < normals->count; v_idx++)
+        {
+            float3 normal = (const float*)normalSrc;
+            *normalDst = vectorToSnorm8(normal);
+
+            normalSrc += normalStride;
+            ++normalDst;
+        }
+    }
+
+    if (tangents)
+    {
+        assert(tangents->count == positions->count);
+
+        auto [tangentSrc, tangentStride] = cgltf_buffer_iterator(tangents, sizeof(float) * 4);
+        uint32_t* tangentDst = buffers.tangentData.data() + vertexOffset;
+        
+        for (size_t v_idx = 0; v_idx < tangents->count; v_idx++)
+        {
+            float4 tangent = (const float*)tangentSrc;
+            *tangentDst = vectorToSnorm8(tangent);
+
+            tangentSrc += tangentStride;
+            ++tangentDst;
+        }
+    }
+
+    if (texcoords)
+    {
+        assert(texcoords->count == positions->count);
+
+        auto [texcoordSrc, texcoordStride] = cgltf_buffer_iterator(texcoords, sizeof(float) * 2);
+        float2* texcoordDst = buffers.texcoord1Data.data() + vertexOffset;
+
+        for (size_t v_idx = 0; v_idx < texcoords->count; v_idx++)
+        {
+            *texcoordDst = (const float*)texcoordSrc;
+
+            texcoordSrc += texcoordStride;
+            ++texcoordDst;
+        }
+    }
+    else
+    {
+        float2* texcoordDst = buffers.texcoord1Data.data() + vertexOffset;
+        for (size_t v_idx = 0; v_idx < positions->count; v_idx++)
+        {
+            *texcoordDst = float2(0.f);
+            ++texcoordDst;
+        }
+    }
+
+    if (normals && texcoords && (!tangents || forceRebuildTangents))
+    {
+        auto [positionSrc, positionStride] = cgltf_buffer_iterator(positions, sizeof(float) * 3);
+        auto [texcoordSrc, texcoordStride] = cgltf_buffer_iterator(texcoords, sizeof(float) * 2);
+        auto [normalSrc, normalStride] = cgltf_buffer_iterator(normals, sizeof(float) * 3);
+        const uint32_t* indexSrc = buffers.indexData.data() + indexOffset;
+
+        scratch.tangents.resize(positions->count);
+        std::fill(scratch.tangents.begin(), scratch.tangents.end(), float3(0.f));
+
+        scratch.bitangents.resize(positions->count);
+        std::fill(scratch.bitangents.begin(), scratch.bitangents.end(), float3(0.f));
+
+        for (size_t t_idx = 0; t_idx < indexCount / 3; t_idx++)
+        {
+            uint3 tri = indexSrc;
+            indexSrc += 3;
+
+            float3 p0 = (const float*)(positionSrc + positionStride * tri.x);
+            float3 p1 = (const float*)(positionSrc + positionStride * tri.y);
+            float3 p2 = (const float*)(positionSrc + positionStride * tri.z);
+
+            float2 t0 = (const float*)(texcoordSrc + texcoordStride * tri.x);
+            float2 t1 = (const float*)(texcoordSrc + texcoordStride * tri.y);
+            float2 t2 = (const float*)(texcoordSrc + texcoordStride * tri.z);
+
+            float3 dPds = p1 - p0;
+            float3 dPdt = p2 - p0;
+
+            float2 dTds = t1 - t0;
+            float2 dTdt = t2 - t0;
+            float r = 1.0f / (dTds.x * dTdt.y - dTds.y * dTdt.x);
+            float3 tangent = r * (dPds * dTdt.y - dPdt * dTds.y);
+            float3 bitangent = r * (dPdt * dTds.x - dPds * dTdt.x);
+
+            float tangentLength = length(tangent);
+            float bitangentLength = length(bitangent);
+            if (tangentLength > 0 && bitangentLength > 0)
+            {
+                tangent /= tangentLength;
+                bitangent /= bitangentLength;
+
+                scratch.tangents[tri.x] += tangent;
+                scratch.tangents[tri.y] += tangent;
+                scratch.tangents[tri.z] += tangent;
+                scratch.bitangents[tri.x] += bitangent;
+                scratch.bitangents[tri.y] += bitangent;
+                scratch.bitangents[tri.z] += bitangent;
+            }
+        }
+
+        uint8_t* tangentSrc = nullptr;
+        size_t tangentStride = 0;
+        if (tangents)
+        {
+            auto pair = cgltf_buffer_iterator(tangents, sizeof(float) * 4);
+            tangentSrc = const_cast<uint8_t*>(pair.first);
+            tangentStride = pair.second;
+        }
+
+        uint32_t* tangentDst = buffers.tangentData.data() + vertexOffset;
+
+        for (size_t v_idx = 0; v_idx < positions->count; v_idx++)
+        {
+            float3 normal = (const float*)normalSrc;
+            float3 tangent = scratch.tangents[v_idx];
+            float3 bitangent = scratch.bitangents[v_idx];
+
+            float sign = 0;
+            float tangentLength = length(tangent);
+            float bitangentLength = length(bitangent);
+            if (tangentLength > 0 && bitangentLength > 0)
+            {
+                tangent /= tangentLength;
+                bitangent /= bitangentLength;
+                float3 cross_b = cross(normal, tangent);
+                sign = (dot(cross_b, bitangent) > 0) ? -1.f : 1.f;
+            }
+
+            *tangentDst = vectorToSnorm8(float4(tangent, sign));
+
+            if (forceRebuildTangents && tangents)
+            {
+                *(float4*)tangentSrc = float4(tangent, sign);
+                tangentSrc += tangentStride;
+            }
+            
+            normalSrc += normalStride;
+            ++tangentDst;
+        }
+    }
+
+    if (joint_indices)
+    {
+        assert(joint_indices->count == positions->count);
+
+        auto [jointSrc, jointStride] = cgltf_buffer_iterator(joint_indices, 0);
+        vector<uint16_t, 4>* jointDst = buffers.jointData.data() + vertexOffset;
+
+        if (joint_indices->component_type == cgltf_component_type_r_8u)
+        {
+            for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
+            {
+                *jointDst = dm::vector<uint16_t, 4>(jointSrc[0], jointSrc[1], jointSrc[2], jointSrc[3]);
+
+                jointSrc += jointStride;
+                ++jointDst;
+            }
+        }
+        else
+        {
+            assert(joint_indices->component_type == cgltf_component_type_r_16u);
+            for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
+            {
+                const uint16_t* jointSrcUshort = (const uint16_t*)jointSrc;
+                *jointDst = dm::vector<uint16_t, 4>(jointSrcUshort[0], jointSrcUshort[1], jointSrcUshort[2], jointSrcUshort[3]);
+
+                jointSrc += jointStride;
+                ++jointDst;
+            }
+        }
+    }
+
+    if (joint_weights)
+    {
+        assert(joint_weights->count == positions->count);
+
+        auto [weightSrc, weightStride] = cgltf_buffer_iterator(joint_weights, 0);
+        float4* weightDst = buffers.weightData.data() + vertexOffset;
+
+        if (joint_weights->component_type == cgltf_component_type_r_8u)
+        {
+            for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
+            {
+                *weightDst = dm::float4(
+                    float(weightSrc[0]) / 255.f,
+                    float(weightSrc[1]) / 255.f,
+                    float(weightSrc[2]) / 255.f,
+                    float(weightSrc[3]) / 255.f);
+
+                weightSrc += weightStride;
+                ++weightDst;
+            }
+        }
+        else if (joint_weights->component_type == cgltf_component_type_r_16u)
+        {
+            for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
+            {
+                const uint16_t* weightSrcUshort = (const uint16_t*)weightSrc;
+                *weightDst = dm::float4(
+                    float(weightSrcUshort[0]) / 65535.f,
+                    float(weightSrcUshort[1]) / 65535.f,
+                    float(weightSrcUshort[2]) / 65535.f,
+                    float(weightSrcUshort[3]) / 65535.f);
+                
+                weightSrc += weightStride;
+                ++weightDst;
+            }
+        }
+        else
+        {
+            assert(joint_weights->component_type == cgltf_component_type_r_32f);
+            for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
+            {
+                *weightDst = (const float*)weightSrc;
+
+                weightSrc += weightStride;
+                ++weightDst;
+            }
+        }
+    }
+
+    return bounds;
+}
+
+
 bool GltfImporter::Load(
     const std::filesystem::path& fileName,
     TextureCache& textureCache,
@@ -225,6 +593,18 @@ bool GltfImporter::Load(
 
     result.rootNode.reset();
 
+    // the cached data depends on the import options
+    uint32_t importOptions = m_OptimizeMeshes ? 1u : 0u;
+    if (m_LodSettings.IsEnabled())
+    {
+        importOptions |= std::min(m_LodSettings.lodCount, 255u) << 8;
+        importOptions |= uint32_t(std::clamp(m_LodSettings.reduction, 0.f, 1.f) * 255.f) << 16;
+        importOptions |= uint32_t(std::clamp(m_LodSettings.attributeWeight, 0.f, 1.f) * 255.f) << 24;
+    }
+
+    if (m_SceneCache && m_SceneCache->Load(fileName, *m_fs, importOptions, m_SceneTypeFactory, textureCache, executor, result))
+        return true;
+
     cgltf_vfs_context vfsContext;
     vfsContext.fs = m_fs;
 
@@ -252,7 +632,11 @@ bool GltfImporter::Load(
 
     std::unordered_map<const cgltf_image*, std::shared_ptr<LoadedTexture>> textures;
 
-    auto load_texture = [this, &textures, &textureCache, executor, &fileName, objects, &vfsContext, c_SearchForDds](const cgltf_texture* texture, bool sRGB)
+    // What the scene cache needs to request the textures again
+    std::vector<SceneCacheTexture> cacheTextures;
+    bool cacheable = true;
+
+    auto load_texture = [this, &textures, &cacheTextures, &cacheable, &textureCache, executor, &fileName, objects, &vfsContext, c_SearchForDds](const cgltf_texture* texture, bool sRGB)
     {
         if (!texture)
             return std::shared_ptr<LoadedTexture>(nullptr);
@@ -271,6 +655,8 @@ bool GltfImporter::Load(
             return it->second;
 
         std::shared_ptr<LoadedTexture> loadedTexture;
+        SceneCacheTexture cacheTexture;
+        cacheTexture.sRGB = sRGB;
 
         if (activeImage->buffer_view)
         {
@@ -283,8 +669,9 @@ bool GltfImporter::Load(
             std::shared_ptr<IBlob> textureData;
 
             // Try to find an existing file blob that includes our data.
-            for (const auto& blob : vfsContext.blobs)
+            for (size_t blobIndex = 0; blobIndex < vfsContext.blobs.size(); blobIndex++)
             {
+                const auto& blob = vfsContext.blobs[blobIndex];
                 const uint8_t* blobData = static_cast<const uint8_t*>(blob->data());
                 const size_t blobSize = blob->size();
 
@@ -293,13 +680,18 @@ bool GltfImporter::Load(
                     // Found the file blob - create a range blob out of it and keep a strong reference.
                     assert(dataPtr + dataSize <= blobData + blobSize);
                     textureData = std::make_shared<BufferRegionBlob>(blob, dataPtr - blobData, dataSize);
+                    cacheTexture.sourceFileIndex = uint32_t(blobIndex);
+                    cacheTexture.dataOffset = dataPtr - blobData;
+                    cacheTexture.dataSize = dataSize;
                     break;
                 }
             }
 
             // Didn't find a file blob - copy the data into a new container.
+            // The scene cache can't locate such data in the source files, so don't cache the model.
             if (!textureData)
             {
+                cacheable = false;
                 void* dataCopy = malloc(dataSize);
                 assert(dataCopy);
                 memcpy(dataCopy, dataPtr, dataSize);
@@ -316,6 +708,9 @@ bool GltfImporter::Load(
             else
 #endif
                 loadedTexture = textureCache.LoadTextureFromMemoryDeferred(textureData, name, mimeType, sRGB);
+
+            cacheTexture.path = name;
+            cacheTexture.mimeType = mimeType;
         }
         else
         {
@@ -339,12 +734,17 @@ bool GltfImporter::Load(
             else
 #endif
                 loadedTexture = textureCache.LoadTextureFromFileDeferred(filePath, sRGB);
+
+            cacheTexture.path = filePath.generic_string();
         }
         textures[activeImage] = loadedTexture;
+        cacheTexture.texture = loadedTexture;
+        cacheTextures.push_back(std::move(cacheTexture));
         return loadedTexture;
     };
 
     std::unordered_map<const cgltf_material*, std::shared_ptr<Material>> materials;
+    std::vector<std::shared_ptr<Material>> materialList;
     
     for (size_t mat_idx = 0; mat_idx < objects->materials_count; mat_idx++)
     {
@@ -416,6 +816,7 @@ bool GltfImporter::Load(
         }
 
         materials[&material] = matinfo;
+        materialList.push_back(matinfo);
     }
     
     size_t totalIndices = 0;
@@ -471,15 +872,24 @@ bool GltfImporter::Load(
         buffers->weightData.resize(totalVertices);
     }
 
-    totalIndices = 0;
-    totalVertices = 0;
-
     std::unordered_map<const cgltf_mesh*, std::shared_ptr<MeshInfo>> meshMap;
-
-    std::vector<float3> computedTangents;
-    std::vector<float3> computedBitangents;
     std::vector<std::shared_ptr<MeshInfo>> meshes;
 
+    struct PrimitiveConversion
+    {
+        const cgltf_primitive* primitive;
+        MeshGeometry* geometry;
+        size_t indexOffset;
+        size_t vertexOffset;
+        MeshOptimizationStatistics statistics;
+        std::vector<MeshLodLevel> lods;
+    };
+    std::vector<PrimitiveConversion> primitiveConversions;
+
+    totalIndices = 0;
+    totalVertices = 0;
+
+    // Create the meshes and geometries and assign their ranges in the buffer group first, then fill the ranges.
     for (size_t mesh_idx = 0; mesh_idx < objects->meshes_count; mesh_idx++)
     {
         const cgltf_mesh& mesh = objects->meshes[mesh_idx];
@@ -501,388 +911,131 @@ bool GltfImporter::Load(
                 prim.attributes_count == 0)
                 continue;
 
-            if (prim.indices)
-            {
-                assert(prim.indices->component_type == cgltf_component_type_r_32u ||
-                    prim.indices->component_type == cgltf_component_type_r_16u ||
-                    prim.indices->component_type == cgltf_component_type_r_8u);
-                assert(prim.indices->type == cgltf_type_scalar);
-            }
+            const size_t vertexCount = prim.attributes->data->count;
+            const size_t indexCount = prim.indices ? prim.indices->count : vertexCount;
 
-            const cgltf_accessor* positions = nullptr;
-            const cgltf_accessor* normals = nullptr;
-            const cgltf_accessor* tangents = nullptr;
-            const cgltf_accessor* texcoords = nullptr;
-            const cgltf_accessor* joint_weights = nullptr;
-            const cgltf_accessor* joint_indices = nullptr;
-            
-            for (size_t attr_idx = 0; attr_idx < prim.attributes_count; attr_idx++)
-            {
-                const cgltf_attribute& attr = prim.attributes[attr_idx];
-
-                // ReSharper disable once CppIncompleteSwitchStatement
-                // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-                switch(attr.type)  // NOLINT(clang-diagnostic-switch)
-                {
-                case cgltf_attribute_type_position:
-                    assert(attr.data->type == cgltf_type_vec3);
-                    assert(attr.data->component_type == cgltf_component_type_r_32f);
-                    positions = attr.data;
-                    break;
-                case cgltf_attribute_type_normal:
-                    assert(attr.data->type == cgltf_type_vec3);
-                    assert(attr.data->component_type == cgltf_component_type_r_32f);
-                    normals = attr.data;
-                    break;
-                case cgltf_attribute_type_tangent:
-                    assert(attr.data->type == cgltf_type_vec4);
-                    assert(attr.data->component_type == cgltf_component_type_r_32f);
-                    tangents = attr.data;
-                    break;
-                case cgltf_attribute_type_texcoord:
-                    assert(attr.data->type == cgltf_type_vec2);
-                    assert(attr.data->component_type == cgltf_component_type_r_32f);
-                    if (attr.index == 0)
-                        texcoords = attr.data;
-                    break;
-                case cgltf_attribute_type_joints:
-                    assert(attr.data->type == cgltf_type_vec4);
-                    assert(attr.data->component_type == cgltf_component_type_r_8u || attr.data->component_type == cgltf_component_type_r_16u);
-                    joint_indices = attr.data;
-                    break;
-                case cgltf_attribute_type_weights:
-                    assert(attr.data->type == cgltf_type_vec4);
-                    assert(attr.data->component_type == cgltf_component_type_r_8u || attr.data->component_type == cgltf_component_type_r_16u || attr.data->component_type == cgltf_component_type_r_32f);
-                    joint_weights = attr.data;
-                    break;
-                }
-            }
-
-            assert(positions);
-
-            size_t indexCount = 0;
-
-            if (prim.indices)
-            {
-                indexCount = prim.indices->count;
-
-                // copy the indices
-                auto [indexSrc, indexStride] = cgltf_buffer_iterator(prim.indices, 0);
-
-                uint32_t* indexDst = buffers->indexData.data() + totalIndices;
-
-                switch(prim.indices->component_type)
-                {
-                case cgltf_component_type_r_8u:
-                    if (!indexStride) indexStride = sizeof(uint8_t);
-                    for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
-                    {
-                        *indexDst = *(const uint8_t*)indexSrc;
-
-                        indexSrc += indexStride;
-                        indexDst++;
-                    }
-                    break;
-                case cgltf_component_type_r_16u:
-                    if (!indexStride) indexStride = sizeof(uint16_t);
-                    for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
-                    {
-                        *indexDst = *(const uint16_t*)indexSrc;
-
-                        indexSrc += indexStride;
-                        indexDst++;
-                    }
-                    break;
-                case cgltf_component_type_r_32u:
-                    if (!indexStride) indexStride = sizeof(uint32_t);
-                    for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
-                    {
-                        *indexDst = *(const uint32_t*)indexSrc;
-
-                        indexSrc += indexStride;
-                        indexDst++;
-                    }
-                    break;
-                default: 
-                    assert(false);
-                }
-            }
-            else
-            {
-                indexCount = positions->count;
-
-                // generate the indices
-                uint32_t* indexDst = buffers->indexData.data() + totalIndices;
-                for (size_t i_idx = 0; i_idx < indexCount; i_idx++)
-                {
-                    *indexDst = (uint32_t)i_idx;
-                    indexDst++;
-                }
-            }
+            auto geometry = m_SceneTypeFactory->CreateMeshGeometry();
+            geometry->material = materials[prim.material];
+            geometry->indexOffsetInMesh = minfo->totalIndices;
+            geometry->vertexOffsetInMesh = minfo->totalVertices;
+            geometry->numIndices = (uint32_t)indexCount;
+            geometry->numVertices = (uint32_t)vertexCount;
+            minfo->totalIndices += geometry->numIndices;
+            minfo->totalVertices += geometry->numVertices;
+            minfo->geometries.push_back(geometry);
 
-            dm::box3 bounds = dm::box3::empty();
+            primitiveConversions.push_back({ &prim, geometry.get(), totalIndices, totalVertices, {} });
 
-            if (positions)
-            {
-                auto [positionSrc, positionStride] = cgltf_buffer_iterator(positions, sizeof(float) * 3);
-                float3* positionDst = buffers->positionData.data() + totalVertices;
+            totalIndices += geometry->numIndices;
+            totalVertices += geometry->numVertices;
+        }
+    }
 
-                for (size_t v_idx = 0; v_idx < positions->count; v_idx++)
-                {
-                    *positionDst = (const float*)positionSrc;
+    // The primitives are taken from a shared counter. The counters are shared with the tasks,
+    // which can outlive this function, see below.
+    struct ConversionState
+    {
+        std::atomic<size_t> nextPrimitive = 0;
+        std::atomic<size_t> convertedPrimitives = 0;
+        size_t primitiveCount = 0;
+    };
+    auto conversionState = std::make_shared<ConversionState>();
+    conversionState->primitiveCount = primitiveConversions.size();
 
-                    bounds |= *positionDst;
+    const bool optimizeMeshes = m_OptimizeMeshes;
+    const MeshLodSettings lodSettings = m_LodSettings;
 
-                    positionSrc += positionStride;
-                    ++positionDst;
-                }
-            }
+    auto convertPrimitives = [&primitiveConversions, &buffers, c_ForceRebuildTangents, optimizeMeshes, &lodSettings](ConversionState& state)
+    {
+        TangentScratch scratch;
+        for (size_t index = state.nextPrimitive++; index < state.primitiveCount; index = state.nextPrimitive++)
+        {
+            PrimitiveConversion& conversion = primitiveConversions[index];
+            conversion.geometry->objectSpaceBounds = ConvertPrimitive(*conversion.primitive, *buffers,
+                conversion.indexOffset, conversion.vertexOffset, c_ForceRebuildTangents, scratch);
 
-            if (normals)
+            if (optimizeMeshes)
             {
-                assert(normals->count == positions->count);
-
-                auto [normalSrc, normalStride] = cgltf_buffer_iterator(normals, sizeof(float) * 3);
-                uint32_t* normalDst = buffers->normalData.data() + totalVertices;
-
-                for (size_t v_idx = 0; v_idx < normals->count; v_idx++)
-                {
-                    float3 normal = (const float*)normalSrc;
-                    *normalDst = vectorToSnorm8(normal);
-
-                    normalSrc += normalStride;
-                    ++normalDst;
-                }
+                conversion.statistics = OptimizeGeometryBuffers(*buffers, conversion.indexOffset, conversion.geometry->numIndices,
+                    conversion.vertexOffset, conversion.geometry->numVertices);
             }
 
-            if (tangents)
+            if (lodSettings.IsEnabled())
             {
-                assert(tangents->count == positions->count);
-
-                auto [tangentSrc, tangentStride] = cgltf_buffer_iterator(tangents, sizeof(float) * 4);
-                uint32_t* tangentDst = buffers->tangentData.data() + totalVertices;
-                
-                for (size_t v_idx = 0; v_idx < tangents->count; v_idx++)
-                {
-                    float4 tangent = (const float*)tangentSrc;
-                    *tangentDst = vectorToSnorm8(tangent);
-
-                    tangentSrc += tangentStride;
-                    ++tangentDst;
-                }
+                conversion.lods = SimplifyGeometryLods(*buffers, conversion.indexOffset, conversion.geometry->numIndices,
+                    conversion.vertexOffset, conversion.geometry->numVertices, lodSettings);
             }
 
-            if (texcoords)
-            {
-                assert(texcoords->count == positions->count);
-
-                auto [texcoordSrc, texcoordStride] = cgltf_buffer_iterator(texcoords, sizeof(float) * 2);
-                float2* texcoordDst = buffers->texcoord1Data.data() + totalVertices;
-
-                for (size_t v_idx = 0; v_idx < texcoords->count; v_idx++)
-                {
-                    *texcoordDst = (const float*)texcoordSrc;
-
-                    texcoordSrc += texcoordStride;
-                    ++texcoordDst;
-                }
-            }
-            else
-            {
-                float2* texcoordDst = buffers->texcoord1Data.data() + totalVertices;
-                for (size_t v_idx = 0; v_idx < positions->count; v_idx++)
-                {
-                    *texcoordDst = float2(0.f);
-                    ++texcoordDst;
-                }
-            }
+            ++state.convertedPrimitives;
+        }
+    };
 
-            if (normals && texcoords && (!tangents || c_ForceRebuildTangents))
+#ifdef DONUT_WITH_TASKFLOW
+    if (executor && primitiveConversions.size() > 1)
+    {
+        // Load usually runs on one of the executor's workers, and all workers might be busy loading other models,
+        // so don't wait for the tasks to start: this thread converts primitives as well, and then only waits
+        // for the primitives taken by other threads. Tasks that start later find no work left.
+        const size_t taskCount = std::min(primitiveConversions.size() - 1, executor->num_workers());
+        for (size_t taskIndex = 0; taskIndex < taskCount; taskIndex++)
+        {
+            executor->silent_async([conversionState, convertPrimitives]()
             {
-                auto [positionSrc, positionStride] = cgltf_buffer_iterator(positions, sizeof(float) * 3);
-                auto [texcoordSrc, texcoordStride] = cgltf_buffer_iterator(texcoords, sizeof(float) * 2);
-                auto [normalSrc, normalStride] = cgltf_buffer_iterator(normals, sizeof(float) * 3);
-                const uint32_t* indexSrc = buffers->indexData.data() + totalIndices;
-
-                computedTangents.resize(positions->count);
-                std::fill(computedTangents.begin(), computedTangents.end(), float3(0.f));
-
-                computedBitangents.resize(positions->count);
-                std::fill(computedBitangents.begin(), computedBitangents.end(), float3(0.f));
-
-                for (size_t t_idx = 0; t_idx < indexCount / 3; t_idx++)
-                {
-                    uint3 tri = indexSrc;
-                    indexSrc += 3;
-
-                    float3 p0 = (const float*)(positionSrc + positionStride * tri.x);
-                    float3 p1 = (const float*)(positionSrc + positionStride * tri.y);
-                    float3 p2 = (const float*)(positionSrc + positionStride * tri.z);
-
-                    float2 t0 = (const float*)(texcoordSrc + texcoordStride * tri.x);
-                    float2 t1 = (const float*)(texcoordSrc + texcoordStride * tri.y);
-                    float2 t2 = (const float*)(texcoordSrc + texcoordStride * tri.z);
-
-                    float3 dPds = p1 - p0;
-                    float3 dPdt = p2 - p0;
-
-                    float2 dTds = t1 - t0;
-                    float2 dTdt = t2 - t0;
-                    float r = 1.0f / (dTds.x * dTdt.y - dTds.y * dTdt.x);
-                    float3 tangent = r * (dPds * dTdt.y - dPdt * dTds.y);
-                    float3 bitangent = r * (dPdt * dTds.x - dPds * dTdt.x);
-
-                    float tangentLength = length(tangent);
-                    float bitangentLength = length(bitangent);
-                    if (tangentLength > 0 && bitangentLength > 0)
-                    {
-                        tangent /= tangentLength;
-                        bitangent /= bitangentLength;
-
-                        computedTangents[tri.x] += tangent;
-                        computedTangents[tri.y] += tangent;
-                        computedTangents[tri.z] += tangent;
-                        computedBitangents[tri.x] += bitangent;
-                        computedBitangents[tri.y] += bitangent;
-                        computedBitangents[tri.z] += bitangent;
-                    }
-                }
+                convertPrimitives(*conversionState);
+            });
+        }
 
-                uint8_t* tangentSrc = nullptr;
-                size_t tangentStride = 0;
-                if (tangents)
-                {
-                    auto pair = cgltf_buffer_iterator(tangents, sizeof(float) * 4);
-                    tangentSrc = const_cast<uint8_t*>(pair.first);
-                    tangentStride = pair.second;
-                }
+        convertPrimitives(*conversionState);
 
-                uint32_t* tangentDst = buffers->tangentData.data() + totalVertices;
+        while (conversionState->convertedPrimitives < primitiveConversions.size())
+            std::this_thread::yield();
+    }
+    else
+#endif
+    {
+        convertPrimitives(*conversionState);
+    }
 
-                for (size_t v_idx = 0; v_idx < positions->count; v_idx++)
-                {
-                    float3 normal = (const float*)normalSrc;
-                    float3 tangent = computedTangents[v_idx];
-                    float3 bitangent = computedBitangents[v_idx];
-
-                    float sign = 0;
-                    float tangentLength = length(tangent);
-                    float bitangentLength = length(bitangent);
-                    if (tangentLength > 0 && bitangentLength > 0)
-                    {
-                        tangent /= tangentLength;
-                        bitangent /= bitangentLength;
-                        float3 cross_b = cross(normal, tangent);
-                        sign = (dot(cross_b, bitangent) > 0) ? -1.f : 1.f;
-                    }
+    for (const auto& minfo : meshes)
+    {
+        for (const auto& geometry : minfo->geometries)
+            minfo->objectSpaceBounds |= geometry->objectSpaceBounds;
+    }
 
-                    *tangentDst = vectorToSnorm8(float4(tangent, sign));
+    if (lodSettings.IsEnabled())
+    {
+        // the LOD indices go after the indices of all meshes, and the geometries of each mesh are consecutive in primitiveConversions
+        size_t conversionIndex = 0;
+        for (const auto& minfo : meshes)
+        {
+            std::vector<std::vector<MeshLodLevel>> geometryLods;
+            for (size_t geometryIndex = 0; geometryIndex < minfo->geometries.size(); geometryIndex++, conversionIndex++)
+                geometryLods.push_back(std::move(primitiveConversions[conversionIndex].lods));
 
-                    if (c_ForceRebuildTangents && tangents)
-                    {
-                        *(float4*)tangentSrc = float4(tangent, sign);
-                        tangentSrc += tangentStride;
-                    }
-                    
-                    normalSrc += normalStride;
-                    ++tangentDst;
-                }
-            }
+            AddMeshLods(*minfo, geometryLods);
+        }
+    }
 
-            if (joint_indices)
+    if (optimizeMeshes)
+    {
+        // the geometries of each mesh are consecutive in primitiveConversions
+        size_t conversionIndex = 0;
+        for (const auto& minfo : meshes)
+        {
+            MeshOptimizationStatistics statistics;
+            for (size_t geometryIndex = 0; geometryIndex < minfo->geometries.size(); geometryIndex++, conversionIndex++)
             {
-                assert(joint_indices->count == positions->count);
-
-                auto [jointSrc, jointStride] = cgltf_buffer_iterator(joint_indices, 0);
-                vector<uint16_t, 4>* jointDst = buffers->jointData.data() + totalVertices;
-
-                if (joint_indices->component_type == cgltf_component_type_r_8u)
-                {
-                    for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
-                    {
-                        *jointDst = dm::vector<uint16_t, 4>(jointSrc[0], jointSrc[1], jointSrc[2], jointSrc[3]);
-
-                        jointSrc += jointStride;
-                        ++jointDst;
-                    }
-                }
-                else
-                {
-                    assert(joint_indices->component_type == cgltf_component_type_r_16u);
-                    for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
-                    {
-                        const uint16_t* jointSrcUshort = (const uint16_t*)jointSrc;
-                        *jointDst = dm::vector<uint16_t, 4>(jointSrcUshort[0], jointSrcUshort[1], jointSrcUshort[2], jointSrcUshort[3]);
-
-                        jointSrc += jointStride;
-                        ++jointDst;
-                    }
-                }
+                statistics.before += primitiveConversions[conversionIndex].statistics.before;
+                statistics.after += primitiveConversions[conversionIndex].statistics.after;
             }
 
-            if (joint_weights)
+            if (statistics.before.triangles)
             {
-                assert(joint_weights->count == positions->count);
-
-                auto [weightSrc, weightStride] = cgltf_buffer_iterator(joint_weights, 0);
-                float4* weightDst = buffers->weightData.data() + totalVertices;
-
-                if (joint_weights->component_type == cgltf_component_type_r_8u)
-                {
-                    for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
-                    {
-                        *weightDst = dm::float4(
-                            float(weightSrc[0]) / 255.f,
-                            float(weightSrc[1]) / 255.f,
-                            float(weightSrc[2]) / 255.f,
-                            float(weightSrc[3]) / 255.f);
-
-                        weightSrc += weightStride;
-                        ++weightDst;
-                    }
-                }
-                else if (joint_weights->component_type == cgltf_component_type_r_16u)
-                {
-                    for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
-                    {
-                        const uint16_t* weightSrcUshort = (const uint16_t*)weightSrc;
-                        *weightDst = dm::float4(
-                            float(weightSrcUshort[0]) / 65535.f,
-                            float(weightSrcUshort[1]) / 65535.f,
-                            float(weightSrcUshort[2]) / 65535.f,
-                            float(weightSrcUshort[3]) / 65535.f);
-                        
-                        weightSrc += weightStride;
-                        ++weightDst;
-                    }
-                }
-                else
-                {
-                    assert(joint_weights->component_type == cgltf_component_type_r_32f);
-                    for (size_t v_idx = 0; v_idx < joint_indices->count; v_idx++)
-                    {
-                        *weightDst = (const float*)weightSrc;
-
-                        weightSrc += weightStride;
-                        ++weightDst;
-                    }
-                }
+                log::info("Optimized mesh '%s' (%zu triangles): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                    minfo->name.c_str(), statistics.before.triangles,
+                    statistics.before.GetACMR(), statistics.after.GetACMR(),
+                    statistics.before.GetATVR(), statistics.after.GetATVR());
             }
-
-            auto geometry = m_SceneTypeFactory->CreateMeshGeometry();
-            geometry->material = materials[prim.material];
-            geometry->indexOffsetInMesh = minfo->totalIndices;
-            geometry->vertexOffsetInMesh = minfo->totalVertices;
-            geometry->numIndices = (uint32_t)indexCount;
-            geometry->numVertices = (uint32_t)positions->count;
-            geometry->objectSpaceBounds = bounds;
-            minfo->objectSpaceBounds |= bounds;
-            minfo->totalIndices += geometry->numIndices;
-            minfo->totalVertices += geometry->numVertices;
-            minfo->geometries.push_back(geometry);
-
-            totalIndices += geometry->numIndices;
-            totalVertices += geometry->numVertices;
         }
     }
 
@@ -1277,5 +1430,18 @@ bool GltfImporter::Load(
 
     cgltf_free(objects);
 
+    if (m_SceneCache && cacheable)
+    {
+        SceneCacheContents contents;
+        contents.importOptions = importOptions;
+        contents.sourceFiles = std::move(vfsContext.paths);
+        contents.sourceBlobs = std::move(vfsContext.blobs);
+        contents.textures = std::move(cacheTextures);
+        contents.materials = std::move(materialList);
+        contents.meshes = std::move(meshes);
+        contents.rootNode = root;
+        m_SceneCache->Save(fileName, contents);
+    }
+
     return true;
 }
@@ -0,0 +1,420 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/InstanceBvh.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <algorithm>
+#include <limits>
+
+using namespace donut::math;
+using namespace donut::engine;
+
+static float HalfSurfaceArea(const box3& box)
+{
+    if (box.isempty())
+        return 0.f;
+
+    float3 d = box.diagonal();
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+enum class FrustumTest
+{
+    Outside,
+    Intersects,
+    Inside
+};
+
+// Tests the box against the frustum planes listed in 'planeMask', and removes the planes
+// that the box is fully inside of from the mask.
+static FrustumTest TestBox(const frustum& frustum, const box3& box, uint32_t& planeMask)
+{
+    for (int i = 0; i < frustum::PLANES_COUNT; ++i)
+    {
+        if (!(planeMask & (1u << i)))
+            continue;
+
+        const plane& p = frustum.planes[i];
+
+        // the corner nearest to the inside of the plane
+        float3 nearCorner = select(p.normal > 0.f, box.m_mins, box.m_maxs);
+        if (dot(p.normal, nearCorner) - p.distance > 0.f)
+            return FrustumTest::Outside;
+
+        // the corner farthest from the inside of the plane
+        float3 farCorner = select(p.normal > 0.f, box.m_maxs, box.m_mins);
+        if (dot(p.normal, farCorner) - p.distance <= 0.f)
+            planeMask &= ~(1u << i);
+    }
+
+    return planeMask ? FrustumTest::Intersects : FrustumTest::Inside;
+}
+
+void InstanceBvh::Build(const std::vector<std::shared_ptr<MeshInstance>>& instances)
+{
+    m_Nodes.clear();
+    m_Instances.clear();
+    m_InstanceNodes.clear();
+    m_InstanceBounds.clear();
+    m_InstanceSlots.clear();
+    m_BuildCost = 0.f;
+
+    std::vector<float3> centroids;
+    centroids.reserve(instances.size());
+    m_Instances.reserve(instances.size());
+    m_InstanceNodes.reserve(instances.size());
+    m_InstanceBounds.reserve(instances.size());
+
+    for (const auto& instance : instances)
+    {
+        SceneGraphNode* node = instance->GetNode();
+        if (!node)
+            continue;
+
+        box3 bounds = instance->GetLocalBoundingBox();
+        if (bounds.isempty())
+            continue; // such instances can never be visible
+
+        bounds = bounds * node->GetLocalToWorldTransformFloat();
+
+        m_Instances.push_back(instance.get());
+        m_InstanceNodes.push_back(node);
+        m_InstanceBounds.push_back(bounds);
+        centroids.push_back(bounds.center());
+    }
+
+    const uint32_t count = uint32_t(m_Instances.size());
+    if (count == 0)
+        return;
+
+    // the build sorts a permutation of the instances, which is applied to the instance arrays at the end
+    std::vector<uint32_t> order(count);
+    for (uint32_t i = 0; i < count; i++)
+        order[i] = i;
+
+    struct BuildItem
+    {
+        uint32_t node;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    constexpr int binCount = 16;
+    struct Bin
+    {
+        box3 bounds = box3::empty();
+        uint32_t count = 0;
+    };
+
+    m_Nodes.reserve(size_t(count) * 2);
+    m_Nodes.emplace_back();
+
+    std::vector<BuildItem> stack;
+    stack.push_back({ 0, 0, count });
+
+    while (!stack.empty())
+    {
+        BuildItem item = stack.back();
+        stack.pop_back();
+
+        box3 bounds = box3::empty();
+        box3 centroidBounds = box3::empty();
+        for (uint32_t i = item.begin; i < item.end; i++)
+        {
+            bounds |= m_InstanceBounds[order[i]];
+            centroidBounds |= centroids[order[i]];
+        }
+        m_Nodes[item.node].bounds = bounds;
+
+        const uint32_t itemCount = item.end - item.begin;
+        if (itemCount <= m_MaxLeafSize)
+        {
+            m_Nodes[item.node].first = item.begin;
+            m_Nodes[item.node].instanceCount = itemCount;
+            continue;
+        }
+
+        // find the split with the lowest SAH cost over the bins on each axis
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float3 extent = centroidBounds.diagonal();
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (extent[axis] <= 0.f)
+                continue;
+
+            Bin bins[binCount];
+            float scale = float(binCount) / extent[axis];
+            for (uint32_t i = item.begin; i < item.end; i++)
+            {
+                int bin = std::min(int((centroids[order[i]][axis] - centroidBounds.m_mins[axis]) * scale), binCount - 1);
+                bins[bin].bounds |= m_InstanceBounds[order[i]];
+                bins[bin].count++;
+            }
+
+            // sweep from the right to get the costs of all right sides, then from the left
+            float rightAreas[binCount];
+            uint32_t rightCounts[binCount];
+            box3 rightBounds = box3::empty();
+            uint32_t rightCount = 0;
+            for (int bin = binCount - 1; bin > 0; bin--)
+            {
+                rightBounds |= bins[bin].bounds;
+                rightCount += bins[bin].count;
+                rightAreas[bin] = HalfSurfaceArea(rightBounds);
+                rightCounts[bin] = rightCount;
+            }
+
+            box3 leftBounds = box3::empty();
+            uint32_t leftCount = 0;
+            for (int split = 1; split < binCount; split++)
+            {
+                leftBounds |= bins[split - 1].bounds;
+                leftCount += bins[split - 1].count;
+                if (leftCount == 0 || rightCounts[split] == 0)
+                    continue;
+
+                float cost = HalfSurfaceArea(leftBounds) * float(leftCount) + rightAreas[split] * float(rightCounts[split]);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        uint32_t middle;
+        if (bestAxis >= 0)
+        {
+            float scale = float(binCount) / extent[bestAxis];
+            float minimum = centroidBounds.m_mins[bestAxis];
+            auto it = std::partition(order.begin() + item.begin, order.begin() + item.end, [&](uint32_t index)
+            {
+                int bin = std::min(int((centroids[index][bestAxis] - minimum) * scale), binCount - 1);
+                return bin < bestSplit;
+            });
+            middle = uint32_t(it - order.begin());
+        }
+        else
+        {
+            // all centroids are in the same place, split the range in half
+            middle = item.begin + itemCount / 2;
+        }
+
+        uint32_t firstChild = uint32_t(m_Nodes.size());
+        m_Nodes[item.node].first = firstChild;
+        m_Nodes[item.node].instanceCount = 0;
+        m_Nodes.emplace_back();
+        m_Nodes.emplace_back();
+
+        stack.push_back({ firstChild + 1, middle, item.end });
+        stack.push_back({ firstChild, item.begin, middle });
+    }
+
+    // reorder the instances to match the leaf ranges
+    std::vector<MeshInstance*> instancesOrdered(count);
+    std::vector<SceneGraphNode*> nodesOrdered(count);
+    std::vector<box3> boundsOrdered(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        instancesOrdered[i] = m_Instances[order[i]];
+        nodesOrdered[i] = m_InstanceNodes[order[i]];
+        boundsOrdered[i] = m_InstanceBounds[order[i]];
+    }
+    m_Instances = std::move(instancesOrdered);
+    m_InstanceNodes = std::move(nodesOrdered);
+    m_InstanceBounds = std::move(boundsOrdered);
+
+    for (uint32_t slot = 0; slot < count; slot++)
+    {
+        int instanceIndex = m_Instances[slot]->GetInstanceIndex();
+        if (instanceIndex < 0)
+            continue;
+
+        if (m_InstanceSlots.size() <= size_t(instanceIndex))
+            m_InstanceSlots.resize(instanceIndex + 1, ~0u);
+        m_InstanceSlots[instanceIndex] = slot;
+    }
+
+    m_BuildCost = ComputeCost();
+}
+
+void InstanceBvh::RefitNodes()
+{
+    // children are always stored after their parents
+    for (size_t index = m_Nodes.size(); index-- > 0; )
+    {
+        Node& node = m_Nodes[index];
+        if (node.instanceCount)
+        {
+            node.bounds = box3::empty();
+            for (uint32_t i = node.first; i < node.first + node.instanceCount; i++)
+                node.bounds |= m_InstanceBounds[i];
+        }
+        else
+        {
+            node.bounds = m_Nodes[node.first].bounds | m_Nodes[node.first + 1].bounds;
+        }
+    }
+}
+
+void InstanceBvh::Refit(const std::vector<int>& updatedInstanceIndices)
+{
+    if (m_Nodes.empty())
+        return;
+
+    auto updateSlot = [this](uint32_t slot)
+    {
+        m_InstanceBounds[slot] = m_Instances[slot]->GetLocalBoundingBox() * m_InstanceNodes[slot]->GetLocalToWorldTransformFloat();
+    };
+
+    if (updatedInstanceIndices.empty())
+    {
+        for (uint32_t slot = 0; slot < uint32_t(m_Instances.size()); slot++)
+            updateSlot(slot);
+    }
+    else
+    {
+        for (int instanceIndex : updatedInstanceIndices)
+        {
+            if (instanceIndex < 0 || size_t(instanceIndex) >= m_InstanceSlots.size())
+                continue;
+
+            uint32_t slot = m_InstanceSlots[instanceIndex];
+            if (slot != ~0u)
+                updateSlot(slot);
+        }
+    }
+
+    RefitNodes();
+}
+
+void InstanceBvh::Update(const SceneGraph& sceneGraph, bool structureChanged, bool transformsChanged)
+{
+    if (structureChanged)
+    {
+        Build(sceneGraph.GetMeshInstances());
+        return;
+    }
+
+    if (!transformsChanged)
+        return;
+
+    const auto& updatedInstanceIndices = sceneGraph.GetUpdatedMeshInstanceIndices();
+    if (updatedInstanceIndices.empty())
+        return;
+
+    Refit(updatedInstanceIndices);
+
+    if (ComputeCost() > m_BuildCost * m_RebuildThreshold)
+        Build(sceneGraph.GetMeshInstances());
+}
+
+float InstanceBvh::ComputeCost() const
+{
+    if (m_Nodes.empty())
+        return 0.f;
+
+    float rootArea = HalfSurfaceArea(m_Nodes[0].bounds);
+    if (rootArea <= 0.f)
+        return 1.f;
+
+    // an interior node costs one box test when its parent is visited, a leaf costs one test per instance
+    float cost = 0.f;
+    for (const Node& node : m_Nodes)
+    {
+        float area = HalfSurfaceArea(node.bounds);
+        cost += node.instanceCount ? area * float(node.instanceCount) : area;
+    }
+
+    return cost / (rootArea * float(m_Instances.size()));
+}
+
+void InstanceBvh::Cull(const frustum& frustum, std::vector<MeshInstance*>& visibleInstances)
+{
+    if (m_Nodes.empty())
+        return;
+
+    constexpr uint32_t allPlanes = (1u << frustum::PLANES_COUNT) - 1;
+
+    // the stack holds node indices with the plane mask of the parent
+    m_StackScratch.clear();
+    m_StackScratch.push_back({ 0, allPlanes });
+
+    while (!m_StackScratch.empty())
+    {
+        StackEntry entry = m_StackScratch.back();
+        m_StackScratch.pop_back();
+
+        const Node& node = m_Nodes[entry.node];
+        uint32_t planeMask = entry.planeMask;
+
+        FrustumTest test = TestBox(frustum, node.bounds, planeMask);
+        if (test == FrustumTest::Outside)
+            continue;
+
+        if (node.instanceCount)
+        {
+            for (uint32_t i = node.first; i < node.first + node.instanceCount; i++)
+            {
+                uint32_t instanceMask = planeMask;
+                if (test == FrustumTest::Inside || node.instanceCount == 1 || TestBox(frustum, m_InstanceBounds[i], instanceMask) != FrustumTest::Outside)
+                    visibleInstances.push_back(m_Instances[i]);
+            }
+        }
+        else if (test == FrustumTest::Inside)
+        {
+            // everything below is visible, collect the leaves without testing
+            size_t stackBase = m_StackScratch.size();
+            m_StackScratch.push_back({ entry.node, 0 });
+            while (m_StackScratch.size() > stackBase)
+            {
+                const Node& inner = m_Nodes[m_StackScratch.back().node];
+                m_StackScratch.pop_back();
+
+                if (inner.instanceCount)
+                {
+                    visibleInstances.insert(visibleInstances.end(), m_Instances.begin() + inner.first, m_Instances.begin() + inner.first + inner.instanceCount);
+                }
+                else
+                {
+                    m_StackScratch.push_back({ inner.first + 1, 0 });
+                    m_StackScratch.push_back({ inner.first, 0 });
+                }
+            }
+        }
+        else
+        {
+            m_StackScratch.push_back({ node.first + 1, planeMask });
+            m_StackScratch.push_back({ node.first, planeMask });
+        }
+    }
+}
+
+void InstanceBvh::Cull(const IView& view, std::vector<MeshInstance*>& visibleInstances)
+{
+    Cull(view.GetViewFrustum(), visibleInstances);
+}
@@ -0,0 +1,495 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/MeshLods.h>
+#include <donut/engine/MeshOptimizer.h>
+#include <donut/engine/SceneTypes.h>
+#include <donut/engine/View.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace donut::math;
+using namespace donut::engine;
+
+namespace
+{
+    // Border edges are kept in place by planes through them, perpendicular to their triangle, with this weight
+    constexpr float c_BorderWeight = 10.f;
+
+    // A collapse is rejected when it turns a triangle by more than about 75 degrees, or makes it degenerate
+    constexpr float c_FlipThreshold = 0.25f;
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return (uint64_t(a) << 32) | b;
+    }
+
+    struct PositionHash
+    {
+        size_t operator()(const float3& p) const
+        {
+            // +0 and -0 are the same position
+            float3 q = p + 0.f;
+            uint32_t bits[3];
+            memcpy(bits, &q, sizeof(bits));
+            return size_t(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+        }
+    };
+
+    struct PositionEqual
+    {
+        bool operator()(const float3& a, const float3& b) const
+        {
+            return all(a == b);
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+        float error;
+    };
+}
+
+MeshSimplifier::MeshSimplifier(const uint32_t* indices, size_t indexCount, const float3* positions, size_t vertexCount,
+    const float2* texcoords, const uint32_t* normals, float attributeWeight)
+    : m_Texcoords(texcoords)
+    , m_Normals(normals)
+    , m_AttributeWeight(attributeWeight)
+{
+    // Work in a unit box, so that the errors and the attribute weight don't depend on the size of the mesh
+    box3 bounds = box3::empty();
+    for (size_t v = 0; v < vertexCount; v++)
+        bounds |= positions[v];
+    float extent = vertexCount ? std::max(std::max(bounds.diagonal().x, bounds.diagonal().y), bounds.diagonal().z) : 0.f;
+    m_Scale = extent > 0.f ? extent : 1.f;
+    m_Positions.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        m_Positions[v] = (positions[v] - bounds.m_mins) / m_Scale;
+
+    // Vertices that share a position are one point of the surface
+    m_PositionIds.resize(vertexCount);
+    std::unordered_map<float3, uint32_t, PositionHash, PositionEqual> positionIds;
+    positionIds.reserve(vertexCount);
+    std::vector<uint32_t> wedgeCounts(vertexCount, 0);
+    for (uint32_t v = 0; v < uint32_t(vertexCount); v++)
+    {
+        m_PositionIds[v] = positionIds.emplace(positions[v], v).first->second;
+        ++wedgeCounts[m_PositionIds[v]];
+    }
+
+    m_Indices.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount ||
+            m_PositionIds[a] == m_PositionIds[b] || m_PositionIds[b] == m_PositionIds[c] || m_PositionIds[a] == m_PositionIds[c])
+            continue;
+        m_Indices.insert(m_Indices.end(), { a, b, c });
+    }
+
+    // Classify the points by the directed edges between them: an edge without its reverse is on a border,
+    // and an edge that appears twice in the same direction is non-manifold
+    std::unordered_map<uint64_t, uint32_t> edgeCounts;
+    edgeCounts.reserve(m_Indices.size());
+    for (size_t i = 0; i < m_Indices.size(); i += 3)
+        for (int e = 0; e < 3; e++)
+            ++edgeCounts[EdgeKey(m_PositionIds[m_Indices[i + e]], m_PositionIds[m_Indices[i + (e + 1) % 3]])];
+
+    m_Kinds.assign(vertexCount, VertexKind::Manifold);
+    for (uint32_t v = 0; v < uint32_t(vertexCount); v++)
+    {
+        if (wedgeCounts[m_PositionIds[v]] > 1)
+            m_Kinds[m_PositionIds[v]] = VertexKind::Locked;
+    }
+
+    m_Quadrics.resize(vertexCount);
+    for (size_t i = 0; i < m_Indices.size(); i += 3)
+    {
+        uint32_t ids[3] = { m_PositionIds[m_Indices[i]], m_PositionIds[m_Indices[i + 1]], m_PositionIds[m_Indices[i + 2]] };
+        const float3& p0 = m_Positions[ids[0]];
+        float3 normal = cross(m_Positions[ids[1]] - p0, m_Positions[ids[2]] - p0);
+        float area = length(normal);
+        if (area > 0.f)
+        {
+            normal /= area;
+            for (uint32_t id : ids)
+                AddPlane(id, normal, p0, area);
+        }
+
+        for (int e = 0; e < 3; e++)
+        {
+            uint32_t a = ids[e], b = ids[(e + 1) % 3];
+            if (edgeCounts[EdgeKey(a, b)] > 1)
+            {
+                m_Kinds[a] = VertexKind::Locked;
+                m_Kinds[b] = VertexKind::Locked;
+            }
+            else if (edgeCounts.find(EdgeKey(b, a)) == edgeCounts.end())
+            {
+                for (uint32_t id : { a, b })
+                {
+                    if (m_Kinds[id] == VertexKind::Manifold)
+                        m_Kinds[id] = VertexKind::Border;
+                }
+
+                float3 edge = m_Positions[b] - m_Positions[a];
+                float edgeLength = length(edge);
+                if (area > 0.f && edgeLength > 0.f)
+                {
+                    float3 borderNormal = normalize(cross(edge, normal));
+                    AddPlane(a, borderNormal, m_Positions[a], edgeLength * edgeLength * c_BorderWeight);
+                    AddPlane(b, borderNormal, m_Positions[a], edgeLength * edgeLength * c_BorderWeight);
+                }
+            }
+        }
+    }
+}
+
+void MeshSimplifier::AddPlane(uint32_t positionId, const float3& normal, const float3& point, float weight)
+{
+    float d = -dot(normal, point);
+    Quadric& q = m_Quadrics[positionId];
+    q.a00 += weight * normal.x * normal.x;
+    q.a01 += weight * normal.x * normal.y;
+    q.a02 += weight * normal.x * normal.z;
+    q.a11 += weight * normal.y * normal.y;
+    q.a12 += weight * normal.y * normal.z;
+    q.a22 += weight * normal.z * normal.z;
+    q.b0 += weight * normal.x * d;
+    q.b1 += weight * normal.y * d;
+    q.b2 += weight * normal.z * d;
+    q.c += weight * d * d;
+    q.weight += weight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other)
+{
+    a00 += other.a00; a01 += other.a01; a02 += other.a02;
+    a11 += other.a11; a12 += other.a12; a22 += other.a22;
+    b0 += other.b0; b1 += other.b1; b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+}
+
+// The weighted sum of squared distances of 'v' to the planes
+float MeshSimplifier::Quadric::Evaluate(const float3& v) const
+{
+    float r = v.x * (a00 * v.x + 2.f * (a01 * v.y + a02 * v.z + b0))
+        + v.y * (a11 * v.y + 2.f * (a12 * v.z + b1))
+        + v.z * (a22 * v.z + 2.f * b2)
+        + c;
+    return std::max(r, 0.f);
+}
+
+float MeshSimplifier::GetAttributeDistance(uint32_t a, uint32_t b) const
+{
+    float distance = 0.f;
+    if (m_Texcoords)
+        distance += lengthSquared(m_Texcoords[a] - m_Texcoords[b]);
+    if (m_Normals && m_Normals[a] != m_Normals[b])
+        distance += lengthSquared(snorm8ToVector<3>(m_Normals[a]) - snorm8ToVector<3>(m_Normals[b])) * 0.25f;
+    return distance;
+}
+
+bool MeshSimplifier::CollapsePass(size_t targetIndexCount, float maxError)
+{
+    const size_t vertexCount = m_Positions.size();
+    const size_t triangleCount = m_Indices.size() / 3;
+    const float maxUnitError = maxError / m_Scale;
+
+    std::unordered_set<uint64_t> edges;
+    edges.reserve(m_Indices.size());
+    for (size_t i = 0; i < m_Indices.size(); i += 3)
+        for (int e = 0; e < 3; e++)
+            edges.insert(EdgeKey(m_PositionIds[m_Indices[i + e]], m_PositionIds[m_Indices[i + (e + 1) % 3]]));
+
+    // The triangles around every vertex
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex : m_Indices)
+        ++adjacencyOffsets[vertex + 1];
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32_t> adjacency(m_Indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < m_Indices.size(); i++)
+            adjacency[fill[m_Indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<Collapse> collapses;
+    for (size_t i = 0; i < m_Indices.size(); i += 3)
+    {
+        for (int e = 0; e < 3; e++)
+        {
+            for (int direction = 0; direction < 2; direction++)
+            {
+                uint32_t from = m_Indices[i + (direction ? (e + 1) % 3 : e)];
+                uint32_t to = m_Indices[i + (direction ? e : (e + 1) % 3)];
+                uint32_t fromId = m_PositionIds[from];
+                uint32_t toId = m_PositionIds[to];
+
+                VertexKind kind = m_Kinds[fromId];
+                if (kind == VertexKind::Locked)
+                    continue;
+
+                if (kind == VertexKind::Border)
+                {
+                    bool borderEdge = edges.find(EdgeKey(toId, fromId)) == edges.end() || edges.find(EdgeKey(fromId, toId)) == edges.end();
+                    if (m_Kinds[toId] != VertexKind::Border || !borderEdge)
+                        continue;
+                }
+
+                Quadric quadric = m_Quadrics[fromId];
+                quadric.Add(m_Quadrics[toId]);
+                float distance = quadric.weight > 0.f ? quadric.Evaluate(m_Positions[toId]) / quadric.weight : 0.f;
+                float error = sqrtf(distance);
+                if (error > maxUnitError)
+                    continue;
+
+                collapses.push_back({ from, to, distance + m_AttributeWeight * GetAttributeDistance(from, to), error });
+            }
+        }
+    }
+
+    if (collapses.empty())
+        return false;
+
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+    // Every collapse changes the triangles around its vertex, so the vertices of those triangles can't take part
+    // in another collapse in the same pass
+    const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+    std::vector<bool> touched(vertexCount, false);
+    std::vector<uint32_t> collapseTargets(vertexCount);
+    for (uint32_t v = 0; v < uint32_t(vertexCount); v++)
+        collapseTargets[v] = v;
+
+    size_t removedTriangles = 0;
+    size_t appliedCollapses = 0;
+    for (const Collapse& collapse : collapses)
+    {
+        if (touched[collapse.from] || touched[collapse.to])
+            continue;
+
+        const float3& target = m_Positions[collapse.to];
+        bool flipped = false;
+        for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flipped; a++)
+        {
+            const uint32_t* triangle = m_Indices.data() + adjacency[a] * 3;
+            if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                continue;
+
+            float3 before[3], after[3];
+            for (int c = 0; c < 3; c++)
+            {
+                before[c] = m_Positions[triangle[c]];
+                after[c] = triangle[c] == collapse.from ? target : before[c];
+            }
+            float3 normalBefore = cross(before[1] - before[0], before[2] - before[0]);
+            float3 normalAfter = cross(after[1] - after[0], after[2] - after[0]);
+            flipped = dot(normalBefore, normalAfter) <= c_FlipThreshold * length(normalBefore) * length(normalAfter);
+        }
+        if (flipped)
+            continue;
+
+        collapseTargets[collapse.from] = collapse.to;
+        m_Quadrics[m_PositionIds[collapse.to]].Add(m_Quadrics[m_PositionIds[collapse.from]]);
+        m_Error = std::max(m_Error, collapse.error * m_Scale);
+        ++appliedCollapses;
+
+        touched[collapse.to] = true;
+        for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+        {
+            const uint32_t* triangle = m_Indices.data() + adjacency[a] * 3;
+            touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+        }
+
+        removedTriangles += m_Kinds[m_PositionIds[collapse.from]] == VertexKind::Border ? 1 : 2;
+        if (removedTriangles >= trianglesToRemove)
+            break;
+    }
+
+    if (appliedCollapses == 0)
+        return false;
+
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < m_Indices.size(); i += 3)
+    {
+        uint32_t a = collapseTargets[m_Indices[i]];
+        uint32_t b = collapseTargets[m_Indices[i + 1]];
+        uint32_t c = collapseTargets[m_Indices[i + 2]];
+        if (m_PositionIds[a] == m_PositionIds[b] || m_PositionIds[b] == m_PositionIds[c] || m_PositionIds[a] == m_PositionIds[c])
+            continue;
+
+        m_Indices[writeIndex++] = a;
+        m_Indices[writeIndex++] = b;
+        m_Indices[writeIndex++] = c;
+    }
+    m_Indices.resize(writeIndex);
+
+    return true;
+}
+
+float MeshSimplifier::Simplify(size_t targetIndexCount, float maxError)
+{
+    while (m_Indices.size() > targetIndexCount && CollapsePass(targetIndexCount, maxError))
+    {
+    }
+
+    return m_Error;
+}
+
+std::vector<MeshLodLevel> donut::engine::SimplifyGeometryLods(const BufferGroup& buffers, size_t indexOffset, size_t indexCount,
+    size_t vertexOffset, size_t vertexCount, const MeshLodSettings& settings)
+{
+    std::vector<MeshLodLevel> levels;
+    if (!settings.IsEnabled() ||
+        indexOffset + indexCount > buffers.indexData.size() ||
+        vertexOffset + vertexCount > buffers.positionData.size())
+        return levels;
+
+    const size_t vertexEnd = vertexOffset + vertexCount;
+    const float2* texcoords = vertexEnd <= buffers.texcoord1Data.size() ? buffers.texcoord1Data.data() + vertexOffset : nullptr;
+    const uint32_t* normals = vertexEnd <= buffers.normalData.size() ? buffers.normalData.data() + vertexOffset : nullptr;
+
+    MeshSimplifier simplifier(buffers.indexData.data() + indexOffset, indexCount, buffers.positionData.data() + vertexOffset,
+        vertexCount, texcoords, normals, settings.attributeWeight);
+
+    size_t previousCount = simplifier.GetIndices().size();
+    for (uint32_t level = 1; level < settings.lodCount; level++)
+    {
+        size_t targetCount = size_t(float(previousCount / 3) * settings.reduction) * 3;
+        simplifier.Simplify(targetCount);
+
+        // Stop when the simplification gets stuck, e.g. on locked vertices
+        size_t count = simplifier.GetIndices().size();
+        if (count == 0 || count * 10 > previousCount * 9)
+            break;
+
+        MeshLodLevel& lod = levels.emplace_back();
+        lod.indices = simplifier.GetIndices();
+        lod.error = simplifier.GetError();
+        OptimizeVertexCache(lod.indices.data(), lod.indices.size(), vertexCount);
+        previousCount = count;
+    }
+
+    return levels;
+}
+
+void donut::engine::AddMeshLods(MeshInfo& mesh, const std::vector<std::vector<MeshLodLevel>>& geometryLods)
+{
+    BufferGroup& buffers = *mesh.buffers;
+    mesh.lodErrors.clear();
+
+    for (size_t geometryIndex = 0; geometryIndex < mesh.geometries.size() && geometryIndex < geometryLods.size(); geometryIndex++)
+    {
+        MeshGeometry& geometry = *mesh.geometries[geometryIndex];
+        geometry.lods.clear();
+
+        const std::vector<MeshLodLevel>& levels = geometryLods[geometryIndex];
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            MeshGeometryLod& lod = geometry.lods.emplace_back();
+            lod.indexOffsetInMesh = uint32_t(buffers.indexData.size() - mesh.indexOffset);
+            lod.numIndices = uint32_t(levels[level].indices.size());
+            buffers.indexData.insert(buffers.indexData.end(), levels[level].indices.begin(), levels[level].indices.end());
+
+            if (mesh.lodErrors.size() <= level)
+                mesh.lodErrors.push_back(0.f);
+            mesh.lodErrors[level] = std::max(mesh.lodErrors[level], levels[level].error);
+        }
+    }
+
+    // geometries with fewer levels use their coarsest one, so the errors never decrease
+    for (size_t level = 1; level < mesh.lodErrors.size(); level++)
+        mesh.lodErrors[level] = std::max(mesh.lodErrors[level], mesh.lodErrors[level - 1]);
+}
+
+void donut::engine::GenerateMeshLods(MeshInfo& mesh, const MeshLodSettings& settings)
+{
+    if (!mesh.buffers)
+        return;
+
+    std::vector<std::vector<MeshLodLevel>> geometryLods;
+    for (const auto& geometry : mesh.geometries)
+    {
+        geometryLods.push_back(SimplifyGeometryLods(*mesh.buffers,
+            size_t(mesh.indexOffset) + geometry->indexOffsetInMesh, geometry->numIndices,
+            size_t(mesh.vertexOffset) + geometry->vertexOffsetInMesh, geometry->numVertices, settings));
+    }
+
+    AddMeshLods(mesh, geometryLods);
+}
+
+void MeshLodSelector::SetView(const IView& view, float pixelThreshold)
+{
+    float4x4 projection = view.GetProjectionMatrix(false);
+    nvrhi::Rect extent = view.GetViewExtent();
+    m_PixelsPerUnit = 0.5f * float(extent.maxY - extent.minY) * std::abs(projection.m11);
+    m_ViewOrigin = view.GetViewOrigin();
+    m_Orthographic = view.IsOrthographicProjection();
+    m_PixelThreshold = pixelThreshold;
+}
+
+uint32_t MeshLodSelector::SelectLod(const MeshInfo& mesh, const affine3& objectToWorld) const
+{
+    if (mesh.lodErrors.empty() || m_PixelThreshold <= 0.f || m_PixelsPerUnit <= 0.f)
+        return 0;
+
+    float objectRadius = length(mesh.objectSpaceBounds.diagonal()) * 0.5f;
+    if (objectRadius <= 0.f)
+        return 0;
+
+    float projectedSize = GetProjectedSize(mesh.objectSpaceBounds * objectToWorld);
+    if (projectedSize == FLT_MAX)
+        return 0;
+
+    // The errors scale with the bounding sphere, which includes the scaling of the transform
+    float maxError = m_PixelThreshold * objectRadius / (projectedSize * 0.5f);
+
+    uint32_t lod = 0;
+    while (lod < mesh.lodErrors.size() && mesh.lodErrors[lod] <= maxError)
+        ++lod;
+    return lod;
+}
+
+float MeshLodSelector::GetProjectedSize(const box3& worldBounds) const
+{
+    float worldRadius = length(worldBounds.diagonal()) * 0.5f;
+
+    float projectedSize = 2.f * worldRadius * m_PixelsPerUnit;
+    if (!m_Orthographic)
+    {
+        float distance = length(worldBounds.center() - m_ViewOrigin) - worldRadius;
+        if (distance <= 0.f)
+            return FLT_MAX;
+        projectedSize /= distance;
+    }
+
+    return projectedSize;
+}
@@ -0,0 +1,369 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/MeshOptimizer.h>
+#include <donut/engine/SceneTypes.h>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace donut::math;
+using namespace donut::engine;
+
+namespace
+{
+    // Simulates a FIFO post-transform cache: a vertex is cached if it was one of the last 'size' vertices transformed
+    class FifoCache
+    {
+    private:
+        std::vector<uint32_t> m_Timestamps;
+        uint32_t m_Size;
+        uint32_t m_Time;
+
+    public:
+        FifoCache(size_t vertexCount, uint32_t size)
+            : m_Timestamps(vertexCount, 0)
+            , m_Size(size)
+            , m_Time(size + 1)
+        { }
+
+        // Returns true on a cache miss
+        bool Access(uint32_t vertex)
+        {
+            if (m_Time - m_Timestamps[vertex] <= m_Size)
+                return false;
+
+            m_Timestamps[vertex] = m_Time++;
+            return true;
+        }
+
+        size_t AccessTriangle(const uint32_t* triangle)
+        {
+            return size_t(Access(triangle[0])) + size_t(Access(triangle[1])) + size_t(Access(triangle[2]));
+        }
+
+        void Clear()
+        {
+            m_Time += m_Size + 1;
+        }
+    };
+
+    template<typename T>
+    void RemapVertexStream(std::vector<T>& stream, size_t vertexOffset, const std::vector<uint32_t>& remap)
+    {
+        // the importer leaves some streams empty, such as the joints of models without skinning
+        if (stream.size() < vertexOffset + remap.size())
+            return;
+
+        T* data = stream.data() + vertexOffset;
+        std::vector<T> original(data, data + remap.size());
+        for (size_t vertex = 0; vertex < remap.size(); vertex++)
+            data[remap[vertex]] = original[vertex];
+    }
+}
+
+VertexCacheStatistics donut::engine::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+    statistics.triangles = indexCount / 3;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+
+    for (size_t index = 0; index < statistics.triangles * 3; index++)
+    {
+        uint32_t vertex = indices[index];
+        statistics.transforms += size_t(cache.Access(vertex));
+        if (!referenced[vertex])
+        {
+            referenced[vertex] = true;
+            ++statistics.vertices;
+        }
+    }
+
+    return statistics;
+}
+
+void donut::engine::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters)
+{
+    if (clusters)
+        clusters->clear();
+
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // the triangles that use each vertex, and how many of them haven't been emitted yet
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t index = 0; index < triangleCount * 3; index++)
+        ++liveTriangles[indices[index]];
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t index = 0; index < triangleCount * 3; index++)
+            adjacency[cursors[indices[index]]++] = uint32_t(index / 3);
+    }
+
+    std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEndStack;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t scanCursor = 0;
+    uint32_t fanningVertex = 0;
+    bool clusterStarts = true;
+
+    while (fanningVertex != ~0u)
+    {
+        // emit all remaining triangles around the fanning vertex
+        candidates.clear();
+        for (uint32_t adjacencyIndex = adjacencyOffsets[fanningVertex]; adjacencyIndex < adjacencyOffsets[fanningVertex + 1]; adjacencyIndex++)
+        {
+            uint32_t triangle = adjacency[adjacencyIndex];
+            if (emitted[triangle])
+                continue;
+
+            if (clusters && clusterStarts)
+                clusters->push_back(uint32_t(output.size() / 3));
+            clusterStarts = false;
+
+            for (int corner = 0; corner < 3; corner++)
+            {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+
+                if (timestamp - cacheTimestamps[vertex] > cacheSize)
+                    cacheTimestamps[vertex] = timestamp++;
+            }
+
+            emitted[triangle] = true;
+        }
+
+        // continue with the candidate that stays in the cache while its remaining triangles are emitted,
+        // preferring the oldest one
+        uint32_t nextVertex = ~0u;
+        int bestPriority = -1;
+        for (uint32_t vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+                continue;
+
+            int priority = 0;
+            uint32_t age = timestamp - cacheTimestamps[vertex];
+            if (age + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = int(age);
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+
+        if (nextVertex == ~0u)
+        {
+            // dead end: go back to a recently used vertex that still has triangles, or to any such vertex
+            clusterStarts = true;
+
+            while (!deadEndStack.empty() && nextVertex == ~0u)
+            {
+                uint32_t vertex = deadEndStack.back();
+                deadEndStack.pop_back();
+                if (liveTriangles[vertex] > 0)
+                    nextVertex = vertex;
+            }
+
+            while (scanCursor < vertexCount && nextVertex == ~0u)
+            {
+                if (liveTriangles[scanCursor] > 0)
+                    nextVertex = scanCursor;
+                else
+                    ++scanCursor;
+            }
+        }
+
+        fanningVertex = nextVertex;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void donut::engine::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float3* positions, size_t vertexCount,
+    const std::vector<uint32_t>& clusters, float threshold, uint32_t cacheSize)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || clusters.empty())
+        return;
+
+    // split the clusters wherever the part before the split alone has a good enough ACMR
+    std::vector<uint32_t> softClusters;
+    FifoCache cache(vertexCount, cacheSize);
+
+    for (size_t clusterIndex = 0; clusterIndex < clusters.size(); clusterIndex++)
+    {
+        const size_t begin = clusters[clusterIndex];
+        const size_t end = (clusterIndex + 1 < clusters.size()) ? clusters[clusterIndex + 1] : triangleCount;
+
+        cache.Clear();
+        size_t clusterTransforms = 0;
+        for (size_t triangle = begin; triangle < end; triangle++)
+            clusterTransforms += cache.AccessTriangle(indices + triangle * 3);
+
+        const float acmrThreshold = threshold * float(clusterTransforms) / float(end - begin);
+
+        cache.Clear();
+        softClusters.push_back(uint32_t(begin));
+        size_t softClusterBegin = begin;
+        size_t softClusterTransforms = 0;
+        for (size_t triangle = begin; triangle < end; triangle++)
+        {
+            softClusterTransforms += cache.AccessTriangle(indices + triangle * 3);
+
+            if (triangle + 1 < end && float(softClusterTransforms) <= acmrThreshold * float(triangle + 1 - softClusterBegin))
+            {
+                softClusters.push_back(uint32_t(triangle + 1));
+                softClusterBegin = triangle + 1;
+                softClusterTransforms = 0;
+                cache.Clear();
+            }
+        }
+    }
+
+    // sort the clusters by how much they face away from the mesh center
+    float3 meshCentroid = 0.f;
+    for (size_t index = 0; index < triangleCount * 3; index++)
+        meshCentroid += positions[indices[index]];
+    meshCentroid /= float(triangleCount * 3);
+
+    std::vector<float> sortKeys(softClusters.size());
+    for (size_t clusterIndex = 0; clusterIndex < softClusters.size(); clusterIndex++)
+    {
+        const size_t begin = softClusters[clusterIndex];
+        const size_t end = (clusterIndex + 1 < softClusters.size()) ? softClusters[clusterIndex + 1] : triangleCount;
+
+        // area weighted
+        float3 centroid = 0.f;
+        float3 normal = 0.f;
+        float area = 0.f;
+        for (size_t triangle = begin; triangle < end; triangle++)
+        {
+            const float3& p0 = positions[indices[triangle * 3 + 0]];
+            const float3& p1 = positions[indices[triangle * 3 + 1]];
+            const float3& p2 = positions[indices[triangle * 3 + 2]];
+            float3 triangleNormal = cross(p1 - p0, p2 - p0);
+            float triangleArea = length(triangleNormal);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        float normalLength = length(normal);
+        sortKeys[clusterIndex] = (area > 0.f && normalLength > 0.f)
+            ? dot(centroid / area - meshCentroid, normal / normalLength)
+            : 0.f;
+    }
+
+    std::vector<uint32_t> order(softClusters.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (uint32_t clusterIndex : order)
+    {
+        const size_t begin = softClusters[clusterIndex];
+        const size_t end = (clusterIndex + 1 < softClusters.size()) ? softClusters[clusterIndex + 1] : triangleCount;
+        output.insert(output.end(), indices + begin * 3, indices + end * 3);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<uint32_t> donut::engine::OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, ~0u);
+    uint32_t nextVertex = 0;
+
+    for (size_t index = 0; index < indexCount; index++)
+    {
+        uint32_t& newVertex = remap[indices[index]];
+        if (newVertex == ~0u)
+            newVertex = nextVertex++;
+        indices[index] = newVertex;
+    }
+
+    for (uint32_t& newVertex : remap)
+    {
+        if (newVertex == ~0u)
+            newVertex = nextVertex++;
+    }
+
+    return remap;
+}
+
+MeshOptimizationStatistics donut::engine::OptimizeGeometryBuffers(BufferGroup& buffers,
+    size_t indexOffset, size_t indexCount, size_t vertexOffset, size_t vertexCount, uint32_t cacheSize)
+{
+    MeshOptimizationStatistics statistics;
+
+    if (indexOffset + indexCount > buffers.indexData.size() || vertexOffset + vertexCount > buffers.positionData.size())
+        return statistics;
+
+    uint32_t* indices = buffers.indexData.data() + indexOffset;
+
+    // leave geometries with broken indices alone
+    for (size_t index = 0; index < indexCount; index++)
+    {
+        if (indices[index] >= vertexCount)
+            return statistics;
+    }
+
+    statistics.before = AnalyzeVertexCache(indices, indexCount, vertexCount, cacheSize);
+
+    std::vector<uint32_t> clusters;
+    OptimizeVertexCache(indices, indexCount, vertexCount, cacheSize, &clusters);
+    OptimizeOverdraw(indices, indexCount, buffers.positionData.data() + vertexOffset, vertexCount, clusters, 1.05f, cacheSize);
+
+    std::vector<uint32_t> remap = OptimizeVertexFetch(indices, indexCount, vertexCount);
+    RemapVertexStream(buffers.positionData, vertexOffset, remap);
+    RemapVertexStream(buffers.texcoord1Data, vertexOffset, remap);
+    RemapVertexStream(buffers.texcoord2Data, vertexOffset, remap);
+    RemapVertexStream(buffers.normalData, vertexOffset, remap);
+    RemapVertexStream(buffers.tangentData, vertexOffset, remap);
+    RemapVertexStream(buffers.jointData, vertexOffset, remap);
+    RemapVertexStream(buffers.weightData, vertexOffset, remap);
+
+    statistics.after = AnalyzeVertexCache(indices, indexCount, vertexCount, cacheSize);
+
+    return statistics;
+}
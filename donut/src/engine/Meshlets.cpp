@@ -0,0 +1,617 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/Meshlets.h>
+#include <donut/engine/SceneTypes.h>
+#include <donut/core/chunk/chunk.h>
+#include <donut/core/log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+using namespace donut::math;
+using namespace donut::engine;
+
+// The meshlets are stored in chunk files as arrays of uint32 headers, written straight from the meshlet array
+static_assert(sizeof(Meshlet) == 16 * sizeof(uint32_t));
+static_assert(std::is_trivially_copyable_v<Meshlet>);
+
+namespace
+{
+    constexpr uint32_t c_UnusedVertex = ~0u;
+
+    // Reads one meshlet header from a chunk file, field by field
+    Meshlet ReadMeshletHeader(const uint32_t* words)
+    {
+        auto readFloat = [words](int index)
+        {
+            float value;
+            memcpy(&value, words + index, sizeof(float));
+            return value;
+        };
+
+        Meshlet meshlet;
+        meshlet.vertexOffset = words[0];
+        meshlet.vertexCount = words[1];
+        meshlet.triangleOffset = words[2];
+        meshlet.triangleCount = words[3];
+        meshlet.boundsCenter = float3(readFloat(4), readFloat(5), readFloat(6));
+        meshlet.boundsRadius = readFloat(7);
+        meshlet.coneApex = float3(readFloat(8), readFloat(9), readFloat(10));
+        meshlet.coneCutoff = readFloat(11);
+        meshlet.coneAxis = float3(readFloat(12), readFloat(13), readFloat(14));
+        meshlet.padding = words[15];
+        return meshlet;
+    }
+
+    // Larger than any sine, so that IsMeshletBackfacing never succeeds
+    constexpr float c_NoConeCutoff = 2.f;
+
+    struct TriangleNormal
+    {
+        float3 normal;
+        float3 point;
+    };
+
+    // Ritter's bounding sphere: starts with the most distant pair of the extreme vertices along the axes
+    // and grows the sphere to include every vertex outside of it.
+    void ComputeBoundingSphere(Meshlet& meshlet, const uint32_t* vertices, const float3* positions)
+    {
+        uint32_t minVertex[3] = { 0, 0, 0 };
+        uint32_t maxVertex[3] = { 0, 0, 0 };
+        for (uint32_t i = 1; i < meshlet.vertexCount; i++)
+        {
+            const float3& p = positions[vertices[i]];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (p[axis] < positions[vertices[minVertex[axis]]][axis])
+                    minVertex[axis] = i;
+                if (p[axis] > positions[vertices[maxVertex[axis]]][axis])
+                    maxVertex[axis] = i;
+            }
+        }
+
+        int widestAxis = 0;
+        float widestDistance = -1.f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float distance = lengthSquared(positions[vertices[maxVertex[axis]]] - positions[vertices[minVertex[axis]]]);
+            if (distance > widestDistance)
+            {
+                widestAxis = axis;
+                widestDistance = distance;
+            }
+        }
+
+        const float3& a = positions[vertices[minVertex[widestAxis]]];
+        const float3& b = positions[vertices[maxVertex[widestAxis]]];
+        float3 center = (a + b) * 0.5f;
+        float radius = length(b - a) * 0.5f;
+
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+        {
+            const float3& p = positions[vertices[i]];
+            float distance = length(p - center);
+            if (distance > radius)
+            {
+                float newRadius = (radius + distance) * 0.5f;
+                center += (p - center) * ((newRadius - radius) / distance);
+                radius = newRadius;
+            }
+        }
+
+        meshlet.boundsCenter = center;
+        meshlet.boundsRadius = radius;
+    }
+
+    // Finds a cone that contains the normals of all triangles, and an apex behind all triangle planes, so that every
+    // triangle faces away from a camera that sees the apex within 90 degrees minus the cone angle from the axis.
+    // This is the same formulation as meshopt_computeClusterBounds in meshoptimizer.
+    void ComputeNormalCone(Meshlet& meshlet, const uint32_t* vertices, const uint8_t* triangles, const float3* positions,
+        std::vector<TriangleNormal>& normals)
+    {
+        meshlet.coneApex = meshlet.boundsCenter;
+        meshlet.coneAxis = float3(0.f, 0.f, 1.f);
+        meshlet.coneCutoff = c_NoConeCutoff;
+
+        normals.clear();
+        float3 normalSum = 0.f;
+        for (uint32_t i = 0; i < meshlet.triangleCount; i++)
+        {
+            const float3& p0 = positions[vertices[triangles[i * 3 + 0]]];
+            const float3& p1 = positions[vertices[triangles[i * 3 + 1]]];
+            const float3& p2 = positions[vertices[triangles[i * 3 + 2]]];
+
+            float3 normal = cross(p1 - p0, p2 - p0);
+            float area = length(normal);
+            if (area <= 0.f)
+                continue;
+
+            normal /= area;
+            normals.push_back({ normal, p0 });
+            normalSum += normal;
+        }
+
+        float sumLength = length(normalSum);
+        if (normals.empty() || sumLength <= 0.f)
+            return;
+
+        float3 axis = normalSum / sumLength;
+        float minDot = 1.f;
+        for (const TriangleNormal& triangle : normals)
+            minDot = std::min(minDot, dot(triangle.normal, axis));
+
+        // Cones wider than about 84 degrees would hardly ever be culled
+        if (minDot <= 0.1f)
+            return;
+
+        // Move the apex back along the axis until it's behind the plane of every triangle
+        float maxDistance = 0.f;
+        for (const TriangleNormal& triangle : normals)
+        {
+            float distance = dot(meshlet.boundsCenter - triangle.point, triangle.normal) / dot(axis, triangle.normal);
+            maxDistance = std::max(maxDistance, distance);
+        }
+
+        meshlet.coneApex = meshlet.boundsCenter - axis * maxDistance;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+    }
+
+    bool IsOutsidePlane(const plane& p, const float3& center, float radius)
+    {
+        return dot(p.normal, center) - p.distance > radius * length(p.normal);
+    }
+}
+
+size_t donut::engine::BuildMeshlets(const uint32_t* indices, size_t indexCount, const float3* positions, size_t vertexCount,
+    uint32_t maxVertices, uint32_t maxTriangles, std::vector<Meshlet>& meshlets,
+    std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+{
+    maxVertices = std::clamp(maxVertices, 3u, c_MeshletMaxVertices);
+    maxTriangles = std::clamp(maxTriangles, 1u, c_MeshletMaxTriangles);
+
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+            continue;
+        if (a == b || b == c || a == c)
+            continue;
+        triangles.insert(triangles.end(), { a, b, c });
+    }
+    const uint32_t triangleCount = uint32_t(triangles.size() / 3);
+
+    // The triangles that use each vertex, in one array with offsets per vertex
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex : triangles)
+        ++adjacencyOffsets[vertex + 1];
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32_t> adjacency(triangles.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; t++)
+            for (uint32_t c = 0; c < 3; c++)
+                adjacency[fill[triangles[t * 3 + c]]++] = t;
+    }
+
+    std::vector<float3> centroids(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; t++)
+        centroids[t] = (positions[triangles[t * 3]] + positions[triangles[t * 3 + 1]] + positions[triangles[t * 3 + 2]]) * (1.f / 3.f);
+
+    const size_t firstMeshlet = meshlets.size();
+    std::vector<uint32_t> localIndices(vertexCount, c_UnusedVertex);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<TriangleNormal> normals;
+    float3 positionSum = 0.f;
+
+    Meshlet current;
+    current.vertexOffset = uint32_t(meshletVertices.size());
+    current.triangleOffset = uint32_t(meshletTriangles.size());
+
+    auto finishMeshlet = [&]()
+    {
+        const uint32_t* vertices = meshletVertices.data() + current.vertexOffset;
+        for (uint32_t i = 0; i < current.vertexCount; i++)
+            localIndices[vertices[i]] = c_UnusedVertex;
+
+        ComputeBoundingSphere(current, vertices, positions);
+        ComputeNormalCone(current, vertices, meshletTriangles.data() + current.triangleOffset, positions, normals);
+        meshlets.push_back(current);
+
+        current = Meshlet();
+        current.vertexOffset = uint32_t(meshletVertices.size());
+        current.triangleOffset = uint32_t(meshletTriangles.size());
+        positionSum = 0.f;
+    };
+
+    auto countNewVertices = [&](uint32_t triangle)
+    {
+        uint32_t count = 0;
+        for (uint32_t c = 0; c < 3; c++)
+            count += localIndices[triangles[triangle * 3 + c]] == c_UnusedVertex ? 1 : 0;
+        return count;
+    };
+
+    // Grows every meshlet from a seed triangle by adding the adjacent triangle that needs the fewest new vertices,
+    // and of those the one closest to the center of the meshlet, which keeps the meshlets compact and their
+    // normal cones narrow. A new meshlet starts at the first unused triangle in index order.
+    uint32_t nextSeed = 0;
+    while (true)
+    {
+        uint32_t best = c_UnusedVertex;
+        uint32_t bestNewVertices = 4;
+        float bestDistance = 0.f;
+
+        if (current.triangleCount > 0)
+        {
+            const float3 center = positionSum / float(current.vertexCount);
+            for (uint32_t i = 0; i < current.vertexCount; i++)
+            {
+                uint32_t vertex = meshletVertices[current.vertexOffset + i];
+                for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+                {
+                    uint32_t triangle = adjacency[a];
+                    if (emitted[triangle])
+                        continue;
+
+                    uint32_t newVertices = countNewVertices(triangle);
+                    if (current.vertexCount + newVertices > maxVertices || newVertices > bestNewVertices)
+                        continue;
+
+                    float distance = lengthSquared(centroids[triangle] - center);
+                    if (newVertices < bestNewVertices || distance < bestDistance)
+                    {
+                        best = triangle;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+
+            if (best == c_UnusedVertex)
+                finishMeshlet();
+        }
+
+        if (best == c_UnusedVertex)
+        {
+            while (nextSeed < triangleCount && emitted[nextSeed])
+                ++nextSeed;
+            if (nextSeed == triangleCount)
+                break;
+            best = nextSeed;
+        }
+
+        emitted[best] = true;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t vertex = triangles[best * 3 + c];
+            if (localIndices[vertex] == c_UnusedVertex)
+            {
+                localIndices[vertex] = current.vertexCount++;
+                meshletVertices.push_back(vertex);
+                positionSum += positions[vertex];
+            }
+            meshletTriangles.push_back(uint8_t(localIndices[vertex]));
+        }
+
+        if (++current.triangleCount == maxTriangles)
+            finishMeshlet();
+    }
+
+    if (current.triangleCount > 0)
+        finishMeshlet();
+
+    return meshlets.size() - firstMeshlet;
+}
+
+void donut::engine::BuildMeshlets(MeshInfo& mesh, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    if (!mesh.buffers)
+        return;
+
+    BufferGroup& buffers = *mesh.buffers;
+
+    for (const auto& geometry : mesh.geometries)
+    {
+        geometry->meshletOffset = uint32_t(buffers.meshletData.size());
+        geometry->numMeshlets = 0;
+
+        size_t firstIndex = size_t(mesh.indexOffset) + geometry->indexOffsetInMesh;
+        size_t firstVertex = size_t(mesh.vertexOffset) + geometry->vertexOffsetInMesh;
+        if (firstIndex + geometry->numIndices > buffers.indexData.size() ||
+            firstVertex + geometry->numVertices > buffers.positionData.size())
+        {
+            log::warning("Mesh '%s' has no index or position data, skipping meshlet generation", mesh.name.c_str());
+            continue;
+        }
+
+        geometry->numMeshlets = uint32_t(BuildMeshlets(buffers.indexData.data() + firstIndex, geometry->numIndices,
+            buffers.positionData.data() + firstVertex, geometry->numVertices, maxVertices, maxTriangles,
+            buffers.meshletData, buffers.meshletVertexData, buffers.meshletTriangleData));
+    }
+}
+
+bool donut::engine::IsMeshletBackfacing(const Meshlet& meshlet, const float3& cameraPosition)
+{
+    float3 direction = meshlet.coneApex - cameraPosition;
+    float distance = length(direction);
+    if (distance <= 0.f)
+        return false;
+
+    return dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * distance;
+}
+
+size_t donut::engine::CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const affine3& objectToWorld,
+    const frustum& worldFrustum, const float3& cameraPosition, bool cullBackfaces,
+    std::vector<uint32_t>& visibleMeshlets)
+{
+    // Move the frustum planes into object space: dot(n, p * L + t) <= d turns into dot(n * transpose(L), p) <= d - dot(n, t)
+    const float3x3& linear = objectToWorld.m_linear;
+    plane planes[frustum::PLANES_COUNT];
+    for (int i = 0; i < frustum::PLANES_COUNT; i++)
+    {
+        const plane& p = worldFrustum.planes[i];
+        planes[i].normal = float3(dot(linear.row0, p.normal), dot(linear.row1, p.normal), dot(linear.row2, p.normal));
+        planes[i].distance = p.distance - dot(p.normal, objectToWorld.m_translation);
+    }
+
+    cullBackfaces = cullBackfaces && determinant(linear) > 0.f;
+    const float3 localCameraPosition = cullBackfaces ? inverse(objectToWorld).transformPoint(cameraPosition) : float3(0.f);
+
+    size_t visibleCount = 0;
+    for (size_t index = 0; index < meshletCount; index++)
+    {
+        const Meshlet& meshlet = meshlets[index];
+
+        bool outside = false;
+        for (const plane& p : planes)
+        {
+            if (IsOutsidePlane(p, meshlet.boundsCenter, meshlet.boundsRadius))
+            {
+                outside = true;
+                break;
+            }
+        }
+
+        if (outside || (cullBackfaces && IsMeshletBackfacing(meshlet, localCameraPosition)))
+            continue;
+
+        visibleMeshlets.push_back(uint32_t(index));
+        ++visibleCount;
+    }
+
+    return visibleCount;
+}
+
+std::shared_ptr<donut::vfs::IBlob const> donut::engine::SerializeMeshlets(const MeshInfo& mesh)
+{
+    if (!mesh.buffers)
+        return nullptr;
+
+    const BufferGroup& buffers = *mesh.buffers;
+    const size_t vertexEnd = size_t(mesh.vertexOffset) + mesh.totalVertices;
+    if (vertexEnd > buffers.positionData.size())
+    {
+        log::error("Mesh '%s' has no position data", mesh.name.c_str());
+        return nullptr;
+    }
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+    std::vector<donut::chunk::MeshletInfo> meshInfos;
+    std::vector<donut::chunk::MeshInstance> instances;
+    uint32_t maxVertices = 0;
+    uint32_t maxTriangles = 0;
+
+    for (const auto& geometry : mesh.geometries)
+    {
+        donut::chunk::MeshletInfo info;
+        info.name = mesh.name.c_str();
+        info.materialName = geometry->material ? geometry->material->name.c_str() : nullptr;
+        info.materialId = geometry->material ? uint32_t(geometry->material->materialID) : 0;
+        info.bbox = geometry->objectSpaceBounds;
+        info.padding = 0;
+        info.firstMeshlet = uint32_t(meshlets.size());
+        info.numMeshlets = geometry->numMeshlets;
+
+        for (uint32_t i = 0; i < geometry->numMeshlets; i++)
+        {
+            Meshlet meshlet = buffers.meshletData[geometry->meshletOffset + i];
+
+            // The chunk indices address the vertex streams of the whole set
+            const uint32_t* meshletVertices = buffers.meshletVertexData.data() + meshlet.vertexOffset;
+            meshlet.vertexOffset = uint32_t(vertices.size());
+            for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+                vertices.push_back(meshletVertices[v] + geometry->vertexOffsetInMesh);
+
+            const uint8_t* meshletTriangles = buffers.meshletTriangleData.data() + meshlet.triangleOffset;
+            meshlet.triangleOffset = uint32_t(triangles.size());
+            triangles.insert(triangles.end(), meshletTriangles, meshletTriangles + meshlet.triangleCount * 3);
+
+            maxVertices = std::max(maxVertices, meshlet.vertexCount);
+            maxTriangles = std::max(maxTriangles, meshlet.triangleCount);
+            meshlets.push_back(meshlet);
+        }
+
+        donut::chunk::MeshInstance instance;
+        instance.name = mesh.name.c_str();
+        instance.minfoId = uint32_t(meshInfos.size());
+        instance.nodeId = ~0u;
+        instance.transform = affine3::identity();
+        instance.bbox = geometry->objectSpaceBounds;
+        instance.center = geometry->objectSpaceBounds.center();
+        instance.padding = 0;
+
+        meshInfos.push_back(info);
+        instances.push_back(instance);
+    }
+
+    if (meshlets.empty())
+    {
+        log::error("Mesh '%s' has no meshlets", mesh.name.c_str());
+        return nullptr;
+    }
+
+    donut::chunk::MeshletSet set;
+    set.type = donut::chunk::MeshSetBase::MESHLET;
+    set.name = mesh.name.c_str();
+    set.nverts = mesh.totalVertices;
+    set.streams.position = buffers.positionData.data() + mesh.vertexOffset;
+    if (vertexEnd <= buffers.normalData.size())
+        set.streams.normal = buffers.normalData.data() + mesh.vertexOffset;
+    if (vertexEnd <= buffers.tangentData.size())
+        set.streams.tangent = buffers.tangentData.data() + mesh.vertexOffset;
+    if (vertexEnd <= buffers.texcoord1Data.size())
+        set.streams.texcoord0 = buffers.texcoord1Data.data() + mesh.vertexOffset;
+    if (vertexEnd <= buffers.texcoord2Data.size())
+        set.streams.texcoord1 = buffers.texcoord2Data.data() + mesh.vertexOffset;
+    set.nmeshInfos = uint32_t(meshInfos.size());
+    set.meshInfos = meshInfos.data();
+    set.instances = instances.data();
+    set.ninstances = uint32_t(instances.size());
+    set.bbox = mesh.objectSpaceBounds;
+
+    // The limits of the set are the largest meshlets, since the build limits aren't recorded anywhere
+    set.maxVerts = maxVertices;
+    set.maxPrims = maxTriangles;
+    set.indices32 = vertices.data();
+    set.nindices32 = uint32_t(vertices.size());
+    set.indices8 = triangles.data();
+    set.nindices8 = uint32_t(triangles.size());
+    set.meshlets = reinterpret_cast<const uint32_t*>(meshlets.data());
+    set.nmeshlets = uint32_t(meshlets.size());
+    set.meshletSize = uint8_t(sizeof(Meshlet) / sizeof(uint32_t));
+
+    return donut::chunk::serialize(set);
+}
+
+std::shared_ptr<MeshInfo> donut::engine::DeserializeMeshlets(const std::shared_ptr<vfs::IBlob const>& blob, const char* assetPath)
+{
+    std::shared_ptr<donut::chunk::MeshSetBase const> meshSet = donut::chunk::deserialize(blob, assetPath);
+    if (!meshSet)
+        return nullptr;
+
+    if (meshSet->type != donut::chunk::MeshSetBase::MESHLET)
+    {
+        log::error("Asset '%s' doesn't contain meshlets", assetPath);
+        return nullptr;
+    }
+
+    const auto& set = static_cast<const donut::chunk::MeshletSet&>(*meshSet);
+    if (set.meshletSize != sizeof(Meshlet) / sizeof(uint32_t))
+    {
+        log::error("Asset '%s' has unsupported meshlet headers (%d words)", assetPath, int(set.meshletSize));
+        return nullptr;
+    }
+
+    auto buffers = std::make_shared<BufferGroup>();
+    const uint32_t vertexCount = set.nverts;
+    buffers->positionData.assign(set.streams.position, set.streams.position + vertexCount);
+    if (set.streams.normal)
+        buffers->normalData.assign(set.streams.normal, set.streams.normal + vertexCount);
+    if (set.streams.tangent)
+        buffers->tangentData.assign(set.streams.tangent, set.streams.tangent + vertexCount);
+    if (set.streams.texcoord0)
+        buffers->texcoord1Data.assign(set.streams.texcoord0, set.streams.texcoord0 + vertexCount);
+    if (set.streams.texcoord1)
+        buffers->texcoord2Data.assign(set.streams.texcoord1, set.streams.texcoord1 + vertexCount);
+
+    auto mesh = std::make_shared<MeshInfo>();
+    mesh->name = set.name ? set.name : "";
+    mesh->buffers = buffers;
+    mesh->objectSpaceBounds = set.bbox;
+    mesh->totalVertices = vertexCount;
+
+    for (uint32_t infoIndex = 0; infoIndex < set.nmeshInfos; infoIndex++)
+    {
+        const donut::chunk::MeshletInfo& info = set.meshInfos[infoIndex];
+        if (size_t(info.firstMeshlet) + info.numMeshlets > set.nmeshlets)
+        {
+            log::error("Asset '%s' has an invalid meshlet range", assetPath);
+            return nullptr;
+        }
+
+        auto material = std::make_shared<Material>();
+        material->name = info.materialName ? info.materialName : "";
+        material->materialID = int(info.materialId);
+
+        auto geometry = std::make_shared<MeshGeometry>();
+        geometry->material = material;
+        geometry->objectSpaceBounds = info.bbox;
+        geometry->numVertices = vertexCount;
+        geometry->indexOffsetInMesh = uint32_t(buffers->indexData.size());
+        geometry->meshletOffset = uint32_t(buffers->meshletData.size());
+        geometry->numMeshlets = info.numMeshlets;
+
+        for (uint32_t i = 0; i < info.numMeshlets; i++)
+        {
+            Meshlet meshlet = ReadMeshletHeader(set.meshlets + size_t(info.firstMeshlet + i) * set.meshletSize);
+
+            if (size_t(meshlet.vertexOffset) + meshlet.vertexCount > set.nindices32 ||
+                size_t(meshlet.triangleOffset) + size_t(meshlet.triangleCount) * 3 > set.nindices8)
+            {
+                log::error("Asset '%s' has an invalid meshlet", assetPath);
+                return nullptr;
+            }
+
+            const uint32_t* vertices = set.indices32 + meshlet.vertexOffset;
+            const uint8_t* triangles = set.indices8 + meshlet.triangleOffset;
+            for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+            {
+                if (vertices[v] >= vertexCount)
+                {
+                    log::error("Asset '%s' has an invalid meshlet vertex", assetPath);
+                    return nullptr;
+                }
+            }
+
+            for (uint32_t t = 0; t < meshlet.triangleCount * 3; t++)
+            {
+                if (triangles[t] >= meshlet.vertexCount)
+                {
+                    log::error("Asset '%s' has an invalid meshlet triangle", assetPath);
+                    return nullptr;
+                }
+                buffers->indexData.push_back(vertices[triangles[t]]);
+            }
+
+            meshlet.vertexOffset = uint32_t(buffers->meshletVertexData.size());
+            meshlet.triangleOffset = uint32_t(buffers->meshletTriangleData.size());
+            buffers->meshletVertexData.insert(buffers->meshletVertexData.end(), vertices, vertices + meshlet.vertexCount);
+            buffers->meshletTriangleData.insert(buffers->meshletTriangleData.end(), triangles, triangles + meshlet.triangleCount * 3);
+            buffers->meshletData.push_back(meshlet);
+        }
+
+        geometry->numIndices = uint32_t(buffers->indexData.size()) - geometry->indexOffsetInMesh;
+        mesh->geometries.push_back(geometry);
+    }
+
+    mesh->totalIndices = uint32_t(buffers->indexData.size());
+
+    return mesh;
+}
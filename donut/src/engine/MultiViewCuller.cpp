@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/MultiViewCuller.h>
+
+using namespace donut::math;
+using namespace donut::engine;
+
+static uint32_t CountBits(uint32_t mask)
+{
+    uint32_t count = 0;
+    for (; mask; mask &= mask - 1)
+        ++count;
+    return count;
+}
+
+void MultiViewCuller::Cull(SceneGraphNode* rootNode, const std::vector<const IView*>& views)
+{
+    m_Stats = Stats();
+    m_Stats.viewCount = uint32_t(views.size());
+
+    m_Views = views;
+    m_Frustums.resize(views.size());
+    m_VisibleInstances.resize(views.size());
+    for (size_t viewIndex = 0; viewIndex < views.size(); viewIndex++)
+    {
+        m_Frustums[viewIndex] = views[viewIndex]->GetViewFrustum();
+        m_VisibleInstances[viewIndex].clear();
+    }
+
+    if (!rootNode)
+        return;
+
+    // each traversal handles up to 32 views, one bit per view in the masks
+    for (size_t firstView = 0; firstView < views.size(); firstView += 32)
+    {
+        const uint32_t batchSize = uint32_t(std::min<size_t>(views.size() - firstView, 32));
+        const dm::frustum* frustums = m_Frustums.data() + firstView;
+        std::vector<MeshInstance*>* visibleInstances = m_VisibleInstances.data() + firstView;
+
+        // views that can see the parent of the current node
+        uint32_t parentMask = (batchSize == 32) ? ~0u : (1u << batchSize) - 1;
+        m_MaskStack.clear();
+        ++m_Stats.traversals;
+
+        SceneGraphWalker walker(rootNode);
+        while (walker)
+        {
+            ++m_Stats.nodesVisited;
+            m_Stats.nodesVisitedWithSeparateTraversals += CountBits(parentMask);
+
+            uint32_t mask = 0;
+            if ((walker->GetSubgraphContentFlags() & m_RelevantContent) != 0)
+            {
+                const box3& bounds = walker->GetGlobalBoundingBox();
+                for (uint32_t view = 0; view < batchSize; view++)
+                {
+                    if ((parentMask & (1u << view)) == 0)
+                        continue;
+
+                    ++m_Stats.boxTests;
+                    if (frustums[view].intersectsWith(bounds))
+                        mask |= 1u << view;
+                }
+
+                if (mask && (walker->GetLeafContentFlags() & m_RelevantContent) != 0)
+                {
+                    if (auto meshInstance = walker->GetLeaf()->AsMeshInstance())
+                    {
+                        for (uint32_t view = 0; view < batchSize; view++)
+                        {
+                            if (mask & (1u << view))
+                                visibleInstances[view].push_back(meshInstance);
+                        }
+                    }
+                }
+            }
+
+            int deltaDepth = walker.Next(mask != 0);
+
+            if (deltaDepth > 0)
+            {
+                m_MaskStack.push_back(parentMask);
+                parentMask = mask;
+            }
+            else
+            {
+                for (; deltaDepth < 0 && !m_MaskStack.empty(); deltaDepth++)
+                {
+                    parentMask = m_MaskStack.back();
+                    m_MaskStack.pop_back();
+                }
+            }
+        }
+    }
+}
+
+void MultiViewCuller::AddChildViews(const ICompositeView& compositeView, ViewType::Enum supportedTypes, std::vector<const IView*>& views)
+{
+    for (uint32_t viewIndex = 0; viewIndex < compositeView.GetNumChildViews(supportedTypes); viewIndex++)
+    {
+        const IView* view = compositeView.GetChildView(supportedTypes, viewIndex);
+        if (view)
+            views.push_back(view);
+    }
+}
+
+const std::vector<MeshInstance*>* MultiViewCuller::GetVisibleInstances(const IView* view) const
+{
+    for (size_t viewIndex = 0; viewIndex < m_Views.size(); viewIndex++)
+    {
+        if (m_Views[viewIndex] == view)
+            return &m_VisibleInstances[viewIndex];
+    }
+
+    return nullptr;
+}
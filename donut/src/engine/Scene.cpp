@@ -36,6 +36,8 @@ this software is released into the Public Domain.
 
 #include <donut/engine/Scene.h>
 #include <donut/engine/GltfImporter.h>
+#include <donut/engine/InstanceBvh.h>
+#include <donut/engine/TextureCache.h>
 #include <donut/core/json.h>
 #include <donut/core/log.h>
 #include <donut/core/string_utils.h>
@@ -49,6 +51,9 @@ this software is released into the Public Domain.
 #include <taskflow/taskflow.hpp>
 #endif
 
+#include <algorithm>
+#include <chrono>
+
 using namespace donut::math;
 #include <donut/shaders/material_cb.h>
 #include <donut/shaders/skinning_cb.h>
@@ -64,6 +69,31 @@ const SceneLoadingStats& Scene::GetLoadingStats()
     return g_LoadingStats;
 }
 
+// Reports the wall time of a scene load, and for a load that used the processed texture cache, the wall time
+// of the load that filled it, rather than the processing time of the textures summed over the loading threads
+static void LogProcessedTextureCacheUse(const TextureCache& textureCache, const std::filesystem::path& sceneFileName,
+    uint32_t texturesFromCache, uint32_t texturesProcessed, double seconds)
+{
+    if (texturesFromCache == 0)
+    {
+        textureCache.WriteUncachedLoadTime(sceneFileName, seconds);
+        donut::log::info("Loaded the scene in %.2f s, processing %u textures into the processed texture cache", seconds, texturesProcessed);
+        return;
+    }
+
+    const double uncachedSeconds = textureCache.ReadUncachedLoadTime(sceneFileName);
+    if (uncachedSeconds > 0.0)
+    {
+        donut::log::info("Loaded the scene in %.2f s with %u textures from the processed texture cache and %u processed; "
+            "the load that processed all textures took %.2f s", seconds, texturesFromCache, texturesProcessed, uncachedSeconds);
+    }
+    else
+    {
+        donut::log::info("Loaded the scene in %.2f s with %u textures from the processed texture cache and %u processed",
+            seconds, texturesFromCache, texturesProcessed);
+    }
+}
+
 struct Scene::Resources
 {
     std::vector<MaterialConstants> materialData;
@@ -135,6 +165,9 @@ bool Scene::LoadWithExecutor(const std::filesystem::path& sceneFileName, tf::Exe
     
     g_LoadingStats.ObjectsLoaded = 0;
     g_LoadingStats.ObjectsTotal = 0;
+
+    const auto loadStartTime = std::chrono::steady_clock::now();
+    const ProcessedTextureCacheStats textureCacheStats = m_TextureCache->GetProcessedTextureCacheStats();
     
     m_SceneGraph = std::make_shared<SceneGraph>();
 
@@ -184,6 +217,16 @@ bool Scene::LoadWithExecutor(const std::filesystem::path& sceneFileName, tf::Exe
         }
     }
 
+    // the texture loads that the models started on the executor have finished with the models
+    const ProcessedTextureCacheStats newTextureCacheStats = m_TextureCache->GetProcessedTextureCacheStats();
+    const uint32_t texturesFromCache = newTextureCacheStats.hits - textureCacheStats.hits;
+    const uint32_t texturesProcessed = newTextureCacheStats.misses - textureCacheStats.misses;
+    if (texturesFromCache + texturesProcessed > 0)
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStartTime).count();
+        LogProcessedTextureCacheUse(*m_TextureCache, sceneFileName, texturesFromCache, texturesProcessed, seconds);
+    }
+
     return true;
 }
 
@@ -624,9 +667,73 @@ void Scene::FinishedLoading(uint32_t frameIndex)
 
 void Scene::RefreshSceneGraph(uint32_t frameIndex)
 {
-    m_SceneStructureChanged = m_SceneGraph->HasPendingStructureChanges();
-    m_SceneTransformsChanged = m_SceneGraph->HasPendingTransformChanges();
+    const bool structureChanged = m_SceneGraph->HasPendingStructureChanges();
+    const bool transformsChanged = m_SceneGraph->HasPendingTransformChanges();
+#ifdef DONUT_WITH_TASKFLOW
+    m_SceneGraph->Refresh(frameIndex, m_RefreshExecutor);
+#else
     m_SceneGraph->Refresh(frameIndex);
+#endif
+
+    // The changes accumulate until the next RefreshBuffers call, which may come after several refreshes
+    m_SceneStructureChanged = m_SceneStructureChanged || structureChanged;
+    m_SceneTransformsChanged = m_SceneTransformsChanged || transformsChanged;
+
+    // A structure change uploads every instance, and the indices from before it are no longer valid
+    if (m_SceneStructureChanged)
+    {
+        m_UpdatedInstanceIndices.clear();
+    }
+    else if (transformsChanged)
+    {
+        const auto& updatedIndices = m_SceneGraph->GetUpdatedMeshInstanceIndices();
+        const auto middle = m_UpdatedInstanceIndices.insert(m_UpdatedInstanceIndices.end(), updatedIndices.begin(), updatedIndices.end());
+        std::inplace_merge(m_UpdatedInstanceIndices.begin(), middle, m_UpdatedInstanceIndices.end());
+        m_UpdatedInstanceIndices.erase(std::unique(m_UpdatedInstanceIndices.begin(), m_UpdatedInstanceIndices.end()), m_UpdatedInstanceIndices.end());
+    }
+
+    if (m_InstanceBvh)
+        m_InstanceBvh->Update(*m_SceneGraph, structureChanged, transformsChanged);
+}
+
+void Scene::SetSceneCache(std::shared_ptr<SceneCache> sceneCache)
+{
+    m_GltfImporter->SetSceneCache(std::move(sceneCache));
+}
+
+void Scene::SetMeshOptimizationEnabled(bool enable)
+{
+    m_GltfImporter->SetMeshOptimizationEnabled(enable);
+}
+
+void Scene::SetMeshLodSettings(const MeshLodSettings& settings)
+{
+    m_GltfImporter->SetMeshLodSettings(settings);
+}
+
+void Scene::SetRefreshExecutor(tf::Executor* executor)
+{
+#ifndef DONUT_WITH_TASKFLOW
+    assert(!executor);
+#endif
+
+    m_RefreshExecutor = executor;
+}
+
+void Scene::SetInstanceBvhEnabled(bool enable)
+{
+    if (!enable)
+    {
+        m_InstanceBvh.reset();
+        return;
+    }
+
+    if (m_InstanceBvh)
+        return;
+
+    m_InstanceBvh = std::make_shared<InstanceBvh>();
+    if (m_SceneGraph)
+        m_InstanceBvh->Build(m_SceneGraph->GetMeshInstances());
 }
 
 void Scene::RefreshBuffers(nvrhi::ICommandList* commandList, uint32_t frameIndex)
@@ -661,8 +768,15 @@ void Scene::RefreshBuffers(nvrhi::ICommandList* commandList, uint32_t frameIndex
         arraysAllocated = true;
     }
 
+    // Streamed textures get new bindless descriptors when their resident mips change
+    const bool texturesReplaced = m_TextureCache && m_TextureCache->IsStreamingEnabled()
+        && (m_TextureCache->GetStreamingStats().texturesUpgraded > 0 || m_TextureCache->GetStreamingStats().texturesEvicted > 0);
+
     for (const auto& material : m_SceneGraph->GetMaterials())
     {
+        if (texturesReplaced && m_TextureCache->MaterialTexturesReplaced(*material))
+            material->dirty = true;
+
         if (material->dirty || m_SceneStructureChanged || arraysAllocated)
             UpdateMaterial(material);
 
@@ -697,7 +811,9 @@ void Scene::RefreshBuffers(nvrhi::ICommandList* commandList, uint32_t frameIndex
             WriteGeometryBuffer(commandList);
     }
 
-    if (m_SceneStructureChanged || m_SceneTransformsChanged || arraysAllocated)
+    m_InstanceBufferBytesUploaded = 0;
+
+    if (m_SceneStructureChanged || arraysAllocated)
     {
         for (const auto& instance : m_SceneGraph->GetMeshInstances())
         {
@@ -705,6 +821,23 @@ void Scene::RefreshBuffers(nvrhi::ICommandList* commandList, uint32_t frameIndex
         }
 
         WriteInstanceBuffer(commandList);
+        m_InstanceBufferBytesUploaded = m_Resources->instanceData.size() * sizeof(InstanceData);
+    }
+    else if (m_SceneTransformsChanged)
+    {
+        // Only the instances that were touched by SceneGraph::Refresh since the last call need to be updated
+        const auto& instances = m_SceneGraph->GetMeshInstances();
+        const auto& updatedIndices = m_UpdatedInstanceIndices;
+
+        for (int index : updatedIndices)
+        {
+            UpdateInstance(instances[index]);
+        }
+
+        const size_t maxGap = 4;
+        m_InstanceBufferBytesUploaded = WriteBufferElementRanges(commandList, m_InstanceBuffer,
+            m_Resources->instanceData.data(), sizeof(InstanceData), instances.size(),
+            updatedIndices, maxGap, m_InstanceUploadThreshold);
     }
 
     if (m_EnableBindlessResources && (materialsChanged || m_SceneStructureChanged || arraysAllocated))
@@ -712,6 +845,10 @@ void Scene::RefreshBuffers(nvrhi::ICommandList* commandList, uint32_t frameIndex
         WriteMaterialBuffer(commandList);
     }
 
+    m_SceneStructureChanged = false;
+    m_SceneTransformsChanged = false;
+    m_UpdatedInstanceIndices.clear();
+
     UpdateSkinnedMeshes(commandList, frameIndex);
 }
 
@@ -1164,6 +1301,68 @@ void Scene::WriteInstanceBuffer(nvrhi::ICommandList* commandList) const
         m_Resources->instanceData.size() * sizeof(InstanceData));
 }
 
+size_t donut::engine::WriteBufferElementRanges(
+    nvrhi::ICommandList* commandList,
+    nvrhi::IBuffer* buffer,
+    const void* data,
+    size_t elementSize,
+    size_t elementCount,
+    const std::vector<int>& dirtyElements,
+    size_t maxGap,
+    float fullUploadFraction)
+{
+    if (dirtyElements.empty() || elementCount == 0)
+        return 0;
+
+    // coalesce the dirty elements into [begin, end) ranges
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t coveredElements = 0;
+
+    for (int dirtyElement : dirtyElements)
+    {
+        if (dirtyElement < 0 || size_t(dirtyElement) >= elementCount)
+            continue;
+
+        size_t index = size_t(dirtyElement);
+
+        if (!ranges.empty() && index < ranges.back().second)
+            continue; // duplicate
+
+        if (!ranges.empty() && index <= ranges.back().second + maxGap)
+        {
+            coveredElements += index + 1 - ranges.back().second;
+            ranges.back().second = index + 1;
+        }
+        else
+        {
+            ranges.emplace_back(index, index + 1);
+            ++coveredElements;
+        }
+    }
+
+    if (ranges.empty())
+        return 0;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    if (float(coveredElements) > float(elementCount) * fullUploadFraction)
+    {
+        commandList->writeBuffer(buffer, bytes, elementCount * elementSize);
+        return elementCount * elementSize;
+    }
+
+    size_t bytesWritten = 0;
+    for (const auto& [begin, end] : ranges)
+    {
+        size_t offset = begin * elementSize;
+        size_t size = (end - begin) * elementSize;
+        commandList->writeBuffer(buffer, bytes + offset, size, offset);
+        bytesWritten += size;
+    }
+
+    return bytesWritten;
+}
+
 void Scene::UpdateMaterial(const std::shared_ptr<Material>& material)
 {
     material->FillConstantBuffer(m_Resources->materialData[material->materialID]);
@@ -0,0 +1,1068 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/SceneCache.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/chunk/chunkFile.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/core/log.h>
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+using namespace donut::math;
+using namespace donut::vfs;
+using namespace donut::engine;
+
+namespace
+{
+    enum SceneCacheChunkType : uint32_t
+    {
+        CHUNKTYPE_SCENE_CACHE_HEADER = 0x600,
+        CHUNKTYPE_SCENE_DESCRIPTION,
+        CHUNKTYPE_SCENE_STREAM_FIRST = 0x610 // one chunk type per SceneStream
+    };
+
+    // Followed by the source file names
+    struct SceneCacheHeader_ChunkDesc_0x100
+    {
+        static constexpr uint32_t const version = 0x100;
+        static constexpr uint32_t const chunktype = CHUNKTYPE_SCENE_CACHE_HEADER;
+
+        uint64_t sourceHash;
+        uint32_t sourceFileCount;
+        uint32_t importOptions;
+    };
+
+    // Serialized textures, materials, meshes, nodes, skins and animations, see SceneCache::Save
+    struct SceneDescription_ChunkDesc_0x101
+    {
+        static constexpr uint32_t const version = 0x101;
+        static constexpr uint32_t const chunktype = CHUNKTYPE_SCENE_DESCRIPTION;
+    };
+
+    enum class SceneStream : uint32_t
+    {
+        Index,
+        Position,
+        TexCoord1,
+        TexCoord2,
+        Normal,
+        Tangent,
+        Joints,
+        Weights,
+
+        Count
+    };
+
+    // The elements of a BufferGroup array, without a header, so that the arrays can be added to the chunk file without copying
+    template<SceneStream stream>
+    struct SceneStream_ChunkDesc_0x100
+    {
+        static constexpr uint32_t const version = 0x100;
+        static constexpr uint32_t const chunktype = CHUNKTYPE_SCENE_STREAM_FIRST + uint32_t(stream);
+    };
+
+    enum class LeafType : uint8_t
+    {
+        None,
+        MeshInstance,
+        SkinnedMeshInstance, // created from the skin list after all nodes
+        PerspectiveCamera,
+        OrthographicCamera,
+        DirectionalLight,
+        PointLight,
+        SpotLight,
+        Animation
+    };
+
+    class BinaryWriter
+    {
+    public:
+        std::vector<uint8_t> data;
+
+        template<typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            data.insert(data.end(), bytes, bytes + sizeof(T));
+        }
+
+        void WriteString(const std::string& value)
+        {
+            Write(uint32_t(value.size()));
+            data.insert(data.end(), value.begin(), value.end());
+        }
+
+        // Chunks are packed back to back, keep them 4-byte aligned for the streams that follow
+        void Align()
+        {
+            data.resize((data.size() + 3) & ~size_t(3), 0);
+        }
+    };
+
+    class BinaryReader
+    {
+    private:
+        const uint8_t* m_Data;
+        size_t m_Size;
+        size_t m_Offset = 0;
+        bool m_Error = false;
+
+    public:
+        BinaryReader(const void* data, size_t size)
+            : m_Data(static_cast<const uint8_t*>(data))
+            , m_Size(size)
+        { }
+
+        template<typename T>
+        T Read()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            // the math types have default constructors that leave them uninitialized, so T{} is not enough:
+            // read through a zeroed buffer, which is also what a failed read returns
+            uint8_t bytes[sizeof(T)] = {};
+            if (m_Error || m_Offset + sizeof(T) > m_Size)
+            {
+                m_Error = true;
+            }
+            else
+            {
+                memcpy(bytes, m_Data + m_Offset, sizeof(T));
+                m_Offset += sizeof(T);
+            }
+
+            T value;
+            memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+        std::string ReadString()
+        {
+            uint32_t length = Read<uint32_t>();
+            if (m_Error || m_Offset + length > m_Size)
+            {
+                m_Error = true;
+                return std::string();
+            }
+            std::string value(reinterpret_cast<const char*>(m_Data + m_Offset), length);
+            m_Offset += length;
+            return value;
+        }
+
+        // Reads an element count, and fails when the remaining data cannot hold that many elements of at least
+        // 'minElementSize' bytes, so that corrupt counts do not cause huge allocations
+        uint32_t ReadCount(size_t minElementSize)
+        {
+            uint32_t count = Read<uint32_t>();
+            if (m_Error || size_t(count) * minElementSize > GetRemainingSize())
+            {
+                m_Error = true;
+                return 0;
+            }
+            return count;
+        }
+
+        // Reads an index that must be below 'count', or ~0u
+        uint32_t ReadIndex(size_t count, bool allowInvalid)
+        {
+            uint32_t index = Read<uint32_t>();
+            if (index >= count && !(allowInvalid && index == ~0u))
+                m_Error = true;
+            return index;
+        }
+
+        [[nodiscard]] const uint8_t* GetCurrentPointer() const { return m_Data + m_Offset; }
+        [[nodiscard]] size_t GetRemainingSize() const { return m_Size - m_Offset; }
+        [[nodiscard]] bool HasError() const { return m_Error; }
+    };
+
+    template<SceneStream stream, typename T>
+    void AddStream(donut::chunk::ChunkFile& chunkFile, const std::vector<T>& elements)
+    {
+        // keeps the following chunks 4-byte aligned
+        static_assert(sizeof(T) % 4 == 0);
+
+        if (!elements.empty())
+            chunkFile.addChunk<SceneStream_ChunkDesc_0x100<stream>>(elements.data(), elements.size() * sizeof(T));
+    }
+
+    template<typename T>
+    bool ReadStream(const donut::chunk::Chunk& chunk, std::vector<T>& elements)
+    {
+        if (chunk.size % sizeof(T) != 0)
+            return false;
+
+        // the chunk data usually points into a memory mapped cache file
+        const T* first = static_cast<const T*>(chunk.data);
+        elements.assign(first, first + chunk.size / sizeof(T));
+        return true;
+    }
+
+    uint64_t RotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    constexpr uint64_t c_HashPrime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t c_HashPrime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t c_HashPrime3 = 0x165667B19E3779F9ull;
+
+    uint64_t HashRound(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * c_HashPrime2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * c_HashPrime1;
+    }
+
+    // Hashes 32 bytes per iteration in 4 independent lanes so that large buffers hash at memory speed
+    uint64_t HashData(const uint8_t* data, size_t size, uint64_t seed)
+    {
+        uint64_t lanes[4] = { seed + c_HashPrime1 + c_HashPrime2, seed + c_HashPrime2, seed, seed - c_HashPrime1 };
+
+        size_t offset = 0;
+        for (; offset + 32 <= size; offset += 32)
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                uint64_t word;
+                memcpy(&word, data + offset + lane * 8, 8);
+                lanes[lane] = HashRound(lanes[lane], word);
+            }
+        }
+
+        uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+        hash += size;
+
+        for (; offset < size; offset++)
+        {
+            hash ^= data[offset] * c_HashPrime3;
+            hash = RotateLeft(hash, 11) * c_HashPrime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= c_HashPrime2;
+        hash ^= hash >> 29;
+        hash *= c_HashPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    const donut::chunk::Chunk* FindChunk(const donut::chunk::ChunkFile& chunkFile, uint32_t chunkType, uint32_t version)
+    {
+        for (const auto& chunk : chunkFile.getChunks())
+        {
+            if (chunk->chunkType == chunkType)
+                return chunk->chunkVersion == version ? chunk.get() : nullptr;
+        }
+        return nullptr;
+    }
+}
+
+SceneCache::SceneCache(std::shared_ptr<vfs::IFileSystem> fs, const std::filesystem::path& cacheDirectory)
+    : m_fs(std::move(fs))
+    , m_CacheDirectory(cacheDirectory)
+{
+}
+
+uint64_t SceneCache::HashSourceFiles(const std::vector<std::shared_ptr<vfs::IBlob>>& blobs)
+{
+    uint64_t hash = 0;
+    for (const auto& blob : blobs)
+    {
+        hash = HashData(static_cast<const uint8_t*>(blob->data()), blob->size(), hash);
+    }
+    return hash;
+}
+
+uint64_t SceneCache::HashFileName(const std::filesystem::path& fileName)
+{
+    std::string normalizedName = fileName.lexically_normal().generic_string();
+    return HashData(reinterpret_cast<const uint8_t*>(normalizedName.data()), normalizedName.size(), 0);
+}
+
+std::filesystem::path SceneCache::GetCacheFileName(const std::filesystem::path& modelFileName) const
+{
+    // models with the same name in different directories get different cache files
+    uint64_t nameHash = HashFileName(modelFileName);
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%016llx.scenecache", (unsigned long long)nameHash);
+
+    return m_CacheDirectory / (modelFileName.stem().generic_string() + suffix);
+}
+
+bool SceneCache::Save(const std::filesystem::path& modelFileName, const SceneCacheContents& contents) const
+{
+    if (!contents.rootNode || contents.sourceFiles.size() != contents.sourceBlobs.size())
+        return false;
+
+    std::shared_ptr<BufferGroup> buffers = contents.meshes.empty() ? nullptr : contents.meshes[0]->buffers;
+
+    std::unordered_map<const LoadedTexture*, uint32_t> textureIndices;
+    std::unordered_map<const Material*, uint32_t> materialIndices;
+    std::unordered_map<const MeshInfo*, uint32_t> meshIndices;
+    std::unordered_map<const SceneGraphNode*, uint32_t> nodeIndices;
+
+    BinaryWriter writer;
+
+    writer.Write(uint32_t(contents.textures.size()));
+    for (const auto& texture : contents.textures)
+    {
+        textureIndices[texture.texture.get()] = uint32_t(textureIndices.size());
+        writer.WriteString(texture.path);
+        writer.WriteString(texture.mimeType);
+        writer.Write(texture.sourceFileIndex);
+        writer.Write(texture.dataOffset);
+        writer.Write(texture.dataSize);
+        writer.Write(uint8_t(texture.sRGB));
+    }
+
+    auto writeTexture = [&writer, &textureIndices](const std::shared_ptr<LoadedTexture>& texture)
+    {
+        auto found = textureIndices.find(texture.get());
+        writer.Write(found != textureIndices.end() ? found->second : ~0u);
+        return !texture || found != textureIndices.end();
+    };
+
+    writer.Write(uint32_t(contents.materials.size()));
+    for (const auto& material : contents.materials)
+    {
+        materialIndices[material.get()] = uint32_t(materialIndices.size());
+        writer.WriteString(material->name);
+        writer.Write(material->domain);
+        bool texturesKnown = writeTexture(material->baseOrDiffuseTexture);
+        texturesKnown = writeTexture(material->metalRoughOrSpecularTexture) && texturesKnown;
+        texturesKnown = writeTexture(material->normalTexture) && texturesKnown;
+        texturesKnown = writeTexture(material->emissiveTexture) && texturesKnown;
+        texturesKnown = writeTexture(material->occlusionTexture) && texturesKnown;
+        texturesKnown = writeTexture(material->transmissionTexture) && texturesKnown;
+        if (!texturesKnown)
+            return false;
+        writer.Write(material->baseOrDiffuseColor);
+        writer.Write(material->specularColor);
+        writer.Write(material->emissiveColor);
+        writer.Write(material->emissiveIntensity);
+        writer.Write(material->metalness);
+        writer.Write(material->roughness);
+        writer.Write(material->opacity);
+        writer.Write(material->alphaCutoff);
+        writer.Write(material->transmissionFactor);
+        writer.Write(material->normalTextureScale);
+        writer.Write(material->occlusionStrength);
+        writer.Write(uint8_t(material->useSpecularGlossModel));
+        writer.Write(uint8_t(material->doubleSided));
+    }
+
+    writer.Write(uint32_t(contents.meshes.size()));
+    for (const auto& mesh : contents.meshes)
+    {
+        if (mesh->buffers != buffers || mesh->skinPrototype)
+            return false;
+
+        meshIndices[mesh.get()] = uint32_t(meshIndices.size());
+        writer.WriteString(mesh->name);
+        writer.Write(mesh->indexOffset);
+        writer.Write(mesh->vertexOffset);
+        writer.Write(mesh->totalIndices);
+        writer.Write(mesh->totalVertices);
+        writer.Write(mesh->objectSpaceBounds);
+        writer.Write(uint32_t(mesh->lodErrors.size()));
+        for (float error : mesh->lodErrors)
+            writer.Write(error);
+        writer.Write(uint32_t(mesh->geometries.size()));
+        for (const auto& geometry : mesh->geometries)
+        {
+            auto material = materialIndices.find(geometry->material.get());
+            if (geometry->material && material == materialIndices.end())
+                return false;
+
+            writer.Write(geometry->material ? material->second : ~0u);
+            writer.Write(geometry->indexOffsetInMesh);
+            writer.Write(geometry->vertexOffsetInMesh);
+            writer.Write(geometry->numIndices);
+            writer.Write(geometry->numVertices);
+            writer.Write(geometry->objectSpaceBounds);
+            writer.Write(uint32_t(geometry->lods.size()));
+            for (const MeshGeometryLod& lod : geometry->lods)
+                writer.Write(lod);
+        }
+    }
+
+    // nodes in depth-first order, so that parents precede their children
+    std::vector<SceneGraphNode*> nodes;
+    for (SceneGraphWalker walker(contents.rootNode.get()); walker; walker.Next(true))
+    {
+        nodeIndices[walker.Get()] = uint32_t(nodes.size());
+        nodes.push_back(walker.Get());
+    }
+
+    std::vector<SkinnedMeshInstance*> skins;
+    std::vector<SceneGraphAnimation*> animations;
+
+    writer.Write(uint32_t(nodes.size()));
+    for (SceneGraphNode* node : nodes)
+    {
+        writer.Write(node->GetParent() && node != contents.rootNode.get() ? nodeIndices[node->GetParent()] : ~0u);
+        writer.WriteString(node->GetName());
+        writer.Write(node->GetTranslation());
+        writer.Write(node->GetRotation());
+        writer.Write(node->GetScaling());
+
+        SceneGraphLeaf* leaf = node->GetLeaf().get();
+        if (!leaf)
+        {
+            writer.Write(LeafType::None);
+            continue;
+        }
+
+        switch (leaf->GetLeafKind())
+        {
+        case SceneGraphLeafKind::MeshInstance: {
+            auto mesh = meshIndices.find(leaf->AsMeshInstance()->GetMesh().get());
+            if (mesh == meshIndices.end())
+                return false;
+            writer.Write(LeafType::MeshInstance);
+            writer.Write(mesh->second);
+            break;
+        }
+        case SceneGraphLeafKind::SkinnedMeshInstance:
+            writer.Write(LeafType::SkinnedMeshInstance);
+            skins.push_back(leaf->AsSkinnedMeshInstance());
+            break;
+        case SceneGraphLeafKind::SkinnedMeshReference:
+            // recreated for the joints of the skins
+            writer.Write(LeafType::None);
+            break;
+        case SceneGraphLeafKind::Camera:
+            if (auto perspective = dynamic_cast<PerspectiveCamera*>(leaf))
+            {
+                writer.Write(LeafType::PerspectiveCamera);
+                writer.Write(perspective->zNear);
+                writer.Write(perspective->verticalFov);
+                writer.Write(uint8_t(perspective->zFar.has_value()));
+                writer.Write(perspective->zFar.value_or(0.f));
+                writer.Write(uint8_t(perspective->aspectRatio.has_value()));
+                writer.Write(perspective->aspectRatio.value_or(0.f));
+            }
+            else if (auto orthographic = dynamic_cast<OrthographicCamera*>(leaf))
+            {
+                writer.Write(LeafType::OrthographicCamera);
+                writer.Write(orthographic->zNear);
+                writer.Write(orthographic->zFar);
+                writer.Write(orthographic->xMag);
+                writer.Write(orthographic->yMag);
+            }
+            else
+                return false;
+            break;
+        case SceneGraphLeafKind::Light: {
+            Light* light = leaf->AsLight();
+            switch (light->GetLightType())
+            {
+            case LightType_Directional: {
+                auto directional = static_cast<DirectionalLight*>(light);
+                writer.Write(LeafType::DirectionalLight);
+                writer.Write(directional->irradiance);
+                writer.Write(directional->angularSize);
+                break;
+            }
+            case LightType_Point: {
+                auto point = static_cast<PointLight*>(light);
+                writer.Write(LeafType::PointLight);
+                writer.Write(point->intensity);
+                writer.Write(point->radius);
+                writer.Write(point->range);
+                break;
+            }
+            case LightType_Spot: {
+                auto spot = static_cast<SpotLight*>(light);
+                writer.Write(LeafType::SpotLight);
+                writer.Write(spot->intensity);
+                writer.Write(spot->radius);
+                writer.Write(spot->range);
+                writer.Write(spot->innerAngle);
+                writer.Write(spot->outerAngle);
+                break;
+            }
+            default:
+                return false;
+            }
+            writer.Write(light->color);
+            writer.Write(light->shadowChannel);
+            break;
+        }
+        case SceneGraphLeafKind::Animation:
+            writer.Write(LeafType::Animation);
+            writer.Write(uint32_t(animations.size()));
+            animations.push_back(leaf->AsAnimation());
+            break;
+        default:
+            // custom leaf types are not known to the cache
+            return false;
+        }
+    }
+
+    writer.Write(uint32_t(skins.size()));
+    for (SkinnedMeshInstance* skin : skins)
+    {
+        auto mesh = meshIndices.find(skin->GetPrototypeMesh().get());
+        if (mesh == meshIndices.end())
+            return false;
+
+        writer.Write(nodeIndices[skin->GetNode()]);
+        writer.Write(mesh->second);
+        writer.Write(uint32_t(skin->joints.size()));
+        for (const auto& joint : skin->joints)
+        {
+            auto jointNode = nodeIndices.find(joint.node.get());
+            if (jointNode == nodeIndices.end())
+                return false;
+            writer.Write(jointNode->second);
+            writer.Write(joint.inverseBindMatrix);
+        }
+    }
+
+    writer.Write(uint32_t(animations.size()));
+    for (SceneGraphAnimation* animation : animations)
+    {
+        std::unordered_map<const animation::Sampler*, uint32_t> samplerIndices;
+        std::vector<animation::Sampler*> samplers;
+        for (const auto& channel : animation->GetChannels())
+        {
+            if (samplerIndices.try_emplace(channel->GetSampler().get(), uint32_t(samplers.size())).second)
+                samplers.push_back(channel->GetSampler().get());
+        }
+
+        writer.Write(uint32_t(samplers.size()));
+        for (animation::Sampler* sampler : samplers)
+        {
+            writer.Write(sampler->GetMode());
+            writer.Write(uint32_t(sampler->GetKeyframes().size()));
+            for (const auto& keyframe : sampler->GetKeyframes())
+                writer.Write(keyframe);
+        }
+
+        writer.Write(uint32_t(animation->GetChannels().size()));
+        for (const auto& channel : animation->GetChannels())
+        {
+            auto targetNode = nodeIndices.find(channel->GetTargetNode().get());
+            if (channel->GetAttribute() == AnimationAttribute::LeafProperty || targetNode == nodeIndices.end())
+                return false;
+
+            writer.Write(samplerIndices[channel->GetSampler().get()]);
+            writer.Write(targetNode->second);
+            writer.Write(channel->GetAttribute());
+        }
+    }
+
+    writer.Align();
+
+    BinaryWriter header;
+    header.Write(SceneCacheHeader_ChunkDesc_0x100{ HashSourceFiles(contents.sourceBlobs), uint32_t(contents.sourceFiles.size()), contents.importOptions });
+    for (const auto& sourceFile : contents.sourceFiles)
+        header.WriteString(sourceFile);
+    header.Align();
+
+    donut::chunk::ChunkFile chunkFile;
+
+    chunkFile.addChunk<SceneCacheHeader_ChunkDesc_0x100>(header.data.data(), header.data.size());
+    chunkFile.addChunk<SceneDescription_ChunkDesc_0x101>(writer.data.data(), writer.data.size());
+
+    if (buffers)
+    {
+        AddStream<SceneStream::Index>(chunkFile, buffers->indexData);
+        AddStream<SceneStream::Position>(chunkFile, buffers->positionData);
+        AddStream<SceneStream::TexCoord1>(chunkFile, buffers->texcoord1Data);
+        AddStream<SceneStream::TexCoord2>(chunkFile, buffers->texcoord2Data);
+        AddStream<SceneStream::Normal>(chunkFile, buffers->normalData);
+        AddStream<SceneStream::Tangent>(chunkFile, buffers->tangentData);
+        AddStream<SceneStream::Joints>(chunkFile, buffers->jointData);
+        AddStream<SceneStream::Weights>(chunkFile, buffers->weightData);
+    }
+
+    auto blob = chunkFile.serialize();
+    if (!blob)
+        return false;
+
+    std::filesystem::path cacheFileName = GetCacheFileName(modelFileName);
+    if (!m_fs->writeFile(cacheFileName, blob->data(), blob->size()))
+    {
+        log::warning("Couldn't write the scene cache file '%s'", cacheFileName.generic_string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool SceneCache::Load(
+    const std::filesystem::path& modelFileName,
+    vfs::IFileSystem& sourceFs,
+    uint32_t importOptions,
+    const std::shared_ptr<SceneTypeFactory>& sceneTypeFactory,
+    TextureCache& textureCache,
+    tf::Executor* executor,
+    SceneImportResult& result)
+{
+    std::filesystem::path cacheFileName = GetCacheFileName(modelFileName);
+    std::string cacheFileNameString = cacheFileName.generic_string();
+
+    std::shared_ptr<IBlob> cacheBlob = m_fs->fileExists(cacheFileName) ? m_fs->readFile(cacheFileName) : nullptr;
+    std::shared_ptr<const donut::chunk::ChunkFile> chunkFile = cacheBlob ? donut::chunk::ChunkFile::deserialize(cacheBlob, cacheFileNameString.c_str()) : nullptr;
+
+    const donut::chunk::Chunk* headerChunk = chunkFile ? FindChunk(*chunkFile, CHUNKTYPE_SCENE_CACHE_HEADER, SceneCacheHeader_ChunkDesc_0x100::version) : nullptr;
+    const donut::chunk::Chunk* descriptionChunk = chunkFile ? FindChunk(*chunkFile, CHUNKTYPE_SCENE_DESCRIPTION, SceneDescription_ChunkDesc_0x101::version) : nullptr;
+
+    if (!headerChunk || !descriptionChunk)
+    {
+        ++m_Misses;
+        return false;
+    }
+
+    // validate the sources
+
+    BinaryReader header(headerChunk->data, headerChunk->size);
+    auto headerDesc = header.Read<SceneCacheHeader_ChunkDesc_0x100>();
+    if (header.HasError() || headerDesc.importOptions != importOptions)
+    {
+        ++m_Misses;
+        return false;
+    }
+
+    // each source file name takes at least its length
+    if (size_t(headerDesc.sourceFileCount) * sizeof(uint32_t) > header.GetRemainingSize())
+    {
+        ++m_Misses;
+        return false;
+    }
+
+    std::vector<std::shared_ptr<IBlob>> sourceBlobs;
+    for (uint32_t index = 0; index < headerDesc.sourceFileCount && !header.HasError(); index++)
+    {
+        std::string sourceFile = header.ReadString();
+        std::shared_ptr<IBlob> sourceBlob = sourceFs.readFile(sourceFile);
+        if (!sourceBlob)
+        {
+            ++m_Misses;
+            return false;
+        }
+        sourceBlobs.push_back(sourceBlob);
+    }
+
+    if (header.HasError() || HashSourceFiles(sourceBlobs) != headerDesc.sourceHash)
+    {
+        ++m_Misses;
+        return false;
+    }
+
+    // create the objects, the textures are only requested after the whole description has been validated
+
+    BinaryReader reader(descriptionChunk->data, descriptionChunk->size);
+
+    struct TextureRecord
+    {
+        std::string path;
+        std::string mimeType;
+        uint32_t sourceFileIndex = ~0u;
+        uint64_t dataOffset = 0;
+        uint64_t dataSize = 0;
+        bool sRGB = false;
+    };
+
+    std::vector<TextureRecord> textureRecords(reader.ReadCount(sizeof(uint32_t)));
+    for (auto& record : textureRecords)
+    {
+        record.path = reader.ReadString();
+        record.mimeType = reader.ReadString();
+        record.sourceFileIndex = reader.ReadIndex(sourceBlobs.size(), true);
+        record.dataOffset = reader.Read<uint64_t>();
+        record.dataSize = reader.Read<uint64_t>();
+        record.sRGB = reader.Read<uint8_t>() != 0;
+
+        if (reader.HasError())
+            break;
+
+        if (record.sourceFileIndex != ~0u)
+        {
+            const size_t sourceSize = sourceBlobs[record.sourceFileIndex]->size();
+            if (record.dataOffset > sourceSize || record.dataSize > sourceSize - record.dataOffset)
+                reader.ReadIndex(0, false);
+        }
+    }
+
+    // the texture slots of each material, filled in when the textures are loaded
+    enum MaterialTextureSlot { BaseOrDiffuse, MetalRoughOrSpecular, Normal, Emissive, Occlusion, Transmission, MaterialTextureSlotCount };
+    std::vector<std::array<uint32_t, MaterialTextureSlotCount>> materialTextures;
+
+    std::vector<std::shared_ptr<Material>> materials(reader.ReadCount(sizeof(uint32_t)));
+    materialTextures.resize(materials.size());
+    for (size_t materialIndex = 0; materialIndex < materials.size(); materialIndex++)
+    {
+        auto& material = materials[materialIndex];
+        material = sceneTypeFactory->CreateMaterial();
+        material->name = reader.ReadString();
+        material->domain = reader.Read<MaterialDomain>();
+        for (uint32_t& textureIndex : materialTextures[materialIndex])
+            textureIndex = reader.ReadIndex(textureRecords.size(), true);
+        material->baseOrDiffuseColor = reader.Read<float3>();
+        material->specularColor = reader.Read<float3>();
+        material->emissiveColor = reader.Read<float3>();
+        material->emissiveIntensity = reader.Read<float>();
+        material->metalness = reader.Read<float>();
+        material->roughness = reader.Read<float>();
+        material->opacity = reader.Read<float>();
+        material->alphaCutoff = reader.Read<float>();
+        material->transmissionFactor = reader.Read<float>();
+        material->normalTextureScale = reader.Read<float>();
+        material->occlusionStrength = reader.Read<float>();
+        material->useSpecularGlossModel = reader.Read<uint8_t>() != 0;
+        material->doubleSided = reader.Read<uint8_t>() != 0;
+
+        if (reader.HasError())
+            break;
+    }
+
+    auto buffers = std::make_shared<BufferGroup>();
+
+    std::vector<std::shared_ptr<MeshInfo>> meshes(reader.ReadCount(sizeof(uint32_t)));
+    for (auto& mesh : meshes)
+    {
+        mesh = sceneTypeFactory->CreateMesh();
+        mesh->name = reader.ReadString();
+        mesh->buffers = buffers;
+        mesh->indexOffset = reader.Read<uint32_t>();
+        mesh->vertexOffset = reader.Read<uint32_t>();
+        mesh->totalIndices = reader.Read<uint32_t>();
+        mesh->totalVertices = reader.Read<uint32_t>();
+        mesh->objectSpaceBounds = reader.Read<box3>();
+        mesh->lodErrors.resize(reader.ReadCount(sizeof(float)));
+        for (float& error : mesh->lodErrors)
+            error = reader.Read<float>();
+
+        mesh->geometries.resize(reader.ReadCount(sizeof(uint32_t)));
+        for (auto& geometry : mesh->geometries)
+        {
+            geometry = sceneTypeFactory->CreateMeshGeometry();
+            uint32_t materialIndex = reader.ReadIndex(materials.size(), true);
+            geometry->material = materialIndex < materials.size() ? materials[materialIndex] : nullptr;
+            geometry->indexOffsetInMesh = reader.Read<uint32_t>();
+            geometry->vertexOffsetInMesh = reader.Read<uint32_t>();
+            geometry->numIndices = reader.Read<uint32_t>();
+            geometry->numVertices = reader.Read<uint32_t>();
+            geometry->objectSpaceBounds = reader.Read<box3>();
+            geometry->lods.resize(reader.ReadCount(sizeof(MeshGeometryLod)));
+            for (MeshGeometryLod& lod : geometry->lods)
+                lod = reader.Read<MeshGeometryLod>();
+
+            if (reader.HasError())
+                break;
+        }
+
+        if (reader.HasError())
+            break;
+    }
+
+    std::vector<std::shared_ptr<SceneGraphNode>> nodes(reader.ReadCount(sizeof(uint32_t)));
+    std::vector<uint32_t> parentIndices(nodes.size());
+    std::vector<uint32_t> animationNodes;
+
+    for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+    {
+        auto node = std::make_shared<SceneGraphNode>();
+        nodes[nodeIndex] = node;
+
+        // parents precede their children
+        parentIndices[nodeIndex] = reader.ReadIndex(nodeIndex, nodeIndex == 0);
+        node->SetName(reader.ReadString());
+        double3 translation = reader.Read<double3>();
+        dquat rotation = reader.Read<dquat>();
+        double3 scaling = reader.Read<double3>();
+        if (any(translation != 0.0) || any(scaling != 1.0) || any(rotation != dquat::identity()))
+            node->SetTransform(&translation, &rotation, &scaling);
+
+        std::shared_ptr<SceneGraphLeaf> leaf;
+        switch (reader.Read<LeafType>())
+        {
+        case LeafType::None:
+        case LeafType::SkinnedMeshInstance:
+            break;
+        case LeafType::MeshInstance: {
+            uint32_t meshIndex = reader.ReadIndex(meshes.size(), false);
+            if (!reader.HasError())
+                leaf = sceneTypeFactory->CreateMeshInstance(meshes[meshIndex]);
+            break;
+        }
+        case LeafType::PerspectiveCamera: {
+            auto camera = std::make_shared<PerspectiveCamera>();
+            camera->zNear = reader.Read<float>();
+            camera->verticalFov = reader.Read<float>();
+            bool hasZFar = reader.Read<uint8_t>() != 0;
+            float zFar = reader.Read<float>();
+            if (hasZFar)
+                camera->zFar = zFar;
+            bool hasAspectRatio = reader.Read<uint8_t>() != 0;
+            float aspectRatio = reader.Read<float>();
+            if (hasAspectRatio)
+                camera->aspectRatio = aspectRatio;
+            leaf = camera;
+            break;
+        }
+        case LeafType::OrthographicCamera: {
+            auto camera = std::make_shared<OrthographicCamera>();
+            camera->zNear = reader.Read<float>();
+            camera->zFar = reader.Read<float>();
+            camera->xMag = reader.Read<float>();
+            camera->yMag = reader.Read<float>();
+            leaf = camera;
+            break;
+        }
+        case LeafType::DirectionalLight: {
+            auto light = std::make_shared<DirectionalLight>();
+            light->irradiance = reader.Read<float>();
+            light->angularSize = reader.Read<float>();
+            light->color = reader.Read<float3>();
+            light->shadowChannel = reader.Read<int>();
+            leaf = light;
+            break;
+        }
+        case LeafType::PointLight: {
+            auto light = std::make_shared<PointLight>();
+            light->intensity = reader.Read<float>();
+            light->radius = reader.Read<float>();
+            light->range = reader.Read<float>();
+            light->color = reader.Read<float3>();
+            light->shadowChannel = reader.Read<int>();
+            leaf = light;
+            break;
+        }
+        case LeafType::SpotLight: {
+            auto light = std::make_shared<SpotLight>();
+            light->intensity = reader.Read<float>();
+            light->radius = reader.Read<float>();
+            light->range = reader.Read<float>();
+            light->innerAngle = reader.Read<float>();
+            light->outerAngle = reader.Read<float>();
+            light->color = reader.Read<float3>();
+            light->shadowChannel = reader.Read<int>();
+            leaf = light;
+            break;
+        }
+        case LeafType::Animation:
+            // the animations are read after the nodes that they target
+            if (reader.Read<uint32_t>() != animationNodes.size())
+                reader.ReadIndex(0, false);
+            animationNodes.push_back(uint32_t(nodeIndex));
+            break;
+        default:
+            reader.ReadIndex(0, false);
+            break;
+        }
+
+        if (reader.HasError())
+            break;
+
+        if (leaf)
+            node->SetLeaf(leaf);
+    }
+
+    uint32_t skinCount = reader.Read<uint32_t>();
+    for (uint32_t skinIndex = 0; skinIndex < skinCount && !reader.HasError(); skinIndex++)
+    {
+        uint32_t nodeIndex = reader.ReadIndex(nodes.size(), false);
+        uint32_t meshIndex = reader.ReadIndex(meshes.size(), false);
+        uint32_t jointCount = reader.ReadCount(sizeof(uint32_t) + sizeof(float4x4));
+        if (reader.HasError())
+            break;
+
+        auto skinnedInstance = std::make_shared<SkinnedMeshInstance>(sceneTypeFactory, meshes[meshIndex]);
+        skinnedInstance->joints.resize(jointCount);
+        for (auto& joint : skinnedInstance->joints)
+        {
+            uint32_t jointNodeIndex = reader.ReadIndex(nodes.size(), false);
+            joint.inverseBindMatrix = reader.Read<float4x4>();
+            if (reader.HasError())
+                break;
+
+            joint.node = nodes[jointNodeIndex];
+            if (!joint.node->GetLeaf())
+                joint.node->SetLeaf(std::make_shared<SkinnedMeshReference>(skinnedInstance));
+        }
+
+        nodes[nodeIndex]->SetLeaf(skinnedInstance);
+    }
+
+    uint32_t animationCount = reader.Read<uint32_t>();
+    if (animationCount != animationNodes.size())
+        reader.ReadIndex(0, false);
+
+    for (uint32_t animationIndex = 0; animationIndex < animationCount && !reader.HasError(); animationIndex++)
+    {
+        auto animation = std::make_shared<SceneGraphAnimation>();
+
+        std::vector<std::shared_ptr<animation::Sampler>> samplers(reader.ReadCount(sizeof(uint32_t)));
+        for (auto& sampler : samplers)
+        {
+            sampler = std::make_shared<animation::Sampler>();
+            sampler->SetInterpolationMode(reader.Read<animation::InterpolationMode>());
+            uint32_t keyframeCount = reader.ReadCount(sizeof(animation::Keyframe));
+            if (reader.HasError())
+                break;
+            sampler->GetKeyframes().resize(keyframeCount);
+            for (auto& keyframe : sampler->GetKeyframes())
+                keyframe = reader.Read<animation::Keyframe>();
+        }
+
+        uint32_t channelCount = reader.Read<uint32_t>();
+        for (uint32_t channelIndex = 0; channelIndex < channelCount && !reader.HasError(); channelIndex++)
+        {
+            uint32_t samplerIndex = reader.ReadIndex(samplers.size(), false);
+            uint32_t targetNodeIndex = reader.ReadIndex(nodes.size(), false);
+            auto attribute = reader.Read<AnimationAttribute>();
+            if (reader.HasError())
+                break;
+
+            animation->AddChannel(std::make_shared<SceneGraphAnimationChannel>(samplers[samplerIndex], nodes[targetNodeIndex], attribute));
+        }
+
+        if (!reader.HasError())
+            nodes[animationNodes[animationIndex]]->SetLeaf(animation);
+    }
+
+    // the vertex and index streams
+    bool streamsValid = true;
+    for (const auto& chunk : chunkFile->getChunks())
+    {
+        if (chunk->chunkType < CHUNKTYPE_SCENE_STREAM_FIRST || chunk->chunkType >= CHUNKTYPE_SCENE_STREAM_FIRST + uint32_t(SceneStream::Count))
+            continue;
+
+        if (chunk->chunkVersion != SceneStream_ChunkDesc_0x100<SceneStream::Index>::version)
+        {
+            streamsValid = false;
+            break;
+        }
+
+        switch (SceneStream(chunk->chunkType - CHUNKTYPE_SCENE_STREAM_FIRST))
+        {
+        case SceneStream::Index: streamsValid = ReadStream(*chunk, buffers->indexData); break;
+        case SceneStream::Position: streamsValid = ReadStream(*chunk, buffers->positionData); break;
+        case SceneStream::TexCoord1: streamsValid = ReadStream(*chunk, buffers->texcoord1Data); break;
+        case SceneStream::TexCoord2: streamsValid = ReadStream(*chunk, buffers->texcoord2Data); break;
+        case SceneStream::Normal: streamsValid = ReadStream(*chunk, buffers->normalData); break;
+        case SceneStream::Tangent: streamsValid = ReadStream(*chunk, buffers->tangentData); break;
+        case SceneStream::Joints: streamsValid = ReadStream(*chunk, buffers->jointData); break;
+        case SceneStream::Weights: streamsValid = ReadStream(*chunk, buffers->weightData); break;
+        default: streamsValid = false; break;
+        }
+
+        if (!streamsValid)
+            break;
+    }
+
+    // the meshes and geometries must reference ranges inside the streams
+    for (const auto& mesh : meshes)
+    {
+        if (!streamsValid || reader.HasError())
+            break;
+
+        streamsValid = size_t(mesh->indexOffset) + mesh->totalIndices <= buffers->indexData.size()
+            && size_t(mesh->vertexOffset) + mesh->totalVertices <= buffers->positionData.size();
+
+        for (const auto& geometry : mesh->geometries)
+        {
+            streamsValid = streamsValid
+                && size_t(geometry->indexOffsetInMesh) + geometry->numIndices <= mesh->totalIndices
+                && size_t(geometry->vertexOffsetInMesh) + geometry->numVertices <= mesh->totalVertices;
+
+            // LOD indices are appended after the indices of all meshes, past totalIndices
+            for (const MeshGeometryLod& lod : geometry->lods)
+                streamsValid = streamsValid && size_t(mesh->indexOffset) + lod.indexOffsetInMesh + lod.numIndices <= buffers->indexData.size();
+        }
+    }
+
+    if (reader.HasError() || !streamsValid || nodes.empty())
+    {
+        log::warning("Scene cache file '%s' is corrupt", cacheFileNameString.c_str());
+        ++m_Misses;
+        return false;
+    }
+
+    // the description is valid, request the textures
+
+    std::vector<std::shared_ptr<LoadedTexture>> textures(textureRecords.size());
+    for (size_t textureIndex = 0; textureIndex < textureRecords.size(); textureIndex++)
+    {
+        const TextureRecord& record = textureRecords[textureIndex];
+        auto& texture = textures[textureIndex];
+
+        if (record.sourceFileIndex != ~0u)
+        {
+            auto textureData = std::make_shared<BufferRegionBlob>(sourceBlobs[record.sourceFileIndex], size_t(record.dataOffset), size_t(record.dataSize));
+#ifdef DONUT_WITH_TASKFLOW
+            if (executor)
+                texture = textureCache.LoadTextureFromMemoryAsync(textureData, record.path, record.mimeType, record.sRGB, *executor);
+            else
+#endif
+                texture = textureCache.LoadTextureFromMemoryDeferred(textureData, record.path, record.mimeType, record.sRGB);
+        }
+        else
+        {
+#ifdef DONUT_WITH_TASKFLOW
+            if (executor)
+                texture = textureCache.LoadTextureFromFileAsync(record.path, record.sRGB, *executor);
+            else
+#endif
+                texture = textureCache.LoadTextureFromFileDeferred(record.path, record.sRGB);
+        }
+    }
+
+    auto getTexture = [&textures](uint32_t index)
+    {
+        return index < textures.size() ? textures[index] : nullptr;
+    };
+
+    for (size_t materialIndex = 0; materialIndex < materials.size(); materialIndex++)
+    {
+        const auto& slots = materialTextures[materialIndex];
+        Material& material = *materials[materialIndex];
+        material.baseOrDiffuseTexture = getTexture(slots[BaseOrDiffuse]);
+        material.metalRoughOrSpecularTexture = getTexture(slots[MetalRoughOrSpecular]);
+        material.normalTexture = getTexture(slots[Normal]);
+        material.emissiveTexture = getTexture(slots[Emissive]);
+        material.occlusionTexture = getTexture(slots[Occlusion]);
+        material.transmissionTexture = getTexture(slots[Transmission]);
+    }
+
+    // attach the children in reverse order because Attach inserts them at the front
+    auto graph = std::make_shared<SceneGraph>();
+    for (size_t nodeIndex = nodes.size() - 1; nodeIndex > 0; nodeIndex--)
+    {
+        graph->Attach(nodes[parentIndices[nodeIndex]], nodes[nodeIndex]);
+    }
+
+    result.rootNode = nodes[0];
+    ++m_Hits;
+    return true;
+}
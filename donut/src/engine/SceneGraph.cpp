@@ -23,8 +23,13 @@
 #include <donut/engine/SceneGraph.h>
 #include <donut/core/log.h>
 #include <donut/core/json.h>
+#include <algorithm>
 #include <sstream>
 
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
 using namespace donut::engine;
 
 const std::string& SceneGraphLeaf::GetName() const
@@ -47,7 +52,7 @@ void SceneGraphLeaf::SetName(const std::string& name) const
 }
 
 SkinnedMeshInstance::SkinnedMeshInstance(std::shared_ptr<SceneTypeFactory> sceneTypeFactory, std::shared_ptr<MeshInfo> prototypeMesh)
-    : MeshInstance(nullptr)
+    : MeshInstance(nullptr, SceneGraphLeafKind::SkinnedMeshInstance)
     , m_SceneTypeFactory(sceneTypeFactory)
 {
     m_PrototypeMesh = std::move(prototypeMesh);
@@ -249,6 +254,36 @@ void SceneGraphNode::UpdateLocalTransform()
     m_LocalTransform = transform;
 }
 
+void SceneGraphNode::ReleaseFlatHierarchy()
+{
+    if (!m_Flat)
+        return;
+
+    // copy the transforms and bounds back into the node
+    m_GlobalTransform = m_Flat->globalTransforms[m_FlatIndex];
+    m_GlobalTransformFloat = m_Flat->globalTransformsFloat[m_FlatIndex];
+    m_PrevGlobalTransform = m_Flat->prevGlobalTransforms[m_FlatIndex];
+    m_PrevGlobalTransformFloat = m_Flat->prevGlobalTransformsFloat[m_FlatIndex];
+    m_GlobalBoundingBox = m_Flat->globalBoundingBoxes[m_FlatIndex];
+
+    uint8_t state = m_Flat->states[m_FlatIndex];
+    m_Flat = nullptr;
+    m_FlatIndex = 0;
+
+    // pending changes are tracked by the node flags from now on
+    if (state & FlatTransformHierarchy::LocalTransformDirty)
+    {
+        m_Dirty |= DirtyFlags::LocalTransform;
+        PropagateDirtyFlags(DirtyFlags::SubgraphTransforms);
+    }
+
+    if (state & FlatTransformHierarchy::PrevTransformDirty)
+    {
+        m_Dirty |= DirtyFlags::PrevTransform;
+        PropagateDirtyFlags(DirtyFlags::SubgraphPrevTransforms);
+    }
+}
+
 void SceneGraphNode::PropagateDirtyFlags(DirtyFlags flags)
 {
     SceneGraphWalker walker(this, nullptr);
@@ -276,6 +311,9 @@ std::filesystem::path SceneGraphNode::GetPath() const
 void SceneGraphNode::InvalidateContent()
 {
     PropagateDirtyFlags(DirtyFlags::SubgraphContentUpdate);
+
+    if (m_Flat)
+        m_Flat->MarkDirty(m_FlatIndex, FlatTransformHierarchy::LeafDirty);
 }
 
 void SceneGraphNode::SetTransform(const dm::double3* translation, const dm::dquat* rotation, const dm::double3* scaling)
@@ -287,6 +325,12 @@ void SceneGraphNode::SetTransform(const dm::double3* translation, const dm::dqua
     m_Dirty |= DirtyFlags::LocalTransform;
     m_HasLocalTransform = true;
     PropagateDirtyFlags(DirtyFlags::SubgraphTransforms);
+
+    if (m_Flat)
+    {
+        m_Flat->states[m_FlatIndex] |= FlatTransformHierarchy::HasLocalTransform;
+        m_Flat->MarkDirty(m_FlatIndex);
+    }
 }
 
 void SceneGraphNode::SetScaling(const dm::double3& scaling)
@@ -400,6 +444,49 @@ int SceneGraphWalker::Up()
     return -1;
 }
 
+void FlatTransformHierarchy::Clear()
+{
+    nodes.clear();
+    meshInstances.clear();
+    parents.clear();
+    subtreeEnds.clear();
+    states.clear();
+    localTransforms.clear();
+    globalTransforms.clear();
+    globalTransformsFloat.clear();
+    prevGlobalTransforms.clear();
+    prevGlobalTransformsFloat.clear();
+    localBoundingBoxes.clear();
+    globalBoundingBoxes.clear();
+}
+
+void FlatTransformHierarchy::Reserve(size_t count)
+{
+    nodes.reserve(count);
+    meshInstances.reserve(count);
+    parents.reserve(count);
+    subtreeEnds.reserve(count);
+    states.reserve(count);
+    localTransforms.reserve(count);
+    globalTransforms.reserve(count);
+    globalTransformsFloat.reserve(count);
+    prevGlobalTransforms.reserve(count);
+    prevGlobalTransformsFloat.reserve(count);
+    localBoundingBoxes.reserve(count);
+    globalBoundingBoxes.reserve(count);
+}
+
+void FlatTransformHierarchy::MarkDirty(uint32_t index, StateBits bits)
+{
+    states[index] |= bits;
+
+    // if a node is marked with SubtreeDirty, all of its parents are marked too
+    for (int current = int(index); current >= 0 && !(states[current] & SubtreeDirty); current = parents[current])
+    {
+        states[current] |= SubtreeDirty;
+    }
+}
+
 bool SceneGraphAnimationChannel::Apply(float time) const
 {
     auto node = m_TargetNode.lock();
@@ -528,9 +615,9 @@ void SceneGraph::RegisterLeaf(const std::shared_ptr<SceneGraphLeaf>& leaf)
     if (!leaf)
         return;
     
-    auto meshInstance = std::dynamic_pointer_cast<MeshInstance>(leaf);
-    if (meshInstance)
+    if (leaf->AsMeshInstance())
     {
+        auto meshInstance = std::static_pointer_cast<MeshInstance>(leaf);
         const auto& mesh = meshInstance->GetMesh();
         if (mesh)
         {
@@ -559,34 +646,30 @@ void SceneGraph::RegisterLeaf(const std::shared_ptr<SceneGraphLeaf>& leaf)
         }
         m_MeshInstances.push_back(meshInstance);
 
-        auto skinnedInstance = std::dynamic_pointer_cast<SkinnedMeshInstance>(meshInstance);
-        if (skinnedInstance)
+        if (leaf->AsSkinnedMeshInstance())
         {
-            m_SkinnedMeshInstances.push_back(skinnedInstance);
+            m_SkinnedMeshInstances.push_back(std::static_pointer_cast<SkinnedMeshInstance>(leaf));
         }
 
         return;
     }
     
-    auto animation = std::dynamic_pointer_cast<SceneGraphAnimation>(leaf);
-    if (animation)
+    switch (leaf->GetLeafKind())
     {
-        m_Animations.push_back(animation);
-        return;
-    }
+    case SceneGraphLeafKind::Animation:
+        m_Animations.push_back(std::static_pointer_cast<SceneGraphAnimation>(leaf));
+        break;
 
-    auto camera = std::dynamic_pointer_cast<SceneCamera>(leaf);
-    if (camera)
-    {
-        m_Cameras.push_back(camera);
-        return;
-    }
+    case SceneGraphLeafKind::Camera:
+        m_Cameras.push_back(std::static_pointer_cast<SceneCamera>(leaf));
+        break;
 
-    auto light = std::dynamic_pointer_cast<Light>(leaf);
-    if (light)
-    {
-        m_Lights.push_back(light);
-        return;
+    case SceneGraphLeafKind::Light:
+        m_Lights.push_back(std::static_pointer_cast<Light>(leaf));
+        break;
+
+    default:
+        break;
     }
 }
 
@@ -595,9 +678,9 @@ void SceneGraph::UnregisterLeaf(const std::shared_ptr<SceneGraphLeaf>& leaf)
     if (!leaf)
         return;
 
-    auto meshInstance = std::dynamic_pointer_cast<MeshInstance>(leaf);
-    if (meshInstance)
+    if (leaf->AsMeshInstance())
     {
+        auto meshInstance = std::static_pointer_cast<MeshInstance>(leaf);
         const auto& mesh = meshInstance->GetMesh();
         if (mesh)
         {
@@ -631,36 +714,36 @@ void SceneGraph::UnregisterLeaf(const std::shared_ptr<SceneGraphLeaf>& leaf)
         return;
     }
 
-    auto skinnedInstance = std::dynamic_pointer_cast<SkinnedMeshInstance>(leaf);
-    if (skinnedInstance)
+    if (leaf->AsSkinnedMeshInstance())
     {
+        auto skinnedInstance = std::static_pointer_cast<SkinnedMeshInstance>(leaf);
         auto it = std::find(m_SkinnedMeshInstances.begin(), m_SkinnedMeshInstances.end(), skinnedInstance);
         if (it != m_SkinnedMeshInstances.end())
             m_SkinnedMeshInstances.erase(it);
         return;
     }
 
-    auto animation = std::dynamic_pointer_cast<SceneGraphAnimation>(leaf);
-    if (animation)
+    if (leaf->AsAnimation())
     {
+        auto animation = std::static_pointer_cast<SceneGraphAnimation>(leaf);
         auto it = std::find(m_Animations.begin(), m_Animations.end(), animation);
         if (it != m_Animations.end())
             m_Animations.erase(it);
         return;
     }
 
-    auto camera = std::dynamic_pointer_cast<SceneCamera>(leaf);
-    if (camera)
+    if (leaf->AsCamera())
     {
+        auto camera = std::static_pointer_cast<SceneCamera>(leaf);
         auto it = std::find(m_Cameras.begin(), m_Cameras.end(), camera);
         if (it != m_Cameras.end())
             m_Cameras.erase(it);
         return;
     }
 
-    auto light = std::dynamic_pointer_cast<Light>(leaf);
-    if (light)
+    if (leaf->AsLight())
     {
+        auto light = std::static_pointer_cast<Light>(leaf);
         auto it = std::find(m_Lights.begin(), m_Lights.end(), light);
         if (it != m_Lights.end())
             m_Lights.erase(it);
@@ -668,6 +751,25 @@ void SceneGraph::UnregisterLeaf(const std::shared_ptr<SceneGraphLeaf>& leaf)
     }
 }
 
+SceneGraph::~SceneGraph()
+{
+    // the nodes may outlive the graph, make them stop referencing the flat arrays
+    ReleaseFlatHierarchy();
+}
+
+void SceneGraph::SetFlatHierarchyEnabled(bool enable)
+{
+    if (m_FlatHierarchyEnabled == enable)
+        return;
+
+    m_FlatHierarchyEnabled = enable;
+
+    if (enable)
+        m_FlatHierarchyValid = false;
+    else
+        ReleaseFlatHierarchy();
+}
+
 std::shared_ptr<SceneGraphNode> SceneGraph::SetRootNode(const std::shared_ptr<SceneGraphNode>& root)
 {
     auto oldRoot = m_Root;
@@ -769,7 +871,14 @@ std::shared_ptr<SceneGraphNode> SceneGraph::Attach(const std::shared_ptr<SceneGr
         walker = SceneGraphWalker(attachedChild.get());
         while (walker)
         {
-            if (auto animation = dynamic_cast<SceneGraphAnimation*>(walker->m_Leaf.get()))
+            SceneGraphLeaf* leaf = walker->m_Leaf.get();
+            if (!leaf)
+            {
+                walker.Next(true);
+                continue;
+            }
+
+            if (auto animation = leaf->AsAnimation())
             {
                 for (const auto& channel : animation->GetChannels())
                 {
@@ -780,7 +889,7 @@ std::shared_ptr<SceneGraphNode> SceneGraph::Attach(const std::shared_ptr<SceneGr
                     }
                 }
             }
-            else if (auto skinnedInstance = dynamic_cast<SkinnedMeshInstance*>(walker->m_Leaf.get()))
+            else if (auto skinnedInstance = leaf->AsSkinnedMeshInstance())
             {
                 for (auto& joint : skinnedInstance->joints)
                 {
@@ -791,7 +900,7 @@ std::shared_ptr<SceneGraphNode> SceneGraph::Attach(const std::shared_ptr<SceneGr
                     }
                 }
             }
-            else if (auto meshReference = dynamic_cast<SkinnedMeshReference*>(walker->m_Leaf.get()))
+            else if (auto meshReference = leaf->AsSkinnedMeshReference())
             {
                 auto instance = meshReference->m_Instance.lock();
                 if (instance)
@@ -800,7 +909,8 @@ std::shared_ptr<SceneGraphNode> SceneGraph::Attach(const std::shared_ptr<SceneGr
 
                     auto newNode = nodeMap[oldNode];
                     if (newNode)
-                        meshReference->m_Instance = std::dynamic_pointer_cast<SkinnedMeshInstance>(newNode->m_Leaf);
+                        meshReference->m_Instance = (newNode->m_Leaf && newNode->m_Leaf->AsSkinnedMeshInstance())
+                            ? std::static_pointer_cast<SkinnedMeshInstance>(newNode->m_Leaf) : nullptr;
                     else
                         meshReference->m_Instance.reset();
                 }
@@ -841,6 +951,8 @@ std::shared_ptr<SceneGraphNode> SceneGraph::Attach(const std::shared_ptr<SceneGr
     attachedChild->PropagateDirtyFlags(SceneGraphNode::DirtyFlags::SubgraphStructure
         | (child->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphMask));
 
+    m_FlatHierarchyValid = false;
+
     return attachedChild;
 }
 
@@ -866,12 +978,15 @@ std::shared_ptr<SceneGraphNode> SceneGraph::Detach(const std::shared_ptr<SceneGr
         SceneGraphWalker walker(node.get());
         while (walker)
         {
+            walker->ReleaseFlatHierarchy();
             walker->m_Graph.reset();
             auto leaf = walker->GetLeaf();
             if (leaf)
                 UnregisterLeaf(leaf);
             walker.Next(true);
         }
+
+        m_FlatHierarchyValid = false;
     }
 
     // remove the node from its parent
@@ -950,91 +1065,195 @@ std::shared_ptr<SceneGraphNode> SceneGraph::FindNode(const std::filesystem::path
 
 void SceneGraph::Refresh(uint32_t frameIndex)
 {
-    struct StackItem
-    {
-        bool supergraphTransformUpdated = false;
-        bool supergraphContentUpdate = false;
-    };
+    Refresh(frameIndex, nullptr);
+}
+
+void SceneGraph::Refresh(uint32_t frameIndex, tf::Executor* executor)
+{
+#ifndef DONUT_WITH_TASKFLOW
+    assert(!executor);
+#endif
 
     bool structureDirty = HasPendingStructureChanges();
 
-    StackItem context;
-    std::vector<StackItem> stack;
+    m_RefreshOutput.transformedMeshInstances.clear();
+    m_RefreshOutput.updatedSkinnedMeshInstances.clear();
 
-    SceneGraphWalker walker(m_Root.get());
-    while (walker)
+    if (m_FlatHierarchyEnabled)
     {
-        auto current = walker.Get();
-        auto parent = current->m_Parent;
-
-        // save the current local/global transforms as previous
-        current->m_PrevLocalTransform = current->m_LocalTransform;
-        current->m_PrevGlobalTransform = current->m_GlobalTransform;
-        current->m_PrevGlobalTransformFloat = current->m_GlobalTransformFloat;
+        RefreshFlatHierarchy(structureDirty);
+    }
+#ifdef DONUT_WITH_TASKFLOW
+    else if (executor && executor->num_workers() > 1 && m_MeshInstances.size() >= m_ParallelRefreshThreshold)
+    {
+        RefreshSubgraphsParallel(*executor);
+    }
+#endif
+    else if (m_Root)
+    {
+        RefreshSubgraph(m_Root.get(), RefreshContext(), m_RefreshOutput);
+    }
 
-        bool currentTransformUpdated = (current->m_Dirty & SceneGraphNode::DirtyFlags::LocalTransform) != 0;
-        bool currentContentUpdated = (current->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphContentUpdate) != 0;
+    // store the update frame number for skinned groups
+    for (SkinnedMeshInstance* instance : m_RefreshOutput.updatedSkinnedMeshInstances)
+        instance->m_LastUpdateFrameIndex = frameIndex;
 
-        if (currentTransformUpdated)
+    if (structureDirty)
+    {
+        int instanceIndex = 0;
+        int geometryInstanceIndex = 0;
+        for (const auto& instance : m_MeshInstances)
         {
-            current->UpdateLocalTransform();
-        }
+            instance->m_InstanceIndex = instanceIndex;
+            ++instanceIndex;
 
-        // update the global transform of the current node
-        if (parent)
-        {
-            current->m_GlobalTransform = current->m_HasLocalTransform
-                ? current->m_LocalTransform * parent->m_GlobalTransform
-                : parent->m_GlobalTransform;
-        }
-        else
-        {
-            current->m_GlobalTransform = current->m_LocalTransform;
+            const auto& mesh = instance->GetMesh();
+            instance->m_GeometryInstanceIndex = geometryInstanceIndex;
+            geometryInstanceIndex += int(mesh->geometries.size());
         }
-        current->m_GlobalTransformFloat = dm::affine3(current->m_GlobalTransform);
+        m_GeometryInstancesCount = geometryInstanceIndex;
 
-        // initialize the global bbox of the current node, start with the leaf (or an empty box if there is no leaf)
-        if ((current->m_Dirty & (SceneGraphNode::DirtyFlags::SubgraphStructure | SceneGraphNode::DirtyFlags::SubgraphTransforms)) != 0 || context.supergraphTransformUpdated)
+        int meshIndex = 0;
+        int geometryIndex = 0;
+        for (const auto& mesh : m_Meshes)
         {
-            current->m_GlobalBoundingBox = dm::box3::empty();
-            if (current->m_Leaf)
+            for (const auto& geometry : mesh->geometries)
             {
-                dm::box3 localBoundingBox = current->m_Leaf->GetLocalBoundingBox();
-                if (!localBoundingBox.isempty())
-                    current->m_GlobalBoundingBox = localBoundingBox * current->m_GlobalTransformFloat;
+                geometry->globalGeometryIndex = geometryIndex;
+                ++geometryIndex;
             }
+
+            mesh->globalMeshIndex = meshIndex;
+            ++meshIndex;
         }
 
-        // initialize the content flags of the current node
-        if (context.supergraphContentUpdate || (current->m_Dirty & (SceneGraphNode::DirtyFlags::SubgraphStructure | SceneGraphNode::DirtyFlags::SubgraphContentUpdate)) != 0)
+        assert(m_GeometryCount == geometryIndex);
+
+        int materialIndex = 0;
+        for (const auto& material : m_Materials)
         {
-            if (current->m_Leaf)
-                current->m_LeafContent = current->m_Leaf->GetContentFlags();
-            else
-                current->m_LeafContent = SceneContentFlags::None;
+            material->materialID = materialIndex;
+            ++materialIndex;
+        }
+    }
+
+    const auto& transformedMeshInstances = m_RefreshOutput.transformedMeshInstances;
+    m_UpdatedMeshInstanceIndices.resize(transformedMeshInstances.size());
+    for (size_t i = 0; i < transformedMeshInstances.size(); i++)
+    {
+        m_UpdatedMeshInstanceIndices[i] = transformedMeshInstances[i]->m_InstanceIndex;
+    }
+    std::sort(m_UpdatedMeshInstanceIndices.begin(), m_UpdatedMeshInstanceIndices.end());
+}
+
+SceneGraph::RefreshContext SceneGraph::RefreshNode(SceneGraphNode* current, const RefreshContext& context, RefreshOutput& output)
+{
+    auto parent = current->m_Parent;
+
+    // save the current local/global transforms as previous
+    current->m_PrevLocalTransform = current->m_LocalTransform;
+    current->m_PrevGlobalTransform = current->m_GlobalTransform;
+    current->m_PrevGlobalTransformFloat = current->m_GlobalTransformFloat;
+
+    bool currentTransformUpdated = (current->m_Dirty & SceneGraphNode::DirtyFlags::LocalTransform) != 0;
+    bool currentContentUpdated = (current->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphContentUpdate) != 0;
+
+    if (currentTransformUpdated)
+    {
+        current->UpdateLocalTransform();
+    }
 
-            current->m_SubgraphContent = current->m_LeafContent;
+    // update the global transform of the current node
+    if (parent)
+    {
+        current->m_GlobalTransform = current->m_HasLocalTransform
+            ? current->m_LocalTransform * parent->m_GlobalTransform
+            : parent->m_GlobalTransform;
+    }
+    else
+    {
+        current->m_GlobalTransform = current->m_LocalTransform;
+    }
+    current->m_GlobalTransformFloat = dm::affine3(current->m_GlobalTransform);
+
+    // initialize the global bbox of the current node, start with the leaf (or an empty box if there is no leaf)
+    if ((current->m_Dirty & (SceneGraphNode::DirtyFlags::SubgraphStructure | SceneGraphNode::DirtyFlags::SubgraphTransforms | SceneGraphNode::DirtyFlags::SubgraphContentUpdate)) != 0 || context.supergraphTransformUpdated)
+    {
+        current->m_GlobalBoundingBox = dm::box3::empty();
+        if (current->m_Leaf)
+        {
+            dm::box3 localBoundingBox = current->m_Leaf->GetLocalBoundingBox();
+            if (!localBoundingBox.isempty())
+                current->m_GlobalBoundingBox = localBoundingBox * current->m_GlobalTransformFloat;
         }
+    }
 
-        // store the update frame number for skinned groups
-        if (auto meshReference = dynamic_cast<SkinnedMeshReference*>(current->m_Leaf.get()))
+    // initialize the content flags of the current node
+    if (context.supergraphContentUpdate || (current->m_Dirty & (SceneGraphNode::DirtyFlags::SubgraphStructure | SceneGraphNode::DirtyFlags::SubgraphContentUpdate)) != 0)
+    {
+        if (current->m_Leaf)
+            current->m_LeafContent = current->m_Leaf->GetContentFlags();
+        else
+            current->m_LeafContent = SceneContentFlags::None;
+
+        current->m_SubgraphContent = current->m_LeafContent;
+    }
+
+    // remember the mesh instances whose instance data needs to be rewritten
+    if ((currentTransformUpdated || context.supergraphTransformUpdated ||
+        (current->m_Dirty & SceneGraphNode::DirtyFlags::PrevTransform) != 0) && current->m_Leaf)
+    {
+        if (auto meshInstance = current->m_Leaf->AsMeshInstance())
+            output.transformedMeshInstances.push_back(meshInstance);
+    }
+
+    // remember the skinned groups that need their update frame number stored
+    if (currentTransformUpdated && current->m_Leaf)
+    {
+        if (auto meshReference = current->m_Leaf->AsSkinnedMeshReference())
         {
-            if ((current->m_Dirty & SceneGraphNode::DirtyFlags::LocalTransform) != 0)
-            {
-                auto instance = meshReference->m_Instance.lock();
-                if (instance)
-                {
-                    instance->m_LastUpdateFrameIndex = frameIndex;
-                }
-            }
+            auto instance = meshReference->m_Instance.lock();
+            if (instance)
+                output.updatedSkinnedMeshInstances.push_back(instance.get());
         }
+    }
+
+    RefreshContext childContext;
+    childContext.supergraphTransformUpdated = context.supergraphTransformUpdated || currentTransformUpdated;
+    childContext.supergraphContentUpdate = context.supergraphContentUpdate || currentContentUpdated;
+    return childContext;
+}
+
+void SceneGraph::MergeIntoParent(SceneGraphNode* node)
+{
+    SceneGraphNode* parent = node->m_Parent;
+
+    parent->m_GlobalBoundingBox |= node->m_GlobalBoundingBox;
+    if ((node->m_Dirty & SceneGraphNode::DirtyFlags::PrevTransform) != 0)
+        parent->m_Dirty |= SceneGraphNode::DirtyFlags::SubgraphPrevTransforms;
+    parent->m_Dirty |= node->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphMask;
+    parent->m_SubgraphContent |= node->m_SubgraphContent;
+}
+
+void SceneGraph::RefreshSubgraph(SceneGraphNode* subgraphRoot, RefreshContext context, RefreshOutput& output)
+{
+    std::vector<RefreshContext> stack;
+
+    SceneGraphWalker walker(subgraphRoot);
+    while (walker)
+    {
+        auto current = walker.Get();
+        auto parent = current->m_Parent;
 
-        // advance to the next node
         bool subgraphNeedsRefresh = (current->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphMask) != 0;
+
+        RefreshContext childContext = RefreshNode(current, context, output);
+
+        // advance to the next node
         int deltaDepth = walker.Next(subgraphNeedsRefresh || context.supergraphTransformUpdated || context.supergraphContentUpdate);
 
         // save the dirty flag to update the same nodes' previous transforms on the next frame
-        current->m_Dirty = (currentTransformUpdated || context.supergraphTransformUpdated)
+        current->m_Dirty = childContext.supergraphTransformUpdated
             ? SceneGraphNode::DirtyFlags::PrevTransform
             : SceneGraphNode::DirtyFlags::None;
         
@@ -1042,19 +1261,15 @@ void SceneGraph::Refresh(uint32_t frameIndex)
         {
             // going down the tree
             stack.push_back(context);
-            context.supergraphTransformUpdated |= currentTransformUpdated;
-            context.supergraphContentUpdate |= currentContentUpdated;
+            context = childContext;
         }
         else
         {
             // sibling or going up. done with our bbox, update the parent.
-            if (parent)
+            // the subgraph root is merged into its parent by the caller.
+            if (parent && current != subgraphRoot)
             {
-                parent->m_GlobalBoundingBox |= current->m_GlobalBoundingBox;
-                if ((current->m_Dirty & SceneGraphNode::DirtyFlags::PrevTransform) != 0)
-                    parent->m_Dirty |= SceneGraphNode::DirtyFlags::SubgraphPrevTransforms;
-                parent->m_Dirty |= current->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphMask;
-                parent->m_SubgraphContent |= current->m_SubgraphContent;
+                MergeIntoParent(current);
             }
 
             // going up the tree, potentially multiple levels
@@ -1062,7 +1277,7 @@ void SceneGraph::Refresh(uint32_t frameIndex)
             {
                 if (stack.empty())
                 {
-                    context = StackItem(); // should only happen once when we reach the top
+                    context = RefreshContext(); // should only happen once when we reach the top
                 }
                 else
                 {
@@ -1072,7 +1287,7 @@ void SceneGraph::Refresh(uint32_t frameIndex)
                     current = parent;
                     parent = current->m_Parent;
 
-                    if (parent)
+                    if (parent && current != subgraphRoot)
                     {
                         parent->m_GlobalBoundingBox |= current->m_GlobalBoundingBox;
                         parent->m_Dirty |= current->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphMask;
@@ -1085,45 +1300,318 @@ void SceneGraph::Refresh(uint32_t frameIndex)
             }
         }
     }
+}
 
-    if (structureDirty)
+#ifdef DONUT_WITH_TASKFLOW
+void SceneGraph::RefreshSubgraphsParallel(tf::Executor& executor)
+{
+    // Process the nodes from the root down to the first node with multiple children serially,
+    // then the subgraphs under that node's children in parallel.
+    std::vector<SceneGraphNode*> spine;
+    RefreshContext context;
+    RefreshContext childContext;
+    bool visitChildren = false;
+
+    SceneGraphNode* current = m_Root.get();
+    while (current)
     {
-        int instanceIndex = 0;
-        int geometryInstanceIndex = 0;
-        for (const auto& instance : m_MeshInstances)
+        visitChildren = (current->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphMask) != 0
+            || context.supergraphTransformUpdated || context.supergraphContentUpdate;
+
+        childContext = RefreshNode(current, context, m_RefreshOutput);
+
+        current->m_Dirty = childContext.supergraphTransformUpdated
+            ? SceneGraphNode::DirtyFlags::PrevTransform
+            : SceneGraphNode::DirtyFlags::None;
+
+        spine.push_back(current);
+
+        if (!visitChildren || !current->m_FirstChild || current->m_FirstChild->m_NextSibling)
+            break;
+
+        context = childContext;
+        current = current->m_FirstChild.get();
+    }
+
+    SceneGraphNode* splitNode = spine.back();
+    std::vector<SceneGraphNode*> children;
+    if (visitChildren)
+    {
+        for (SceneGraphNode* child = splitNode->m_FirstChild.get(); child; child = child->m_NextSibling.get())
+            children.push_back(child);
+    }
+
+    if (!children.empty())
+    {
+        // process contiguous ranges of children in each task to limit the number of tasks on very wide graphs,
+        // and keep the outputs per task so that they can be concatenated in the serial order
+        const size_t taskCount = std::min(children.size(), std::max<size_t>(executor.num_workers(), 1) * 4);
+        m_RefreshTaskOutputs.resize(taskCount);
+
+        tf::Taskflow taskflow;
+        for (size_t taskIndex = 0; taskIndex < taskCount; taskIndex++)
         {
-            instance->m_InstanceIndex = instanceIndex;
-            ++instanceIndex;
+            taskflow.emplace([this, &children, childContext, taskIndex, taskCount]()
+            {
+                RefreshOutput& output = m_RefreshTaskOutputs[taskIndex];
+                output.transformedMeshInstances.clear();
+                output.updatedSkinnedMeshInstances.clear();
+
+                size_t begin = children.size() * taskIndex / taskCount;
+                size_t end = children.size() * (taskIndex + 1) / taskCount;
+                for (size_t childIndex = begin; childIndex < end; childIndex++)
+                    RefreshSubgraph(children[childIndex], childContext, output);
+            });
+        }
+        executor.run(taskflow).wait();
 
-            const auto& mesh = instance->GetMesh();
-            instance->m_GeometryInstanceIndex = geometryInstanceIndex;
-            geometryInstanceIndex += int(mesh->geometries.size());
+        for (SceneGraphNode* child : children)
+            MergeIntoParent(child);
+
+        for (const RefreshOutput& output : m_RefreshTaskOutputs)
+        {
+            m_RefreshOutput.transformedMeshInstances.insert(m_RefreshOutput.transformedMeshInstances.end(),
+                output.transformedMeshInstances.begin(), output.transformedMeshInstances.end());
+            m_RefreshOutput.updatedSkinnedMeshInstances.insert(m_RefreshOutput.updatedSkinnedMeshInstances.end(),
+                output.updatedSkinnedMeshInstances.begin(), output.updatedSkinnedMeshInstances.end());
         }
-        m_GeometryInstancesCount = geometryInstanceIndex;
+    }
 
-        int meshIndex = 0;
-        int geometryIndex = 0;
-        for (const auto& mesh : m_Meshes)
+    for (size_t i = spine.size() - 1; i > 0; i--)
+        MergeIntoParent(spine[i]);
+}
+#endif
+
+void SceneGraph::BuildFlatHierarchy()
+{
+    FlatTransformHierarchy flat;
+    flat.Reserve(m_FlatHierarchy.size());
+
+    std::vector<uint32_t> parentStack;
+
+    SceneGraphWalker walker(m_Root.get());
+    while (walker)
+    {
+        SceneGraphNode* node = walker.Get();
+        uint32_t index = uint32_t(flat.size());
+
+        uint8_t state = 0;
+        if (node->m_HasLocalTransform)
+            state |= FlatTransformHierarchy::HasLocalTransform;
+        if ((node->m_Dirty & SceneGraphNode::DirtyFlags::LocalTransform) != 0)
+            state |= FlatTransformHierarchy::LocalTransformDirty;
+        // keep the pending previous transform updates of the nodes that moved on the last frame
+        if ((node->m_Dirty & SceneGraphNode::DirtyFlags::PrevTransform) != 0 ||
+            (node->m_Flat && (node->m_Flat->states[node->m_FlatIndex] & FlatTransformHierarchy::PrevTransformDirty) != 0))
+            state |= FlatTransformHierarchy::PrevTransformDirty;
+        if (node->m_Flat && (node->m_Flat->states[node->m_FlatIndex] & FlatTransformHierarchy::PrevLocalTransformDirty) != 0)
+            state |= FlatTransformHierarchy::PrevLocalTransformDirty;
+        SceneGraphLeaf* leaf = node->m_Leaf.get();
+        if (leaf && leaf->AsSkinnedMeshReference())
+            state |= FlatTransformHierarchy::SkinnedMeshJoint;
+
+        // the previous arrays are still alive, so the getters return current data for the nodes that were in them
+        flat.nodes.push_back(node);
+        flat.meshInstances.push_back(leaf ? leaf->AsMeshInstance() : nullptr);
+        flat.parents.push_back(parentStack.empty() ? -1 : int(parentStack.back()));
+        flat.subtreeEnds.push_back(index + 1);
+        flat.states.push_back(state);
+        flat.localTransforms.push_back(node->m_LocalTransform);
+        flat.globalTransforms.push_back(node->GetLocalToWorldTransform());
+        flat.globalTransformsFloat.push_back(node->GetLocalToWorldTransformFloat());
+        flat.prevGlobalTransforms.push_back(node->GetPrevLocalToWorldTransform());
+        flat.prevGlobalTransformsFloat.push_back(node->GetPrevLocalToWorldTransformFloat());
+        flat.localBoundingBoxes.push_back(node->m_Leaf ? node->m_Leaf->GetLocalBoundingBox() : dm::box3::empty());
+        flat.globalBoundingBoxes.push_back(dm::box3::empty());
+
+        int deltaDepth = walker.Next(true);
+
+        if (deltaDepth > 0)
         {
-            for (const auto& geometry : mesh->geometries)
+            parentStack.push_back(index);
+        }
+        else
+        {
+            // leaving the subtrees of one or more parents
+            while (deltaDepth++ < 0)
             {
-                geometry->globalGeometryIndex = geometryIndex;
-                ++geometryIndex;
+                flat.subtreeEnds[parentStack.back()] = index + 1;
+                parentStack.pop_back();
             }
+        }
+    }
 
-            mesh->globalMeshIndex = meshIndex;
-            ++meshIndex;
+    for (uint32_t index = 0; index < uint32_t(flat.size()); index++)
+    {
+        flat.nodes[index]->m_Flat = &m_FlatHierarchy;
+        flat.nodes[index]->m_FlatIndex = index;
+    }
+
+    m_FlatHierarchy = std::move(flat);
+    m_FlatHierarchyValid = true;
+}
+
+void SceneGraph::ReleaseFlatHierarchy()
+{
+    // only walk the attached nodes: the arrays may reference nodes that were detached and destroyed since
+    SceneGraphWalker walker(m_Root.get());
+    while (walker)
+    {
+        walker->ReleaseFlatHierarchy();
+        walker.Next(true);
+    }
+
+    m_FlatHierarchy.Clear();
+    m_FlatHierarchyValid = false;
+}
+
+void SceneGraph::RefreshFlatHierarchy(bool structureDirty)
+{
+    bool rebuilt = false;
+    if (structureDirty || !m_FlatHierarchyValid)
+    {
+        BuildFlatHierarchy();
+        rebuilt = true;
+    }
+
+    FlatTransformHierarchy& flat = m_FlatHierarchy;
+    const uint32_t count = uint32_t(flat.size());
+    if (count == 0)
+        return;
+
+    bool contentDirty = rebuilt || (m_Root->m_Dirty & SceneGraphNode::DirtyFlags::SubgraphContentUpdate) != 0;
+    bool anyTransformUpdated = false;
+
+    // Forward pass: parents always come before their children, so the global transforms can be computed in one go.
+    // Subtrees without changes are skipped, but their roots are still recorded for the bounding box pass.
+    m_FlatVisitedNodes.clear();
+
+    uint32_t index = 0;
+    while (index < count)
+    {
+        const uint8_t state = flat.states[index];
+        const int parent = flat.parents[index];
+        const bool parentUpdated = parent >= 0 && (flat.states[parent] & FlatTransformHierarchy::TransformUpdated) != 0;
+
+        m_FlatVisitedNodes.push_back(index);
+
+        if (!rebuilt && !parentUpdated && !(state & FlatTransformHierarchy::SubtreeDirty))
+        {
+            index = flat.subtreeEnds[index];
+            continue;
         }
 
-        assert(m_GeometryCount == geometryIndex);
+        // the node objects are only touched when their own data changes, everything else is in the arrays
+        SceneGraphNode* node = flat.nodes[index];
+        const bool localUpdated = (state & FlatTransformHierarchy::LocalTransformDirty) != 0;
+        const bool updated = localUpdated || parentUpdated;
 
-        int materialIndex = 0;
-        for (const auto& material : m_Materials)
+        // save the current local/global transforms as previous; after a rebuild, only the nodes that actually moved
+        // are reported, like the walker does
+        if (rebuilt || updated || (state & FlatTransformHierarchy::PrevTransformDirty))
         {
-            material->materialID = materialIndex;
-            ++materialIndex;
+            flat.prevGlobalTransforms[index] = flat.globalTransforms[index];
+            flat.prevGlobalTransformsFloat[index] = flat.globalTransformsFloat[index];
+
+            if (flat.meshInstances[index] && (updated || (state & FlatTransformHierarchy::PrevTransformDirty)))
+                m_RefreshOutput.transformedMeshInstances.push_back(flat.meshInstances[index]);
         }
+
+        if (rebuilt || localUpdated || (state & FlatTransformHierarchy::PrevLocalTransformDirty))
+            node->m_PrevLocalTransform = flat.localTransforms[index];
+
+        if (state & FlatTransformHierarchy::LocalTransformDirty)
+        {
+            node->UpdateLocalTransform();
+            flat.localTransforms[index] = node->m_LocalTransform;
+
+            if (state & FlatTransformHierarchy::SkinnedMeshJoint)
+            {
+                auto meshReference = static_cast<SkinnedMeshReference*>(node->m_Leaf.get());
+                auto instance = meshReference->m_Instance.lock();
+                if (instance)
+                    m_RefreshOutput.updatedSkinnedMeshInstances.push_back(instance.get());
+            }
+        }
+
+        if (rebuilt || updated)
+        {
+            if (parent >= 0)
+            {
+                flat.globalTransforms[index] = (state & FlatTransformHierarchy::HasLocalTransform)
+                    ? flat.localTransforms[index] * flat.globalTransforms[parent]
+                    : flat.globalTransforms[parent];
+            }
+            else
+            {
+                flat.globalTransforms[index] = flat.localTransforms[index];
+            }
+            flat.globalTransformsFloat[index] = dm::affine3(flat.globalTransforms[index]);
+            anyTransformUpdated = anyTransformUpdated || updated;
+        }
+
+        // the leaf bounds are cached in the arrays, read them again when the leaf might have changed
+        if ((updated || (state & FlatTransformHierarchy::LeafDirty)) && node->m_Leaf)
+            flat.localBoundingBoxes[index] = node->m_Leaf->GetLocalBoundingBox();
+
+        // start the bbox with the leaf, the children are merged in below
+        const dm::box3& localBoundingBox = flat.localBoundingBoxes[index];
+        flat.globalBoundingBoxes[index] = localBoundingBox.isempty()
+            ? dm::box3::empty()
+            : localBoundingBox * flat.globalTransformsFloat[index];
+
+        uint8_t newState = state & (FlatTransformHierarchy::HasLocalTransform | FlatTransformHierarchy::SkinnedMeshJoint);
+        if (updated)
+        {
+            // the previous transforms of this node need to be updated on the next frame
+            newState |= FlatTransformHierarchy::TransformUpdated | FlatTransformHierarchy::PrevTransformDirty | FlatTransformHierarchy::SubtreeDirty;
+            if (localUpdated)
+                newState |= FlatTransformHierarchy::PrevLocalTransformDirty;
+
+            for (int current = parent; current >= 0 && !(flat.states[current] & FlatTransformHierarchy::SubtreeDirty); current = flat.parents[current])
+            {
+                flat.states[current] |= FlatTransformHierarchy::SubtreeDirty;
+            }
+        }
+        flat.states[index] = newState;
+
+        // nodes marked by SetTransform, and their parents, have dirty flags that need to be reset
+        if (rebuilt || localUpdated || (state & FlatTransformHierarchy::SubtreeDirty))
+            node->m_Dirty = SceneGraphNode::DirtyFlags::None;
+
+        ++index;
     }
+
+    // Backward pass over the visited nodes: children come after their parents, so every subtree bbox is complete
+    // by the time it's merged into the parent bbox.
+    for (auto it = m_FlatVisitedNodes.rbegin(); it != m_FlatVisitedNodes.rend(); ++it)
+    {
+        int parent = flat.parents[*it];
+        if (parent >= 0)
+            flat.globalBoundingBoxes[parent] |= flat.globalBoundingBoxes[*it];
+    }
+
+    if (contentDirty)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            SceneGraphNode* node = flat.nodes[i];
+            node->m_LeafContent = node->m_Leaf ? node->m_Leaf->GetContentFlags() : SceneContentFlags::None;
+            node->m_SubgraphContent = node->m_LeafContent;
+            node->m_Dirty = SceneGraphNode::DirtyFlags::None;
+        }
+
+        for (uint32_t i = count - 1; i > 0; i--)
+        {
+            SceneGraphNode* node = flat.nodes[i];
+            flat.nodes[flat.parents[i]]->m_SubgraphContent |= node->m_SubgraphContent;
+        }
+    }
+
+    // HasPendingTransformChanges should return true on the next frame to let the previous transforms be uploaded
+    m_Root->m_Dirty = anyTransformUpdated
+        ? SceneGraphNode::DirtyFlags::SubgraphPrevTransforms
+        : SceneGraphNode::DirtyFlags::None;
 }
 
 std::shared_ptr<SceneGraphLeaf> SceneTypeFactory::CreateLeaf(const std::string& type)
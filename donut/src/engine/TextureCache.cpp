@@ -47,9 +47,11 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <donut/engine/TextureCache.h>
 
+#include <donut/engine/BlockCompression.h>
 #include <donut/engine/CommonRenderPasses.h>
 #include <donut/engine/ConsoleObjects.h>
 #include <donut/engine/DDSFile.h>
+#include <donut/engine/SceneCache.h>
 #include <donut/core/vfs/VFS.h>
 #include <donut/core/log.h>
 
@@ -147,6 +149,10 @@ void TextureCache::Reset()
 
     m_TexturesRequested = 0;
     m_TexturesLoaded = 0;
+
+    m_StreamedTextures.clear();
+    m_StreamedTextureIndices.clear();
+    m_StreamingStats = TextureStreamingStats();
 }
 
 void TextureCache::SetGenerateMipmaps(bool generateMipmaps)
@@ -154,6 +160,200 @@ void TextureCache::SetGenerateMipmaps(bool generateMipmaps)
     m_GenerateMipmaps = generateMipmaps;
 }
 
+void TextureCache::SetCpuMipGeneration(bool enable, MipFilter filter)
+{
+    m_CpuMipGeneration = enable;
+    m_CpuMipFilter = filter;
+}
+
+void TextureCache::EnableTextureCompression(const TextureCompressionSettings& settings)
+{
+    m_CompressionEnabled = true;
+    m_CompressionSettings = settings;
+}
+
+void TextureCache::EnableProcessedTextureCache(const std::filesystem::path& folder)
+{
+    m_ProcessedTextureCacheFolder = folder;
+}
+
+ProcessedTextureCacheStats TextureCache::GetProcessedTextureCacheStats() const
+{
+    ProcessedTextureCacheStats stats;
+    stats.hits = m_ProcessedTextureHits;
+    stats.misses = m_ProcessedTextureMisses;
+    stats.processingThreadSeconds = double(m_ProcessingMicroseconds) * 1e-6;
+    return stats;
+}
+
+static constexpr uint32_t c_UncachedLoadMagic = 0x44414f4c; // "LOAD"
+
+struct UncachedLoadRecord
+{
+    uint32_t magic;
+    uint32_t reserved;
+    double seconds;
+};
+
+static std::filesystem::path GetUncachedLoadRecordPath(const std::filesystem::path& folder, const std::filesystem::path& sceneFileName)
+{
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "%016llx.load", (unsigned long long)SceneCache::HashFileName(sceneFileName));
+    return folder / (sceneFileName.stem().generic_string() + "_" + suffix);
+}
+
+void TextureCache::WriteUncachedLoadTime(const std::filesystem::path& sceneFileName, double seconds) const
+{
+    if (!IsProcessedTextureCacheEnabled() || !m_fs)
+        return;
+
+    UncachedLoadRecord record;
+    record.magic = c_UncachedLoadMagic;
+    record.reserved = 0;
+    record.seconds = seconds;
+
+    const std::filesystem::path recordPath = GetUncachedLoadRecordPath(m_ProcessedTextureCacheFolder, sceneFileName);
+    if (!m_fs->writeFile(recordPath, &record, sizeof(record)))
+        log::message(m_ErrorLogSeverity, "Couldn't write the load time record '%s'", recordPath.generic_string().c_str());
+}
+
+double TextureCache::ReadUncachedLoadTime(const std::filesystem::path& sceneFileName) const
+{
+    if (!IsProcessedTextureCacheEnabled() || !m_fs)
+        return 0.0;
+
+    const std::filesystem::path recordPath = GetUncachedLoadRecordPath(m_ProcessedTextureCacheFolder, sceneFileName);
+    std::shared_ptr<IBlob> recordData = m_fs->fileExists(recordPath) ? m_fs->readFile(recordPath) : nullptr;
+    if (!recordData || recordData->size() != sizeof(UncachedLoadRecord))
+        return 0.0;
+
+    UncachedLoadRecord record;
+    memcpy(&record, recordData->data(), sizeof(record));
+    return record.magic == c_UncachedLoadMagic ? record.seconds : 0.0;
+}
+
+void TextureCache::CompressTexture(TextureData& texture) const
+{
+    const bool preferBC7 = texture.format == nvrhi::Format::SRGBA8_UNORM
+        ? m_CompressionSettings.useBC7ForColor
+        : m_CompressionSettings.useBC7ForData;
+
+    const nvrhi::Format format = ChooseBlockCompressedFormat(texture, preferBC7);
+    if (format != nvrhi::Format::UNKNOWN)
+        CompressTextureData(texture, format);
+}
+
+// Changes to the decoding, the mip generation or the encoders must change this, so that the cached files are replaced
+static constexpr uint32_t c_ProcessedTextureVersion = 3;
+static constexpr uint32_t c_ProcessedTextureMagic = 0x43585444; // "DTXC"
+
+struct ProcessedTextureRecord
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint64_t sourceHash;
+};
+
+static uint64_t GetMicroseconds(std::chrono::steady_clock::time_point startTime)
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
+}
+
+void TextureCache::ReadProcessedTextureRecord(const std::string& name, uint64_t key, bool sRGB, ProcessedTextureEntry& entry) const
+{
+    // the same file gives different results with different processing settings
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "%016llx_v%u_%c%c%c_%c%c_%u", (unsigned long long)key, c_ProcessedTextureVersion,
+        sRGB ? 's' : 'l',
+        m_CompressionEnabled ? (m_CompressionSettings.useBC7ForColor ? '7' : '1') : 'u',
+        m_CompressionEnabled ? (m_CompressionSettings.useBC7ForData ? '7' : '1') : 'u',
+        m_CpuMipFilter == MipFilter::Kaiser ? 'k' : 'b', m_GenerateMipmaps ? 'm' : 'n', m_MaxTextureSize);
+
+    const std::string baseName = name.empty() ? std::string(suffix) : name + "_" + suffix;
+    entry.ddsPath = m_ProcessedTextureCacheFolder / (baseName + ".dds");
+    entry.recordPath = m_ProcessedTextureCacheFolder / (baseName + ".rec");
+
+    std::shared_ptr<IBlob> recordData = m_fs->fileExists(entry.recordPath) ? m_fs->readFile(entry.recordPath) : nullptr;
+    if (!recordData || recordData->size() != sizeof(ProcessedTextureRecord))
+        return;
+
+    ProcessedTextureRecord record;
+    memcpy(&record, recordData->data(), sizeof(record));
+    if (record.magic != c_ProcessedTextureMagic || record.version != c_ProcessedTextureVersion)
+        return;
+
+    entry.hasRecord = true;
+    entry.recordedSize = record.sourceSize;
+    entry.recordedModificationTime = record.sourceModificationTime;
+    entry.recordedHash = record.sourceHash;
+}
+
+bool TextureCache::FindProcessedTexture(const std::filesystem::path& path, bool sRGB, ProcessedTextureEntry& entry) const
+{
+    if (!IsProcessedTextureCacheEnabled() || !m_fs)
+        return false;
+
+    ReadProcessedTextureRecord(path.stem().generic_string(), SceneCache::HashFileName(path), sRGB, entry);
+
+    FileInfo info;
+    if (!m_fs->getFileInfo(path, info) || info.modificationTime == 0)
+        return false;
+
+    entry.sourceSize = info.size;
+    entry.sourceModificationTime = info.modificationTime;
+
+    // the file hasn't changed since it was processed, so it doesn't need to be read
+    return entry.hasRecord && entry.recordedSize == info.size && entry.recordedModificationTime == info.modificationTime;
+}
+
+bool TextureCache::LoadProcessedTexture(const std::shared_ptr<IBlob>& ddsData, TextureData& texture) const
+{
+    if (!ddsData)
+        return false;
+
+    texture.data = ddsData;
+    if (!LoadDDSTextureFromMemory(texture))
+    {
+        texture.data = nullptr;
+        return false;
+    }
+
+    ++m_ProcessedTextureHits;
+    return true;
+}
+
+void TextureCache::WriteProcessedTextureRecord(const ProcessedTextureEntry& entry, uint64_t sourceHash) const
+{
+    ProcessedTextureRecord record;
+    record.magic = c_ProcessedTextureMagic;
+    record.version = c_ProcessedTextureVersion;
+    record.sourceSize = entry.sourceSize;
+    record.sourceModificationTime = entry.sourceModificationTime;
+    record.sourceHash = sourceHash;
+
+    if (!m_fs->writeFile(entry.recordPath, &record, sizeof(record)))
+        log::message(m_ErrorLogSeverity, "Couldn't write the processed texture record '%s'", entry.recordPath.generic_string().c_str());
+}
+
+void TextureCache::SaveProcessedTexture(const TextureData& texture, const ProcessedTextureEntry& entry, uint64_t sourceHash, std::chrono::steady_clock::time_point startTime) const
+{
+    const uint64_t processingTime = GetMicroseconds(startTime);
+    ++m_ProcessedTextureMisses;
+    m_ProcessingMicroseconds += processingTime;
+
+    // the record is written last, so that an entry is only used when its DDS file has been written completely
+    std::shared_ptr<IBlob> ddsData = SaveTextureDataAsDDS(texture);
+    if (!ddsData || !m_fs->writeFile(entry.ddsPath, ddsData->data(), ddsData->size()))
+    {
+        log::message(m_ErrorLogSeverity, "Couldn't write the processed texture '%s'", entry.ddsPath.generic_string().c_str());
+        return;
+    }
+
+    WriteProcessedTextureRecord(entry, sourceHash);
+}
+
 bool TextureCache::FindTextureInCache(const std::filesystem::path& path, std::shared_ptr<TextureData>& texture)
 {
     std::lock_guard<std::shared_mutex> guard(m_LoadedTexturesMutex);
@@ -188,13 +388,37 @@ std::shared_ptr<IBlob> TextureCache::ReadTextureFile(const std::filesystem::path
     return fileData;
 }
 
+std::shared_ptr<AsyncReadRequest> TextureCache::ReadTextureFileAsync(const std::filesystem::path& path) const
+{
+    return m_fs->readFileAsync(path, 0, [this, path](const std::shared_ptr<IBlob>& fileData)
+    {
+        if (!fileData)
+            log::message(m_ErrorLogSeverity, "Couldn't read texture file '%s'", path.generic_string().c_str());
+    });
+}
+
 std::shared_ptr<TextureData> TextureCache::CreateTextureData()
 {
     return std::make_shared<TextureData>();
 }
 
-bool TextureCache::FillTextureData(const std::shared_ptr<vfs::IBlob>& fileData, const std::shared_ptr<TextureData>& texture, const std::string& extension, const std::string& mimeType) const
+bool TextureCache::ReadAndFillTextureData(const std::filesystem::path& path, const std::shared_ptr<TextureData>& texture) const
 {
+    ProcessedTextureEntry processedEntry;
+    if (FindProcessedTexture(path, texture->forceSRGB, processedEntry) &&
+        LoadProcessedTexture(m_fs->readFile(processedEntry.ddsPath), *texture))
+        return true;
+
+    auto fileData = ReadTextureFile(path);
+    return fileData && FillTextureData(fileData, texture, path.extension().generic_string(), "", &processedEntry);
+}
+
+bool TextureCache::FillTextureData(const std::shared_ptr<vfs::IBlob>& fileData, const std::shared_ptr<TextureData>& texture, const std::string& extension, const std::string& mimeType, ProcessedTextureEntry* processedEntry) const
+{
+    const auto processingStartTime = std::chrono::steady_clock::now();
+    ProcessedTextureEntry memoryEntry;
+    uint64_t sourceHash = 0;
+
     if (extension == ".dds" || extension == ".DDS" || mimeType == "image/vnd-ms.dds")
     {
         texture->data = fileData;
@@ -246,6 +470,28 @@ bool TextureCache::FillTextureData(const std::shared_ptr<vfs::IBlob>& fileData,
 #endif // DONUT_WITH_TINYEXR
     else
     {
+        if (IsProcessedTextureCacheEnabled() && m_fs)
+        {
+            sourceHash = SceneCache::HashSourceFiles({ fileData });
+
+            // textures loaded from memory are found by their contents
+            if (!processedEntry)
+            {
+                processedEntry = &memoryEntry;
+                ReadProcessedTextureRecord(std::string(), sourceHash, texture->forceSRGB, memoryEntry);
+            }
+            processedEntry->sourceSize = fileData->size();
+
+            // a file with a new modification time and the same contents, or the same image loaded from memory again
+            if (processedEntry->hasRecord && processedEntry->recordedHash == sourceHash && processedEntry->recordedSize == fileData->size() &&
+                LoadProcessedTexture(m_fs->readFile(processedEntry->ddsPath), *texture))
+            {
+                if (processedEntry->recordedModificationTime != processedEntry->sourceModificationTime)
+                    WriteProcessedTextureRecord(*processedEntry, sourceHash);
+                return true;
+            }
+        }
+
         int width = 0, height = 0, originalChannels = 0, channels = 0;
 
         if (!stbi_info_from_memory(
@@ -330,6 +576,20 @@ bool TextureCache::FillTextureData(const std::shared_ptr<vfs::IBlob>& fileData,
         }
     }
 
+    // The decoded images are render targets for the mip generation and downscaling on the GPU, not needed after this.
+    // Block compression and the processed texture cache need all mips on the CPU as well.
+    if ((m_CpuMipGeneration || m_CompressionEnabled || IsProcessedTextureCacheEnabled()) && texture->isRenderTarget &&
+        GenerateTextureMips(*texture, m_CpuMipFilter, m_MaxTextureSize, m_GenerateMipmaps))
+    {
+        texture->isRenderTarget = false;
+
+        if (m_CompressionEnabled)
+            CompressTexture(*texture);
+
+        if (processedEntry && !processedEntry->ddsPath.empty())
+            SaveProcessedTexture(*texture, *processedEntry, sourceHash, processingStartTime);
+    }
+
     return true;
 }
 
@@ -374,7 +634,7 @@ void TextureCache::FinalizeTexture(std::shared_ptr<TextureData> texture, CommonR
     uint scaledWidth = originalWidth;
     uint scaledHeight = originalHeight;
 
-    if (m_MaxTextureSize > 0 && int(std::max(originalWidth, originalHeight)) > m_MaxTextureSize && texture->isRenderTarget && texture->dimension == nvrhi::TextureDimension::Texture2D)
+    if (m_MaxTextureSize > 0 && int(std::max(originalWidth, originalHeight)) > m_MaxTextureSize && texture->isRenderTarget && texture->dimension == nvrhi::TextureDimension::Texture2D && passes)
     {
         if (originalWidth >= originalHeight)
         {
@@ -388,6 +648,10 @@ void TextureCache::FinalizeTexture(std::shared_ptr<TextureData> texture, CommonR
         }
     }
 
+    if (m_StreamingEnabled && scaledWidth == originalWidth && scaledHeight == originalHeight &&
+        FinalizeStreamedTexture(texture, isBlockCompressed, commandList))
+        return;
+
     const char* dataPointer = static_cast<const char*>(texture->data->data());
 
     nvrhi::TextureDesc textureDesc;
@@ -477,6 +741,289 @@ void TextureCache::FinalizeTexture(std::shared_ptr<TextureData> texture, CommonR
     ++m_TexturesFinalized;
 }
 
+bool TextureCache::FinalizeStreamedTexture(const std::shared_ptr<TextureData>& texture, bool isBlockCompressed, nvrhi::ICommandList* commandList)
+{
+    if (texture->dimension != nvrhi::TextureDimension::Texture2D || texture->mipLevels < 2 || texture->dataLayout.size() != texture->arraySize)
+        return false;
+
+    uint32_t tailMip = 0;
+    while (tailMip + 1 < texture->mipLevels && std::max(texture->width, texture->height) >> tailMip > m_StreamingSettings.minResidentSize)
+        ++tailMip;
+
+    if (tailMip == 0)
+        return false;
+
+    // Block compressed textures can only be created with sizes that are multiples of the block size
+    if (isBlockCompressed && ((texture->width | texture->height) & ((4u << tailMip) - 1)) != 0)
+        return false;
+
+    StreamedTexture streamed;
+    streamed.texture = texture;
+    streamed.mipChainSizes.resize(texture->mipLevels + 1, 0);
+    for (const auto& arraySlice : texture->dataLayout)
+    {
+        if (arraySlice.size() < texture->mipLevels)
+            return false;
+
+        for (uint32_t mipLevel = 0; mipLevel < texture->mipLevels; mipLevel++)
+            streamed.mipChainSizes[mipLevel] += arraySlice[mipLevel].dataSize;
+    }
+    for (uint32_t mipLevel = texture->mipLevels - 1; mipLevel > 0; mipLevel--)
+        streamed.mipChainSizes[mipLevel - 1] += streamed.mipChainSizes[mipLevel];
+
+    streamed.residentMip = texture->mipLevels; // nothing resident yet
+    streamed.tailMip = tailMip;
+    streamed.requestedMip = tailMip;
+    streamed.lastUseFrame = 0;
+
+    m_StreamedTextureIndices[texture.get()] = m_StreamedTextures.size();
+    StreamedTexture& added = m_StreamedTextures.emplace_back(std::move(streamed));
+    ++m_StreamingStats.streamedTextures;
+
+    SetResidentMip(added, tailMip, commandList);
+
+    ++m_TexturesFinalized;
+    return true;
+}
+
+// Recreates the texture with the mips from 'mipLevel' to the last one, uploaded from the CPU copy of the data.
+// Copying the mips that stay resident from the previous texture would need it in a copy source state,
+// but the textures are kept in a permanent shader resource state.
+void TextureCache::SetResidentMip(StreamedTexture& streamed, uint32_t mipLevel, nvrhi::ICommandList* commandList)
+{
+    TextureData& texture = *streamed.texture;
+
+    nvrhi::TextureDesc textureDesc;
+    textureDesc.format = texture.format;
+    textureDesc.width = std::max(texture.width >> mipLevel, 1u);
+    textureDesc.height = std::max(texture.height >> mipLevel, 1u);
+    textureDesc.depth = texture.depth;
+    textureDesc.arraySize = texture.arraySize;
+    textureDesc.dimension = texture.dimension;
+    textureDesc.mipLevels = texture.mipLevels - mipLevel;
+    textureDesc.debugName = texture.path;
+    nvrhi::TextureHandle gpuTexture = m_Device->createTexture(textureDesc);
+
+    commandList->beginTrackingTextureState(gpuTexture, nvrhi::AllSubresources, nvrhi::ResourceStates::Common);
+
+    const char* dataPointer = static_cast<const char*>(texture.data->data());
+    for (uint32_t arraySlice = 0; arraySlice < texture.arraySize; arraySlice++)
+    {
+        for (uint32_t level = mipLevel; level < texture.mipLevels; level++)
+        {
+            const TextureSubresourceData& layout = texture.dataLayout[arraySlice][level];
+
+            commandList->writeTexture(gpuTexture, arraySlice, level - mipLevel, dataPointer + layout.dataOffset, layout.rowPitch, layout.depthPitch);
+        }
+    }
+
+    commandList->setPermanentTextureState(gpuTexture, nvrhi::ResourceStates::ShaderResource);
+    commandList->commitBarriers();
+
+    // Command lists of the frames in flight may still read the previous texture through its bindless descriptor,
+    // so both are released by UpdateStreaming once those frames are done, and the texture gets a new descriptor
+    if (texture.texture)
+    {
+        RetiredTexture& retired = m_RetiredTextures.emplace_back();
+        retired.texture = std::move(texture.texture);
+        retired.bindlessDescriptor = std::move(texture.bindlessDescriptor);
+        retired.frame = m_StreamingFrame;
+    }
+
+    if (m_DescriptorTable)
+        texture.bindlessDescriptor = m_DescriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, gpuTexture));
+
+    texture.texture = gpuTexture;
+    streamed.replacedFrame = m_StreamingFrame;
+
+    m_StreamingStats.residentBytes += streamed.mipChainSizes[mipLevel];
+    m_StreamingStats.residentBytes -= streamed.mipChainSizes[streamed.residentMip];
+    m_StreamingStats.bytesUploaded += streamed.mipChainSizes[mipLevel];
+    streamed.residentMip = mipLevel;
+}
+
+void TextureCache::RemoveStreamedTexture(const LoadedTexture* texture)
+{
+    auto it = m_StreamedTextureIndices.find(texture);
+    if (it == m_StreamedTextureIndices.end())
+        return;
+
+    size_t index = it->second;
+    m_StreamedTextureIndices.erase(it);
+
+    StreamedTexture& streamed = m_StreamedTextures[index];
+    m_StreamingStats.residentBytes -= streamed.mipChainSizes[streamed.residentMip];
+    --m_StreamingStats.streamedTextures;
+
+    if (index + 1 < m_StreamedTextures.size())
+    {
+        streamed = std::move(m_StreamedTextures.back());
+        m_StreamedTextureIndices[streamed.texture.get()] = index;
+    }
+    m_StreamedTextures.pop_back();
+}
+
+void TextureCache::EnableStreaming(const TextureStreamingSettings& settings)
+{
+    m_StreamingEnabled = true;
+    m_StreamingSettings = settings;
+}
+
+void TextureCache::ReportTextureUse(const LoadedTexture* texture, float screenSize)
+{
+    if (!texture)
+        return;
+
+    auto it = m_StreamedTextureIndices.find(texture);
+    if (it == m_StreamedTextureIndices.end())
+        return;
+
+    StreamedTexture& streamed = m_StreamedTextures[it->second];
+
+    float texels = float(std::max(streamed.texture->width, streamed.texture->height));
+    float mipLevel = std::log2(texels / std::max(screenSize, 1.f)) + m_StreamingSettings.mipBias;
+    uint32_t requestedMip = mipLevel > 0.f ? std::min(uint32_t(mipLevel), streamed.tailMip) : 0;
+
+    streamed.requestedMip = std::min(streamed.requestedMip, requestedMip);
+    streamed.lastUseFrame = m_StreamingFrame;
+}
+
+void TextureCache::ReportMaterialUse(const Material& material, float screenSize)
+{
+    ReportTextureUse(material.baseOrDiffuseTexture.get(), screenSize);
+    ReportTextureUse(material.metalRoughOrSpecularTexture.get(), screenSize);
+    ReportTextureUse(material.normalTexture.get(), screenSize);
+    ReportTextureUse(material.emissiveTexture.get(), screenSize);
+    ReportTextureUse(material.occlusionTexture.get(), screenSize);
+    ReportTextureUse(material.transmissionTexture.get(), screenSize);
+}
+
+TextureStreamingStats TextureCache::UpdateStreaming(nvrhi::ICommandList* commandList)
+{
+    m_StreamingStats.texturesUpgraded = 0;
+    m_StreamingStats.texturesEvicted = 0;
+    m_StreamingStats.bytesUploaded = 0;
+
+    const uint64_t frame = m_StreamingFrame++;
+    const uint64_t budget = m_StreamingSettings.budgetBytes;
+    const uint64_t maxUpload = m_StreamingSettings.maxUploadBytesPerUpdate;
+
+    // The textures replaced 'framesInFlight' calls ago are no longer used by the GPU
+    while (!m_RetiredTextures.empty() && m_RetiredTextures.front().frame + m_StreamingSettings.framesInFlight <= m_StreamingFrame)
+        m_RetiredTextures.pop_front();
+
+    // Textures not used in this frame can go back to their tail mips, the others to the mips they need
+    auto getEvictionMip = [frame](const StreamedTexture& streamed)
+    {
+        return streamed.lastUseFrame < frame ? streamed.tailMip : std::max(streamed.requestedMip, streamed.residentMip);
+    };
+
+    std::vector<size_t> upgrades;
+    std::vector<size_t> evictions;
+    for (size_t index = 0; index < m_StreamedTextures.size(); index++)
+    {
+        const StreamedTexture& streamed = m_StreamedTextures[index];
+        if (streamed.requestedMip < streamed.residentMip)
+            upgrades.push_back(index);
+        else if (getEvictionMip(streamed) > streamed.residentMip)
+            evictions.push_back(index);
+    }
+
+    // The textures missing the most mips go first, and the least recently used textures are evicted first
+    std::stable_sort(upgrades.begin(), upgrades.end(), [this](size_t a, size_t b)
+    {
+        const StreamedTexture& streamedA = m_StreamedTextures[a];
+        const StreamedTexture& streamedB = m_StreamedTextures[b];
+        return streamedA.residentMip - streamedA.requestedMip > streamedB.residentMip - streamedB.requestedMip;
+    });
+    std::stable_sort(evictions.begin(), evictions.end(), [this](size_t a, size_t b)
+    {
+        return m_StreamedTextures[a].lastUseFrame < m_StreamedTextures[b].lastUseFrame;
+    });
+
+    size_t nextEviction = 0;
+    auto evictNext = [this, commandList, &evictions, &nextEviction, &getEvictionMip]()
+    {
+        if (nextEviction >= evictions.size())
+            return false;
+
+        StreamedTexture& streamed = m_StreamedTextures[evictions[nextEviction++]];
+        SetResidentMip(streamed, getEvictionMip(streamed), commandList);
+        ++m_StreamingStats.texturesEvicted;
+        return true;
+    };
+
+    for (size_t index : upgrades)
+    {
+        StreamedTexture& streamed = m_StreamedTextures[index];
+
+        // Settle for coarser mips than requested when the finer ones don't fit
+        for (uint32_t mipLevel = streamed.requestedMip; mipLevel < streamed.residentMip; mipLevel++)
+        {
+            uint64_t size = streamed.mipChainSizes[mipLevel];
+            if (maxUpload > 0 && m_StreamingStats.bytesUploaded > 0 && m_StreamingStats.bytesUploaded + size > maxUpload)
+                continue;
+
+            uint64_t growth = size - streamed.mipChainSizes[streamed.residentMip];
+            while (m_StreamingStats.residentBytes + growth > budget)
+            {
+                if (!evictNext())
+                    break;
+            }
+
+            if (m_StreamingStats.residentBytes + growth > budget)
+                continue;
+
+            SetResidentMip(streamed, mipLevel, commandList);
+            ++m_StreamingStats.texturesUpgraded;
+            break;
+        }
+    }
+
+    // The budget may have been reduced
+    while (m_StreamingStats.residentBytes > budget)
+    {
+        if (!evictNext())
+            break;
+    }
+
+    for (StreamedTexture& streamed : m_StreamedTextures)
+        streamed.requestedMip = streamed.tailMip;
+
+    return m_StreamingStats;
+}
+
+bool TextureCache::TextureReplaced(const LoadedTexture* texture) const
+{
+    if (!texture)
+        return false;
+
+    auto it = m_StreamedTextureIndices.find(texture);
+    if (it == m_StreamedTextureIndices.end())
+        return false;
+
+    return m_StreamedTextures[it->second].replacedFrame == m_StreamingFrame;
+}
+
+bool TextureCache::MaterialTexturesReplaced(const Material& material) const
+{
+    return TextureReplaced(material.baseOrDiffuseTexture.get())
+        || TextureReplaced(material.metalRoughOrSpecularTexture.get())
+        || TextureReplaced(material.normalTexture.get())
+        || TextureReplaced(material.emissiveTexture.get())
+        || TextureReplaced(material.occlusionTexture.get())
+        || TextureReplaced(material.transmissionTexture.get());
+}
+
+uint32_t TextureCache::GetResidentMip(const LoadedTexture* texture) const
+{
+    auto it = m_StreamedTextureIndices.find(texture);
+    if (it == m_StreamedTextureIndices.end())
+        return 0;
+
+    return m_StreamedTextures[it->second].residentMip;
+}
+
 void TextureCache::TextureLoaded(std::shared_ptr<TextureData> texture)
 {
     std::lock_guard<std::mutex> guard(m_TexturesToFinalizeMutex);
@@ -497,15 +1044,11 @@ std::shared_ptr<LoadedTexture> TextureCache::LoadTextureFromFile(const std::file
     texture->forceSRGB = sRGB;
     texture->path = path.generic_string();
 
-    auto fileData = ReadTextureFile(path);
-    if (fileData)
+    if (ReadAndFillTextureData(path, texture))
     {
-        if (FillTextureData(fileData, texture, path.extension().generic_string(), ""))
-        {
-            TextureLoaded(texture);
+        TextureLoaded(texture);
 
-            FinalizeTexture(texture, passes, commandList);
-        }
+        FinalizeTexture(texture, passes, commandList);
     }
 
     ++m_TexturesLoaded;
@@ -523,17 +1066,13 @@ std::shared_ptr<LoadedTexture> TextureCache::LoadTextureFromFileDeferred(const s
     texture->forceSRGB = sRGB;
     texture->path = path.generic_string();
 
-    auto fileData = ReadTextureFile(path);
-    if (fileData)
+    if (ReadAndFillTextureData(path, texture))
     {
-        if (FillTextureData(fileData, texture, path.extension().generic_string(), ""))
-        {
-            TextureLoaded(texture);
+        TextureLoaded(texture);
 
-            std::lock_guard<std::mutex> guard(m_TexturesToFinalizeMutex);
+        std::lock_guard<std::mutex> guard(m_TexturesToFinalizeMutex);
 
-            m_TexturesToFinalize.push(texture);
-        }
+        m_TexturesToFinalize.push(texture);
     }
 
     ++m_TexturesLoaded;
@@ -552,19 +1091,39 @@ std::shared_ptr<LoadedTexture> TextureCache::LoadTextureFromFileAsync(const std:
     texture->forceSRGB = sRGB;
     texture->path = path.generic_string();
 
-    executor.async([this, sRGB, texture, path]()
+    // an up-to-date processed texture is read instead of the file
+    ProcessedTextureEntry processedEntry;
+    const bool processed = FindProcessedTexture(path, sRGB, processedEntry);
+
+    // start the read now, so that the file system can have many reads in flight
+    // while the executor threads are decoding other textures
+    auto readRequest = processed ? m_fs->readFileAsync(processedEntry.ddsPath) : ReadTextureFileAsync(path);
+
+    executor.async([this, sRGB, texture, path, readRequest, processed, processedEntry]() mutable
     {
-        auto fileData = ReadTextureFile(path);
-        if (fileData)
+        bool loaded = false;
+        if (processed)
         {
-            if (FillTextureData(fileData, texture, path.extension().generic_string(), ""))
+            loaded = LoadProcessedTexture(readRequest->wait(), *texture);
+            if (!loaded)
             {
-                TextureLoaded(texture);
+                auto fileData = ReadTextureFile(path);
+                loaded = fileData && FillTextureData(fileData, texture, path.extension().generic_string(), "", &processedEntry);
+            }
+        }
+        else
+        {
+            auto fileData = readRequest->wait();
+            loaded = fileData && FillTextureData(fileData, texture, path.extension().generic_string(), "", &processedEntry);
+        }
 
-                std::lock_guard<std::mutex> guard(m_TexturesToFinalizeMutex);
+        if (loaded)
+        {
+            TextureLoaded(texture);
 
-                m_TexturesToFinalize.push(texture);
-            }
+            std::lock_guard<std::mutex> guard(m_TexturesToFinalizeMutex);
+
+            m_TexturesToFinalize.push(texture);
         }
 
         ++m_TexturesLoaded;
@@ -647,18 +1206,48 @@ std::shared_ptr<TextureData> TextureCache::GetLoadedTexture(std::filesystem::pat
 	return m_LoadedTextures[path.generic_string()];
 }
 
+static uint64_t GetTextureDataSize(const TextureData& texture)
+{
+    uint64_t size = 0;
+    for (const auto& arraySlice : texture.dataLayout)
+        for (const TextureSubresourceData& mipLevel : arraySlice)
+            size += mipLevel.dataSize;
+    return size;
+}
+
 bool TextureCache::ProcessRenderingThreadCommands(CommonRenderPasses& passes, float timeLimitMilliseconds)
+{
+    return ProcessRenderingThreadCommands(&passes, timeLimitMilliseconds);
+}
+
+bool TextureCache::ProcessRenderingThreadCommands(CommonRenderPasses* passes, float timeLimitMilliseconds)
 {
     using namespace std::chrono;
 
     time_point<high_resolution_clock> startTime = high_resolution_clock::now();
 
-    uint commandsExecuted = 0;
+    m_LastUploadStats = TextureUploadStats();
+    uint64_t batchBytes = 0;
+    bool batchOpen = false;
+
+    auto submitBatch = [this, &batchBytes, &batchOpen]()
+    {
+        m_CommandList->close();
+        m_Device->executeCommandList(m_CommandList);
+        m_Device->runGarbageCollection();
+
+        ++m_LastUploadStats.submissions;
+        batchBytes = 0;
+        batchOpen = false;
+    };
+
     while (true)
     {
         std::shared_ptr<TextureData> pTexture;
+        uint64_t textureBytes = 0;
+        bool batchFull = false;
 
-        if (timeLimitMilliseconds > 0 && commandsExecuted > 0)
+        if (timeLimitMilliseconds > 0 && m_LastUploadStats.textures > 0)
         {
             time_point<high_resolution_clock> now = high_resolution_clock::now();
 
@@ -673,30 +1262,52 @@ bool TextureCache::ProcessRenderingThreadCommands(CommonRenderPasses& passes, fl
                 break;
 
             pTexture = m_TexturesToFinalize.front();
+            textureBytes = pTexture->data ? GetTextureDataSize(*pTexture) : 0;
+
+            if (m_UploadBudgetBytes > 0 && batchBytes > 0 && batchBytes + textureBytes > m_UploadBudgetBytes)
+            {
+                // with a time limit, the texture waits for the next call
+                if (timeLimitMilliseconds > 0)
+                    break;
+
+                batchFull = true;
+            }
+
             m_TexturesToFinalize.pop();
         }
 
+        if (batchFull)
+            submitBatch();
+
         if (pTexture->data)
         {
-            //LOG("Finalizing texture %s", pTexture->fileName.c_str());
-            commandsExecuted += 1;
-
-            if (!m_CommandList)
+            if (!batchOpen)
             {
-                m_CommandList = m_Device->createCommandList();
-            }
+                if (!m_CommandList)
+                {
+                    nvrhi::CommandListParameters params;
+                    if (m_UploadBudgetBytes > 0)
+                        params.setUploadChunkSize(m_UploadBudgetBytes);
+
+                    m_CommandList = m_Device->createCommandList(params);
+                }
 
-            m_CommandList->open();
+                m_CommandList->open();
+                batchOpen = true;
+            }
 
-            FinalizeTexture(pTexture, &passes, m_CommandList);
+            FinalizeTexture(pTexture, passes, m_CommandList);
 
-            m_CommandList->close();
-            m_Device->executeCommandList(m_CommandList);
-            m_Device->runGarbageCollection();
+            batchBytes += textureBytes;
+            m_LastUploadStats.bytes += textureBytes;
+            ++m_LastUploadStats.textures;
         }
     }
 
-    return (commandsExecuted > 0);
+    if (batchOpen)
+        submitBatch();
+
+    return (m_LastUploadStats.textures > 0);
 }
 
 void TextureCache::LoadingFinished()
@@ -704,6 +1315,14 @@ void TextureCache::LoadingFinished()
     m_CommandList = nullptr;
 }
 
+void TextureCache::SetUploadBudget(size_t bytes)
+{
+    m_UploadBudgetBytes = bytes;
+
+    // the upload chunk size is set when the command list is created
+    m_CommandList = nullptr;
+}
+
 void TextureCache::SetMaxTextureSize(uint32_t size)
 {
 	m_MaxTextureSize = size;
@@ -819,6 +1438,8 @@ namespace donut::engine
 
         m_LoadedTextures.erase(it);
 
+        RemoveStreamedTexture(texture.get());
+
         return true;
     }
 
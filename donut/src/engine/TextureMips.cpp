@@ -0,0 +1,590 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureMips.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/math/math.h>
+#include <donut/core/vfs/VFS.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DONUT_TEXTURE_MIPS_X64 1
+#include <immintrin.h>
+#endif
+
+// Same as in frustum.cpp: the AVX2 functions are compiled for AVX2 without enabling it for the whole file,
+// and FMA is not used, so that the SIMD results match the scalar code exactly.
+#if defined(__GNUC__) || defined(__clang__)
+#define DONUT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DONUT_TARGET_AVX2
+#endif
+
+using namespace donut::math;
+using namespace donut::engine;
+
+namespace
+{
+    constexpr float c_KaiserWidth = 3.f;
+    constexpr float c_KaiserAlpha = 4.f;
+
+    // Modified Bessel function of the first kind, order 0
+    float BesselI0(float x)
+    {
+        const float quarterX2 = x * x * 0.25f;
+        float sum = 1.f;
+        float term = 1.f;
+        for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+        {
+            term *= quarterX2 / float(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    float KaiserSinc(float x)
+    {
+        const float t = x / c_KaiserWidth;
+        if (t * t >= 1.f)
+            return 0.f;
+
+        static const float invI0Alpha = 1.f / BesselI0(c_KaiserAlpha);
+        const float sinc = (x == 0.f) ? 1.f : sinf(PI_f * x) / (PI_f * x);
+        return sinc * BesselI0(c_KaiserAlpha * sqrtf(1.f - t * t)) * invI0Alpha;
+    }
+
+    float SrgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    const float* GetSrgbToLinearTable()
+    {
+        static const std::array<float, 256> table = []()
+        {
+            std::array<float, 256> result;
+            for (int i = 0; i < 256; i++)
+                result[i] = SrgbToLinear(float(i) / 255.f);
+            return result;
+        }();
+        return table.data();
+    }
+
+    // [i] = the linear value half-way between the sRGB codes i and i + 1
+    const float* GetSrgbThresholds()
+    {
+        static const std::array<float, 255> table = []()
+        {
+            std::array<float, 255> result;
+            for (int i = 0; i < 255; i++)
+                result[i] = SrgbToLinear((float(i) + 0.5f) / 255.f);
+            return result;
+        }();
+        return table.data();
+    }
+
+    // [i] = the sRGB code of the linear value i / (c_SrgbEncodeTableSize - 1), a lower bound for the values up to the next entry.
+    // The table is fine enough for the codes of neighboring entries to differ by a few steps at most.
+    constexpr int c_SrgbEncodeTableSize = 4096;
+
+    const uint8_t* GetSrgbEncodeTable()
+    {
+        static const std::array<uint8_t, c_SrgbEncodeTableSize> table = []()
+        {
+            const float* thresholds = GetSrgbThresholds();
+            std::array<uint8_t, c_SrgbEncodeTableSize> result;
+            for (int i = 0; i < c_SrgbEncodeTableSize; i++)
+            {
+                const float value = float(i) / float(c_SrgbEncodeTableSize - 1);
+                result[i] = uint8_t(std::upper_bound(thresholds, thresholds + 255, value) - thresholds);
+            }
+            return result;
+        }();
+        return table.data();
+    }
+
+    uint8_t LinearToSrgb(float value, const uint8_t* encodeTable, const float* thresholds)
+    {
+        value = std::clamp(value, 0.f, 1.f);
+        int code = encodeTable[int(value * float(c_SrgbEncodeTableSize - 1))];
+        while (code < 255 && thresholds[code] <= value)
+            code++;
+        return uint8_t(code);
+    }
+
+    struct PixelFormat
+    {
+        uint32_t channels = 0;
+        bool isFloat = false;
+        bool isSrgb = false;
+    };
+
+    // The rows of an image, either in the texture format or already converted to linear floats
+    struct SourceImage
+    {
+        const uint8_t* encoded = nullptr;
+        size_t rowPitch = 0;
+        const float* linear = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    struct FilterWeights
+    {
+        uint32_t taps = 0;           // the largest number of source pixels for one output pixel
+        std::vector<uint32_t> first; // [output pixel] = the first source pixel
+        std::vector<uint32_t> count; // [output pixel] = the number of source pixels
+        std::vector<float> weights;  // [output pixel * taps + source pixel - first]
+    };
+
+    FilterWeights ComputeWeights(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+    {
+        const float scale = float(srcSize) / float(dstSize);
+        const float support = std::max(scale, 1.f);
+        const float radius = (filter == MipFilter::Box ? 0.5f : c_KaiserWidth) * support;
+
+        FilterWeights result;
+        result.taps = uint32_t(ceilf(2.f * radius)) + 1;
+        result.first.resize(dstSize);
+        result.count.resize(dstSize);
+        result.weights.resize(size_t(dstSize) * result.taps, 0.f);
+
+        for (uint32_t i = 0; i < dstSize; i++)
+        {
+            const float center = (float(i) + 0.5f) * scale;
+            const int lo = int(floorf(center - radius));
+            const int hi = int(ceilf(center + radius));
+            const int first = std::clamp(lo, 0, int(srcSize) - 1);
+            const int last = std::clamp(hi - 1, 0, int(srcSize) - 1);
+            float* weights = &result.weights[size_t(i) * result.taps];
+
+            // pixels outside of the image add to the weight of the nearest edge pixel
+            float sum = 0.f;
+            for (int j = lo; j < hi; j++)
+            {
+                float weight;
+                if (filter == MipFilter::Box)
+                    weight = std::max(0.f, std::min(float(j + 1), center + radius) - std::max(float(j), center - radius));
+                else
+                    weight = KaiserSinc((float(j) + 0.5f - center) / support);
+
+                weights[std::clamp(j, first, last) - first] += weight;
+                sum += weight;
+            }
+
+            result.first[i] = uint32_t(first);
+            result.count[i] = uint32_t(last - first + 1);
+            for (uint32_t k = 0; k < result.count[i]; k++)
+                weights[k] /= sum;
+        }
+
+        return result;
+    }
+
+    void LoadRow(const SourceImage& image, const PixelFormat& format, uint32_t y, float* row)
+    {
+        const size_t count = size_t(image.width) * format.channels;
+
+        if (image.linear)
+        {
+            memcpy(row, image.linear + y * count, count * sizeof(float));
+            return;
+        }
+
+        const uint8_t* src = image.encoded + y * image.rowPitch;
+
+        if (format.isFloat)
+        {
+            memcpy(row, src, count * sizeof(float));
+        }
+        else if (format.isSrgb)
+        {
+            // RGBA, alpha is linear
+            const float* srgbToLinear = GetSrgbToLinearTable();
+            for (size_t i = 0; i < count; i += 4)
+            {
+                row[i + 0] = srgbToLinear[src[i + 0]];
+                row[i + 1] = srgbToLinear[src[i + 1]];
+                row[i + 2] = srgbToLinear[src[i + 2]];
+                row[i + 3] = float(src[i + 3]) * (1.f / 255.f);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+                row[i] = float(src[i]) * (1.f / 255.f);
+        }
+    }
+
+    void StoreRow(const float* row, uint8_t* dst, const PixelFormat& format, uint32_t width)
+    {
+        const size_t count = size_t(width) * format.channels;
+
+        if (format.isFloat)
+        {
+            float* dstFloat = reinterpret_cast<float*>(dst);
+            for (size_t i = 0; i < count; i++)
+                dstFloat[i] = std::max(row[i], 0.f);
+        }
+        else if (format.isSrgb)
+        {
+            const uint8_t* encodeTable = GetSrgbEncodeTable();
+            const float* thresholds = GetSrgbThresholds();
+            for (size_t i = 0; i < count; i += 4)
+            {
+                for (size_t c = 0; c < 3; c++)
+                    dst[i + c] = LinearToSrgb(row[i + c], encodeTable, thresholds);
+                dst[i + 3] = uint8_t(std::clamp(row[i + 3], 0.f, 1.f) * 255.f + 0.5f);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = uint8_t(std::clamp(row[i], 0.f, 1.f) * 255.f + 0.5f);
+        }
+    }
+
+    // The channel count is a template parameter for the common formats, so that the inner loops get unrolled and vectorized
+    template<uint32_t C>
+    void FilterRow(const float* src, float* dst, const FilterWeights& weights, uint32_t dstWidth)
+    {
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            const float* w = &weights.weights[size_t(x) * weights.taps];
+            const float* s = src + size_t(weights.first[x]) * C;
+            const uint32_t count = weights.count[x];
+
+            float sum[C] = {};
+            for (uint32_t k = 0; k < count; k++)
+                for (uint32_t c = 0; c < C; c++)
+                    sum[c] += w[k] * s[k * C + c];
+
+            for (uint32_t c = 0; c < C; c++)
+                dst[x * C + c] = sum[c];
+        }
+    }
+
+    void FilterRow(const float* src, float* dst, const FilterWeights& weights, uint32_t dstWidth, uint32_t channels)
+    {
+        switch (channels)
+        {
+        case 1: FilterRow<1>(src, dst, weights, dstWidth); return;
+        case 2: FilterRow<2>(src, dst, weights, dstWidth); return;
+        case 3: FilterRow<3>(src, dst, weights, dstWidth); return;
+        case 4: FilterRow<4>(src, dst, weights, dstWidth); return;
+        default: break;
+        }
+
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            const float* w = &weights.weights[size_t(x) * weights.taps];
+            const float* s = src + size_t(weights.first[x]) * channels;
+            float* d = dst + size_t(x) * channels;
+
+            std::fill(d, d + channels, 0.f);
+            for (uint32_t k = 0; k < weights.count[x]; k++)
+                for (uint32_t c = 0; c < channels; c++)
+                    d[c] += w[k] * s[k * channels + c];
+        }
+    }
+
+#if DONUT_TEXTURE_MIPS_X64
+    // Box filtering to half the width, which is what most mip levels need: every output value is the average
+    // of two neighboring source pixels, with weights of exactly 0.5. (a + b) * 0.5 rounds the same as the
+    // 0.5 * a + 0.5 * b of FilterRow, so the results are identical. The halving functions return the number of
+    // output floats done, a multiple of the vector width, and support 1, 2 and 4 channels.
+    size_t HalveRowSse(const float* src, float* dst, size_t count, uint32_t channels)
+    {
+        const __m128 half = _mm_set1_ps(0.5f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(src + i * 2);
+            const __m128 b = _mm_loadu_ps(src + i * 2 + 4);
+            __m128 sum;
+            if (channels == 1)
+                sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            else if (channels == 2)
+                sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 1, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 3, 2)));
+            else
+                sum = _mm_add_ps(a, b);
+            _mm_storeu_ps(dst + i, _mm_mul_ps(sum, half));
+        }
+        return i;
+    }
+
+    DONUT_TARGET_AVX2
+    size_t HalveRowAvx2(const float* src, float* dst, size_t count, uint32_t channels)
+    {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 a = _mm256_loadu_ps(src + i * 2);
+            const __m256 b = _mm256_loadu_ps(src + i * 2 + 8);
+            __m256 sum;
+            if (channels == 4)
+            {
+                sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+            }
+            else
+            {
+                // the shuffles work within the 128-bit lanes, which leaves the pairs of outputs in the order 0, 2, 1, 3
+                if (channels == 1)
+                    sum = _mm256_add_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                else
+                    sum = _mm256_add_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 3, 2)));
+                sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(sum, half));
+        }
+        return i;
+    }
+
+    // out += weight * row, with the same operations as the scalar loop in Resample
+    size_t AccumulateRowSse(float* out, const float* row, float weight, size_t count)
+    {
+        const __m128 w = _mm_set1_ps(weight);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w, _mm_loadu_ps(row + i))));
+        return i;
+    }
+
+    DONUT_TARGET_AVX2
+    size_t AccumulateRowAvx2(float* out, const float* row, float weight, size_t count)
+    {
+        const __m256 w = _mm256_set1_ps(weight);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(w, _mm256_loadu_ps(row + i))));
+        return i;
+    }
+#endif
+
+    void FilterRow(const float* src, float* dst, const FilterWeights& weights, uint32_t dstWidth, uint32_t channels, bool halving, simd_level level)
+    {
+        const size_t count = size_t(dstWidth) * channels;
+        size_t done = 0;
+#if DONUT_TEXTURE_MIPS_X64
+        if (halving && level == simd_level::avx2)
+            done = HalveRowAvx2(src, dst, count, channels);
+        else if (halving && level == simd_level::sse)
+            done = HalveRowSse(src, dst, count, channels);
+#endif
+        if (done == 0)
+        {
+            FilterRow(src, dst, weights, dstWidth, channels);
+            return;
+        }
+
+        // the values that don't fill a vector
+        for (size_t i = done; i < count; i++)
+        {
+            const size_t x = i / channels;
+            const size_t c = i % channels;
+            dst[i] = 0.5f * src[x * 2 * channels + c] + 0.5f * src[(x * 2 + 1) * channels + c];
+        }
+    }
+
+    void AccumulateRow(float* out, const float* row, float weight, size_t count, simd_level level)
+    {
+        size_t i = 0;
+#if DONUT_TEXTURE_MIPS_X64
+        if (level == simd_level::avx2)
+            i = AccumulateRowAvx2(out, row, weight, count);
+        else if (level == simd_level::sse)
+            i = AccumulateRowSse(out, row, weight, count);
+#endif
+        for (; i < count; i++)
+            out[i] += weight * row[i];
+    }
+
+    // Separable resampling: every source row is filtered horizontally once, when the first output row needs it,
+    // into a ring that holds the rows of one vertical filter window. So only one level is ever converted to floats.
+    void Resample(const SourceImage& image, const PixelFormat& format, float* dst, uint32_t dstWidth, uint32_t dstHeight, MipFilter filter, simd_level level)
+    {
+        const FilterWeights horizontal = ComputeWeights(image.width, dstWidth, filter);
+        const FilterWeights vertical = ComputeWeights(image.height, dstHeight, filter);
+        const bool halving = filter == MipFilter::Box && image.width == dstWidth * 2 && format.channels != 3;
+
+        const size_t rowSize = size_t(dstWidth) * format.channels;
+        std::vector<float> sourceRow(size_t(image.width) * format.channels);
+        std::vector<float> ring(rowSize * vertical.taps);
+        uint32_t nextRow = 0;
+
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            const uint32_t first = vertical.first[y];
+            const uint32_t count = vertical.count[y];
+
+            for (nextRow = std::max(nextRow, first); nextRow < first + count; nextRow++)
+            {
+                LoadRow(image, format, nextRow, sourceRow.data());
+                FilterRow(sourceRow.data(), &ring[(nextRow % vertical.taps) * rowSize], horizontal, dstWidth, format.channels, halving, level);
+            }
+
+            const float* w = &vertical.weights[size_t(y) * vertical.taps];
+            float* out = dst + y * rowSize;
+            std::fill(out, out + rowSize, 0.f);
+
+            for (uint32_t k = 0; k < count; k++)
+                AccumulateRow(out, &ring[((first + k) % vertical.taps) * rowSize], w[k], rowSize, level);
+        }
+    }
+}
+
+static simd_level ResolveSimdLevel(simd_level level)
+{
+    const simd_level supported = get_supported_simd_level();
+    return (level == simd_level::best || level > supported) ? supported : level;
+}
+
+void donut::engine::ResampleImage(const float* src, uint32_t srcWidth, uint32_t srcHeight,
+    float* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels, MipFilter filter, simd_level level)
+{
+    SourceImage image;
+    image.linear = src;
+    image.width = srcWidth;
+    image.height = srcHeight;
+
+    PixelFormat format;
+    format.channels = channels;
+    format.isFloat = true;
+
+    Resample(image, format, dst, dstWidth, dstHeight, filter, ResolveSimdLevel(level));
+}
+
+bool donut::engine::GenerateTextureMips(TextureData& texture, MipFilter filter, uint32_t maxSize, bool generateMips, simd_level level)
+{
+    PixelFormat format;
+    switch (texture.format)
+    {
+    case nvrhi::Format::R8_UNORM:     format.channels = 1; break;
+    case nvrhi::Format::RG8_UNORM:    format.channels = 2; break;
+    case nvrhi::Format::RGBA8_UNORM:  format.channels = 4; break;
+    case nvrhi::Format::SRGBA8_UNORM: format.channels = 4; format.isSrgb = true; break;
+    case nvrhi::Format::R32_FLOAT:    format.channels = 1; format.isFloat = true; break;
+    case nvrhi::Format::RG32_FLOAT:   format.channels = 2; format.isFloat = true; break;
+    case nvrhi::Format::RGBA32_FLOAT: format.channels = 4; format.isFloat = true; break;
+    default:
+        return false;
+    }
+
+    if (!texture.data || texture.dimension != nvrhi::TextureDimension::Texture2D || texture.arraySize != 1 ||
+        texture.mipLevels != 1 || texture.dataLayout.size() != 1 || texture.dataLayout[0].size() != 1)
+        return false;
+
+    const TextureSubresourceData& sourceLayout = texture.dataLayout[0][0];
+    SourceImage source;
+    source.encoded = static_cast<const uint8_t*>(texture.data->data()) + sourceLayout.dataOffset;
+    source.rowPitch = sourceLayout.rowPitch;
+    source.width = texture.width;
+    source.height = texture.height;
+
+    // same size rounding as the downscaling on the GPU in TextureCache::FinalizeTexture
+    uint32_t width = texture.width;
+    uint32_t height = texture.height;
+    if (maxSize > 0 && std::max(width, height) > maxSize)
+    {
+        if (width >= height)
+        {
+            height = std::max(uint32_t(uint64_t(height) * maxSize / width), 1u);
+            width = maxSize;
+        }
+        else
+        {
+            width = std::max(uint32_t(uint64_t(width) * maxSize / height), 1u);
+            height = maxSize;
+        }
+    }
+
+    uint32_t mipLevels = 1;
+    while (generateMips && (std::max(width, height) >> mipLevels) > 0)
+        mipLevels++;
+
+    if (mipLevels == 1 && width == texture.width && height == texture.height)
+        return true;
+
+    const uint32_t bytesPerPixel = format.channels * (format.isFloat ? 4 : 1);
+    std::vector<TextureSubresourceData> layout(mipLevels);
+    size_t dataSize = 0;
+    for (uint32_t mipLevel = 0; mipLevel < mipLevels; mipLevel++)
+    {
+        const uint32_t mipWidth = std::max(width >> mipLevel, 1u);
+        const uint32_t mipHeight = std::max(height >> mipLevel, 1u);
+
+        layout[mipLevel].dataOffset = ptrdiff_t(dataSize);
+        layout[mipLevel].rowPitch = size_t(mipWidth) * bytesPerPixel;
+        layout[mipLevel].depthPitch = layout[mipLevel].rowPitch * mipHeight;
+        layout[mipLevel].dataSize = layout[mipLevel].depthPitch;
+        dataSize += layout[mipLevel].dataSize;
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(malloc(dataSize));
+    if (!data)
+        return false;
+
+    level = ResolveSimdLevel(level);
+
+    std::vector<float> current; // the previous level in linear floats, when it was resampled
+    std::vector<float> next;
+
+    for (uint32_t mipLevel = 0; mipLevel < mipLevels; mipLevel++)
+    {
+        const uint32_t mipWidth = std::max(width >> mipLevel, 1u);
+        const uint32_t mipHeight = std::max(height >> mipLevel, 1u);
+        const TextureSubresourceData& mipLayout = layout[mipLevel];
+        uint8_t* mipData = data + mipLayout.dataOffset;
+
+        if (mipLevel == 0 && mipWidth == source.width && mipHeight == source.height)
+        {
+            // the first level is the decoded image, and the second level is computed from it directly
+            for (uint32_t y = 0; y < mipHeight; y++)
+                memcpy(mipData + y * mipLayout.rowPitch, source.encoded + y * source.rowPitch, mipLayout.rowPitch);
+            continue;
+        }
+
+        next.resize(size_t(mipWidth) * mipHeight * format.channels);
+        Resample(source, format, next.data(), mipWidth, mipHeight, filter, level);
+
+        for (uint32_t y = 0; y < mipHeight; y++)
+            StoreRow(&next[size_t(y) * mipWidth * format.channels], mipData + y * mipLayout.rowPitch, format, mipWidth);
+
+        std::swap(current, next);
+        source = SourceImage();
+        source.linear = current.data();
+        source.width = mipWidth;
+        source.height = mipHeight;
+    }
+
+    texture.data = std::make_shared<vfs::Blob>(data, dataSize);
+    texture.width = width;
+    texture.height = height;
+    texture.mipLevels = mipLevels;
+    texture.dataLayout[0] = std::move(layout);
+
+    return true;
+}
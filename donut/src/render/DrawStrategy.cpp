@@ -23,6 +23,8 @@
 #include <donut/render/DrawStrategy.h>
 #include <donut/render/GeometryPasses.h>
 #include <donut/engine/SceneGraph.h>
+#include <donut/engine/InstanceBvh.h>
+#include <donut/engine/TextureCache.h>
 #include <donut/engine/View.h>
 
 using namespace donut::math;
@@ -58,19 +60,82 @@ static int CompareDrawItemsOpaque(const DrawItem* a, const DrawItem* b)
     if (a->mesh != b->mesh)
         return a->mesh < b->mesh;
 
+    if (a->lod != b->lod)
+        return a->lod < b->lod;
+
     return a->instance < b->instance;
 }
 
+// Writes the opaque and alpha-tested geometries of the instance that intersect the frustum into 'items',
+// starting at 'itemCount'. There must be space for all geometries of the mesh.
+// Reports the screen size of the instance for the textures of those geometries if 'textureFeedback' is not null.
+static void AddOpaqueInstanceItems(MeshInstance* meshInstance, const dm::affine3& transform, const dm::frustum& viewFrustum,
+    const MeshLodSelector& lodSelector, TextureCache* textureFeedback, DrawItem* items, size_t& itemCount)
+{
+    const MeshInfo* mesh = meshInstance->GetMesh().get();
+    const uint32_t lod = lodSelector.SelectLod(*mesh, transform);
+    const float screenSize = textureFeedback ? lodSelector.GetProjectedSize(mesh->objectSpaceBounds * transform) : 0.f;
+
+    for (const auto& geometry : mesh->geometries)
+    {
+        auto domain = geometry->material->domain;
+        if (domain != MaterialDomain::Opaque && domain != MaterialDomain::AlphaTested)
+            continue;
+        
+        if (mesh->geometries.size() > 1 && !mesh->skinPrototype)
+        {
+            dm::box3 geometryGlobalBoundingBox = geometry->objectSpaceBounds * transform;
+            if (!viewFrustum.intersectsWith(geometryGlobalBoundingBox))
+                continue;
+        }
+
+        DrawItem& item = items[itemCount];
+        item.instance = meshInstance;
+        item.mesh = mesh;
+        item.geometry = geometry.get();
+        item.material = geometry->material.get();
+        item.buffers = item.mesh->buffers.get();
+        item.cullMode = (item.material->doubleSided) ? nvrhi::RasterCullMode::None : nvrhi::RasterCullMode::Back;
+        item.distanceToCamera = 0; // don't care
+        item.lod = lod;
+
+        if (textureFeedback)
+            textureFeedback->ReportMaterialUse(*item.material, screenSize);
+        
+        ++itemCount;
+    }
+}
+
+void InstancedOpaqueDrawStrategy::AddInstanceItems(MeshInstance* meshInstance, const dm::affine3& transform, size_t& itemCount)
+{
+    size_t requiredChunkSize = itemCount + meshInstance->GetMesh()->geometries.size();
+    if (m_InstanceChunk.size() < requiredChunkSize)
+        m_InstanceChunk.resize(requiredChunkSize);
+
+    AddOpaqueInstanceItems(meshInstance, transform, m_ViewFrustum, m_LodSelector, m_TextureFeedback.get(), m_InstanceChunk.data(), itemCount);
+}
+
 void InstancedOpaqueDrawStrategy::FillChunk()
 {
     m_InstanceChunk.resize(m_ChunkSize);
 
-    DrawItem* writePtr = m_InstanceChunk.data();
     size_t itemCount = 0;
+    auto relevantContentFlags = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes;
+
+    if (m_UseVisibleInstances)
+    {
+        while (m_VisibleInstanceReadPtr < m_VisibleInstances.size() && itemCount < m_ChunkSize)
+        {
+            MeshInstance* meshInstance = m_VisibleInstances[m_VisibleInstanceReadPtr++];
+            SceneGraphNode* node = meshInstance->GetNode();
+
+            if (node && (node->GetLeafContentFlags() & relevantContentFlags) != 0)
+                AddInstanceItems(meshInstance, node->GetLocalToWorldTransformFloat(), itemCount);
+        }
+    }
 
     while (m_Walker && itemCount < m_ChunkSize)
     {
-        auto relevantContentFlags = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes;
         bool subgraphContentRelevant = (m_Walker->GetSubgraphContentFlags() & relevantContentFlags) != 0;
         bool nodeContentsRelevant = (m_Walker->GetLeafContentFlags() & relevantContentFlags) != 0;
 
@@ -81,44 +146,9 @@ void InstancedOpaqueDrawStrategy::FillChunk()
 
             if (nodeVisible && nodeContentsRelevant)
             {
-                auto meshInstance = dynamic_cast<MeshInstance*>(m_Walker->GetLeaf().get());
+                auto meshInstance = m_Walker->GetLeaf()->AsMeshInstance();
                 if (meshInstance)
-                {
-                    const engine::MeshInfo* mesh = meshInstance->GetMesh().get();
-
-                    size_t requiredChunkSize = itemCount + mesh->geometries.size();
-                    if (m_InstanceChunk.size() < requiredChunkSize)
-                    {
-                        m_InstanceChunk.resize(requiredChunkSize);
-                        writePtr = m_InstanceChunk.data() + itemCount;
-                    }
-
-                    for (const auto& geometry : mesh->geometries)
-                    {
-                        auto domain = geometry->material->domain;
-                        if (domain != MaterialDomain::Opaque && domain != MaterialDomain::AlphaTested)
-                            continue;
-                        
-                        if (mesh->geometries.size() > 1 && !mesh->skinPrototype)
-                        {
-                            dm::box3 geometryGlobalBoundingBox = geometry->objectSpaceBounds * m_Walker->GetLocalToWorldTransformFloat();
-                            if (!m_ViewFrustum.intersectsWith(geometryGlobalBoundingBox))
-                                continue;
-                        }
-
-                        DrawItem& item = *writePtr;
-                        item.instance = meshInstance;
-                        item.mesh = mesh;
-                        item.geometry = geometry.get();
-                        item.material = geometry->material.get();
-                        item.buffers = item.mesh->buffers.get();
-                        item.cullMode = (item.material->doubleSided) ? nvrhi::RasterCullMode::None : nvrhi::RasterCullMode::Back;
-                        item.distanceToCamera = 0; // don't care
-                        
-                        ++writePtr;
-                        ++itemCount;
-                    }
-                }
+                    AddInstanceItems(meshInstance, m_Walker->GetLocalToWorldTransformFloat(), itemCount);
             }
         }
 
@@ -143,10 +173,37 @@ void InstancedOpaqueDrawStrategy::FillChunk()
 
 void donut::render::InstancedOpaqueDrawStrategy::PrepareForView(const std::shared_ptr<engine::SceneGraphNode>& rootNode, const engine::IView& view)
 {
-    m_Walker = SceneGraphWalker(rootNode.get());
     m_ViewFrustum = view.GetViewFrustum();
+    m_LodSelector.SetView(view, m_LodPixelThreshold);
+    m_InstanceChunk.clear();
+    m_ReadPtr = 0;
+
+    m_VisibleInstances.clear();
+    m_VisibleInstanceReadPtr = 0;
+    m_UseVisibleInstances = m_InstanceBvh != nullptr;
+
+    if (m_InstanceBvh)
+    {
+        m_Walker = SceneGraphWalker(nullptr);
+        m_InstanceBvh->Cull(m_ViewFrustum, m_VisibleInstances);
+    }
+    else
+    {
+        m_Walker = SceneGraphWalker(rootNode.get());
+    }
+}
+
+void InstancedOpaqueDrawStrategy::PrepareForVisibleInstances(const std::shared_ptr<engine::SceneGraphNode>& rootNode, const engine::IView& view, const std::vector<engine::MeshInstance*>& visibleInstances)
+{
+    m_ViewFrustum = view.GetViewFrustum();
+    m_LodSelector.SetView(view, m_LodPixelThreshold);
     m_InstanceChunk.clear();
     m_ReadPtr = 0;
+
+    m_Walker = SceneGraphWalker(nullptr);
+    m_VisibleInstances = visibleInstances;
+    m_VisibleInstanceReadPtr = 0;
+    m_UseVisibleInstances = true;
 }
 
 const DrawItem* InstancedOpaqueDrawStrategy::GetNextItem()
@@ -160,6 +217,216 @@ const DrawItem* InstancedOpaqueDrawStrategy::GetNextItem()
     return m_InstancePtrChunk[m_ReadPtr++];
 }
 
+void SortedOpaqueDrawStrategy::Reset(const engine::IView& view)
+{
+    m_ViewFrustum = view.GetViewFrustum();
+    m_LodSelector.SetView(view, m_LodPixelThreshold);
+    m_ItemCount = 0;
+    m_SortedItems.clear();
+    m_ReadPtr = 0;
+}
+
+void SortedOpaqueDrawStrategy::AddInstanceItems(MeshInstance* meshInstance, const dm::affine3& transform)
+{
+    size_t requiredSize = m_ItemCount + meshInstance->GetMesh()->geometries.size();
+    if (m_Items.size() < requiredSize)
+        m_Items.resize(std::max(requiredSize, m_Items.size() * 2));
+
+    AddOpaqueInstanceItems(meshInstance, transform, m_ViewFrustum, m_LodSelector, m_TextureFeedback.get(), m_Items.data(), m_ItemCount);
+}
+
+void SortedOpaqueDrawStrategy::PrepareForView(const std::shared_ptr<engine::SceneGraphNode>& rootNode, const engine::IView& view)
+{
+    Reset(view);
+
+    auto relevantContentFlags = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes;
+
+    SceneGraphWalker walker(rootNode.get());
+    while (walker)
+    {
+        bool nodeVisible = false;
+        if ((walker->GetSubgraphContentFlags() & relevantContentFlags) != 0)
+        {
+            nodeVisible = m_ViewFrustum.intersectsWith(walker->GetGlobalBoundingBox());
+
+            if (nodeVisible && (walker->GetLeafContentFlags() & relevantContentFlags) != 0)
+            {
+                auto meshInstance = walker->GetLeaf()->AsMeshInstance();
+                if (meshInstance)
+                    AddInstanceItems(meshInstance, walker->GetLocalToWorldTransformFloat());
+            }
+        }
+
+        walker.Next(nodeVisible);
+    }
+
+    SortItems();
+}
+
+void SortedOpaqueDrawStrategy::PrepareForVisibleInstances(const std::shared_ptr<engine::SceneGraphNode>& rootNode, const engine::IView& view, const std::vector<engine::MeshInstance*>& visibleInstances)
+{
+    Reset(view);
+
+    auto relevantContentFlags = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes;
+
+    for (MeshInstance* meshInstance : visibleInstances)
+    {
+        SceneGraphNode* node = meshInstance->GetNode();
+        if (node && (node->GetLeafContentFlags() & relevantContentFlags) != 0)
+            AddInstanceItems(meshInstance, node->GetLocalToWorldTransformFloat());
+    }
+
+    SortItems();
+}
+
+static uint32_t GetBitCount(uint32_t maxValue)
+{
+    uint32_t bits = 0;
+    while (bits < 32 && (maxValue >> bits) != 0)
+        ++bits;
+    return bits;
+}
+
+void SortedOpaqueDrawStrategy::SortItems()
+{
+    const size_t itemCount = m_ItemCount;
+    m_SortedItems.resize(itemCount);
+    if (itemCount == 0)
+        return;
+
+    m_SortEntries.resize(itemCount);
+    m_BufferGroupIndices.resize(itemCount);
+    m_BufferGroupIds.clear();
+    m_MaterialKeys.resize(itemCount);
+    m_UnassignedMaterialIds.clear();
+
+    // dense buffer group indices, and dense indices of the materials without an ID, in the order of first appearance
+    bool anyAssignedMaterial = false;
+    uint32_t maxMaterial = 0;
+    uint32_t maxGeometry = 0;
+    uint32_t maxLod = 0;
+    uint32_t maxInstance = 0;
+    const BufferGroup* lastBuffers = nullptr;
+    uint32_t lastBufferIndex = 0;
+    for (size_t i = 0; i < itemCount; i++)
+    {
+        const DrawItem& item = m_Items[i];
+        if (item.buffers != lastBuffers || i == 0)
+        {
+            auto found = m_BufferGroupIds.emplace(item.buffers, uint32_t(m_BufferGroupIds.size()));
+            lastBuffers = item.buffers;
+            lastBufferIndex = found.first->second;
+        }
+        m_BufferGroupIndices[i] = lastBufferIndex;
+
+        if (item.material->materialID >= 0)
+        {
+            anyAssignedMaterial = true;
+            maxMaterial = std::max(maxMaterial, uint32_t(item.material->materialID));
+        }
+        else
+        {
+            m_UnassignedMaterialIds.emplace(item.material, uint32_t(m_UnassignedMaterialIds.size()));
+        }
+
+        maxGeometry = std::max(maxGeometry, uint32_t(std::max(item.geometry->globalGeometryIndex, 0)));
+        maxLod = std::max(maxLod, item.lod);
+        maxInstance = std::max(maxInstance, uint32_t(std::max(item.instance->GetInstanceIndex(), 0)));
+    }
+
+    // materials without an ID get their own keys after the assigned IDs, so that they don't share a key with material 0
+    const uint32_t unassignedMaterialBase = anyAssignedMaterial ? maxMaterial + 1 : 0;
+    if (!m_UnassignedMaterialIds.empty())
+        maxMaterial = unassignedMaterialBase + uint32_t(m_UnassignedMaterialIds.size()) - 1;
+
+    for (size_t i = 0; i < itemCount; i++)
+    {
+        const Material* material = m_Items[i].material;
+        m_MaterialKeys[i] = material->materialID >= 0
+            ? uint32_t(material->materialID)
+            : unassignedMaterialBase + m_UnassignedMaterialIds[material];
+    }
+
+    // key layout from the top: material | buffer group | geometry | LOD | instance.
+    // Geometry indices are assigned mesh by mesh, so sorting by geometry also groups the meshes.
+    const uint32_t instanceBits = GetBitCount(maxInstance);
+    const uint32_t lodBits = GetBitCount(maxLod);
+    const uint32_t geometryBits = GetBitCount(maxGeometry);
+    const uint32_t bufferBits = GetBitCount(uint32_t(m_BufferGroupIds.size()) - 1);
+    const uint32_t materialBits = GetBitCount(maxMaterial);
+    const uint32_t totalBits = instanceBits + lodBits + geometryBits + bufferBits + materialBits;
+
+    if (totalBits > 64)
+    {
+        // too many objects to pack the key, compare the fields instead
+        for (size_t i = 0; i < itemCount; i++)
+            m_SortEntries[i] = SortEntry{ 0, uint32_t(i) };
+
+        std::sort(m_SortEntries.begin(), m_SortEntries.end(), [this](const SortEntry& a, const SortEntry& b)
+        {
+            const DrawItem& itemA = m_Items[a.itemIndex];
+            const DrawItem& itemB = m_Items[b.itemIndex];
+            if (m_MaterialKeys[a.itemIndex] != m_MaterialKeys[b.itemIndex])
+                return m_MaterialKeys[a.itemIndex] < m_MaterialKeys[b.itemIndex];
+            if (m_BufferGroupIndices[a.itemIndex] != m_BufferGroupIndices[b.itemIndex])
+                return m_BufferGroupIndices[a.itemIndex] < m_BufferGroupIndices[b.itemIndex];
+            if (itemA.geometry->globalGeometryIndex != itemB.geometry->globalGeometryIndex)
+                return itemA.geometry->globalGeometryIndex < itemB.geometry->globalGeometryIndex;
+            if (itemA.lod != itemB.lod)
+                return itemA.lod < itemB.lod;
+            return itemA.instance->GetInstanceIndex() < itemB.instance->GetInstanceIndex();
+        });
+    }
+    else
+    {
+        for (size_t i = 0; i < itemCount; i++)
+        {
+            const DrawItem& item = m_Items[i];
+            uint64_t key = m_MaterialKeys[i];
+            key = (key << bufferBits) | m_BufferGroupIndices[i];
+            key = (key << geometryBits) | uint64_t(std::max(item.geometry->globalGeometryIndex, 0));
+            key = (key << lodBits) | item.lod;
+            key = (key << instanceBits) | uint64_t(std::max(item.instance->GetInstanceIndex(), 0));
+            m_SortEntries[i] = SortEntry{ key, uint32_t(i) };
+        }
+
+        // LSD radix sort with 8-bit digits over the used bits, skipping the digits that are the same in all keys
+        m_SortScratch.resize(itemCount);
+        for (uint32_t shift = 0; shift < totalBits; shift += 8)
+        {
+            uint32_t histogram[256] = {};
+            for (const SortEntry& entry : m_SortEntries)
+                ++histogram[(entry.key >> shift) & 0xff];
+
+            if (histogram[(m_SortEntries[0].key >> shift) & 0xff] == itemCount)
+                continue;
+
+            uint32_t offset = 0;
+            for (uint32_t& count : histogram)
+            {
+                uint32_t bucketSize = count;
+                count = offset;
+                offset += bucketSize;
+            }
+
+            for (const SortEntry& entry : m_SortEntries)
+                m_SortScratch[histogram[(entry.key >> shift) & 0xff]++] = entry;
+
+            m_SortEntries.swap(m_SortScratch);
+        }
+    }
+
+    for (size_t i = 0; i < itemCount; i++)
+        m_SortedItems[i] = &m_Items[m_SortEntries[i].itemIndex];
+}
+
+const DrawItem* SortedOpaqueDrawStrategy::GetNextItem()
+{
+    if (m_ReadPtr >= m_SortedItems.size())
+        return nullptr;
+
+    return m_SortedItems[m_ReadPtr++];
+}
 
 static int CompareDrawItemsTransparent(const DrawItem* a, const DrawItem* b)
 {
@@ -179,6 +446,9 @@ void TransparentDrawStrategy::PrepareForView(const std::shared_ptr<engine::Scene
     float3 viewOrigin = view.GetViewOrigin();
     auto viewFrustum = view.GetViewFrustum();
 
+    MeshLodSelector lodSelector;
+    lodSelector.SetView(view, LodPixelThreshold);
+
     SceneGraphWalker walker(rootNode.get());
     while (walker)
     {
@@ -193,10 +463,12 @@ void TransparentDrawStrategy::PrepareForView(const std::shared_ptr<engine::Scene
 
             if (nodeVisible && nodeContentsRelevant)
             {
-                auto meshInstance = dynamic_cast<MeshInstance*>(walker->GetLeaf().get());
+                auto meshInstance = walker->GetLeaf()->AsMeshInstance();
                 if (meshInstance)
                 {
                     const engine::MeshInfo* mesh = meshInstance->GetMesh().get();
+                    const uint32_t lod = lodSelector.SelectLod(*mesh, walker->GetLocalToWorldTransformFloat());
+                    const float screenSize = TextureFeedback ? lodSelector.GetProjectedSize(walker->GetGlobalBoundingBox()) : 0.f;
                     for (const auto& geometry : mesh->geometries)
                     {
                         const auto& material = geometry->material;
@@ -222,6 +494,11 @@ void TransparentDrawStrategy::PrepareForView(const std::shared_ptr<engine::Scene
                         item.material = geometry->material.get();
                         item.buffers = mesh->buffers.get();
                         item.distanceToCamera = length(geometryGlobalBoundingBox.center() - viewOrigin);
+                        item.lod = lod;
+
+                        if (TextureFeedback)
+                            TextureFeedback->ReportMaterialUse(*material, screenSize);
+
                         if (material->doubleSided)
                         {
                             if (DrawDoubleSidedMaterialsSeparately)
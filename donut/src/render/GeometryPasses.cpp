@@ -23,6 +23,7 @@
 #include <donut/render/GeometryPasses.h>
 #include <donut/engine/SceneGraph.h>
 #include <donut/engine/FramebufferFactory.h>
+#include <donut/engine/MultiViewCuller.h>
 #include <donut/render/DrawStrategy.h>
 
 using namespace donut::math;
@@ -124,11 +125,13 @@ void donut::render::RenderView(
                 stateValid = true;
             }
 
+            MeshGeometryLod lod = item->geometry->GetLod(item->lod);
+
             nvrhi::DrawArguments args;
-            args.vertexCount = item->geometry->numIndices;
+            args.vertexCount = lod.numIndices;
             args.instanceCount = 1;
             args.startVertexLocation = item->mesh->vertexOffset + item->geometry->vertexOffsetInMesh;
-            args.startIndexLocation = item->mesh->indexOffset + item->geometry->indexOffsetInMesh;
+            args.startIndexLocation = item->mesh->indexOffset + lod.indexOffsetInMesh;
             args.startInstanceLocation = item->instance->GetInstanceIndex();
 
             if (currentDraw.instanceCount > 0 && 
@@ -162,7 +165,8 @@ void donut::render::RenderCompositeView(
     IGeometryPass& pass,
     GeometryPassContext& passContext,
     const char* passEvent, 
-    bool materialEvents)
+    bool materialEvents,
+    const MultiViewCuller* culler)
 {
     if (passEvent)
         commandList->beginMarker(passEvent);
@@ -182,7 +186,11 @@ void donut::render::RenderCompositeView(
 
         assert(view != nullptr);
 
-        drawStrategy.PrepareForView(rootNode, *view);
+        const std::vector<MeshInstance*>* visibleInstances = culler ? culler->GetVisibleInstances(view) : nullptr;
+        if (visibleInstances)
+            drawStrategy.PrepareForVisibleInstances(rootNode, *view, *visibleInstances);
+        else
+            drawStrategy.PrepareForView(rootNode, *view);
 
         nvrhi::IFramebuffer* framebuffer = framebufferFactory.GetFramebuffer(*view);
 
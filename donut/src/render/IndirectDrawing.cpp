@@ -0,0 +1,200 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/render/IndirectDrawing.h>
+#include <donut/render/DrawStrategy.h>
+#include <donut/render/GeometryPasses.h>
+#include <donut/engine/SceneGraph.h>
+
+using namespace donut::engine;
+using namespace donut::render;
+
+void IndirectDrawPacker::Clear()
+{
+    m_Arguments.clear();
+    m_Buckets.clear();
+}
+
+void IndirectDrawPacker::AddItem(const DrawItem& item)
+{
+    if (item.material == nullptr)
+        return;
+
+    engine::MeshGeometryLod lod = item.geometry->GetLod(item.lod);
+
+    nvrhi::DrawIndexedIndirectArguments args;
+    args.indexCount = lod.numIndices;
+    args.instanceCount = 1;
+    args.startIndexLocation = item.mesh->indexOffset + lod.indexOffsetInMesh;
+    args.baseVertexLocation = int32_t(item.mesh->vertexOffset + item.geometry->vertexOffsetInMesh);
+    args.startInstanceLocation = uint32_t(item.instance->GetInstanceIndex());
+
+    if (!m_Buckets.empty())
+    {
+        Bucket& bucket = m_Buckets.back();
+        if (bucket.material == item.material && bucket.buffers == item.buffers && bucket.cullMode == item.cullMode)
+        {
+            nvrhi::DrawIndexedIndirectArguments& last = m_Arguments.back();
+            if (last.startIndexLocation == args.startIndexLocation &&
+                last.baseVertexLocation == args.baseVertexLocation &&
+                last.startInstanceLocation + last.instanceCount == args.startInstanceLocation)
+            {
+                last.instanceCount += 1;
+            }
+            else
+            {
+                m_Arguments.push_back(args);
+                ++bucket.drawCount;
+            }
+            return;
+        }
+    }
+
+    Bucket bucket;
+    bucket.material = item.material;
+    bucket.buffers = item.buffers;
+    bucket.cullMode = item.cullMode;
+    bucket.firstDraw = uint32_t(m_Arguments.size());
+    bucket.drawCount = 1;
+    m_Buckets.push_back(bucket);
+    m_Arguments.push_back(args);
+}
+
+void IndirectDrawPacker::AddItems(IDrawStrategy& drawStrategy)
+{
+    while (const DrawItem* item = drawStrategy.GetNextItem())
+        AddItem(*item);
+}
+
+void IndirectDrawPacker::Upload(nvrhi::ICommandList* commandList)
+{
+    if (m_Arguments.empty())
+        return;
+
+    const size_t requiredSize = m_Arguments.size() * sizeof(nvrhi::DrawIndexedIndirectArguments);
+
+    if (!m_ArgumentBuffer || m_ArgumentBuffer->getDesc().byteSize < requiredSize)
+    {
+        // grow geometrically to avoid re-creating the buffer every frame while the scene changes
+        size_t newSize = m_ArgumentBuffer ? size_t(m_ArgumentBuffer->getDesc().byteSize) * 2 : 0;
+        newSize = std::max(newSize, requiredSize);
+
+        nvrhi::BufferDesc bufferDesc;
+        bufferDesc.byteSize = newSize;
+        bufferDesc.isDrawIndirectArgs = true;
+        bufferDesc.debugName = "IndirectDrawArguments";
+        bufferDesc.initialState = nvrhi::ResourceStates::IndirectArgument;
+        bufferDesc.keepInitialState = true;
+        m_ArgumentBuffer = commandList->getDevice()->createBuffer(bufferDesc);
+    }
+
+    commandList->writeBuffer(m_ArgumentBuffer, m_Arguments.data(), requiredSize);
+}
+
+void donut::render::RenderViewIndirect(
+    nvrhi::ICommandList* commandList,
+    const IView* view,
+    const IView* viewPrev,
+    nvrhi::IFramebuffer* framebuffer,
+    const IndirectDrawPacker& packer,
+    IGeometryPass& pass,
+    GeometryPassContext& passContext,
+    bool materialEvents)
+{
+    pass.SetupView(passContext, commandList, view, viewPrev);
+
+    const Material* lastMaterial = nullptr;
+    const BufferGroup* lastBuffers = nullptr;
+    nvrhi::RasterCullMode lastCullMode = nvrhi::RasterCullMode::Back;
+
+    bool drawMaterial = true;
+    bool stateValid = false;
+
+    const Material* eventMaterial = nullptr;
+
+    nvrhi::GraphicsState graphicsState;
+    graphicsState.framebuffer = framebuffer;
+    graphicsState.viewport = view->GetViewportState();
+    graphicsState.shadingRateState = view->GetVariableRateShadingState();
+    graphicsState.indirectParams = packer.GetArgumentBuffer();
+
+    const auto& arguments = packer.GetArguments();
+
+    for (const IndirectDrawPacker::Bucket& bucket : packer.GetBuckets())
+    {
+        if (bucket.buffers != lastBuffers)
+        {
+            pass.SetupInputBuffers(passContext, bucket.buffers, graphicsState);
+
+            lastBuffers = bucket.buffers;
+            stateValid = false;
+        }
+
+        if (bucket.material != lastMaterial || bucket.cullMode != lastCullMode)
+        {
+            drawMaterial = pass.SetupMaterial(passContext, bucket.material, bucket.cullMode, graphicsState);
+
+            lastMaterial = bucket.material;
+            lastCullMode = bucket.cullMode;
+            stateValid = false;
+        }
+
+        if (!drawMaterial)
+            continue;
+
+        if (materialEvents && bucket.material != eventMaterial)
+        {
+            if (eventMaterial)
+                commandList->endMarker();
+
+            if (bucket.material->name.empty())
+            {
+                eventMaterial = nullptr;
+            }
+            else
+            {
+                commandList->beginMarker(bucket.material->name.c_str());
+                eventMaterial = bucket.material;
+            }
+        }
+
+        if (!stateValid)
+        {
+            commandList->setGraphicsState(graphicsState);
+            stateValid = true;
+        }
+
+        const nvrhi::DrawIndexedIndirectArguments& first = arguments[bucket.firstDraw];
+        nvrhi::DrawArguments args;
+        args.vertexCount = first.indexCount;
+        args.instanceCount = first.instanceCount;
+        args.startIndexLocation = first.startIndexLocation;
+        args.startVertexLocation = uint32_t(first.baseVertexLocation);
+        args.startInstanceLocation = first.startInstanceLocation;
+        pass.SetPushConstants(passContext, commandList, graphicsState, args);
+
+        commandList->drawIndexedIndirect(bucket.firstDraw * uint32_t(sizeof(nvrhi::DrawIndexedIndirectArguments)), bucket.drawCount);
+    }
+
+    if (materialEvents && eventMaterial)
+        commandList->endMarker();
+}
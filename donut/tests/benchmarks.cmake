@@ -0,0 +1,76 @@
+#
+# Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+
+# Benchmarks are built like the tests but not registered with CTest: they take
+# a while to run and their output is meant to be read, not checked.
+
+add_custom_target(donut_all_benchmarks)
+set_property(TARGET donut_all_benchmarks PROPERTY FOLDER "Donut/donut_tests")
+
+file(GLOB donut_core_benchmarks src/core/bench_*.cpp)
+
+foreach(bench_src ${donut_core_benchmarks})
+
+    get_filename_component(bench_name "${bench_src}" NAME_WE)
+
+    add_executable("${bench_name}" "${bench_src}")
+    target_link_libraries("${bench_name}" donut_core donut_tests_utils)
+
+    add_dependencies(donut_all_benchmarks "${bench_name}")
+
+    set_property(TARGET "${bench_name}" PROPERTY FOLDER "Donut/donut_tests/donut_benchmarks")
+
+endforeach()
+
+if (DONUT_WITH_NVRHI)
+
+    file(GLOB donut_engine_benchmarks src/engine/bench_*.cpp)
+
+    foreach(bench_src ${donut_engine_benchmarks})
+
+        get_filename_component(bench_name "${bench_src}" NAME_WE)
+
+        add_executable("${bench_name}" "${bench_src}")
+        target_link_libraries("${bench_name}" donut_engine donut_core donut_tests_utils)
+
+        add_dependencies(donut_all_benchmarks "${bench_name}")
+
+        set_property(TARGET "${bench_name}" PROPERTY FOLDER "Donut/donut_tests/donut_benchmarks")
+
+    endforeach()
+
+    file(GLOB donut_render_benchmarks src/render/bench_*.cpp)
+
+    foreach(bench_src ${donut_render_benchmarks})
+
+        get_filename_component(bench_name "${bench_src}" NAME_WE)
+
+        add_executable("${bench_name}" "${bench_src}")
+        target_link_libraries("${bench_name}" donut_render donut_engine donut_core donut_tests_utils)
+
+        add_dependencies(donut_all_benchmarks "${bench_name}")
+
+        set_property(TARGET "${bench_name}" PROPERTY FOLDER "Donut/donut_tests/donut_benchmarks")
+
+    endforeach()
+
+endif()
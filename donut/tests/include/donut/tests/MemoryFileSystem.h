@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/core/vfs/VFS.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace donut::tests
+{
+	// A file system that keeps its files in memory and counts the reads and writes, for tests and benchmarks
+	// that shouldn't touch the disk. Reads don't copy the data: the blobs share it with the file system,
+	// and writing a file replaces its data without changing the blobs returned earlier.
+	class MemoryFileSystem : public vfs::IFileSystem
+	{
+	private:
+		class SharedBlob : public vfs::IBlob
+		{
+		private:
+			std::shared_ptr<const std::vector<uint8_t>> m_Data;
+
+		public:
+			explicit SharedBlob(std::shared_ptr<const std::vector<uint8_t>> data) : m_Data(std::move(data)) { }
+			[[nodiscard]] const void* data() const override { return m_Data->data(); }
+			[[nodiscard]] size_t size() const override { return m_Data->size(); }
+		};
+
+	public:
+		struct File
+		{
+			std::shared_ptr<const std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>();
+			int64_t modificationTime = 0;
+			int reads = 0;
+			int writes = 0;
+		};
+
+		std::map<std::string, File> files;
+		int reads = 0;  // of all files
+		int writes = 0;
+		bool provideFileInfo = true; // getFileInfo fails when false, like on file systems that don't support it
+
+		File& get(const std::filesystem::path& name) { return files[name.generic_string()]; }
+
+		// Like writeFile, without copying the data
+		void setFile(const std::filesystem::path& name, std::vector<uint8_t> data)
+		{
+			File& file = get(name);
+			file.data = std::make_shared<std::vector<uint8_t>>(std::move(data));
+			++file.modificationTime;
+			++file.writes;
+			++writes;
+		}
+
+		// The number of files with the extension, such as ".dds"
+		[[nodiscard]] int count(const char* extension) const
+		{
+			int result = 0;
+			for (const auto& [name, file] : files)
+				result += std::filesystem::path(name).extension() == extension ? 1 : 0;
+			return result;
+		}
+
+		bool folderExists(const std::filesystem::path&) override { return true; }
+		bool fileExists(const std::filesystem::path& name) override { return files.find(name.generic_string()) != files.end(); }
+
+		std::shared_ptr<vfs::IBlob> readFile(const std::filesystem::path& name) override
+		{
+			++reads;
+			auto it = files.find(name.generic_string());
+			if (it == files.end())
+				return nullptr;
+			++it->second.reads;
+			return std::make_shared<SharedBlob>(it->second.data);
+		}
+
+		bool writeFile(const std::filesystem::path& name, const void* data, size_t size) override
+		{
+			setFile(name, std::vector<uint8_t>(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size));
+			return true;
+		}
+
+		bool getFileInfo(const std::filesystem::path& name, vfs::FileInfo& info) override
+		{
+			auto it = files.find(name.generic_string());
+			if (!provideFileInfo || it == files.end())
+				return false;
+			info.size = it->second.data->size();
+			info.modificationTime = it->second.modificationTime;
+			return true;
+		}
+
+		int enumerateFiles(const std::filesystem::path&, const std::vector<std::string>&, vfs::enumerate_callback_t, bool) override { return 0; }
+		int enumerateDirectories(const std::filesystem::path&, vfs::enumerate_callback_t, bool) override { return 0; }
+	};
+}
@@ -0,0 +1,170 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <vector>
+
+namespace donut::tests
+{
+	// A command list that does nothing but record what was submitted to it,
+	// used to test CPU-side code that produces GPU commands without a device.
+	class MockCommandList : public nvrhi::RefCounter<nvrhi::ICommandList>
+	{
+	public:
+		struct BufferWrite
+		{
+			nvrhi::IBuffer* buffer;
+			size_t dataSize;
+			uint64_t destOffsetBytes;
+		};
+
+		struct TextureWrite
+		{
+			nvrhi::ITexture* texture;
+			uint32_t arraySlice;
+			uint32_t mipLevel;
+		};
+
+		std::vector<BufferWrite> bufferWrites;
+		std::vector<TextureWrite> textureWrites;
+		uint32_t numSetGraphicsState = 0;
+		uint32_t numDraws = 0;
+		uint32_t numIndirectDraws = 0;
+		uint32_t numIndirectDrawRecords = 0;
+		uint64_t numInstancesDrawn = 0;
+		uint64_t numTrianglesDrawn = 0;
+
+		[[nodiscard]] size_t GetBytesWritten() const
+		{
+			size_t total = 0;
+			for (const auto& write : bufferWrites)
+				total += write.dataSize;
+			return total;
+		}
+
+		MockCommandList() = default;
+		explicit MockCommandList(const nvrhi::CommandListParameters& desc, nvrhi::IDevice* device = nullptr) : m_Desc(desc), m_Device(device) { }
+
+		void Reset()
+		{
+			bufferWrites.clear();
+			textureWrites.clear();
+			numSetGraphicsState = 0;
+			numDraws = 0;
+			numIndirectDraws = 0;
+			numIndirectDrawRecords = 0;
+			numInstancesDrawn = 0;
+			numTrianglesDrawn = 0;
+		}
+
+		void open() override { }
+		void close() override { }
+		void clearState() override { }
+
+		void clearTextureFloat(nvrhi::ITexture*, nvrhi::TextureSubresourceSet, const nvrhi::Color&) override { }
+		void clearDepthStencilTexture(nvrhi::ITexture*, nvrhi::TextureSubresourceSet, bool, float, bool, uint8_t) override { }
+		void clearTextureUInt(nvrhi::ITexture*, nvrhi::TextureSubresourceSet, uint32_t) override { }
+
+		void copyTexture(nvrhi::ITexture*, const nvrhi::TextureSlice&, nvrhi::ITexture*, const nvrhi::TextureSlice&) override { }
+		void copyTexture(nvrhi::IStagingTexture*, const nvrhi::TextureSlice&, nvrhi::ITexture*, const nvrhi::TextureSlice&) override { }
+		void copyTexture(nvrhi::ITexture*, const nvrhi::TextureSlice&, nvrhi::IStagingTexture*, const nvrhi::TextureSlice&) override { }
+		void writeTexture(nvrhi::ITexture* t, uint32_t arraySlice, uint32_t mipLevel, const void*, size_t, size_t) override
+		{
+			textureWrites.push_back({ t, arraySlice, mipLevel });
+		}
+		void resolveTexture(nvrhi::ITexture*, const nvrhi::TextureSubresourceSet&, nvrhi::ITexture*, const nvrhi::TextureSubresourceSet&) override { }
+
+		void writeBuffer(nvrhi::IBuffer* b, const void*, size_t dataSize, uint64_t destOffsetBytes) override
+		{
+			bufferWrites.push_back({ b, dataSize, destOffsetBytes });
+		}
+		void clearBufferUInt(nvrhi::IBuffer*, uint32_t) override { }
+		void copyBuffer(nvrhi::IBuffer*, uint64_t, nvrhi::IBuffer*, uint64_t, uint64_t) override { }
+
+		void setPushConstants(const void*, size_t) override { }
+
+		void setGraphicsState(const nvrhi::GraphicsState&) override { ++numSetGraphicsState; }
+		void draw(const nvrhi::DrawArguments& args) override { ++numDraws; numInstancesDrawn += args.instanceCount; numTrianglesDrawn += uint64_t(args.vertexCount / 3) * args.instanceCount; }
+		void drawIndexed(const nvrhi::DrawArguments& args) override { ++numDraws; numInstancesDrawn += args.instanceCount; numTrianglesDrawn += uint64_t(args.vertexCount / 3) * args.instanceCount; }
+		void drawIndirect(uint32_t) override { ++numIndirectDraws; ++numIndirectDrawRecords; }
+		void drawIndexedIndirect(uint32_t, uint32_t drawCount) override { ++numIndirectDraws; numIndirectDrawRecords += drawCount; }
+
+		void setComputeState(const nvrhi::ComputeState&) override { }
+		void dispatch(uint32_t, uint32_t, uint32_t) override { }
+		void dispatchIndirect(uint32_t) override { }
+
+		void setMeshletState(const nvrhi::MeshletState&) override { }
+		void dispatchMesh(uint32_t, uint32_t, uint32_t) override { }
+
+		void setRayTracingState(const nvrhi::rt::State&) override { }
+		void dispatchRays(const nvrhi::rt::DispatchRaysArguments&) override { }
+
+		void buildBottomLevelAccelStruct(nvrhi::rt::IAccelStruct*, const nvrhi::rt::GeometryDesc*, size_t, nvrhi::rt::AccelStructBuildFlags) override { }
+		void compactBottomLevelAccelStructs() override { }
+		void buildTopLevelAccelStruct(nvrhi::rt::IAccelStruct*, const nvrhi::rt::InstanceDesc*, size_t, nvrhi::rt::AccelStructBuildFlags) override { }
+		void buildTopLevelAccelStructFromBuffer(nvrhi::rt::IAccelStruct*, nvrhi::IBuffer*, uint64_t, size_t, nvrhi::rt::AccelStructBuildFlags) override { }
+
+		void beginTimerQuery(nvrhi::ITimerQuery*) override { }
+		void endTimerQuery(nvrhi::ITimerQuery*) override { }
+
+		void beginMarker(const char*) override { }
+		void endMarker() override { }
+
+		void setEnableAutomaticBarriers(bool) override { }
+		void setResourceStatesForBindingSet(nvrhi::IBindingSet*) override { }
+		void setEnableUavBarriersForTexture(nvrhi::ITexture*, bool) override { }
+		void setEnableUavBarriersForBuffer(nvrhi::IBuffer*, bool) override { }
+
+		void beginTrackingTextureState(nvrhi::ITexture*, nvrhi::TextureSubresourceSet, nvrhi::ResourceStates) override { }
+		void beginTrackingBufferState(nvrhi::IBuffer*, nvrhi::ResourceStates) override { }
+		void setTextureState(nvrhi::ITexture*, nvrhi::TextureSubresourceSet, nvrhi::ResourceStates) override { }
+		void setBufferState(nvrhi::IBuffer*, nvrhi::ResourceStates) override { }
+		void setAccelStructState(nvrhi::rt::IAccelStruct*, nvrhi::ResourceStates) override { }
+		void setPermanentTextureState(nvrhi::ITexture*, nvrhi::ResourceStates) override { }
+		void setPermanentBufferState(nvrhi::IBuffer*, nvrhi::ResourceStates) override { }
+		void commitBarriers() override { }
+
+		nvrhi::ResourceStates getTextureSubresourceState(nvrhi::ITexture*, nvrhi::ArraySlice, nvrhi::MipLevel) override { return nvrhi::ResourceStates::Common; }
+		nvrhi::ResourceStates getBufferState(nvrhi::IBuffer*) override { return nvrhi::ResourceStates::Common; }
+
+		nvrhi::IDevice* getDevice() override { return m_Device; }
+		const nvrhi::CommandListParameters& getDesc() override { return m_Desc; }
+
+	private:
+		nvrhi::CommandListParameters m_Desc;
+		nvrhi::IDevice* m_Device = nullptr;
+	};
+
+	// A buffer without storage, to pass where the code under test only needs a buffer object
+	class MockBuffer : public nvrhi::RefCounter<nvrhi::IBuffer>
+	{
+	public:
+		explicit MockBuffer(const nvrhi::BufferDesc& desc) : m_Desc(desc) { }
+
+		const nvrhi::BufferDesc& getDesc() const override { return m_Desc; }
+
+	private:
+		nvrhi::BufferDesc m_Desc;
+	};
+}
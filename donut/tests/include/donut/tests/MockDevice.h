@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/tests/MockCommandList.h>
+#include <nvrhi/nvrhi.h>
+#include <vector>
+
+namespace donut::tests
+{
+	// A texture without storage, created by MockDevice
+	class MockTexture : public nvrhi::RefCounter<nvrhi::ITexture>
+	{
+	public:
+		explicit MockTexture(const nvrhi::TextureDesc& desc) : m_Desc(desc) { }
+
+		const nvrhi::TextureDesc& getDesc() const override { return m_Desc; }
+		nvrhi::Object getNativeView(nvrhi::ObjectType, nvrhi::Format, nvrhi::TextureSubresourceSet, nvrhi::TextureDimension, bool) override { return nullptr; }
+
+	private:
+		nvrhi::TextureDesc m_Desc;
+	};
+
+	// A device that creates textures without storage and MockCommandList command lists, and records
+	// the command lists executed on it. Objects that the code under test isn't expected to create are null.
+	class MockDevice : public nvrhi::RefCounter<nvrhi::IDevice>
+	{
+	public:
+		std::vector<nvrhi::RefCountPtr<MockCommandList>> commandLists; // in the order of creation
+		std::vector<nvrhi::TextureDesc> texturesCreated;
+		uint32_t numExecutions = 0;           // calls to executeCommandLists
+		uint32_t numCommandListsExecuted = 0;
+		uint32_t numGarbageCollections = 0;
+
+		void Reset()
+		{
+			commandLists.clear();
+			texturesCreated.clear();
+			numExecutions = 0;
+			numCommandListsExecuted = 0;
+			numGarbageCollections = 0;
+		}
+
+		nvrhi::HeapHandle createHeap(const nvrhi::HeapDesc&) override { return nullptr; }
+
+		nvrhi::TextureHandle createTexture(const nvrhi::TextureDesc& d) override
+		{
+			texturesCreated.push_back(d);
+			return nvrhi::TextureHandle::Create(new MockTexture(d));
+		}
+		nvrhi::MemoryRequirements getTextureMemoryRequirements(nvrhi::ITexture*) override { return nvrhi::MemoryRequirements(); }
+		bool bindTextureMemory(nvrhi::ITexture*, nvrhi::IHeap*, uint64_t) override { return false; }
+
+		nvrhi::TextureHandle createHandleForNativeTexture(nvrhi::ObjectType, nvrhi::Object, const nvrhi::TextureDesc&) override { return nullptr; }
+
+		nvrhi::StagingTextureHandle createStagingTexture(const nvrhi::TextureDesc&, nvrhi::CpuAccessMode) override { return nullptr; }
+		void* mapStagingTexture(nvrhi::IStagingTexture*, const nvrhi::TextureSlice&, nvrhi::CpuAccessMode, size_t*) override { return nullptr; }
+		void unmapStagingTexture(nvrhi::IStagingTexture*) override { }
+
+		nvrhi::BufferHandle createBuffer(const nvrhi::BufferDesc& d) override { return nvrhi::BufferHandle::Create(new MockBuffer(d)); }
+		void* mapBuffer(nvrhi::IBuffer*, nvrhi::CpuAccessMode) override { return nullptr; }
+		void unmapBuffer(nvrhi::IBuffer*) override { }
+		nvrhi::MemoryRequirements getBufferMemoryRequirements(nvrhi::IBuffer*) override { return nvrhi::MemoryRequirements(); }
+		bool bindBufferMemory(nvrhi::IBuffer*, nvrhi::IHeap*, uint64_t) override { return false; }
+
+		nvrhi::BufferHandle createHandleForNativeBuffer(nvrhi::ObjectType, nvrhi::Object, const nvrhi::BufferDesc&) override { return nullptr; }
+
+		nvrhi::ShaderHandle createShader(const nvrhi::ShaderDesc&, const void*, size_t) override { return nullptr; }
+		nvrhi::ShaderHandle createShaderSpecialization(nvrhi::IShader*, const nvrhi::ShaderSpecialization*, uint32_t) override { return nullptr; }
+		nvrhi::ShaderLibraryHandle createShaderLibrary(const void*, size_t) override { return nullptr; }
+
+		nvrhi::SamplerHandle createSampler(const nvrhi::SamplerDesc&) override { return nullptr; }
+
+		nvrhi::InputLayoutHandle createInputLayout(const nvrhi::VertexAttributeDesc*, uint32_t, nvrhi::IShader*) override { return nullptr; }
+
+		nvrhi::EventQueryHandle createEventQuery() override { return nullptr; }
+		void setEventQuery(nvrhi::IEventQuery*, nvrhi::CommandQueue) override { }
+		bool pollEventQuery(nvrhi::IEventQuery*) override { return true; }
+		void waitEventQuery(nvrhi::IEventQuery*) override { }
+		void resetEventQuery(nvrhi::IEventQuery*) override { }
+
+		nvrhi::TimerQueryHandle createTimerQuery() override { return nullptr; }
+		bool pollTimerQuery(nvrhi::ITimerQuery*) override { return true; }
+		float getTimerQueryTime(nvrhi::ITimerQuery*) override { return 0.f; }
+		void resetTimerQuery(nvrhi::ITimerQuery*) override { }
+
+		nvrhi::GraphicsAPI getGraphicsAPI() override { return nvrhi::GraphicsAPI::VULKAN; }
+
+		nvrhi::FramebufferHandle createFramebuffer(const nvrhi::FramebufferDesc&) override { return nullptr; }
+		nvrhi::GraphicsPipelineHandle createGraphicsPipeline(const nvrhi::GraphicsPipelineDesc&, nvrhi::IFramebuffer*) override { return nullptr; }
+		nvrhi::ComputePipelineHandle createComputePipeline(const nvrhi::ComputePipelineDesc&) override { return nullptr; }
+		nvrhi::MeshletPipelineHandle createMeshletPipeline(const nvrhi::MeshletPipelineDesc&, nvrhi::IFramebuffer*) override { return nullptr; }
+		nvrhi::rt::PipelineHandle createRayTracingPipeline(const nvrhi::rt::PipelineDesc&) override { return nullptr; }
+
+		nvrhi::BindingLayoutHandle createBindingLayout(const nvrhi::BindingLayoutDesc&) override { return nullptr; }
+		nvrhi::BindingLayoutHandle createBindlessLayout(const nvrhi::BindlessLayoutDesc&) override { return nullptr; }
+		nvrhi::BindingSetHandle createBindingSet(const nvrhi::BindingSetDesc&, nvrhi::IBindingLayout*) override { return nullptr; }
+		nvrhi::DescriptorTableHandle createDescriptorTable(nvrhi::IBindingLayout*) override { return nullptr; }
+		void resizeDescriptorTable(nvrhi::IDescriptorTable*, uint32_t, bool) override { }
+		bool writeDescriptorTable(nvrhi::IDescriptorTable*, const nvrhi::BindingSetItem&) override { return false; }
+
+		nvrhi::rt::AccelStructHandle createAccelStruct(const nvrhi::rt::AccelStructDesc&) override { return nullptr; }
+		nvrhi::MemoryRequirements getAccelStructMemoryRequirements(nvrhi::rt::IAccelStruct*) override { return nvrhi::MemoryRequirements(); }
+		bool bindAccelStructMemory(nvrhi::rt::IAccelStruct*, nvrhi::IHeap*, uint64_t) override { return false; }
+
+		nvrhi::CommandListHandle createCommandList(const nvrhi::CommandListParameters& params) override
+		{
+			auto commandList = nvrhi::RefCountPtr<MockCommandList>::Create(new MockCommandList(params, this));
+			commandLists.push_back(commandList);
+			return commandList;
+		}
+		uint64_t executeCommandLists(nvrhi::ICommandList* const*, size_t numCommandLists, nvrhi::CommandQueue) override
+		{
+			++numExecutions;
+			numCommandListsExecuted += uint32_t(numCommandLists);
+			return numExecutions;
+		}
+		void queueWaitForCommandList(nvrhi::CommandQueue, nvrhi::CommandQueue, uint64_t) override { }
+		void waitForIdle() override { }
+		void runGarbageCollection() override { ++numGarbageCollections; }
+
+		bool queryFeatureSupport(nvrhi::Feature, void*, size_t) override { return false; }
+		nvrhi::FormatSupport queryFormatSupport(nvrhi::Format) override { return nvrhi::FormatSupport::None; }
+		nvrhi::Object getNativeQueue(nvrhi::ObjectType, nvrhi::CommandQueue) override { return nullptr; }
+		nvrhi::IMessageCallback* getMessageCallback() override { return nullptr; }
+	};
+}
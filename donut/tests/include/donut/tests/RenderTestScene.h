@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <donut/render/GeometryPasses.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <memory>
+#include <vector>
+
+namespace donut::tests
+{
+	// A geometry pass that sets no state, so that only the command list calls made by RenderView are recorded.
+	// Counts the material setups.
+	class NullGeometryPass : public render::IGeometryPass
+	{
+	public:
+		uint32_t numMaterialSetups = 0;
+
+		[[nodiscard]] engine::ViewType::Enum GetSupportedViewTypes() const override { return engine::ViewType::PLANAR; }
+		void SetupView(render::GeometryPassContext&, nvrhi::ICommandList*, const engine::IView*, const engine::IView*) override { }
+		bool SetupMaterial(render::GeometryPassContext&, const engine::Material*, nvrhi::RasterCullMode, nvrhi::GraphicsState&) override { ++numMaterialSetups; return true; }
+		void SetupInputBuffers(render::GeometryPassContext&, const engine::BufferGroup*, nvrhi::GraphicsState&) override { }
+		void SetPushConstants(render::GeometryPassContext&, nvrhi::ICommandList*, nvrhi::GraphicsState&, nvrhi::DrawArguments&) override { }
+	};
+
+	struct RenderTestScene
+	{
+		std::shared_ptr<engine::SceneGraph> graph;
+		std::vector<std::shared_ptr<engine::Material>> materials;
+		std::shared_ptr<engine::BufferGroup> buffers;
+		std::vector<std::shared_ptr<engine::MeshInfo>> meshes;
+	};
+
+	// 'meshCount' meshes with 'geometriesPerMesh' geometries of 300 indices each in one buffer group,
+	// where geometry 'g' of every mesh uses material 'g'. The instances of each mesh are added together,
+	// so they have consecutive instance indices, and each mesh gets its own row of instances.
+	inline RenderTestScene CreateRenderTestScene(int meshCount, int geometriesPerMesh, int instancesPerMesh)
+	{
+		RenderTestScene scene;
+		scene.buffers = std::make_shared<engine::BufferGroup>();
+		for (int i = 0; i < geometriesPerMesh; i++)
+			scene.materials.push_back(std::make_shared<engine::Material>());
+
+		scene.graph = std::make_shared<engine::SceneGraph>();
+		auto root = std::make_shared<engine::SceneGraphNode>();
+		scene.graph->SetRootNode(root);
+
+		for (int meshIndex = 0; meshIndex < meshCount; meshIndex++)
+		{
+			auto mesh = std::make_shared<engine::MeshInfo>();
+			mesh->buffers = scene.buffers;
+			mesh->indexOffset = uint32_t(meshIndex * geometriesPerMesh) * 300;
+			mesh->vertexOffset = uint32_t(meshIndex * geometriesPerMesh) * 100;
+			mesh->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+			for (int geometryIndex = 0; geometryIndex < geometriesPerMesh; geometryIndex++)
+			{
+				auto geometry = std::make_shared<engine::MeshGeometry>();
+				geometry->material = scene.materials[geometryIndex];
+				geometry->objectSpaceBounds = mesh->objectSpaceBounds;
+				geometry->indexOffsetInMesh = uint32_t(geometryIndex) * 300;
+				geometry->vertexOffsetInMesh = uint32_t(geometryIndex) * 100;
+				geometry->numIndices = 300;
+				mesh->geometries.push_back(geometry);
+			}
+			scene.meshes.push_back(mesh);
+
+			for (int i = 0; i < instancesPerMesh; i++)
+			{
+				auto node = scene.graph->AttachLeafNode(root, std::make_shared<engine::MeshInstance>(mesh));
+				node->SetTranslation(dm::double3(double(i) * 3.0, 0.0, double(meshIndex) * 3.0));
+			}
+		}
+
+		scene.graph->Refresh(0);
+		return scene;
+	}
+
+	// A view from high above that sees every instance of CreateRenderTestScene
+	inline engine::PlanarView CreateViewOfEverything()
+	{
+		dm::affine3 cameraToWorld = dm::rotation(dm::float3(1.f, 0.f, 0.f), dm::radians(90.f)) * dm::translation(dm::float3(0.f, 1000.f, 0.f));
+
+		engine::PlanarView view;
+		view.SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(120.f), 1.f, 0.1f, 5000.f));
+		view.UpdateCache();
+		return view;
+	}
+}
@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/VFS.h>
+#include <donut/core/vfs/TarFile.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace donut;
+using namespace donut::tests;
+
+// Measures the load time and peak memory use of reading all assets of a large generated scene
+// and keeping them in memory, with copying reads and with memory-mapped blobs, from native files and from a tar archive.
+// Each read mode runs in a separate process so that the peak RSS of one mode doesn't hide the others.
+// Usage: bench_blob_loading [scene size in MB] [scene directory]
+
+static const size_t c_AssetSize = 8 * 1024 * 1024;
+
+static std::string asset_name(size_t index)
+{
+	return "assets/asset" + std::to_string(index) + ".bin";
+}
+
+static bool generate_scene(const std::filesystem::path& directory, size_t assetCount)
+{
+	std::filesystem::create_directories(directory / "assets");
+
+	vfs::NativeFileSystem fs;
+	std::vector<uint64_t> data(c_AssetSize / sizeof(uint64_t));
+	uint64_t seed = 1;
+
+	FILE* tar = fopen((directory / "scene.tar").generic_string().c_str(), "wb");
+	if (!tar)
+		return false;
+
+	for (size_t i = 0; i < assetCount; i++)
+	{
+		for (auto& word : data)
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			word = seed;
+		}
+
+		if (!fs.writeFile(directory / asset_name(i), data.data(), c_AssetSize))
+			return false;
+
+		char header[512] = {};
+		snprintf(header, 100, "%s", asset_name(i).c_str());
+		snprintf(header + 100, 8, "%07o", 0644);
+		snprintf(header + 124, 12, "%011llo", (unsigned long long)c_AssetSize);
+		header[156] = '0';
+		memcpy(header + 257, "ustar", 6);
+		fwrite(header, 1, sizeof(header), tar);
+		fwrite(data.data(), 1, c_AssetSize, tar);
+	}
+
+	std::vector<char> zeros(1024, 0);
+	fwrite(zeros.data(), 1, zeros.size(), tar);
+	fclose(tar);
+	return true;
+}
+
+// Reads all assets like a scene loader would and consumes every byte of them.
+static uint64_t load_scene(vfs::IFileSystem& fs, size_t assetCount, std::vector<std::shared_ptr<vfs::IBlob>>& blobs)
+{
+	uint64_t checksum = 0;
+	for (size_t i = 0; i < assetCount; i++)
+	{
+		auto blob = fs.readFile(asset_name(i));
+		if (!blob)
+			continue;
+
+		const uint64_t* words = static_cast<const uint64_t*>(blob->data());
+		for (size_t word = 0; word < blob->size() / sizeof(uint64_t); word++)
+			checksum ^= words[word];
+
+		blobs.push_back(blob);
+	}
+	return checksum;
+}
+
+static void print_memory_usage()
+{
+#ifdef WIN32
+	printf("    peak RSS: not measured on this platform\n");
+#else
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	printf("    peak RSS: %.0f MB\n", double(usage.ru_maxrss) / 1024.0);
+
+	// the anonymous part is the memory that can't be shared with the OS file cache
+	FILE* status = fopen("/proc/self/status", "r");
+	if (status)
+	{
+		char line[256];
+		while (fgets(line, sizeof(line), status))
+		{
+			if (strncmp(line, "RssAnon:", 8) == 0 || strncmp(line, "RssFile:", 8) == 0)
+				printf("    %s", line);
+		}
+		fclose(status);
+	}
+#endif
+}
+
+static int run_mode(const std::string& mode, const std::filesystem::path& directory, size_t assetCount)
+{
+	std::shared_ptr<vfs::IFileSystem> fs;
+	if (mode == "native-copy" || mode == "native-mapped")
+	{
+		auto nativeFs = std::make_shared<vfs::NativeFileSystem>();
+		if (mode == "native-copy")
+			nativeFs->setMemoryMappingThreshold(std::numeric_limits<size_t>::max());
+		fs = std::make_shared<vfs::RelativeFileSystem>(nativeFs, directory);
+	}
+	else
+	{
+		auto tar = std::make_shared<vfs::TarFile>(directory / "scene.tar",
+			mode == "tar-mapped" ? vfs::TarFile::ReadMode::MemoryMapped : vfs::TarFile::ReadMode::Buffered);
+		if (!tar->isOpen())
+			return 1;
+		fs = tar;
+	}
+
+	uint64_t checksum = 0;
+	double time = MeasureMedianMilliseconds(3, [&]()
+	{
+		std::vector<std::shared_ptr<vfs::IBlob>> blobs;
+		checksum = load_scene(*fs, assetCount, blobs);
+	});
+
+	PrintBenchmarkResult(("load scene, " + mode).c_str(), time);
+	printf("    checksum %016llx\n", (unsigned long long)checksum);
+
+	// measure the memory with the whole scene loaded
+	std::vector<std::shared_ptr<vfs::IBlob>> blobs;
+	load_scene(*fs, assetCount, blobs);
+	print_memory_usage();
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	size_t sceneMegabytes = (argc > 1) ? size_t(atoi(argv[1])) : 1024;
+	std::filesystem::path directory = (argc > 2) ? argv[2] : "bench_blob_loading";
+	size_t assetCount = sceneMegabytes * 1024 * 1024 / c_AssetSize;
+
+	// child process: measure one mode
+	if (argc > 3)
+		return run_mode(argv[3], directory, assetCount);
+
+	std::error_code error;
+	if (std::filesystem::file_size(directory / "scene.tar", error) != assetCount * (c_AssetSize + 512) + 1024)
+	{
+		printf("Generating the scene in '%s' (%zu MB)...\n", directory.generic_string().c_str(), sceneMegabytes);
+		if (!generate_scene(directory, assetCount))
+		{
+			printf("Cannot write the scene\n");
+			return 1;
+		}
+	}
+
+	for (const char* mode : { "native-copy", "native-mapped", "tar-buffered", "tar-mapped" })
+	{
+		fflush(stdout);
+		std::string command = "\"" + std::string(argv[0]) + "\" " + std::to_string(sceneMegabytes) + " \""
+			+ directory.generic_string() + "\" " + mode;
+		if (std::system(command.c_str()) != 0)
+			printf("%s: failed\n", mode);
+	}
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/Compression.h>
+#include <donut/tests/MemoryFileSystem.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::tests;
+
+// Measures the decompression throughput of CompressionLayer::readFile for one large file written with
+// linked blocks (streaming decompression) and with independent blocks, decoded serially and on 1 to N threads.
+// The compressed file is kept in memory so that only the decompression is measured.
+// Usage: bench_compression [file size in MB]
+
+// Vertex-like data: slowly changing floats with some noise, which compresses about 2:1 with LZ4
+static std::vector<uint8_t> create_data(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	float* floats = reinterpret_cast<float*>(data.data());
+	uint32_t seed = 1;
+	for (size_t i = 0; i < size / sizeof(float); i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		floats[i] = float(i / 16) * 0.25f + ((i % 4 == 3) ? float(seed >> 8) : 0.f);
+	}
+	return data;
+}
+
+int main(int argc, char** argv)
+{
+	size_t fileMegabytes = (argc > 1) ? size_t(atoi(argv[1])) : 256;
+	std::vector<uint8_t> data = create_data(fileMegabytes * 1024 * 1024);
+
+	auto memoryFs = std::make_shared<MemoryFileSystem>();
+	vfs::CompressionLayer compression(memoryFs);
+	compression.setCompressionLevel(1);
+
+	auto measure = [&](const char* name)
+	{
+		bool valid = true;
+		double time = MeasureMedianMilliseconds(5, [&]()
+		{
+			auto blob = compression.readFile("data.bin");
+			valid = blob && blob->size() == data.size() && memcmp(blob->data(), data.data(), data.size()) == 0;
+		});
+		
+		PrintBenchmarkResult(name, time);
+		printf("    %.0f MB/s\n", double(fileMegabytes) / (time * 0.001));
+
+		if (!valid)
+			printf("WARNING: the decompressed data doesn't match\n");
+	};
+
+	compression.setBlockSize(0);
+	compression.writeFile("data.bin.lz4", data.data(), data.size());
+	printf("Linked blocks: %zu MB compressed to %.1f MB\n", fileMegabytes,
+		double(memoryFs->readFile("data.bin.lz4")->size()) / (1024.0 * 1024.0));
+	measure("linked blocks, streaming");
+
+	compression.setBlockSize(1024 * 1024);
+	compression.writeFile("data.bin.lz4", data.data(), data.size());
+	printf("Independent 1 MB blocks: %zu MB compressed to %.1f MB\n", fileMegabytes,
+		double(memoryFs->readFile("data.bin.lz4")->size()) / (1024.0 * 1024.0));
+	measure("independent blocks, serial");
+
+#ifdef DONUT_WITH_TASKFLOW
+	int maxThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+	std::vector<int> threadCounts = { 1 };
+	for (int count = 2; count < maxThreads; count *= 2)
+		threadCounts.push_back(count);
+	if (maxThreads > 1)
+		threadCounts.push_back(maxThreads);
+
+	for (int threadCount : threadCounts)
+	{
+		tf::Executor executor(threadCount);
+		compression.setExecutor(&executor);
+
+		char name[128];
+		snprintf(name, sizeof(name), "independent blocks, %d threads", threadCount);
+		measure(name);
+	}
+	compression.setExecutor(nullptr);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/math/math.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+
+using namespace donut::math;
+using namespace donut::tests;
+
+// Compares the scalar frustum-box test with the batch test at each SIMD level.
+// Usage: bench_frustum [box count]
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = (argc > 1) ? size_t(atoi(argv[1])) : 1000000;
+
+	std::vector<float> minX(count), minY(count), minZ(count), maxX(count), maxY(count), maxZ(count);
+	std::vector<box3> boxes(count);
+
+	uint32_t seed = 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		float3 center = (float3(random_float(seed), random_float(seed), random_float(seed)) * 2.f - 1.f) * 200.f;
+		float3 extent = float3(random_float(seed), random_float(seed), random_float(seed)) * 5.f;
+		boxes[i] = box3(center - extent, center + extent);
+		minX[i] = boxes[i].m_mins.x; minY[i] = boxes[i].m_mins.y; minZ[i] = boxes[i].m_mins.z;
+		maxX[i] = boxes[i].m_maxs.x; maxY[i] = boxes[i].m_maxs.y; maxZ[i] = boxes[i].m_maxs.z;
+	}
+
+	box3_soa soa;
+	soa.minX = minX.data(); soa.minY = minY.data(); soa.minZ = minZ.data();
+	soa.maxX = maxX.data(); soa.maxY = maxY.data(); soa.maxZ = maxZ.data();
+	soa.count = count;
+
+	frustum f(perspProjD3DStyle(radians(60.f), 16.f / 9.f, 0.1f, 200.f), false);
+
+	printf("%d boxes, supported SIMD level: %d\n", int(count), int(get_supported_simd_level()));
+
+	const int iterations = 20;
+	size_t visibleCount = 0;
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		visibleCount = 0;
+		for (const box3& box : boxes)
+			visibleCount += f.intersectsWith(box) ? 1 : 0;
+	});
+	PrintBenchmarkResult("intersectsWith(box3) loop", time);
+	printf("%d boxes visible\n", int(visibleCount));
+
+	std::vector<uint32_t> mask((count + 31) / 32);
+	const char* names[] = { "batch, scalar", "batch, SSE", "batch, AVX2" };
+	for (simd_level level : { simd_level::scalar, simd_level::sse, simd_level::avx2 })
+	{
+		if (level > get_supported_simd_level())
+			continue;
+
+		time = MeasureMedianMilliseconds(iterations, [&]() { f.intersectsWith(soa, mask.data(), level); });
+		PrintBenchmarkResult(names[int(level)], time);
+	}
+
+	return 0;
+}
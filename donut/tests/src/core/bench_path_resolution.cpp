@@ -0,0 +1,176 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/TarFile.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+
+using namespace donut;
+using namespace donut::tests;
+
+// Measures the throughput of fileExists calls through a RootFileSystem with several mount points
+// into a TarFile, compared with the linear mount scan and lexically_normal lookups that they replaced.
+// Usage: bench_path_resolution [file count]
+
+static bool generate_archive(const std::string& path, const std::vector<std::string>& names)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	for (const auto& name : names)
+	{
+		char header[1024] = {};
+		strncpy(header, name.c_str(), 100);
+		snprintf(header + 100, 8, "%07o", 0644);
+		snprintf(header + 124, 12, "%011llo", 1ull);
+		header[156] = '0';
+		memcpy(header + 257, "ustar", 6);
+		header[512] = 'x';
+		fwrite(header, 1, sizeof(header), file);
+	}
+
+	std::vector<char> zeros(1024, 0);
+	fwrite(zeros.data(), 1, zeros.size(), file);
+	fclose(file);
+	return true;
+}
+
+// The mount point lookup and archive file set as they were implemented before PathTable
+class LegacyResolver
+{
+private:
+	std::vector<std::pair<std::string, int>> m_MountPoints;
+	std::unordered_set<std::string> m_Files;
+
+public:
+	void mount(const std::filesystem::path& path, int id)
+	{
+		m_MountPoints.push_back(std::make_pair(path.lexically_normal().generic_string(), id));
+	}
+
+	void addFile(const std::string& name)
+	{
+		m_Files.insert(name);
+	}
+
+	bool fileExists(const std::filesystem::path& path, int archiveId)
+	{
+		std::string spath = path.lexically_normal().generic_string();
+
+		for (auto it : m_MountPoints)
+		{
+			if (spath.find(it.first, 0) == 0 && ((spath.length() == it.first.length()) || (spath[it.first.length()] == '/')))
+			{
+				if (it.second != archiveId)
+					return false;
+
+				std::filesystem::path relativePath = spath.substr(it.first.size() + 1);
+				std::string normalizedName = relativePath.lexically_normal().relative_path().generic_string();
+				return m_Files.find(normalizedName) != m_Files.end();
+			}
+		}
+
+		return false;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	const int fileCount = (argc > 1) ? atoi(argv[1]) : 20000;
+
+	std::vector<std::string> names;
+	for (int i = 0; i < fileCount; i++)
+	{
+		char name[100];
+		snprintf(name, sizeof(name), "textures/set%02d/material%05d_albedo.dds", i % 37, i);
+		names.push_back(name);
+	}
+
+	const std::string archivePath = (std::filesystem::path(DONUT_TEST_BINARY_DIR) / "bench_path_resolution.tar").generic_string();
+	if (!generate_archive(archivePath, names))
+	{
+		fprintf(stderr, "Cannot write '%s'\n", archivePath.c_str());
+		return 1;
+	}
+
+	const char* otherMounts[] = { "/shaders/donut", "/shaders/app", "/media/fonts", "/media/env", "/native", "/cache", "/config" };
+
+	vfs::RootFileSystem root;
+	LegacyResolver legacy;
+	for (int i = 0; i < int(std::size(otherMounts)); i++)
+	{
+		root.mount(otherMounts[i], std::make_shared<vfs::NativeFileSystem>());
+		legacy.mount(otherMounts[i], i);
+	}
+	root.mount("/media/assets", std::make_shared<vfs::TarFile>(archivePath));
+	legacy.mount("/media/assets", -1);
+	for (const auto& name : names)
+		legacy.addFile(name);
+
+	std::vector<std::filesystem::path> normalPaths;
+	std::vector<std::filesystem::path> unnormalizedPaths;
+	for (const auto& name : names)
+	{
+		normalPaths.push_back("/media/assets/" + name);
+		unnormalizedPaths.push_back("/media/./assets//" + name);
+	}
+
+	printf("%d files, %d mount points\n", fileCount, int(std::size(otherMounts)) + 1);
+
+	const int iterations = 10;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const auto& paths = pass == 0 ? normalPaths : unnormalizedPaths;
+		const char* kind = pass == 0 ? "normal paths" : "unnormalized paths";
+		char label[100];
+
+		int found = 0;
+		double time = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			found = 0;
+			for (const auto& path : paths)
+				found += legacy.fileExists(path, -1) ? 1 : 0;
+		});
+		snprintf(label, sizeof(label), "legacy: %s (%.1f M/s)", kind, double(paths.size()) / time * 1e-3);
+		PrintBenchmarkResult(label, time);
+		if (found != fileCount)
+			printf("WARNING: legacy resolver found %d of %d files\n", found, fileCount);
+
+		time = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			found = 0;
+			for (const auto& path : paths)
+				found += root.fileExists(path) ? 1 : 0;
+		});
+		snprintf(label, sizeof(label), "indexed: %s (%.1f M/s)", kind, double(paths.size()) / time * 1e-3);
+		PrintBenchmarkResult(label, time);
+		if (found != fileCount)
+			printf("WARNING: RootFileSystem found %d of %d files\n", found, fileCount);
+	}
+
+	std::filesystem::remove(archivePath);
+
+	return 0;
+}
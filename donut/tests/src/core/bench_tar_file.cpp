@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/TarFile.h>
+#include <donut/tests/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace donut;
+using namespace donut::tests;
+
+// Measures the throughput of reading all files of a large tar archive from 1 to N threads with each TarFile read mode.
+// The archive is generated on the first run and reused after that; the reads mostly hit the OS file cache.
+// Usage: bench_tar_file [archive size in MB] [archive path]
+
+static const size_t c_FileSize = 4 * 1024 * 1024;
+
+static bool generate_archive(const std::string& path, size_t fileCount)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	std::vector<uint64_t> data(c_FileSize / sizeof(uint64_t));
+	uint64_t seed = 1;
+
+	for (size_t i = 0; i < fileCount; i++)
+	{
+		char header[512] = {};
+		snprintf(header, 100, "data/file%05zu.bin", i);
+		snprintf(header + 100, 8, "%07o", 0644);
+		snprintf(header + 124, 12, "%011llo", (unsigned long long)c_FileSize);
+		header[156] = '0';
+		memcpy(header + 257, "ustar", 6);
+		fwrite(header, 1, sizeof(header), file);
+
+		for (auto& word : data)
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			word = seed;
+		}
+		fwrite(data.data(), 1, c_FileSize, file);
+	}
+
+	std::vector<char> zeros(1024, 0);
+	fwrite(zeros.data(), 1, zeros.size(), file);
+	fclose(file);
+	return true;
+}
+
+// Reads all files, spread over 'threadCount' threads, and consumes every byte of them.
+static uint64_t read_all(vfs::TarFile& tar, size_t fileCount, int threadCount)
+{
+	std::atomic<size_t> nextFile = 0;
+	std::atomic<uint64_t> checksum = 0;
+
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < threadCount; thread++)
+	{
+		threads.emplace_back([&]()
+		{
+			uint64_t localChecksum = 0;
+			char fileName[64];
+			for (size_t i = nextFile++; i < fileCount; i = nextFile++)
+			{
+				snprintf(fileName, sizeof(fileName), "data/file%05zu.bin", i);
+				auto blob = tar.readFile(fileName);
+				if (!blob)
+					continue;
+
+				const uint64_t* words = static_cast<const uint64_t*>(blob->data());
+				for (size_t word = 0; word < blob->size() / sizeof(uint64_t); word++)
+					localChecksum ^= words[word];
+			}
+			checksum ^= localChecksum;
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	return checksum;
+}
+
+int main(int argc, char** argv)
+{
+	size_t archiveMegabytes = (argc > 1) ? size_t(atoi(argv[1])) : 2048;
+	std::string archivePath = (argc > 2) ? argv[2] : "bench_tar_file.tar";
+	size_t fileCount = archiveMegabytes * 1024 * 1024 / c_FileSize;
+
+	std::error_code error;
+	size_t expectedSize = fileCount * (c_FileSize + 512) + 1024;
+	if (std::filesystem::file_size(archivePath, error) != expectedSize)
+	{
+		printf("Generating '%s' (%zu MB)...\n", archivePath.c_str(), archiveMegabytes);
+		if (!generate_archive(archivePath, fileCount))
+		{
+			printf("Cannot write the archive\n");
+			return 1;
+		}
+	}
+
+	int maxThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+	std::vector<int> threadCounts = { 1 };
+	for (int count = 2; count < maxThreads; count *= 2)
+		threadCounts.push_back(count);
+	if (maxThreads > 1)
+		threadCounts.push_back(maxThreads);
+
+	const std::pair<vfs::TarFile::ReadMode, const char*> modes[] = {
+		{ vfs::TarFile::ReadMode::Buffered, "buffered" },
+		{ vfs::TarFile::ReadMode::Positional, "positional" },
+		{ vfs::TarFile::ReadMode::MemoryMapped, "memory-mapped" }
+	};
+
+	uint64_t referenceChecksum = 0;
+	bool firstRun = true;
+
+	for (const auto& [mode, modeName] : modes)
+	{
+		vfs::TarFile tar(archivePath, mode);
+		if (!tar.isOpen())
+		{
+			printf("Cannot open the archive\n");
+			return 1;
+		}
+
+		for (int threadCount : threadCounts)
+		{
+			uint64_t checksum = 0;
+			double time = MeasureMedianMilliseconds(3, [&]() { checksum = read_all(tar, fileCount, threadCount); });
+
+			char name[128];
+			snprintf(name, sizeof(name), "%s, %d threads", modeName, threadCount);
+			PrintBenchmarkResult(name, time);
+			printf("    %.0f MB/s\n", double(fileCount * c_FileSize) / (1024.0 * 1024.0) / (time * 0.001));
+
+			if (firstRun)
+				referenceChecksum = checksum;
+			else if (checksum != referenceChecksum)
+				printf("WARNING: checksum mismatch\n");
+			firstRun = false;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/VFS.h>
+#include <donut/core/vfs/Compression.h>
+#include <donut/core/vfs/TarFile.h>
+#include <donut/tests/utils.h>
+#include <cstring>
+
+using namespace donut;
+
+static std::vector<uint8_t> create_data(size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		data[i] = (i % 3 == 0) ? uint8_t(seed >> 24) : uint8_t(i / 1024);
+	}
+	return data;
+}
+
+static bool blob_matches(const std::shared_ptr<vfs::IBlob>& blob, const std::vector<uint8_t>& data)
+{
+	return blob && blob->size() == data.size() && memcmp(blob->data(), data.data(), data.size()) == 0;
+}
+
+class Gate
+{
+private:
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Open = false;
+
+public:
+	void open()
+	{
+		{
+			std::lock_guard<std::mutex> lockGuard(m_Mutex);
+			m_Open = true;
+		}
+		m_Condition.notify_all();
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Condition.wait(lock, [this]() { return m_Open; });
+	}
+};
+
+void test_priorities_and_cancellation()
+{
+	vfs::IoThreadPool pool(1);
+	Gate gate;
+
+	// keep the only thread busy until all requests are queued
+	auto blocker = pool.submit(0, nullptr, [&gate]() { gate.wait(); return std::shared_ptr<vfs::IBlob>(); });
+
+	std::mutex orderMutex;
+	std::vector<int> order;
+	int callbacks = 0;
+	auto submit = [&](int priority)
+	{
+		return pool.submit(priority,
+			[&callbacks](const std::shared_ptr<vfs::IBlob>&) { ++callbacks; },
+			[&, priority]()
+			{
+				std::lock_guard<std::mutex> lockGuard(orderMutex);
+				order.push_back(priority);
+				return std::shared_ptr<vfs::IBlob>();
+			});
+	};
+
+	auto low = submit(-1);
+	auto normal1 = submit(0);
+	auto high = submit(10);
+	auto cancelled = submit(5);
+	auto normal2 = submit(0);
+
+	CHECK(cancelled->cancel());
+	CHECK(cancelled->isDone());
+	CHECK(cancelled->isCancelled());
+	CHECK(cancelled->wait() == nullptr);
+
+	gate.open();
+
+	// the reads return no blobs, and the requests are done when wait() returns
+	for (const auto& request : { blocker, low, normal1, normal2, high })
+	{
+		CHECK(request->wait() == nullptr);
+		CHECK(request->isDone());
+		CHECK(!request->isCancelled());
+	}
+
+	CHECK(order == std::vector<int>({ 10, 0, 0, -1 }));
+	CHECK(callbacks == 4);
+
+	// finished requests can't be cancelled
+	CHECK(!high->cancel());
+	CHECK(high->isDone());
+	CHECK(!high->isCancelled());
+}
+
+void test_forwarding()
+{
+	const std::filesystem::path directory = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_async_read_files";
+	std::filesystem::create_directories(directory);
+
+	auto nativeFs = std::make_shared<vfs::NativeFileSystem>();
+	auto relativeFs = std::make_shared<vfs::RelativeFileSystem>(nativeFs, directory);
+	auto compression = std::make_shared<vfs::CompressionLayer>(relativeFs);
+
+	std::vector<uint8_t> plainData = create_data(100 * 1024, 1);
+	std::vector<uint8_t> compressedData = create_data(900 * 1024, 2);
+	CHECK(compression->writeFile("plain.bin", plainData.data(), plainData.size()));
+	CHECK(compression->writeFile("compressed.bin.lz4", compressedData.data(), compressedData.size()));
+
+	vfs::RootFileSystem root;
+	root.mount("/data", compression);
+
+	std::atomic<int> callbacks = 0;
+	auto countCallback = [&callbacks](const std::shared_ptr<vfs::IBlob>&) { ++callbacks; };
+
+	std::vector<std::shared_ptr<vfs::AsyncReadRequest>> requests;
+	for (int i = 0; i < 16; i++)
+	{
+		requests.push_back(root.readFileAsync("/data/plain.bin", i, countCallback));
+		requests.push_back(root.readFileAsync("/data/compressed.bin", i, countCallback));
+	}
+	auto missing = root.readFileAsync("/data/missing.bin", 0, countCallback);
+	auto unmounted = root.readFileAsync("/other/plain.bin", 0, countCallback);
+
+	for (size_t i = 0; i < requests.size(); i += 2)
+	{
+		CHECK(blob_matches(requests[i]->wait(), plainData));
+		CHECK(blob_matches(requests[i + 1]->getFuture().get(), compressedData));
+	}
+	CHECK(missing->wait() == nullptr);
+	CHECK(unmounted->wait() == nullptr);
+	CHECK(callbacks == int(requests.size()) + 2);
+
+	std::filesystem::remove_all(directory);
+}
+
+void test_tar_file_async()
+{
+	const std::filesystem::path archivePath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_async_read.tar";
+	std::vector<uint8_t> data = create_data(5000, 3);
+
+	FILE* file = fopen(archivePath.generic_string().c_str(), "wb");
+	CHECK(file != nullptr);
+	char header[512] = {};
+	strncpy(header, "file.bin", 100);
+	snprintf(header + 100, 8, "%07o", 0644);
+	snprintf(header + 124, 12, "%011llo", (unsigned long long)data.size());
+	header[156] = '0';
+	memcpy(header + 257, "ustar", 6);
+	fwrite(header, 1, sizeof(header), file);
+	fwrite(data.data(), 1, data.size(), file);
+	std::vector<char> zeros(1024 + 512 - data.size() % 512, 0);
+	fwrite(zeros.data(), 1, zeros.size(), file);
+	fclose(file);
+
+	for (auto mode : { vfs::TarFile::ReadMode::Buffered, vfs::TarFile::ReadMode::Positional, vfs::TarFile::ReadMode::MemoryMapped })
+	{
+		vfs::TarFile tar(archivePath, mode);
+		auto request = tar.readFileAsync("file.bin");
+		CHECK(blob_matches(request->wait(), data));
+
+		// mapped archives complete the request right away
+		if (mode == vfs::TarFile::ReadMode::MemoryMapped)
+			CHECK(request->isDone());
+
+		CHECK(tar.readFileAsync("missing.bin")->wait() == nullptr);
+	}
+
+	std::filesystem::remove(archivePath);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_priorities_and_cancellation();
+		test_forwarding();
+		test_tar_file_async();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,182 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/CachingFileSystem.h>
+#include <donut/tests/utils.h>
+#include <cstring>
+
+using namespace donut;
+
+// Counts the reads that reach the underlying file system.
+class CountingFileSystem : public vfs::RelativeFileSystem
+{
+public:
+	std::atomic<int> reads = 0;
+
+	using vfs::RelativeFileSystem::RelativeFileSystem;
+
+	std::shared_ptr<vfs::IBlob> readFile(const std::filesystem::path& name) override
+	{
+		++reads;
+		return vfs::RelativeFileSystem::readFile(name);
+	}
+
+	// the default implementation calls readFile on a pool thread, so async reads are counted too
+	std::shared_ptr<vfs::AsyncReadRequest> readFileAsync(const std::filesystem::path& name, int priority, vfs::read_callback_t callback) override
+	{
+		return vfs::IFileSystem::readFileAsync(name, priority, std::move(callback));
+	}
+};
+
+static std::vector<uint8_t> create_data(size_t size, uint8_t value)
+{
+	return std::vector<uint8_t>(size, value);
+}
+
+static bool blob_matches(const std::shared_ptr<vfs::IBlob>& blob, const std::vector<uint8_t>& data)
+{
+	return blob && blob->size() == data.size() && memcmp(blob->data(), data.data(), data.size()) == 0;
+}
+
+void test_lru_eviction(const std::shared_ptr<CountingFileSystem>& fs)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		std::vector<uint8_t> data = create_data(1000, uint8_t(i));
+		CHECK(fs->writeFile("file" + std::to_string(i) + ".bin", data.data(), data.size()));
+	}
+	std::vector<uint8_t> largeData = create_data(5000, 9);
+	CHECK(fs->writeFile("large.bin", largeData.data(), largeData.size()));
+
+	fs->reads = 0;
+	vfs::CachingFileSystem cache(fs, 3000);
+
+	auto blob0 = cache.readFile("file0.bin");
+	CHECK(blob_matches(blob0, create_data(1000, 0)));
+	CHECK(cache.readFile("./dir/../file0.bin") == blob0);
+	CHECK(fs->reads == 1);
+
+	cache.readFile("file1.bin");
+	cache.readFile("file2.bin");
+	cache.readFile("file0.bin"); // file1 is now the least recently used
+	cache.readFile("file3.bin");
+
+	auto statistics = cache.getStatistics();
+	CHECK(statistics.hits == 2);
+	CHECK(statistics.misses == 4);
+	CHECK(statistics.evictions == 1);
+	CHECK(statistics.cachedFiles == 3);
+	CHECK(statistics.cachedBytes == 3000);
+
+	fs->reads = 0;
+	cache.readFile("file0.bin");
+	cache.readFile("file2.bin");
+	cache.readFile("file3.bin");
+	CHECK(fs->reads == 0);
+	cache.readFile("file1.bin");
+	CHECK(fs->reads == 1);
+
+	// blobs over the budget are passed through
+	fs->reads = 0;
+	CHECK(blob_matches(cache.readFile("large.bin"), largeData));
+	CHECK(blob_matches(cache.readFile("large.bin"), largeData));
+	CHECK(fs->reads == 2);
+
+	// missing files are not cached
+	CHECK(cache.readFile("missing.bin") == nullptr);
+
+	cache.setBudget(1000);
+	CHECK(cache.getStatistics().cachedFiles == 1);
+	cache.clear();
+	CHECK(cache.getStatistics().cachedBytes == 0);
+}
+
+void test_invalidation(const std::shared_ptr<CountingFileSystem>& fs)
+{
+	std::vector<uint8_t> oldData = create_data(1000, 1);
+	std::vector<uint8_t> newData = create_data(1200, 2);
+	CHECK(fs->writeFile("changing.bin", oldData.data(), oldData.size()));
+
+	vfs::CachingFileSystem cache(fs, 1 << 20);
+
+	// writing through the cache invalidates the entry
+	CHECK(blob_matches(cache.readFile("changing.bin"), oldData));
+	CHECK(cache.writeFile("changing.bin", newData.data(), newData.size()));
+	CHECK(blob_matches(cache.readFile("changing.bin"), newData));
+	CHECK(cache.getStatistics().invalidations == 1);
+
+	// without validation, changes made behind the cache's back are not noticed
+	CHECK(fs->writeFile("changing.bin", oldData.data(), oldData.size()));
+	CHECK(blob_matches(cache.readFile("changing.bin"), newData));
+
+	cache.setValidateFiles(true);
+	cache.clear();
+	CHECK(blob_matches(cache.readFile("changing.bin"), oldData));
+	CHECK(fs->writeFile("changing.bin", newData.data(), newData.size()));
+	CHECK(blob_matches(cache.readFile("changing.bin"), newData));
+	CHECK(cache.getStatistics().invalidations == 2);
+
+	fs->reads = 0;
+	CHECK(blob_matches(cache.readFile("changing.bin"), newData));
+	CHECK(fs->reads == 0);
+}
+
+void test_async_reads(const std::shared_ptr<CountingFileSystem>& fs)
+{
+	std::vector<uint8_t> data = create_data(2000, 7);
+	CHECK(fs->writeFile("async.bin", data.data(), data.size()));
+
+	vfs::CachingFileSystem cache(fs, 1 << 20);
+
+	fs->reads = 0;
+	CHECK(blob_matches(cache.readFileAsync("async.bin")->wait(), data));
+
+	int callbacks = 0;
+	auto request = cache.readFileAsync("async.bin", 0, [&callbacks](const std::shared_ptr<vfs::IBlob>&) { ++callbacks; });
+	CHECK(request->isDone());
+	CHECK(blob_matches(request->wait(), data));
+	CHECK(callbacks == 1);
+	CHECK(fs->reads == 1);
+	CHECK(cache.getStatistics().hits == 1);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		const std::filesystem::path directory = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_caching_files";
+		std::filesystem::create_directories(directory);
+		auto fs = std::make_shared<CountingFileSystem>(std::make_shared<vfs::NativeFileSystem>(), directory);
+
+		test_lru_eviction(fs);
+		test_invalidation(fs);
+		test_async_reads(fs);
+
+		std::filesystem::remove_all(directory);
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/Compression.h>
+#include <donut/tests/utils.h>
+#include <cstring>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+
+// Generates data that compresses reasonably well: runs of repeated bytes mixed with noise.
+static std::vector<uint8_t> create_data(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	uint32_t seed = 1;
+	for (size_t i = 0; i < size; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		data[i] = ((i / 64) % 3 == 0) ? uint8_t(seed >> 24) : uint8_t(i / 256);
+	}
+	return data;
+}
+
+static bool blob_matches(const std::shared_ptr<vfs::IBlob>& blob, const std::vector<uint8_t>& data)
+{
+	return blob && blob->size() == data.size() && memcmp(blob->data(), data.data(), data.size()) == 0;
+}
+
+static bool has_independent_blocks(vfs::IFileSystem& fs, const std::filesystem::path& name)
+{
+	auto blob = fs.readFile(name);
+	// FLG byte after the magic number, bit 5 is block independence
+	return blob && blob->size() > 4 && (static_cast<const uint8_t*>(blob->data())[4] & 0x20) != 0;
+}
+
+void test_compression_round_trip(vfs::IFileSystem& rawFs, vfs::CompressionLayer& compression)
+{
+	const size_t blockSizes[] = { 0, 64 * 1024, 1024 * 1024 };
+	const size_t dataSizes[] = { 1, 1000, 64 * 1024, 700 * 1024, 3 * 1024 * 1024 + 17 };
+
+	for (size_t blockSize : blockSizes)
+	{
+		compression.setBlockSize(blockSize);
+
+		for (size_t dataSize : dataSizes)
+		{
+			std::vector<uint8_t> data = create_data(dataSize);
+			CHECK(compression.writeFile("round_trip.bin.lz4", data.data(), data.size()));
+			// frames that fit into one block are always written as independent by LZ4
+			if (blockSize != 0)
+				CHECK(has_independent_blocks(rawFs, "round_trip.bin.lz4"));
+			CHECK(blob_matches(compression.readFile("round_trip.bin"), data));
+		}
+	}
+
+	std::filesystem::remove(std::filesystem::path(DONUT_TEST_BINARY_DIR) / "round_trip.bin.lz4");
+}
+
+void test_compression_corrupted_block(vfs::IFileSystem& rawFs, vfs::CompressionLayer& compression)
+{
+	compression.setBlockSize(64 * 1024);
+
+	std::vector<uint8_t> data = create_data(500 * 1024);
+	CHECK(compression.writeFile("corrupted.bin.lz4", data.data(), data.size()));
+
+	auto compressed = rawFs.readFile("corrupted.bin.lz4");
+	CHECK(compressed);
+	std::vector<uint8_t> corrupted(static_cast<const uint8_t*>(compressed->data()),
+		static_cast<const uint8_t*>(compressed->data()) + compressed->size());
+
+	// flip a byte in the middle of the data, the block checksum must catch it
+	corrupted[corrupted.size() / 2] ^= 0x55;
+	CHECK(rawFs.writeFile("corrupted.bin.lz4", corrupted.data(), corrupted.size()));
+	CHECK(compression.readFile("corrupted.bin") == nullptr);
+
+	// a truncated frame is rejected by the streaming decompressor
+	CHECK(rawFs.writeFile("corrupted.bin.lz4", corrupted.data(), corrupted.size() / 3));
+	CHECK(compression.readFile("corrupted.bin") == nullptr);
+
+	std::filesystem::remove(std::filesystem::path(DONUT_TEST_BINARY_DIR) / "corrupted.bin.lz4");
+}
+
+#ifdef DONUT_WITH_TASKFLOW
+void test_compression_from_worker(vfs::CompressionLayer& compression, tf::Executor& executor)
+{
+	compression.setBlockSize(64 * 1024);
+
+	std::vector<uint8_t> data = create_data(2 * 1024 * 1024);
+	CHECK(compression.writeFile("worker.bin.lz4", data.data(), data.size()));
+
+	// reads from the executor's own workers decode serially instead of waiting on the executor
+	std::vector<std::shared_ptr<vfs::IBlob>> blobs(8);
+	tf::Taskflow taskflow;
+	for (auto& blob : blobs)
+		taskflow.emplace([&compression, &blob]() { blob = compression.readFile("worker.bin"); });
+	executor.run(taskflow).wait();
+
+	for (const auto& blob : blobs)
+		CHECK(blob_matches(blob, data));
+
+	std::filesystem::remove(std::filesystem::path(DONUT_TEST_BINARY_DIR) / "worker.bin.lz4");
+}
+#endif
+
+int main(int, char** argv)
+{
+	try
+	{
+		auto nativeFs = std::make_shared<vfs::NativeFileSystem>();
+		auto relativeFs = std::make_shared<vfs::RelativeFileSystem>(nativeFs, DONUT_TEST_BINARY_DIR);
+		vfs::CompressionLayer compression(relativeFs);
+
+		test_compression_round_trip(*relativeFs, compression);
+		test_compression_corrupted_block(*relativeFs, compression);
+
+#ifdef DONUT_WITH_TASKFLOW
+		tf::Executor executor(4);
+		compression.setExecutor(&executor);
+
+		test_compression_round_trip(*relativeFs, compression);
+		test_compression_corrupted_block(*relativeFs, compression);
+		test_compression_from_worker(compression, executor);
+#endif
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
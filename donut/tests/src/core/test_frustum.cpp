@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/math/math.h>
+
+#include <donut/tests/utils.h>
+#include <limits>
+#include <vector>
+
+using namespace donut::math;
+
+struct BoxArrays
+{
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+	void push_back(const box3& box)
+	{
+		minX.push_back(box.m_mins.x); minY.push_back(box.m_mins.y); minZ.push_back(box.m_mins.z);
+		maxX.push_back(box.m_maxs.x); maxY.push_back(box.m_maxs.y); maxZ.push_back(box.m_maxs.z);
+	}
+
+	box3_soa view() const
+	{
+		box3_soa soa;
+		soa.minX = minX.data(); soa.minY = minY.data(); soa.minZ = minZ.data();
+		soa.maxX = maxX.data(); soa.maxY = maxY.data(); soa.maxZ = maxZ.data();
+		soa.count = minX.size();
+		return soa;
+	}
+};
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+static float3 random_float3(uint32_t& seed, float scale)
+{
+	return (float3(random_float(seed), random_float(seed), random_float(seed)) * 2.f - 1.f) * scale;
+}
+
+static std::vector<frustum> create_frusta(uint32_t& seed)
+{
+	std::vector<frustum> frusta;
+
+	for (int i = 0; i < 8; i++)
+	{
+		affine3 cameraToWorld = rotation(random_float3(seed, 3.f)) * translation(random_float3(seed, 50.f));
+		float4x4 viewProj = affineToHomogeneous(inverse(cameraToWorld)) * perspProjD3DStyle(radians(30.f + 60.f * random_float(seed)), 1.5f, 0.1f, 100.f);
+		frusta.push_back(frustum(viewProj, false));
+	}
+
+	frusta.push_back(frustum::fromBox(box3(float3(-10.f), float3(10.f))));
+	frusta.push_back(frustum::infinite());
+	frusta.push_back(frustum::empty());
+
+	return frusta;
+}
+
+static BoxArrays create_boxes(uint32_t& seed, int count)
+{
+	BoxArrays boxes;
+
+	for (int i = 0; i < count; i++)
+	{
+		float3 center = random_float3(seed, 100.f);
+		float3 extent = abs(random_float3(seed, 10.f));
+		boxes.push_back(box3(center - extent, center + extent));
+	}
+
+	// special cases: points, boxes touching the faces of the fromBox frustum, empty and non-finite boxes
+	const float inf = std::numeric_limits<float>::infinity();
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	boxes.push_back(box3(float3(0.f), float3(0.f)));
+	boxes.push_back(box3(float3(10.f, 0.f, 0.f), float3(20.f, 1.f, 1.f)));
+	boxes.push_back(box3(float3(-20.f, -20.f, -20.f), float3(-10.f, -10.f, -10.f)));
+	boxes.push_back(box3(float3(10.0001f, 0.f, 0.f), float3(20.f, 1.f, 1.f)));
+	boxes.push_back(box3::empty());
+	boxes.push_back(box3(float3(-inf), float3(inf)));
+	boxes.push_back(box3(float3(nan), float3(nan)));
+	boxes.push_back(box3(float3(0.f, nan, 0.f), float3(1.f)));
+
+	return boxes;
+}
+
+void test_batch_intersection_matches_scalar()
+{
+	uint32_t seed = 1;
+	std::vector<frustum> frusta = create_frusta(seed);
+
+	// counts that do and don't fill whole vectors and mask words
+	for (int count : { 0, 1, 7, 64, 1000, 1003 })
+	{
+		BoxArrays boxes = create_boxes(seed, count);
+		box3_soa soa = boxes.view();
+		std::vector<uint32_t> mask((soa.count + 31) / 32 + 1);
+
+		for (const frustum& f : frusta)
+		{
+			for (simd_level level : { simd_level::scalar, simd_level::sse, simd_level::avx2, simd_level::best })
+			{
+				// the extra word past the end must not be touched
+				mask.back() = 0xdeadbeef;
+				f.intersectsWith(soa, mask.data(), level);
+				CHECK(mask.back() == 0xdeadbeef);
+
+				for (size_t i = 0; i < soa.count; i++)
+				{
+					box3 box(float3(soa.minX[i], soa.minY[i], soa.minZ[i]), float3(soa.maxX[i], soa.maxY[i], soa.maxZ[i]));
+					bool visible = (mask[i / 32] & (1u << (i % 32))) != 0;
+					CHECK(visible == f.intersectsWith(box));
+				}
+
+				// no bits are set past the last box
+				if (soa.count % 32)
+					CHECK((mask[soa.count / 32] >> (soa.count % 32)) == 0);
+			}
+		}
+	}
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_batch_intersection_matches_scalar();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
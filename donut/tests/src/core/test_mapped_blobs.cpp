@@ -0,0 +1,185 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/utils.h>
+#include <cstring>
+#include <limits>
+
+#ifdef DONUT_WITH_MINIZ
+#include <donut/core/vfs/ZipFile.h>
+#include <miniz.h>
+#include <miniz_zip.h>
+#endif
+
+using namespace donut;
+
+static std::vector<uint8_t> create_data(size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	for (auto& byte : data)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		byte = uint8_t(seed >> 24);
+	}
+	return data;
+}
+
+static bool blob_matches(const std::shared_ptr<vfs::IBlob>& blob, const std::vector<uint8_t>& data)
+{
+	return blob && blob->size() == data.size() && memcmp(blob->data(), data.data(), data.size()) == 0;
+}
+
+void test_native_file_mapping()
+{
+	const std::filesystem::path largePath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_mapped_large.bin";
+	const std::filesystem::path smallPath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_mapped_small.bin";
+	std::vector<uint8_t> largeData = create_data(200 * 1024, 1);
+	std::vector<uint8_t> smallData = create_data(100, 2);
+
+	vfs::NativeFileSystem fs;
+	CHECK(fs.writeFile(largePath, largeData.data(), largeData.size()));
+	CHECK(fs.writeFile(smallPath, smallData.data(), smallData.size()));
+
+	// large files are mapped, small files are read into memory
+	auto largeBlob = fs.readFile(largePath);
+	auto smallBlob = fs.readFile(smallPath);
+	CHECK(blob_matches(largeBlob, largeData));
+	CHECK(blob_matches(smallBlob, smallData));
+	CHECK(std::dynamic_pointer_cast<vfs::MappedFileBlob>(largeBlob) != nullptr);
+	CHECK(std::dynamic_pointer_cast<vfs::MappedFileBlob>(smallBlob) == nullptr);
+
+	fs.setMemoryMappingThreshold(std::numeric_limits<size_t>::max());
+	auto copiedBlob = fs.readFile(largePath);
+	CHECK(blob_matches(copiedBlob, largeData));
+	CHECK(std::dynamic_pointer_cast<vfs::MappedFileBlob>(copiedBlob) == nullptr);
+	fs.setMemoryMappingThreshold(64 * 1024);
+
+	// a region keeps the mapping alive
+	auto region = std::make_shared<vfs::BufferRegionBlob>(largeBlob, 1000, 5000);
+	largeBlob.reset();
+	CHECK(region->size() == 5000);
+	CHECK(memcmp(region->data(), largeData.data() + 1000, 5000) == 0);
+
+#ifndef WIN32
+	// overwriting a mapped file replaces it, the existing mapping keeps the old contents
+	std::vector<uint8_t> newData = create_data(70 * 1024, 3);
+	CHECK(fs.writeFile(largePath, newData.data(), newData.size()));
+	CHECK(memcmp(region->data(), largeData.data() + 1000, 5000) == 0);
+	CHECK(blob_matches(fs.readFile(largePath), newData));
+#endif
+
+	region.reset();
+
+	vfs::MappedFileBlob missing(std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_mapped_missing.bin");
+	CHECK(!missing.isOpen());
+
+	std::filesystem::remove(largePath);
+	std::filesystem::remove(smallPath);
+}
+
+void test_native_file_replacement()
+{
+	const std::filesystem::path directory = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_file_replacement";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	const std::filesystem::path path = directory / "file.bin";
+	std::vector<uint8_t> data = create_data(1000, 5);
+	std::vector<uint8_t> newData = create_data(2000, 6);
+
+	vfs::NativeFileSystem fs;
+	CHECK(fs.writeFile(path, data.data(), data.size()));
+	CHECK(!fs.writeFile(directory / "missing" / "file.bin", data.data(), data.size()));
+
+#ifndef WIN32
+	// the permissions of the replaced file are kept, and links are written through
+	const auto permissions = std::filesystem::perms::owner_read | std::filesystem::perms::owner_write | std::filesystem::perms::group_read;
+	std::filesystem::permissions(path, permissions);
+	const std::filesystem::path link = directory / "link.bin";
+	std::filesystem::create_symlink(path, link);
+
+	CHECK(fs.writeFile(link, newData.data(), newData.size()));
+	CHECK(std::filesystem::is_symlink(link));
+	CHECK(blob_matches(fs.readFile(path), newData));
+	CHECK(std::filesystem::status(path).permissions() == permissions);
+#endif
+
+	// no temporary files are left
+	for (const auto& entry : std::filesystem::directory_iterator(directory))
+		CHECK(entry.path().filename() == "file.bin" || entry.path().filename() == "link.bin");
+
+	std::filesystem::remove_all(directory);
+}
+
+#ifdef DONUT_WITH_MINIZ
+void test_zip_stored_files()
+{
+	const std::filesystem::path archivePath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_mapped_blobs.zip";
+	std::vector<uint8_t> storedData = create_data(300 * 1024, 4);
+	std::vector<uint8_t> deflatedData(100 * 1024, 7);
+
+	mz_zip_archive writer{};
+	CHECK(mz_zip_writer_init_file(&writer, archivePath.generic_string().c_str(), 0));
+	CHECK(mz_zip_writer_add_mem(&writer, "data/stored.bin", storedData.data(), storedData.size(), MZ_NO_COMPRESSION));
+	CHECK(mz_zip_writer_add_mem(&writer, "data/deflated.bin", deflatedData.data(), deflatedData.size(), MZ_DEFAULT_COMPRESSION));
+	CHECK(mz_zip_writer_finalize_archive(&writer));
+	CHECK(mz_zip_writer_end(&writer));
+
+	std::shared_ptr<vfs::IBlob> storedBlob;
+	{
+		vfs::ZipFile zip(archivePath);
+		CHECK(zip.isOpen());
+
+		storedBlob = zip.readFile("data/stored.bin");
+		CHECK(blob_matches(storedBlob, storedData));
+		CHECK(std::dynamic_pointer_cast<vfs::BufferRegionBlob>(storedBlob) != nullptr);
+
+		auto deflatedBlob = zip.readFile("data/deflated.bin");
+		CHECK(blob_matches(deflatedBlob, deflatedData));
+		CHECK(std::dynamic_pointer_cast<vfs::BufferRegionBlob>(deflatedBlob) == nullptr);
+	}
+
+	// the stored file outlives the archive object
+	CHECK(blob_matches(storedBlob, storedData));
+	storedBlob.reset();
+
+	std::filesystem::remove(archivePath);
+}
+#endif
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_native_file_mapping();
+		test_native_file_replacement();
+#ifdef DONUT_WITH_MINIZ
+		test_zip_stored_files();
+#endif
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
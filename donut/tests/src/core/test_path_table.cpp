@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/VFS.h>
+#include <donut/core/vfs/PathTable.h>
+#include <donut/tests/utils.h>
+
+using namespace donut;
+
+void test_normalization()
+{
+	const char* paths[] = {
+		"", ".", "..", "/", "//", "a", "a/", "a//", "/a", "//a", "///a/b",
+		"a/b", "a/./b", "./a", "a/.", "a/./", "./", ".//", "a/..", "a/../", "/..", "/../a",
+		"../a", "../../a/b", "../a/..", "a/../..", "a/b/../../..", "x/../../y", "/a/b/../c/./d/",
+		"a/b/..", "a/b/../", "..//a", "../", "/a/..", "media/./textures//wall.dds", "a/b/c/../../../..",
+		".a/..b/...", "a/.../b", "/media/../shaders/./x.bin",
+	};
+
+	for (const char* path : paths)
+	{
+		std::string expected = std::filesystem::path(path).lexically_normal().generic_string();
+		std::string normalized = vfs::normalizePath(path);
+		if (normalized != expected)
+			printf("normalizePath(\"%s\") = \"%s\", expected \"%s\"\n", path, normalized.c_str(), expected.c_str());
+		CHECK(normalized == expected);
+		CHECK(vfs::isNormalPath(path) == (expected == path));
+
+		vfs::NormalizedPath normalizedPath((std::filesystem::path(path)));
+		CHECK(normalizedPath.view() == expected);
+	}
+
+	CHECK(vfs::NormalizedPath(std::string_view("/a/b")).relative() == "a/b");
+	CHECK(vfs::NormalizedPath(std::string_view("a/./b")).relative() == "a/b");
+}
+
+void test_path_table()
+{
+	vfs::PathTable table;
+	CHECK(table.find("a") == vfs::PathTable::InvalidIndex);
+
+	for (int i = 0; i < 1000; i++)
+		CHECK(table.insert("dir/file" + std::to_string(i)) == uint32_t(i));
+
+	CHECK(table.size() == 1000);
+	CHECK(table.insert("dir/file123") == 123);
+	CHECK(table.size() == 1000);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		std::string path = "dir/file" + std::to_string(i);
+		CHECK(table.find(path) == uint32_t(i));
+		CHECK(table.getPath(i) == path);
+	}
+	CHECK(!table.contains("dir/file1000"));
+	CHECK(!table.contains("dir"));
+
+	table.clear();
+	CHECK(table.empty());
+	CHECK(!table.contains("dir/file1"));
+}
+
+// Records the last path that reached it.
+class RecordingFileSystem : public vfs::IFileSystem
+{
+public:
+	std::string lastPath;
+
+	bool folderExists(const std::filesystem::path& name) override { lastPath = name.generic_string(); return true; }
+	bool fileExists(const std::filesystem::path& name) override { lastPath = name.generic_string(); return true; }
+	std::shared_ptr<vfs::IBlob> readFile(const std::filesystem::path& name) override { lastPath = name.generic_string(); return nullptr; }
+	bool writeFile(const std::filesystem::path& name, const void*, size_t) override { lastPath = name.generic_string(); return false; }
+	int enumerateFiles(const std::filesystem::path&, const std::vector<std::string>&, vfs::enumerate_callback_t, bool) override { return 0; }
+	int enumerateDirectories(const std::filesystem::path&, vfs::enumerate_callback_t, bool) override { return 0; }
+};
+
+void test_mount_lookup()
+{
+	auto media = std::make_shared<RecordingFileSystem>();
+	auto textures = std::make_shared<RecordingFileSystem>();
+	auto shaders = std::make_shared<RecordingFileSystem>();
+
+	vfs::RootFileSystem root;
+	root.mount("/media/textures", textures);
+	root.mount("/media", media);
+	root.mount("/shaders/./donut", shaders);
+
+	// nested inside an existing mount point
+	root.mount("/media/textures/hd", std::make_shared<RecordingFileSystem>());
+
+	CHECK(root.fileExists("/media/model.gltf"));
+	CHECK(media->lastPath == "model.gltf");
+	CHECK(root.fileExists("/media/textures/wall.dds"));
+	CHECK(textures->lastPath == "wall.dds");
+	CHECK(root.fileExists("/media/textures/hd/wall.dds"));
+	CHECK(textures->lastPath == "hd/wall.dds");
+	CHECK(root.fileExists("/media/../media/./textures//a/../wall.dds"));
+	CHECK(textures->lastPath == "wall.dds");
+	CHECK(root.fileExists("/shaders/donut/x.bin"));
+	CHECK(shaders->lastPath == "x.bin");
+	CHECK(root.folderExists("/media"));
+	CHECK(media->lastPath == "");
+
+	CHECK(!root.fileExists("/mediax/model.gltf"));
+	CHECK(!root.fileExists("/shaders/x.bin"));
+	CHECK(!root.fileExists("media/model.gltf"));
+
+	CHECK(root.unmount("/media/./textures"));
+	CHECK(!root.unmount("/media/textures"));
+	CHECK(root.fileExists("/media/textures/wall.dds"));
+	CHECK(media->lastPath == "textures/wall.dds");
+}
+
+void test_relative_file_system()
+{
+	auto recorder = std::make_shared<RecordingFileSystem>();
+
+	vfs::RelativeFileSystem relative(recorder, "base/./dir/");
+	CHECK(relative.fileExists("/a/b.txt"));
+	CHECK(recorder->lastPath == "base/dir/a/b.txt");
+	CHECK(relative.fileExists("a/./c/../b.txt"));
+	CHECK(recorder->lastPath == "base/dir/a/b.txt");
+	CHECK(relative.folderExists(""));
+	CHECK(recorder->lastPath == "base/dir/");
+
+	vfs::RelativeFileSystem unrooted(recorder, "");
+	CHECK(unrooted.fileExists("/a/b.txt"));
+	CHECK(recorder->lastPath == "a/b.txt");
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_normalization();
+		test_path_table();
+		test_mount_lookup();
+		test_relative_file_system();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
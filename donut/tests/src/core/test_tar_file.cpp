@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/core/vfs/TarFile.h>
+#include <donut/tests/utils.h>
+#include <cstring>
+#include <thread>
+
+using namespace donut;
+
+struct TestEntry
+{
+	std::string name;
+	std::vector<uint8_t> data;
+};
+
+// Writes a minimal ustar archive with the given regular files.
+static void write_tar(const std::filesystem::path& path, const std::vector<TestEntry>& entries)
+{
+	FILE* file = fopen(path.generic_string().c_str(), "wb");
+	CHECK(file != nullptr);
+
+	for (const auto& entry : entries)
+	{
+		char header[512] = {};
+		strncpy(header, entry.name.c_str(), 100);
+		snprintf(header + 100, 8, "%07o", 0644);
+		snprintf(header + 124, 12, "%011llo", (unsigned long long)entry.data.size());
+		header[156] = '0';
+		memcpy(header + 257, "ustar", 6);
+		fwrite(header, 1, sizeof(header), file);
+
+		fwrite(entry.data.data(), 1, entry.data.size(), file);
+		size_t padding = (512 - entry.data.size() % 512) % 512;
+		std::vector<char> zeros(padding, 0);
+		fwrite(zeros.data(), 1, zeros.size(), file);
+	}
+
+	// end of archive marker
+	std::vector<char> zeros(1024, 0);
+	fwrite(zeros.data(), 1, zeros.size(), file);
+	fclose(file);
+}
+
+static std::vector<TestEntry> create_entries()
+{
+	std::vector<TestEntry> entries;
+	uint32_t seed = 1;
+	for (int i = 0; i < 64; i++)
+	{
+		TestEntry entry;
+		entry.name = "dir" + std::to_string(i % 4) + "/file" + std::to_string(i) + ".bin";
+		entry.data.resize(size_t(i) * 997 + 1);
+		for (auto& byte : entry.data)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			byte = uint8_t(seed >> 24);
+		}
+		entries.push_back(std::move(entry));
+	}
+	return entries;
+}
+
+static bool blob_matches(const std::shared_ptr<vfs::IBlob>& blob, const std::vector<uint8_t>& data)
+{
+	return blob && blob->size() == data.size() && memcmp(blob->data(), data.data(), data.size()) == 0;
+}
+
+void test_tar_read_modes()
+{
+	std::filesystem::path archivePath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "test_tar_read_modes.tar";
+	std::vector<TestEntry> entries = create_entries();
+	write_tar(archivePath, entries);
+
+	for (auto mode : { vfs::TarFile::ReadMode::Buffered, vfs::TarFile::ReadMode::Positional, vfs::TarFile::ReadMode::MemoryMapped })
+	{
+		auto tar = std::make_shared<vfs::TarFile>(archivePath, mode);
+		CHECK(tar->isOpen());
+		CHECK(tar->getReadMode() == mode);
+		CHECK(tar->folderExists("dir2"));
+		CHECK(tar->fileExists("dir1/file5.bin"));
+		CHECK(tar->readFile("dir1/missing.bin") == nullptr);
+
+		// read every file from several threads at once
+		std::vector<std::thread> threads;
+		std::vector<int> failures(4, 0);
+		for (int thread = 0; thread < 4; thread++)
+		{
+			threads.emplace_back([&, thread]()
+			{
+				for (int repeat = 0; repeat < 10; repeat++)
+				{
+					for (size_t i = thread; i < entries.size(); i++)
+					{
+						if (!blob_matches(tar->readFile(entries[i].name), entries[i].data))
+							++failures[thread];
+					}
+				}
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+
+		for (int count : failures)
+			CHECK(count == 0);
+
+		// mapped blobs alias the archive and stay valid after the file system is gone
+		auto blob = tar->readFile(entries[10].name);
+		auto blob2 = tar->readFile(entries[10].name);
+		bool aliased = blob->data() == blob2->data();
+		CHECK(aliased == (mode == vfs::TarFile::ReadMode::MemoryMapped));
+
+		tar.reset();
+		CHECK(blob_matches(blob, entries[10].data));
+	}
+
+	std::filesystem::remove(archivePath);
+}
+
+void test_tar_missing_archive()
+{
+	vfs::TarFile tar(std::filesystem::path(DONUT_TEST_BINARY_DIR) / "missing.tar", vfs::TarFile::ReadMode::MemoryMapped);
+	CHECK(!tar.isOpen());
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_tar_read_modes();
+		test_tar_missing_archive();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,205 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/BlockCompression.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MemoryFileSystem.h>
+#include <donut/tests/benchmark.h>
+#include <stb_image_write.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Measures the throughput and quality of the block compression formats on a photo-like color image and
+// a normal map, and the load time of a PNG texture with compression against loading it from the DDS cache.
+// Usage: bench_block_compression [image size]
+
+class BenchTextureCache : public TextureCache
+{
+public:
+	BenchTextureCache(std::shared_ptr<vfs::IFileSystem> fs) : TextureCache(nullptr, fs, nullptr)
+	{
+		SetInfoLogSeverity(log::Severity::None);
+	}
+
+	bool Load(const std::shared_ptr<vfs::IBlob>& file)
+	{
+		auto texture = CreateTextureData();
+		texture->forceSRGB = true;
+		return FillTextureData(file, texture, ".png", "");
+	}
+};
+
+static void write_to_vector(void* context, void* data, int size)
+{
+	auto& file = *static_cast<std::vector<uint8_t>*>(context);
+	file.insert(file.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+}
+
+static std::shared_ptr<vfs::IBlob> make_blob(const std::vector<uint8_t>& file)
+{
+	void* data = malloc(file.size());
+	memcpy(data, file.data(), file.size());
+	return std::make_shared<vfs::Blob>(data, file.size());
+}
+
+static double compute_psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int channels)
+{
+	double error = 0.0;
+	for (size_t i = 0; i < a.size(); i += 4)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			const double d = double(a[i + c]) - double(b[i + c]);
+			error += d * d;
+		}
+	}
+	error /= double(a.size() / 4) * channels;
+	return error == 0.0 ? 100.0 : 10.0 * log10(255.0 * 255.0 / error);
+}
+
+int main(int argc, char** argv)
+{
+	const int size = (argc > 1) ? atoi(argv[1]) : 1024;
+	const double megapixels = double(size) * double(size) / 1e6;
+
+	// smooth gradients with some noise, and a normal map of bumps with its X and Y in the red and green channels
+	std::vector<uint8_t> color(size_t(size) * size * 4);
+	std::vector<uint8_t> normals(size_t(size) * size * 4);
+	uint32_t seed = 1;
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const int noise = int(seed >> 28) - 8;
+			uint8_t* pixel = &color[(size_t(y) * size + x) * 4];
+			pixel[0] = uint8_t(std::clamp(x * 255 / size + noise, 0, 255));
+			pixel[1] = uint8_t(std::clamp(y * 255 / size + noise, 0, 255));
+			pixel[2] = uint8_t(std::clamp(int(127.f + 127.f * sinf(float(x + y) * 0.01f)) + noise, 0, 255));
+			pixel[3] = uint8_t(std::clamp(int(127.f + 127.f * cosf(float(x - y) * 0.02f)), 0, 255));
+
+			const float nx = 0.5f * cosf(float(x) * 0.1f) * sinf(float(y) * 0.07f);
+			const float ny = 0.5f * sinf(float(x) * 0.1f) * cosf(float(y) * 0.07f);
+			uint8_t* normal = &normals[(size_t(y) * size + x) * 4];
+			normal[0] = uint8_t(127.5f + 127.f * nx);
+			normal[1] = uint8_t(127.5f + 127.f * ny);
+			normal[2] = uint8_t(127.5f + 127.f * sqrtf(1.f - nx * nx - ny * ny));
+			normal[3] = 255;
+		}
+	}
+
+	printf("%d x %d image\n", size, size);
+
+	struct Case
+	{
+		const char* name;
+		nvrhi::Format format;
+		const std::vector<uint8_t>& pixels;
+		int channels; // the channels that the format stores
+	};
+
+	const Case cases[] = {
+		{ "BC1 color",  nvrhi::Format::BC1_UNORM, color,   3 },
+		{ "BC3 color",  nvrhi::Format::BC3_UNORM, color,   4 },
+		{ "BC7 color",  nvrhi::Format::BC7_UNORM, color,   4 },
+		{ "BC4 normal", nvrhi::Format::BC4_UNORM, normals, 1 },
+		{ "BC5 normal", nvrhi::Format::BC5_UNORM, normals, 2 },
+		{ "BC7 normal", nvrhi::Format::BC7_UNORM, normals, 4 },
+	};
+
+#ifdef DONUT_WITH_TASKFLOW
+	tf::Executor executor;
+#endif
+
+	const int iterations = 5;
+	std::vector<uint8_t> blocks(size_t(size) * size);
+	std::vector<uint8_t> decoded(size_t(size) * size * 4);
+	for (const Case& c : cases)
+	{
+		char name[64];
+		double time = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			CompressImage(c.format, c.pixels.data(), size, size, size_t(size) * 4, 4, blocks.data());
+		});
+		snprintf(name, sizeof(name), "%s: 1 thread", c.name);
+		PrintBenchmarkResult(name, time);
+
+#ifdef DONUT_WITH_TASKFLOW
+		time = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			CompressImage(c.format, c.pixels.data(), size, size, size_t(size) * 4, 4, blocks.data(), &executor);
+		});
+		snprintf(name, sizeof(name), "%s: %zu threads", c.name, executor.num_workers());
+		PrintBenchmarkResult(name, time);
+#endif
+
+		DecompressImage(c.format, blocks.data(), size, size, decoded.data());
+		printf("%-48s %10.1f MPix/s, PSNR %.2f dB\n", c.name, megapixels / (time * 1e-3), compute_psnr(c.pixels, decoded, c.channels));
+	}
+
+	// a texture load with the mip chain and compression, then the same texture from the cache
+	std::vector<uint8_t> png;
+	stbi_write_png_to_func(write_to_vector, &png, size, size, 4, color.data(), size * 4);
+
+	auto fs = std::make_shared<MemoryFileSystem>();
+	TextureCompressionSettings settings;
+
+	for (bool useBC7 : { false, true })
+	{
+		settings.useBC7ForColor = useBC7;
+
+		double coldTime = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			fs->files.clear();
+			BenchTextureCache cache(fs);
+			cache.EnableTextureCompression(settings);
+			cache.EnableProcessedTextureCache("/cache");
+			cache.Load(make_blob(png));
+		});
+
+		double cachedTime = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			BenchTextureCache cache(fs);
+			cache.EnableTextureCompression(settings);
+			cache.EnableProcessedTextureCache("/cache");
+			cache.Load(make_blob(png));
+		});
+
+		char name[64];
+		snprintf(name, sizeof(name), "load PNG + mips + %s", useBC7 ? "BC7" : "BC1/BC3");
+		PrintBenchmarkResult(name, coldTime);
+		snprintf(name, sizeof(name), "load PNG + mips + %s, cached", useBC7 ? "BC7" : "BC1/BC3");
+		PrintBenchmarkResult(name, cachedTime);
+	}
+
+	return 0;
+}
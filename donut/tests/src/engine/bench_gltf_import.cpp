@@ -0,0 +1,175 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/GltfImporter.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Measures the glTF import of a synthetic model made of many grid primitives without tangents,
+// so that the importer converts all attributes and generates the tangents, serially and on an executor.
+// test_gltf_import checks that both produce identical meshes.
+// Usage: bench_gltf_import [triangle count] [primitive count] [worker count]
+
+static const std::filesystem::path g_DataPath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "gltf_import_bench";
+
+static void write_model(vfs::IFileSystem& fs, size_t triangleCount, int primitiveCount)
+{
+	// square grids with 2 * (size - 1)^2 triangles each
+	const int gridSize = std::max(2, int(sqrt(double(triangleCount) / (2.0 * primitiveCount))) + 1);
+	const size_t vertexCount = size_t(gridSize) * gridSize;
+	const size_t indexCount = size_t(gridSize - 1) * (gridSize - 1) * 6;
+
+	std::vector<uint8_t> buffer;
+	auto append = [&buffer](const void* data, size_t bytes)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + bytes);
+		memcpy(buffer.data() + offset, data, bytes);
+		return offset;
+	};
+
+	std::vector<uint32_t> indices;
+	indices.reserve(indexCount);
+	for (int y = 0; y < gridSize - 1; y++)
+	{
+		for (int x = 0; x < gridSize - 1; x++)
+		{
+			uint32_t i = uint32_t(y * gridSize + x);
+			indices.insert(indices.end(), { i, i + uint32_t(gridSize), i + 1, i + 1, i + uint32_t(gridSize), i + uint32_t(gridSize) + 1 });
+		}
+	}
+	const size_t indexOffset = append(indices.data(), indices.size() * sizeof(uint32_t));
+
+	std::string bufferViews;
+	std::string accessors;
+	std::string primitives;
+
+	for (int primitive = 0; primitive < primitiveCount; primitive++)
+	{
+		std::vector<float> vertices;
+		vertices.reserve(vertexCount * 8);
+		for (int y = 0; y < gridSize; y++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				float u = float(x) / float(gridSize - 1);
+				float v = float(y) / float(gridSize - 1);
+				// interleaved position, normal and texture coordinates
+				vertices.insert(vertices.end(), { u + float(primitive), 0.1f * sinf(u * 20.f) * cosf(v * 20.f), v, 0.f, 1.f, 0.f, u, v });
+			}
+		}
+		const size_t vertexOffset = append(vertices.data(), vertices.size() * sizeof(float));
+
+		int view = primitive;
+		int accessor = primitive * 3;
+		bufferViews += std::string(primitive ? ", " : "") + "{ \"buffer\": 0, \"byteOffset\": " + std::to_string(vertexOffset)
+			+ ", \"byteLength\": " + std::to_string(vertices.size() * sizeof(float)) + ", \"byteStride\": 32 }";
+		accessors += std::string(primitive ? ", " : "")
+			+ "{ \"bufferView\": " + std::to_string(view) + ", \"componentType\": 5126, \"count\": " + std::to_string(vertexCount) + ", \"type\": \"VEC3\", "
+			+ "\"min\": [ " + std::to_string(primitive) + ", -0.1, 0 ], \"max\": [ " + std::to_string(primitive + 1) + ", 0.1, 1 ] }, "
+			+ "{ \"bufferView\": " + std::to_string(view) + ", \"byteOffset\": 12, \"componentType\": 5126, \"count\": " + std::to_string(vertexCount) + ", \"type\": \"VEC3\" }, "
+			+ "{ \"bufferView\": " + std::to_string(view) + ", \"byteOffset\": 24, \"componentType\": 5126, \"count\": " + std::to_string(vertexCount) + ", \"type\": \"VEC2\" }";
+		primitives += std::string(primitive ? ", " : "")
+			+ "{ \"attributes\": { \"POSITION\": " + std::to_string(accessor) + ", \"NORMAL\": " + std::to_string(accessor + 1)
+			+ ", \"TEXCOORD_0\": " + std::to_string(accessor + 2) + " }, \"indices\": " + std::to_string(primitiveCount * 3) + " }";
+	}
+
+	bufferViews += ", { \"buffer\": 0, \"byteOffset\": " + std::to_string(indexOffset) + ", \"byteLength\": " + std::to_string(indices.size() * sizeof(uint32_t)) + " }";
+	accessors += ", { \"bufferView\": " + std::to_string(primitiveCount) + ", \"componentType\": 5125, \"count\": " + std::to_string(indexCount) + ", \"type\": \"SCALAR\" }";
+
+	std::string gltf = std::string("{ \"asset\": { \"version\": \"2.0\" }, \"scene\": 0, \"scenes\": [ { \"nodes\": [ 0 ] } ], ")
+		+ "\"nodes\": [ { \"mesh\": 0 } ], \"meshes\": [ { \"primitives\": [ " + primitives + " ] } ], "
+		+ "\"buffers\": [ { \"uri\": \"model.bin\", \"byteLength\": " + std::to_string(buffer.size()) + " } ], "
+		+ "\"bufferViews\": [ " + bufferViews + " ], \"accessors\": [ " + accessors + " ] }";
+
+	fs.writeFile(g_DataPath / "model.gltf", gltf.data(), gltf.size());
+	fs.writeFile(g_DataPath / "model.bin", buffer.data(), buffer.size());
+
+	printf("%d primitives, %zu triangles\n", primitiveCount, indexCount / 3 * primitiveCount);
+}
+
+int main(int argc, char** argv)
+{
+	size_t triangleCount = (argc > 1) ? size_t(atoll(argv[1])) : 2000000;
+	int primitiveCount = (argc > 2) ? std::max(1, atoi(argv[2])) : 64;
+	const int iterations = 3;
+
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	std::filesystem::create_directories(g_DataPath);
+	write_model(*fs, triangleCount, primitiveCount);
+
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+
+	SceneImportResult serialResult;
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		importer.Load(g_DataPath / "model.gltf", textureCache, stats, nullptr, serialResult);
+	});
+	PrintBenchmarkResult("import, serial", time);
+
+	// logs the vertex cache statistics of the mesh
+	GltfImporter optimizingImporter(fs, std::make_shared<SceneTypeFactory>());
+	optimizingImporter.SetMeshOptimizationEnabled(true);
+	time = MeasureMedianMilliseconds(1, [&]()
+	{
+		SceneImportResult result;
+		optimizingImporter.Load(g_DataPath / "model.gltf", textureCache, stats, nullptr, result);
+	});
+	PrintBenchmarkResult("import, serial, optimized meshes", time);
+
+#ifdef DONUT_WITH_TASKFLOW
+	const size_t workerCount = (argc > 3) ? size_t(std::max(1, atoi(argv[3]))) : std::thread::hardware_concurrency();
+	tf::Executor executor(workerCount);
+	SceneImportResult parallelResult;
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		importer.Load(g_DataPath / "model.gltf", textureCache, stats, &executor, parallelResult);
+	});
+	char name[128];
+	snprintf(name, sizeof(name), "import, executor with %zu workers", executor.num_workers());
+	PrintBenchmarkResult(name, time);
+
+	// the import itself running on a worker, like in Scene::LoadWithExecutor
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		executor.async([&]() { importer.Load(g_DataPath / "model.gltf", textureCache, stats, &executor, parallelResult); }).wait();
+	});
+	PrintBenchmarkResult("import, executor, called from a worker", time);
+#endif
+
+	return 0;
+}
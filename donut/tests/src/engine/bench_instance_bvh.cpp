@@ -0,0 +1,144 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/InstanceBvh.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Compares frustum culling of a procedurally generated instance field by walking the scene graph
+// (like InstancedOpaqueDrawStrategy does) with culling through an InstanceBvh.
+// Usage: bench_instance_bvh [instance count]
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+static size_t cull_with_walker(SceneGraphNode* root, const dm::frustum& frustum)
+{
+	size_t visibleCount = 0;
+
+	SceneGraphWalker walker(root);
+	while (walker)
+	{
+		bool nodeVisible = frustum.intersectsWith(walker->GetGlobalBoundingBox());
+		if (nodeVisible && walker->GetLeaf())
+			++visibleCount;
+
+		walker.Next(nodeVisible);
+	}
+
+	return visibleCount;
+}
+
+int main(int argc, char** argv)
+{
+	int instanceCount = (argc > 1) ? atoi(argv[1]) : 100000;
+
+	auto material = std::make_shared<Material>();
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	// a flat field of instances under one node, as produced by many glTF exporters
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	const float fieldSize = 20.f * sqrtf(float(instanceCount));
+	uint32_t seed = 1;
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+	for (int i = 0; i < instanceCount; i++)
+	{
+		auto node = graph->AttachLeafNode(root, std::make_shared<MeshInstance>(mesh));
+		node->SetTranslation(dm::double3(random_float(seed), random_float(seed) * 0.05f, random_float(seed)) * double(fieldSize));
+		nodes.push_back(node);
+	}
+	graph->Refresh(0);
+
+	printf("Instance field with %d instances\n", instanceCount);
+
+	std::vector<PlanarView> views(16);
+	for (auto& view : views)
+	{
+		dm::float3 eye = dm::float3(random_float(seed), 0.02f, random_float(seed)) * fieldSize;
+		dm::affine3 cameraToWorld = dm::rotation(dm::float3(0.f, 1.f, 0.f), random_float(seed) * 6.28f) * dm::translation(eye);
+		view.SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(60.f), 16.f / 9.f, 0.1f, 500.f));
+		view.UpdateCache();
+	}
+
+	const int iterations = 10;
+	size_t walkerVisible = 0;
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		walkerVisible = 0;
+		for (const auto& view : views)
+			walkerVisible += cull_with_walker(root.get(), view.GetViewFrustum());
+	});
+	PrintBenchmarkResult("walker: cull 16 views", time);
+
+	InstanceBvh bvh;
+	time = MeasureMedianMilliseconds(iterations, [&]() { bvh.Build(graph->GetMeshInstances()); });
+	PrintBenchmarkResult("bvh: build", time);
+	printf("bvh: %d nodes, SAH cost %.4f\n", int(bvh.GetNodes().size()), bvh.ComputeCost());
+
+	std::vector<MeshInstance*> visible;
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		visible.clear();
+		for (const auto& view : views)
+			bvh.Cull(view, visible);
+	});
+	PrintBenchmarkResult("bvh: cull 16 views", time);
+
+	if (visible.size() != walkerVisible)
+		printf("WARNING: the walker found %d visible instances, the BVH found %d\n", int(walkerVisible), int(visible.size()));
+
+	time = MeasureMedianMilliseconds(iterations, [&]() { bvh.Refit({}); });
+	PrintBenchmarkResult("bvh: refit all instances", time);
+
+	uint32_t frameIndex = 1;
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		for (int i = 0; i < instanceCount / 100; i++)
+		{
+			const auto& node = nodes[uint32_t(random_float(seed) * float(instanceCount)) % instanceCount];
+			node->SetTranslation(node->GetTranslation() + dm::double3(1.0, 0.0, 0.0));
+		}
+		bool transformsChanged = graph->HasPendingTransformChanges();
+		graph->Refresh(frameIndex++);
+		bvh.Update(*graph, false, transformsChanged);
+	});
+	PrintBenchmarkResult("scene graph refresh + bvh update, 1% moved", time);
+
+	return 0;
+}
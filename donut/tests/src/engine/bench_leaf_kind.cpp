@@ -0,0 +1,138 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Measures the culling walk that the draw strategies do over a large scene graph, finding the mesh instances
+// with dynamic_cast (as before the leaf kind tags) and with SceneGraphLeaf::AsMeshInstance.
+// Usage: bench_leaf_kind [instance count]
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+template<typename CastFunction>
+static size_t cull(SceneGraphNode* root, const dm::frustum& frustum, CastFunction&& cast)
+{
+	const SceneContentFlags relevantContent = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes;
+	size_t geometryCount = 0;
+
+	SceneGraphWalker walker(root);
+	while (walker)
+	{
+		bool nodeVisible = false;
+		if ((walker->GetSubgraphContentFlags() & relevantContent) != 0)
+		{
+			nodeVisible = frustum.intersectsWith(walker->GetGlobalBoundingBox());
+
+			if (nodeVisible && (walker->GetLeafContentFlags() & relevantContent) != 0)
+			{
+				if (MeshInstance* meshInstance = cast(walker->GetLeaf().get()))
+					geometryCount += meshInstance->GetMesh()->geometries.size();
+			}
+		}
+
+		walker.Next(nodeVisible);
+	}
+
+	return geometryCount;
+}
+
+int main(int argc, char** argv)
+{
+	int instanceCount = (argc > 1) ? atoi(argv[1]) : 200000;
+
+	auto material = std::make_shared<Material>();
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	// groups of 16 instances, like objects made of several parts
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	const float fieldSize = 20.f * sqrtf(float(instanceCount));
+	uint32_t seed = 1;
+	std::shared_ptr<SceneGraphNode> group;
+	for (int i = 0; i < instanceCount; i++)
+	{
+		if (i % 16 == 0)
+		{
+			group = std::make_shared<SceneGraphNode>();
+			graph->Attach(root, group);
+			group->SetTranslation(dm::double3(random_float(seed), 0.0, random_float(seed)) * double(fieldSize));
+		}
+
+		auto node = graph->AttachLeafNode(group, std::make_shared<MeshInstance>(mesh));
+		node->SetTranslation(dm::double3(random_float(seed), random_float(seed), random_float(seed)) * 10.0);
+	}
+	graph->Refresh(0);
+
+	printf("Scene graph with %d instances\n", instanceCount);
+
+	std::vector<PlanarView> views(8);
+	for (auto& view : views)
+	{
+		dm::float3 eye = dm::float3(random_float(seed), 0.02f, random_float(seed)) * fieldSize;
+		dm::affine3 cameraToWorld = dm::rotation(dm::float3(0.f, 1.f, 0.f), random_float(seed) * 6.28f) * dm::translation(eye);
+		view.SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(60.f), 16.f / 9.f, 0.1f, fieldSize));
+		view.UpdateCache();
+	}
+
+	const int iterations = 10;
+	size_t visibleWithRtti = 0;
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		visibleWithRtti = 0;
+		for (const auto& view : views)
+			visibleWithRtti += cull(root.get(), view.GetViewFrustum(), [](SceneGraphLeaf* leaf) { return dynamic_cast<MeshInstance*>(leaf); });
+	});
+	PrintBenchmarkResult("dynamic_cast: cull 8 views", time);
+
+	size_t visibleWithTags = 0;
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		visibleWithTags = 0;
+		for (const auto& view : views)
+			visibleWithTags += cull(root.get(), view.GetViewFrustum(), [](SceneGraphLeaf* leaf) { return leaf->AsMeshInstance(); });
+	});
+	PrintBenchmarkResult("AsMeshInstance: cull 8 views", time);
+
+	printf("%d visible geometries\n", int(visibleWithTags));
+	if (visibleWithRtti != visibleWithTags)
+		printf("WARNING: the results are different\n");
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MemoryFileSystem.h>
+#include <donut/tests/benchmark.h>
+#include <stb_image_write.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Loads a set of PNG textures like a scene does, first with an empty processed texture cache and then from the cache,
+// and reports the load times and the time that the cache reports as saved.
+// Usage: bench_processed_texture_cache [texture count] [texture size]
+
+static void write_to_vector(void* context, void* data, int size)
+{
+	auto& file = *static_cast<std::vector<uint8_t>*>(context);
+	file.insert(file.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+}
+
+int main(int argc, char** argv)
+{
+	const int count = (argc > 1) ? atoi(argv[1]) : 8;
+	const int size = (argc > 2) ? atoi(argv[2]) : 1024;
+
+	auto fs = std::make_shared<MemoryFileSystem>();
+	std::vector<std::filesystem::path> paths;
+
+	// smooth gradients with some noise, different in every texture
+	std::vector<uint8_t> pixels(size_t(size) * size * 3);
+	uint32_t seed = 1;
+	for (int index = 0; index < count; index++)
+	{
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				const int noise = int(seed >> 28) - 8;
+				uint8_t* pixel = &pixels[(size_t(y) * size + x) * 3];
+				pixel[0] = uint8_t(std::clamp((x + index * 16) * 255 / size + noise, 0, 255));
+				pixel[1] = uint8_t(std::clamp(y * 255 / size + noise, 0, 255));
+				pixel[2] = uint8_t(std::clamp(int(127.f + 127.f * sinf(float(x + y + index) * 0.01f)) + noise, 0, 255));
+			}
+		}
+
+		paths.push_back("/textures/texture" + std::to_string(index) + ".png");
+		std::vector<uint8_t> png;
+		stbi_write_png_to_func(write_to_vector, &png, size, size, 3, pixels.data(), size * 3);
+		fs->setFile(paths.back(), std::move(png));
+	}
+
+	printf("%d textures, %d x %d\n", count, size, size);
+
+	const int iterations = 3;
+	for (bool compression : { false, true })
+	{
+		ProcessedTextureCacheStats coldStats;
+		ProcessedTextureCacheStats cachedStats;
+
+		auto loadScene = [&](ProcessedTextureCacheStats& stats)
+		{
+			TextureCache cache(nullptr, fs, nullptr);
+			cache.SetInfoLogSeverity(log::Severity::None);
+			if (compression)
+				cache.EnableTextureCompression(TextureCompressionSettings());
+			cache.EnableProcessedTextureCache("/cache");
+
+			for (const auto& path : paths)
+				cache.LoadTextureFromFileDeferred(path, true);
+
+			stats = cache.GetProcessedTextureCacheStats();
+		};
+
+		const double coldTime = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			for (auto it = fs->files.begin(); it != fs->files.end(); )
+				it = it->first.rfind("/cache/", 0) == 0 ? fs->files.erase(it) : std::next(it);
+			loadScene(coldStats);
+		});
+
+		const double cachedTime = MeasureMedianMilliseconds(iterations, [&]() { loadScene(cachedStats); });
+
+		const char* mode = compression ? "mips + BC1" : "mips";
+		char name[64];
+		snprintf(name, sizeof(name), "%s: first load", mode);
+		PrintBenchmarkResult(name, coldTime);
+		snprintf(name, sizeof(name), "%s: cached load", mode);
+		PrintBenchmarkResult(name, cachedTime);
+		printf("%-48s %10.3f ms of processing thread time, %u hits\n", mode,
+			coldStats.processingThreadSeconds * 1e3, cachedStats.hits);
+	}
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/GltfImporter.h>
+#include <donut/engine/SceneCache.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Measures loading a large glTF grid mesh with the glTF importer alone, through an empty scene cache
+// (import and save, the cold start) and from the scene cache (the warm start).
+// Usage: bench_scene_cache [grid size]
+
+static const std::filesystem::path g_DataPath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "scene_cache_bench";
+
+static void write_grid_model(vfs::IFileSystem& fs, int size)
+{
+	const size_t vertexCount = size_t(size) * size;
+	const size_t indexCount = size_t(size - 1) * (size - 1) * 6;
+
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<float> texcoords;
+	positions.reserve(vertexCount * 3);
+	normals.reserve(vertexCount * 3);
+	texcoords.reserve(vertexCount * 2);
+
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			float u = float(x) / float(size - 1);
+			float v = float(y) / float(size - 1);
+			positions.insert(positions.end(), { u, 0.1f * sinf(u * 20.f) * cosf(v * 20.f), v });
+			normals.insert(normals.end(), { 0.f, 1.f, 0.f });
+			texcoords.insert(texcoords.end(), { u, v });
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	indices.reserve(indexCount);
+	for (int y = 0; y < size - 1; y++)
+	{
+		for (int x = 0; x < size - 1; x++)
+		{
+			uint32_t i = uint32_t(y * size + x);
+			indices.insert(indices.end(), { i, i + uint32_t(size), i + 1, i + 1, i + uint32_t(size), i + uint32_t(size) + 1 });
+		}
+	}
+
+	std::vector<uint8_t> buffer;
+	auto append = [&buffer](const void* data, size_t bytes)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + bytes);
+		memcpy(buffer.data() + offset, data, bytes);
+		return offset;
+	};
+	size_t positionOffset = append(positions.data(), positions.size() * sizeof(float));
+	size_t normalOffset = append(normals.data(), normals.size() * sizeof(float));
+	size_t texcoordOffset = append(texcoords.data(), texcoords.size() * sizeof(float));
+	size_t indexOffset = append(indices.data(), indices.size() * sizeof(uint32_t));
+
+	char gltf[4096];
+	snprintf(gltf, sizeof(gltf), R"({
+		"asset": { "version": "2.0" },
+		"scene": 0,
+		"scenes": [ { "nodes": [ 0 ] } ],
+		"nodes": [ { "name": "grid", "mesh": 0 } ],
+		"meshes": [ { "primitives": [ { "attributes": { "POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2 }, "indices": 3, "material": 0 } ] } ],
+		"materials": [ { "name": "grid" } ],
+		"buffers": [ { "uri": "grid.bin", "byteLength": %zu } ],
+		"bufferViews": [
+			{ "buffer": 0, "byteOffset": %zu, "byteLength": %zu },
+			{ "buffer": 0, "byteOffset": %zu, "byteLength": %zu },
+			{ "buffer": 0, "byteOffset": %zu, "byteLength": %zu },
+			{ "buffer": 0, "byteOffset": %zu, "byteLength": %zu }
+		],
+		"accessors": [
+			{ "bufferView": 0, "componentType": 5126, "count": %zu, "type": "VEC3", "min": [ 0, -0.1, 0 ], "max": [ 1, 0.1, 1 ] },
+			{ "bufferView": 1, "componentType": 5126, "count": %zu, "type": "VEC3" },
+			{ "bufferView": 2, "componentType": 5126, "count": %zu, "type": "VEC2" },
+			{ "bufferView": 3, "componentType": 5125, "count": %zu, "type": "SCALAR" }
+		]
+	})", buffer.size(),
+		positionOffset, positions.size() * sizeof(float),
+		normalOffset, normals.size() * sizeof(float),
+		texcoordOffset, texcoords.size() * sizeof(float),
+		indexOffset, indices.size() * sizeof(uint32_t),
+		vertexCount, vertexCount, vertexCount, indexCount);
+
+	fs.writeFile(g_DataPath / "grid.gltf", gltf, strlen(gltf));
+	fs.writeFile(g_DataPath / "grid.bin", buffer.data(), buffer.size());
+}
+
+int main(int argc, char** argv)
+{
+	int gridSize = (argc > 1) ? std::max(2, atoi(argv[1])) : 1024;
+	const int iterations = 5;
+
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	std::filesystem::create_directories(g_DataPath);
+	write_grid_model(*fs, gridSize);
+	printf("Grid mesh with %d vertices\n", gridSize * gridSize);
+
+	const std::filesystem::path modelFileName = g_DataPath / "grid.gltf";
+	auto sceneCache = std::make_shared<SceneCache>(fs, g_DataPath);
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+
+	GltfImporter plainImporter(fs, std::make_shared<SceneTypeFactory>());
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		SceneImportResult result;
+		plainImporter.Load(modelFileName, textureCache, stats, nullptr, result);
+	});
+	PrintBenchmarkResult("glTF import", time);
+
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+	importer.SetSceneCache(sceneCache);
+
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		std::filesystem::remove(sceneCache->GetCacheFileName(modelFileName));
+		SceneImportResult result;
+		importer.Load(modelFileName, textureCache, stats, nullptr, result);
+	});
+	PrintBenchmarkResult("cold: glTF import and cache save", time);
+
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		SceneImportResult result;
+		importer.Load(modelFileName, textureCache, stats, nullptr, result);
+	});
+	PrintBenchmarkResult("warm: scene cache hit", time);
+
+	printf("%u hits, %u misses\n", sceneCache->GetHitCount(), sceneCache->GetMissCount());
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/SceneGraph.h>
+#include <donut/tests/benchmark.h>
+#include <cstdlib>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Compares SceneGraph::Refresh with the recursive walker (serial and parallel) and with the flat hierarchy
+// on a large graph, for a few typical update patterns.
+// Usage: bench_scene_graph [node count]
+
+static std::shared_ptr<SceneGraph> create_graph(int count, std::vector<std::shared_ptr<SceneGraphNode>>& nodes)
+{
+	auto material = std::make_shared<Material>();
+
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+	nodes.push_back(root);
+
+	// a tree with 8 children per node, breadth-first; the last level holds the mesh instances
+	for (int i = 1; i < count; i++)
+	{
+		const auto& parent = nodes[(i - 1) / 8];
+		std::shared_ptr<SceneGraphNode> node;
+		if (i * 8 + 1 >= count)
+			node = graph->AttachLeafNode(parent, std::make_shared<MeshInstance>(mesh));
+		else
+			node = graph->Attach(parent, std::make_shared<SceneGraphNode>());
+
+		node->SetTranslation(dm::double3(double(i % 8), double(i % 5), 0.0));
+		nodes.push_back(node);
+	}
+
+	return graph;
+}
+
+static void run_scenarios(const char* mode, SceneGraph& graph, const std::vector<std::shared_ptr<SceneGraphNode>>& nodes, uint32_t& frameIndex, tf::Executor* executor)
+{
+	const int iterations = 10;
+	char name[128];
+
+	// settle the graph, including the previous transforms
+	graph.Refresh(frameIndex++, executor);
+	graph.Refresh(frameIndex++, executor);
+
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		graph.Refresh(frameIndex++, executor);
+	});
+	snprintf(name, sizeof(name), "%s: no changes", mode);
+	PrintBenchmarkResult(name, time);
+
+	uint32_t seed = 1;
+	const size_t animatedCount = std::max<size_t>(1, nodes.size() / 100);
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		for (size_t i = 0; i < animatedCount; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			nodes[(seed >> 8) % nodes.size()]->SetTranslation(dm::double3(double(frameIndex % 7), 0.0, 1.0));
+		}
+		graph.Refresh(frameIndex++, executor);
+	});
+	snprintf(name, sizeof(name), "%s: 1%% of nodes animated", mode);
+	PrintBenchmarkResult(name, time);
+
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		nodes[0]->SetTranslation(dm::double3(double(frameIndex % 7), 0.0, 0.0));
+		graph.Refresh(frameIndex++, executor);
+	});
+	snprintf(name, sizeof(name), "%s: root moved", mode);
+	PrintBenchmarkResult(name, time);
+}
+
+int main(int argc, char** argv)
+{
+	int nodeCount = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+	auto graph = create_graph(nodeCount, nodes);
+	printf("Scene graph with %d nodes, %d mesh instances\n", nodeCount, int(graph->GetMeshInstances().size()));
+
+	uint32_t frameIndex = 0;
+
+	graph->SetFlatHierarchyEnabled(false);
+	run_scenarios("walker", *graph, nodes, frameIndex, nullptr);
+
+#ifdef DONUT_WITH_TASKFLOW
+	tf::Executor executor;
+	run_scenarios("walker, parallel", *graph, nodes, frameIndex, &executor);
+#endif
+
+	graph->SetFlatHierarchyEnabled(true);
+	double buildTime = MeasureMedianMilliseconds(1, [&]() { graph->Refresh(frameIndex++); });
+	PrintBenchmarkResult("flat: build", buildTime);
+	run_scenarios("flat", *graph, nodes, frameIndex, nullptr);
+
+	return 0;
+}
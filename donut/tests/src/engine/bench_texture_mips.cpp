@@ -0,0 +1,175 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureCache.h>
+#include <donut/engine/TextureMips.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/benchmark.h>
+#include <stb_image_write.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Measures decoding PNG and JPG images as the texture loading threads do, without and with the mip chain
+// generation on the CPU, and the mip chain generation alone at each SIMD level. Reports the times per megapixel
+// of the decoded image.
+// Usage: bench_texture_mips [image size]
+
+class BenchTextureCache : public TextureCache
+{
+public:
+	BenchTextureCache() : TextureCache(nullptr, nullptr, nullptr)
+	{
+		SetInfoLogSeverity(log::Severity::None);
+	}
+
+	bool Decode(const std::shared_ptr<vfs::IBlob>& file, const char* extension)
+	{
+		auto texture = CreateTextureData();
+		texture->forceSRGB = true;
+		return FillTextureData(file, texture, extension, "");
+	}
+};
+
+static void write_to_vector(void* context, void* data, int size)
+{
+	auto& file = *static_cast<std::vector<uint8_t>*>(context);
+	file.insert(file.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+}
+
+static std::shared_ptr<vfs::IBlob> make_blob(const std::vector<uint8_t>& file)
+{
+	void* data = malloc(file.size());
+	memcpy(data, file.data(), file.size());
+	return std::make_shared<vfs::Blob>(data, file.size());
+}
+
+int main(int argc, char** argv)
+{
+	const int size = (argc > 1) ? atoi(argv[1]) : 2048;
+
+	// smooth gradients with some noise, so that the files compress like photos
+	std::vector<uint8_t> pixels(size_t(size) * size * 3);
+	uint32_t seed = 1;
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const int noise = int(seed >> 28) - 8;
+			uint8_t* pixel = &pixels[(size_t(y) * size + x) * 3];
+			pixel[0] = uint8_t(std::clamp(x * 255 / size + noise, 0, 255));
+			pixel[1] = uint8_t(std::clamp(y * 255 / size + noise, 0, 255));
+			pixel[2] = uint8_t(std::clamp(int(127.f + 127.f * sinf(float(x + y) * 0.01f)) + noise, 0, 255));
+		}
+	}
+
+	std::vector<uint8_t> png;
+	std::vector<uint8_t> jpg;
+	stbi_write_png_to_func(write_to_vector, &png, size, size, 3, pixels.data(), size * 3);
+	stbi_write_jpg_to_func(write_to_vector, &jpg, size, size, 3, pixels.data(), 90);
+	auto pngBlob = make_blob(png);
+	auto jpgBlob = make_blob(jpg);
+
+	const double megapixels = double(size) * double(size) / 1e6;
+	printf("%d x %d image, PNG %.1f MB, JPG %.1f MB\n", size, size, double(png.size()) / 1e6, double(jpg.size()) / 1e6);
+
+	struct Case
+	{
+		const char* name;
+		bool cpuMips;
+		MipFilter filter;
+		uint32_t maxSize;
+	};
+
+	const Case cases[] = {
+		{ "decode",                      false, MipFilter::Box,    0 },
+		{ "decode + box mips",           true,  MipFilter::Box,    0 },
+		{ "decode + kaiser mips",        true,  MipFilter::Kaiser, 0 },
+		{ "decode + downscale + kaiser", true,  MipFilter::Kaiser, uint32_t(size / 2) },
+	};
+
+	const int iterations = 5;
+	for (const auto& [blob, extension] : { std::make_pair(pngBlob, ".png"), std::make_pair(jpgBlob, ".jpg") })
+	{
+		for (const Case& c : cases)
+		{
+			BenchTextureCache cache;
+			cache.SetCpuMipGeneration(c.cpuMips, c.filter);
+			cache.SetMaxTextureSize(c.maxSize);
+
+			double time = MeasureMedianMilliseconds(iterations, [&]() { cache.Decode(blob, extension); });
+
+			char name[64];
+			snprintf(name, sizeof(name), "%s: %s", extension + 1, c.name);
+			PrintBenchmarkResult(name, time);
+			snprintf(name, sizeof(name), "%s: %s, per MP", extension + 1, c.name);
+			PrintBenchmarkResult(name, time / megapixels);
+		}
+	}
+
+	// the mip chain generation alone, at each SIMD level, for the 8-bit sRGB RGBA images that the decoders produce
+	std::vector<uint8_t> rgba(size_t(size) * size * 4);
+	for (size_t i = 0; i < size_t(size) * size; i++)
+	{
+		memcpy(&rgba[i * 4], &pixels[i * 3], 3);
+		rgba[i * 4 + 3] = 255;
+	}
+
+	printf("supported SIMD level: %d\n", int(math::get_supported_simd_level()));
+	for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		for (math::simd_level level : { math::simd_level::scalar, math::simd_level::sse, math::simd_level::avx2 })
+		{
+			if (level > math::get_supported_simd_level())
+				continue;
+
+			double time = MeasureMedianMilliseconds(iterations, [&]()
+			{
+				TextureData texture;
+				texture.format = nvrhi::Format::SRGBA8_UNORM;
+				texture.width = uint32_t(size);
+				texture.height = uint32_t(size);
+				texture.dimension = nvrhi::TextureDimension::Texture2D;
+				void* data = malloc(rgba.size());
+				memcpy(data, rgba.data(), rgba.size());
+				texture.data = std::make_shared<vfs::Blob>(data, rgba.size());
+				texture.dataLayout.resize(1);
+				texture.dataLayout[0].resize(1);
+				texture.dataLayout[0][0].rowPitch = size_t(size) * 4;
+				texture.dataLayout[0][0].dataSize = rgba.size();
+				GenerateTextureMips(texture, filter, 0, true, level);
+			});
+
+			const char* levelNames[] = { "scalar", "sse", "avx2" };
+			char name[64];
+			snprintf(name, sizeof(name), "%s mips only, %s, per MP", filter == MipFilter::Box ? "box" : "kaiser", levelNames[int(level)]);
+			PrintBenchmarkResult(name, time / megapixels);
+		}
+	}
+
+	return 0;
+}
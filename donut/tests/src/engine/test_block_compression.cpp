@@ -0,0 +1,336 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/BlockCompression.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MemoryFileSystem.h>
+#include <donut/tests/MockDevice.h>
+#include <donut/tests/utils.h>
+#include <stb_image_write.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+static size_t compressed_size(nvrhi::Format format, uint32_t width, uint32_t height)
+{
+	const size_t blockSize = (format == nvrhi::Format::BC1_UNORM || format == nvrhi::Format::BC4_UNORM) ? 8 : 16;
+	return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+// Compresses and decodes an RGBA image, returns the PSNR over the channels the format stores
+static double round_trip_psnr(nvrhi::Format format, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, int channels = 4)
+{
+	std::vector<uint8_t> blocks(compressed_size(format, width, height));
+	std::vector<uint8_t> decoded(size_t(width) * height * 4);
+	CHECK(CompressImage(format, pixels.data(), width, height, size_t(width) * 4, 4, blocks.data()));
+	CHECK(DecompressImage(format, blocks.data(), width, height, decoded.data()));
+
+	double error = 0.0;
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			const double d = double(pixels[i + c]) - double(decoded[i + c]);
+			error += d * d;
+		}
+	}
+
+	error /= double(width) * height * channels;
+	return error == 0.0 ? 100.0 : 10.0 * log10(255.0 * 255.0 / error);
+}
+
+static std::vector<uint8_t> make_gradient(uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+			pixel[0] = uint8_t(x * 255 / (width - 1));
+			pixel[1] = uint8_t(y * 255 / (height - 1));
+			pixel[2] = uint8_t(128 + 100 * sinf(float(x + y) * 0.05f));
+			pixel[3] = uint8_t((x + y) * 255 / (width + height - 2));
+		}
+	}
+	return pixels;
+}
+
+void test_block_layouts()
+{
+	// BC1: red and blue endpoints, all pixels at index 2, a third of the way to blue
+	const uint8_t bc1[8] = { 0x00, 0xf8, 0x1f, 0x00, 0xaa, 0xaa, 0xaa, 0xaa };
+	uint8_t pixels[16 * 4];
+	CHECK(DecompressImage(nvrhi::Format::BC1_UNORM, bc1, 4, 4, pixels));
+	for (int i = 0; i < 16; i++)
+	{
+		CHECK(pixels[i * 4 + 0] == 170);
+		CHECK(pixels[i * 4 + 1] == 0);
+		CHECK(pixels[i * 4 + 2] == 85);
+		CHECK(pixels[i * 4 + 3] == 255);
+	}
+
+	// BC4: endpoints 200 and 100, pixel i at index i % 8
+	uint8_t bc4[8] = { 200, 100 };
+	uint64_t indices = 0;
+	for (int i = 0; i < 16; i++)
+		indices |= uint64_t(i % 8) << (i * 3);
+	for (int i = 0; i < 6; i++)
+		bc4[2 + i] = uint8_t(indices >> (i * 8));
+	const uint8_t expected[8] = { 200, 100, 186, 171, 157, 143, 129, 114 };
+	CHECK(DecompressImage(nvrhi::Format::BC4_UNORM, bc4, 4, 4, pixels));
+	for (int i = 0; i < 16; i++)
+		CHECK(pixels[i * 4] == expected[i % 8]);
+
+	// BC7 mode 6: the first endpoint is R = 127 and A = 127 with p-bit 1, all indices 0
+	const uint8_t bc7[16] = { 0xc0, 0x3f, 0, 0, 0, 0, 0xfe, 0x80 };
+	CHECK(DecompressImage(nvrhi::Format::BC7_UNORM, bc7, 4, 4, pixels));
+	for (int i = 0; i < 16; i++)
+	{
+		CHECK(pixels[i * 4 + 0] == 255);
+		CHECK(pixels[i * 4 + 1] == 1);
+		CHECK(pixels[i * 4 + 2] == 1);
+		CHECK(pixels[i * 4 + 3] == 255);
+	}
+
+	// other BC7 modes are not decoded
+	const uint8_t bc7Mode0[16] = { 0x01 };
+	CHECK(!DecompressImage(nvrhi::Format::BC7_UNORM, bc7Mode0, 4, 4, pixels));
+
+	CHECK(IsBlockCompressionSupported(nvrhi::Format::BC3_UNORM_SRGB));
+	CHECK(!IsBlockCompressionSupported(nvrhi::Format::BC6H_UFLOAT));
+	CHECK(!CompressImage(nvrhi::Format::BC2_UNORM, pixels, 4, 4, 16, 4, pixels));
+}
+
+void test_exact_blocks()
+{
+	// two colors at the ends of every channel are stored exactly, also in partial blocks at the edges
+	const uint32_t width = 7;
+	const uint32_t height = 6;
+	std::vector<uint8_t> pixels(width * height * 4);
+	for (uint32_t i = 0; i < width * height; i++)
+	{
+		const bool odd = (i % width + i / width) & 1;
+		pixels[i * 4 + 0] = odd ? 255 : 0;
+		pixels[i * 4 + 1] = odd ? 0 : 255;
+		pixels[i * 4 + 2] = odd ? 255 : 0;
+		pixels[i * 4 + 3] = odd ? 0 : 255;
+	}
+
+	CHECK(round_trip_psnr(nvrhi::Format::BC1_UNORM, pixels, width, height, 3) == 100.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC3_UNORM, pixels, width, height, 4) == 100.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC4_UNORM, pixels, width, height, 1) == 100.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC5_UNORM, pixels, width, height, 2) == 100.0);
+
+	// BC7 mode 6 shares the p-bit between the channels of an endpoint, so 0 and 255 in one endpoint are off by one
+	CHECK(round_trip_psnr(nvrhi::Format::BC7_UNORM, pixels, width, height, 4) > 48.0);
+
+	// constant blocks
+	std::vector<uint8_t> constant(16 * 4);
+	for (size_t i = 0; i < constant.size(); i += 4)
+	{
+		constant[i + 0] = 10;
+		constant[i + 1] = 130;
+		constant[i + 2] = 250;
+		constant[i + 3] = 77;
+	}
+	CHECK(round_trip_psnr(nvrhi::Format::BC4_UNORM, constant, 4, 4, 1) == 100.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC5_UNORM, constant, 4, 4, 2) == 100.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC3_UNORM, constant, 4, 4, 4) > 40.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC7_UNORM, constant, 4, 4, 4) > 50.0);
+}
+
+void test_quality()
+{
+	std::vector<uint8_t> gradient = make_gradient(64, 64);
+	// the channels change in different directions, so the colors of a block are not on a line
+	CHECK(round_trip_psnr(nvrhi::Format::BC1_UNORM, gradient, 64, 64, 3) > 36.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC3_UNORM, gradient, 64, 64, 4) > 37.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC4_UNORM, gradient, 64, 64, 1) > 48.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC5_UNORM, gradient, 64, 64, 2) > 48.0);
+	CHECK(round_trip_psnr(nvrhi::Format::BC7_UNORM, gradient, 64, 64, 4) > 39.0);
+
+	// BC7 keeps more of an uncorrelated image than BC1
+	std::vector<uint8_t> noise(64 * 64 * 4);
+	uint32_t seed = 1;
+	for (uint8_t& value : noise)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		value = uint8_t(seed >> 24);
+	}
+	for (size_t i = 3; i < noise.size(); i += 4)
+		noise[i] = 255;
+	CHECK(round_trip_psnr(nvrhi::Format::BC7_UNORM, noise, 64, 64, 3) > round_trip_psnr(nvrhi::Format::BC1_UNORM, noise, 64, 64, 3));
+
+#ifdef DONUT_WITH_TASKFLOW
+	// the same blocks on several threads
+	tf::Executor executor(4);
+	std::vector<uint8_t> serial(compressed_size(nvrhi::Format::BC7_UNORM, 64, 64));
+	std::vector<uint8_t> parallel(serial.size());
+	CHECK(CompressImage(nvrhi::Format::BC7_UNORM, gradient.data(), 64, 64, 64 * 4, 4, serial.data()));
+	CHECK(CompressImage(nvrhi::Format::BC7_UNORM, gradient.data(), 64, 64, 64 * 4, 4, parallel.data(), &executor));
+	CHECK(serial == parallel);
+#endif
+}
+
+static TextureData make_texture(nvrhi::Format format, uint32_t width, uint32_t height, uint32_t channels, uint8_t alpha = 255)
+{
+	const size_t size = size_t(width) * height * channels;
+	uint8_t* data = static_cast<uint8_t*>(malloc(size));
+	memset(data, alpha, size);
+
+	TextureData texture;
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+	texture.dimension = nvrhi::TextureDimension::Texture2D;
+	texture.data = std::make_shared<vfs::Blob>(data, size);
+	texture.dataLayout.resize(1);
+	texture.dataLayout[0].resize(1);
+	texture.dataLayout[0][0].rowPitch = size_t(width) * channels;
+	texture.dataLayout[0][0].dataSize = size;
+	return texture;
+}
+
+void test_format_choice()
+{
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::R8_UNORM, 8, 8, 1), false) == nvrhi::Format::BC4_UNORM);
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::RG8_UNORM, 8, 8, 2), true) == nvrhi::Format::BC5_UNORM);
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::SRGBA8_UNORM, 8, 8, 4), false) == nvrhi::Format::BC1_UNORM_SRGB);
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::SRGBA8_UNORM, 8, 8, 4, 128), false) == nvrhi::Format::BC3_UNORM_SRGB);
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::RGBA8_UNORM, 8, 8, 4), true) == nvrhi::Format::BC7_UNORM);
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::SRGBA8_UNORM, 8, 8, 4), true) == nvrhi::Format::BC7_UNORM_SRGB);
+
+	// not a multiple of 4, or not 8-bit
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::RGBA8_UNORM, 10, 8, 4), false) == nvrhi::Format::UNKNOWN);
+	CHECK(ChooseBlockCompressedFormat(make_texture(nvrhi::Format::R32_FLOAT, 8, 8, 4), false) == nvrhi::Format::UNKNOWN);
+
+	// all mips, with one block for the mips smaller than a block
+	TextureData texture = make_texture(nvrhi::Format::RGBA8_UNORM, 8, 4, 4);
+	CHECK(GenerateTextureMips(texture, MipFilter::Box));
+	CHECK(texture.mipLevels == 4);
+	CHECK(CompressTextureData(texture, nvrhi::Format::BC1_UNORM));
+	CHECK(texture.format == nvrhi::Format::BC1_UNORM);
+	CHECK(texture.data->size() == (2 + 1 + 1 + 1) * 8);
+	CHECK(texture.dataLayout[0][0].rowPitch == 16);
+	CHECK(texture.dataLayout[0][3].dataOffset == 4 * 8);
+	CHECK(texture.dataLayout[0][3].dataSize == 8);
+}
+
+void test_texture_cache()
+{
+	// a 64x32 RGB image in a PNG file
+	std::vector<uint8_t> pixels(64 * 32 * 3);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = uint8_t(i * 7);
+
+	std::vector<uint8_t> png;
+	CHECK(stbi_write_png_to_func([](void* context, void* data, int size)
+	{
+		auto& png = *static_cast<std::vector<uint8_t>*>(context);
+		png.insert(png.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+	}, &png, 64, 32, 3, pixels.data(), 64 * 3));
+
+	auto make_blob = [&png]()
+	{
+		void* data = malloc(png.size());
+		memcpy(data, png.data(), png.size());
+		return std::make_shared<vfs::Blob>(data, png.size());
+	};
+
+	auto fs = std::make_shared<MemoryFileSystem>();
+	TextureCompressionSettings settings;
+
+	std::vector<uint8_t> firstData;
+	for (int load = 0; load < 2; load++)
+	{
+		auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+		TextureCache cache(device, fs, nullptr);
+		cache.SetInfoLogSeverity(log::Severity::None);
+		cache.EnableTextureCompression(settings);
+		cache.EnableProcessedTextureCache("/cache");
+		CHECK(cache.IsTextureCompressionEnabled());
+
+		auto texture = std::static_pointer_cast<TextureData>(cache.LoadTextureFromMemoryDeferred(make_blob(), "image.png", "image/png", true));
+		CHECK(texture->format == nvrhi::Format::BC1_UNORM_SRGB);
+		CHECK(texture->width == 64);
+		CHECK(texture->height == 32);
+		CHECK(texture->mipLevels == 7);
+		CHECK(!texture->isRenderTarget);
+
+		// compressed once, then read from the cache: the DDS file and its record
+		CHECK(fs->files.size() == 2);
+		CHECK(fs->writes == 2);
+		CHECK(fs->reads == load * 2);
+
+		const TextureSubresourceData& layout = texture->dataLayout[0][0];
+		const uint8_t* data = static_cast<const uint8_t*>(texture->data->data()) + layout.dataOffset;
+		std::vector<uint8_t> allData(data, data + texture->dataLayout[0][6].dataOffset + 8 - layout.dataOffset);
+		if (load == 0)
+			firstData = allData;
+		else
+			CHECK(allData == firstData);
+
+		CHECK(cache.ProcessRenderingThreadCommands(nullptr, 0.f));
+		CHECK(device->texturesCreated.size() == 1);
+		CHECK(device->texturesCreated[0].format == nvrhi::Format::BC1_UNORM_SRGB);
+		CHECK(device->texturesCreated[0].mipLevels == 7);
+		CHECK(device->commandLists[0]->textureWrites.size() == 7);
+	}
+
+	// other settings don't use the same cached file
+	settings.useBC7ForColor = true;
+	TextureCache cache(nullptr, fs, nullptr);
+	cache.SetInfoLogSeverity(log::Severity::None);
+	cache.EnableTextureCompression(settings);
+	cache.EnableProcessedTextureCache("/cache");
+	auto texture = std::static_pointer_cast<TextureData>(cache.LoadTextureFromMemoryDeferred(make_blob(), "image.png", "image/png", true));
+	CHECK(texture->format == nvrhi::Format::BC7_UNORM_SRGB);
+	CHECK(fs->files.size() == 4);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_block_layouts();
+		test_exact_blocks();
+		test_quality();
+		test_format_choice();
+		test_texture_cache();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
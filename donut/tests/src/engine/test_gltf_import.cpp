@@ -0,0 +1,215 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/GltfImporter.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/utils.h>
+#include <cstring>
+#include <string>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+
+static const std::filesystem::path g_DataPath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "gltf_import_data";
+
+// Writes a model with 'primitiveCount' grid primitives that have no tangents, so that the importer
+// converts all attributes and generates the tangents.
+static void write_model(vfs::IFileSystem& fs, int gridSize, int primitiveCount)
+{
+	const size_t vertexCount = size_t(gridSize) * gridSize;
+	const size_t indexCount = size_t(gridSize - 1) * (gridSize - 1) * 6;
+
+	std::vector<uint8_t> buffer;
+	auto append = [&buffer](const void* data, size_t bytes)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + bytes);
+		memcpy(buffer.data() + offset, data, bytes);
+		return offset;
+	};
+
+	std::vector<uint32_t> indices;
+	for (int y = 0; y < gridSize - 1; y++)
+	{
+		for (int x = 0; x < gridSize - 1; x++)
+		{
+			uint32_t i = uint32_t(y * gridSize + x);
+			indices.insert(indices.end(), { i, i + uint32_t(gridSize), i + 1, i + 1, i + uint32_t(gridSize), i + uint32_t(gridSize) + 1 });
+		}
+	}
+	const size_t indexOffset = append(indices.data(), indices.size() * sizeof(uint32_t));
+
+	std::string bufferViews;
+	std::string accessors;
+	std::string primitives;
+
+	for (int primitive = 0; primitive < primitiveCount; primitive++)
+	{
+		// interleaved position, normal and texture coordinates
+		std::vector<float> vertices;
+		for (int y = 0; y < gridSize; y++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				float u = float(x) / float(gridSize - 1);
+				float v = float(y) / float(gridSize - 1);
+				vertices.insert(vertices.end(), { u + float(primitive), 0.1f * sinf(u * 20.f) * cosf(v * 20.f), v, 0.f, 1.f, 0.f, u, v });
+			}
+		}
+		const size_t vertexOffset = append(vertices.data(), vertices.size() * sizeof(float));
+
+		int accessor = primitive * 3;
+		bufferViews += std::string(primitive ? ", " : "") + "{ \"buffer\": 0, \"byteOffset\": " + std::to_string(vertexOffset)
+			+ ", \"byteLength\": " + std::to_string(vertices.size() * sizeof(float)) + ", \"byteStride\": 32 }";
+		accessors += std::string(primitive ? ", " : "")
+			+ "{ \"bufferView\": " + std::to_string(primitive) + ", \"componentType\": 5126, \"count\": " + std::to_string(vertexCount) + ", \"type\": \"VEC3\", "
+			+ "\"min\": [ " + std::to_string(primitive) + ", -0.1, 0 ], \"max\": [ " + std::to_string(primitive + 1) + ", 0.1, 1 ] }, "
+			+ "{ \"bufferView\": " + std::to_string(primitive) + ", \"byteOffset\": 12, \"componentType\": 5126, \"count\": " + std::to_string(vertexCount) + ", \"type\": \"VEC3\" }, "
+			+ "{ \"bufferView\": " + std::to_string(primitive) + ", \"byteOffset\": 24, \"componentType\": 5126, \"count\": " + std::to_string(vertexCount) + ", \"type\": \"VEC2\" }";
+		primitives += std::string(primitive ? ", " : "")
+			+ "{ \"attributes\": { \"POSITION\": " + std::to_string(accessor) + ", \"NORMAL\": " + std::to_string(accessor + 1)
+			+ ", \"TEXCOORD_0\": " + std::to_string(accessor + 2) + " }, \"indices\": " + std::to_string(primitiveCount * 3) + " }";
+	}
+
+	bufferViews += ", { \"buffer\": 0, \"byteOffset\": " + std::to_string(indexOffset) + ", \"byteLength\": " + std::to_string(indices.size() * sizeof(uint32_t)) + " }";
+	accessors += ", { \"bufferView\": " + std::to_string(primitiveCount) + ", \"componentType\": 5125, \"count\": " + std::to_string(indexCount) + ", \"type\": \"SCALAR\" }";
+
+	std::string gltf = std::string("{ \"asset\": { \"version\": \"2.0\" }, \"scene\": 0, \"scenes\": [ { \"nodes\": [ 0 ] } ], ")
+		+ "\"nodes\": [ { \"mesh\": 0 } ], \"meshes\": [ { \"primitives\": [ " + primitives + " ] } ], "
+		+ "\"buffers\": [ { \"uri\": \"model.bin\", \"byteLength\": " + std::to_string(buffer.size()) + " } ], "
+		+ "\"bufferViews\": [ " + bufferViews + " ], \"accessors\": [ " + accessors + " ] }";
+
+	CHECK(fs.writeFile(g_DataPath / "model.gltf", gltf.data(), gltf.size()));
+	CHECK(fs.writeFile(g_DataPath / "model.bin", buffer.data(), buffer.size()));
+}
+
+static std::shared_ptr<MeshInfo> get_mesh(const SceneImportResult& result)
+{
+	for (SceneGraphWalker walker(result.rootNode.get()); walker; walker.Next(true))
+	{
+		if (walker->GetLeaf() && walker->GetLeaf()->AsMeshInstance())
+			return walker->GetLeaf()->AsMeshInstance()->GetMesh();
+	}
+	return nullptr;
+}
+
+static void compare_meshes(const MeshInfo& a, const MeshInfo& b)
+{
+	CHECK(a.totalIndices == b.totalIndices);
+	CHECK(a.totalVertices == b.totalVertices);
+	CHECK(a.geometries.size() == b.geometries.size());
+	for (size_t i = 0; i < a.geometries.size(); i++)
+	{
+		CHECK(a.geometries[i]->indexOffsetInMesh == b.geometries[i]->indexOffsetInMesh);
+		CHECK(a.geometries[i]->vertexOffsetInMesh == b.geometries[i]->vertexOffsetInMesh);
+	}
+
+	const BufferGroup& ba = *a.buffers;
+	const BufferGroup& bb = *b.buffers;
+	CHECK(ba.indexData == bb.indexData);
+	CHECK(ba.normalData == bb.normalData);
+	CHECK(ba.tangentData == bb.tangentData);
+	CHECK(ba.positionData.size() == bb.positionData.size());
+	CHECK(memcmp(ba.positionData.data(), bb.positionData.data(), ba.positionData.size() * sizeof(dm::float3)) == 0);
+	CHECK(ba.texcoord1Data.size() == bb.texcoord1Data.size());
+	CHECK(memcmp(ba.texcoord1Data.data(), bb.texcoord1Data.data(), ba.texcoord1Data.size() * sizeof(dm::float2)) == 0);
+	CHECK(all(a.objectSpaceBounds.m_mins == b.objectSpaceBounds.m_mins));
+	CHECK(all(a.objectSpaceBounds.m_maxs == b.objectSpaceBounds.m_maxs));
+}
+
+void test_serial_import()
+{
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+
+	SceneImportResult result;
+	CHECK(importer.Load(g_DataPath / "model.gltf", textureCache, stats, nullptr, result));
+
+	auto mesh = get_mesh(result);
+	CHECK(mesh);
+	CHECK(mesh->geometries.size() == 16);
+	CHECK(mesh->totalVertices == 16 * 32 * 32);
+	CHECK(mesh->totalIndices == 16 * 31 * 31 * 6);
+	CHECK(mesh->buffers->tangentData.size() == mesh->totalVertices);
+}
+
+#ifdef DONUT_WITH_TASKFLOW
+void test_parallel_import_matches_serial()
+{
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+
+	SceneImportResult serialResult;
+	CHECK(importer.Load(g_DataPath / "model.gltf", textureCache, stats, nullptr, serialResult));
+	auto serialMesh = get_mesh(serialResult);
+	CHECK(serialMesh);
+
+	tf::Executor executor(4);
+
+	// called from the main thread, the workers take some of the primitives
+	SceneImportResult parallelResult;
+	CHECK(importer.Load(g_DataPath / "model.gltf", textureCache, stats, &executor, parallelResult));
+	auto parallelMesh = get_mesh(parallelResult);
+	CHECK(parallelMesh);
+	compare_meshes(*serialMesh, *parallelMesh);
+
+	// called from a worker, like in Scene::LoadWithExecutor
+	SceneImportResult workerResult;
+	bool loaded = false;
+	executor.async([&]() { loaded = importer.Load(g_DataPath / "model.gltf", textureCache, stats, &executor, workerResult); }).wait();
+	CHECK(loaded);
+	auto workerMesh = get_mesh(workerResult);
+	CHECK(workerMesh);
+	compare_meshes(*serialMesh, *workerMesh);
+}
+#endif
+
+int main(int, char** argv)
+{
+	try
+	{
+		std::filesystem::create_directories(g_DataPath);
+		auto fs = std::make_shared<vfs::NativeFileSystem>();
+		write_model(*fs, 32, 16);
+
+		test_serial_import();
+#ifdef DONUT_WITH_TASKFLOW
+		test_parallel_import_matches_serial();
+#endif
+	}
+	catch (const std::runtime_error & err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
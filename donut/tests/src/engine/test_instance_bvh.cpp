@@ -0,0 +1,176 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/InstanceBvh.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/utils.h>
+#include <algorithm>
+
+using namespace donut;
+using namespace donut::engine;
+
+struct InstanceField
+{
+	std::shared_ptr<SceneGraph> graph;
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+};
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+static InstanceField create_instance_field(int count, uint32_t seed)
+{
+	auto material = std::make_shared<Material>();
+
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	InstanceField field;
+	field.graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	field.graph->SetRootNode(root);
+
+	// all instances are siblings, like in a flat glTF scene
+	for (int i = 0; i < count; i++)
+	{
+		auto node = field.graph->AttachLeafNode(root, std::make_shared<MeshInstance>(mesh));
+		node->SetTranslation(dm::double3(random_float(seed), random_float(seed) * 0.1f, random_float(seed)) * 1000.0);
+		field.nodes.push_back(node);
+	}
+
+	field.graph->Refresh(0);
+	return field;
+}
+
+static PlanarView create_view(dm::float3 eye, float yaw)
+{
+	dm::affine3 cameraToWorld = dm::rotation(dm::float3(0.f, 1.f, 0.f), yaw) * dm::translation(eye);
+
+	PlanarView view;
+	view.SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(60.f), 1.f, 0.1f, 300.f));
+	view.UpdateCache();
+	return view;
+}
+
+static std::vector<MeshInstance*> cull_brute_force(const SceneGraph& graph, const dm::frustum& frustum)
+{
+	std::vector<MeshInstance*> result;
+	for (const auto& instance : graph.GetMeshInstances())
+	{
+		dm::box3 bounds = instance->GetLocalBoundingBox() * instance->GetNode()->GetLocalToWorldTransformFloat();
+		if (frustum.intersectsWith(bounds))
+			result.push_back(instance.get());
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+static void check_views(InstanceBvh& bvh, const SceneGraph& graph, uint32_t seed)
+{
+	for (int i = 0; i < 20; i++)
+	{
+		dm::float3 eye = dm::float3(random_float(seed), 0.05f, random_float(seed)) * 1000.f;
+		PlanarView view = create_view(eye, random_float(seed) * 6.28f);
+
+		std::vector<MeshInstance*> visible;
+		bvh.Cull(view, visible);
+		std::sort(visible.begin(), visible.end());
+
+		CHECK(visible == cull_brute_force(graph, view.GetViewFrustum()));
+	}
+}
+
+void test_bvh_culling_matches_brute_force()
+{
+	InstanceField field = create_instance_field(5000, 1);
+
+	InstanceBvh bvh;
+	bvh.Build(field.graph->GetMeshInstances());
+	CHECK(bvh.GetInstanceCount() == 5000);
+	CHECK(bvh.ComputeCost() < 0.1f);
+
+	check_views(bvh, *field.graph, 2);
+
+	// everything is inside a frustum built from the whole field's bounds
+	std::vector<MeshInstance*> visible;
+	bvh.Cull(dm::frustum::fromBox(field.nodes[0]->GetParent()->GetGlobalBoundingBox()), visible);
+	CHECK(visible.size() == 5000);
+}
+
+void test_bvh_refit()
+{
+	InstanceField field = create_instance_field(2000, 3);
+
+	InstanceBvh bvh;
+	bvh.SetRebuildThreshold(1000.f); // test the refit only
+	bvh.Update(*field.graph, true, false);
+
+	uint32_t seed = 4;
+	for (uint32_t frame = 1; frame < 5; frame++)
+	{
+		for (int i = 0; i < 100; i++)
+		{
+			const auto& node = field.nodes[uint32_t(random_float(seed) * 2000.f) % 2000];
+			node->SetTranslation(dm::double3(random_float(seed), 0.f, random_float(seed)) * 1000.0);
+		}
+
+		bool transformsChanged = field.graph->HasPendingTransformChanges();
+		field.graph->Refresh(frame);
+		bvh.Update(*field.graph, false, transformsChanged);
+
+		check_views(bvh, *field.graph, 5 + frame);
+	}
+
+	// moving everything to a small area makes the refitted tree bad; the rebuild fixes that
+	for (const auto& node : field.nodes)
+		node->SetTranslation(dm::double3(random_float(seed), 0.f, random_float(seed)) * 10.0);
+	field.graph->Refresh(10);
+	bvh.SetRebuildThreshold(1.5f);
+	float costBefore = bvh.ComputeCost();
+	bvh.Update(*field.graph, false, true);
+	CHECK(bvh.ComputeCost() <= costBefore);
+	check_views(bvh, *field.graph, 20);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_bvh_culling_matches_brute_force();
+		test_bvh_refit();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
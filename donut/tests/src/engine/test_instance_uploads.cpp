@@ -0,0 +1,326 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/Scene.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/ShaderFactory.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/core/log.h>
+#include <donut/tests/utils.h>
+#include <donut/tests/MockCommandList.h>
+#include <donut/tests/MockDevice.h>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+static std::shared_ptr<SceneGraph> create_instance_row(int count, std::vector<std::shared_ptr<SceneGraphNode>>& nodes)
+{
+	auto material = std::make_shared<Material>();
+
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->buffers = std::make_shared<BufferGroup>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	for (int i = 0; i < count; i++)
+	{
+		auto node = graph->AttachLeafNode(root, std::make_shared<MeshInstance>(mesh));
+		node->SetTranslation(dm::double3(double(i) * 3.0, 0.0, 0.0));
+		nodes.push_back(node);
+	}
+
+	return graph;
+}
+
+void test_updated_instance_tracking()
+{
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+	auto graph = create_instance_row(100, nodes);
+
+	// the first refresh processes the new structure; every instance gets an index
+	graph->Refresh(0);
+	CHECK(graph->GetMeshInstances().size() == 100);
+
+	// nothing changed
+	graph->Refresh(1);
+	graph->Refresh(2);
+	CHECK(graph->GetUpdatedMeshInstanceIndices().empty());
+
+	// move one node: its instance is reported on this frame and the next one, for the previous transform
+	auto movedInstance = std::static_pointer_cast<MeshInstance>(nodes[42]->GetLeaf());
+	nodes[42]->SetTranslation(dm::double3(0.0, 5.0, 0.0));
+	graph->Refresh(3);
+	CHECK(graph->GetUpdatedMeshInstanceIndices().size() == 1);
+	CHECK(graph->GetUpdatedMeshInstanceIndices()[0] == movedInstance->GetInstanceIndex());
+
+	graph->Refresh(4);
+	CHECK(graph->GetUpdatedMeshInstanceIndices().size() == 1);
+
+	graph->Refresh(5);
+	CHECK(graph->GetUpdatedMeshInstanceIndices().empty());
+
+	// moving the root affects every instance
+	graph->GetRootNode()->SetTranslation(dm::double3(1.0, 0.0, 0.0));
+	graph->Refresh(6);
+	CHECK(graph->GetUpdatedMeshInstanceIndices().size() == 100);
+	for (int i = 0; i < 100; i++)
+		CHECK(graph->GetUpdatedMeshInstanceIndices()[i] == i);
+}
+
+void test_buffer_element_ranges()
+{
+	tests::MockCommandList commandList;
+	nvrhi::IBuffer* buffer = nullptr;
+	const size_t elementSize = 16;
+	const size_t elementCount = 1000;
+	std::vector<uint8_t> data(elementSize * elementCount);
+
+	// no dirty elements, nothing to write
+	size_t bytes = WriteBufferElementRanges(&commandList, buffer, data.data(), elementSize, elementCount, {}, 4, 0.5f);
+	CHECK(bytes == 0);
+	CHECK(commandList.bufferWrites.empty());
+
+	// isolated elements produce one write each, close elements are merged across small gaps
+	bytes = WriteBufferElementRanges(&commandList, buffer, data.data(), elementSize, elementCount, { 10, 500, 502, 503, 999 }, 2, 0.5f);
+	CHECK(commandList.bufferWrites.size() == 3);
+	CHECK(commandList.bufferWrites[0].destOffsetBytes == 10 * elementSize);
+	CHECK(commandList.bufferWrites[0].dataSize == elementSize);
+	CHECK(commandList.bufferWrites[1].destOffsetBytes == 500 * elementSize);
+	CHECK(commandList.bufferWrites[1].dataSize == 4 * elementSize);
+	CHECK(commandList.bufferWrites[2].destOffsetBytes == 999 * elementSize);
+	CHECK(bytes == 6 * elementSize);
+	CHECK(bytes == commandList.GetBytesWritten());
+
+	// duplicates and out-of-range indices are ignored
+	commandList.Reset();
+	bytes = WriteBufferElementRanges(&commandList, buffer, data.data(), elementSize, elementCount, { -1, 7, 7, 1000 }, 0, 0.5f);
+	CHECK(commandList.bufferWrites.size() == 1);
+	CHECK(bytes == elementSize);
+
+	// too many dirty elements fall back to a single full upload
+	commandList.Reset();
+	std::vector<int> manyElements;
+	for (int i = 0; i < 600; i += 2)
+		manyElements.push_back(i);
+	bytes = WriteBufferElementRanges(&commandList, buffer, data.data(), elementSize, elementCount, manyElements, 0, 0.25f);
+	CHECK(commandList.bufferWrites.size() == 1);
+	CHECK(commandList.bufferWrites[0].destOffsetBytes == 0);
+	CHECK(bytes == elementCount * elementSize);
+}
+
+void test_single_node_upload_size()
+{
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+	auto graph = create_instance_row(10000, nodes);
+	graph->Refresh(0);
+	graph->Refresh(1);
+	graph->Refresh(2);
+
+	nodes[1234]->SetTranslation(dm::double3(0.0, 1.0, 0.0));
+	graph->Refresh(3);
+
+	tests::MockCommandList commandList;
+	const size_t elementSize = 128;
+	std::vector<uint8_t> data(elementSize * graph->GetMeshInstances().size());
+	size_t bytes = WriteBufferElementRanges(&commandList, nullptr, data.data(), elementSize, graph->GetMeshInstances().size(),
+		graph->GetUpdatedMeshInstanceIndices(), 4, 0.5f);
+
+	CHECK(bytes == elementSize);
+	CHECK(commandList.bufferWrites.size() == 1);
+}
+
+// Exposes the scene graph and instance buffer of a Scene that is not loaded from a file
+class TestScene : public Scene
+{
+public:
+	using Scene::Scene;
+
+	void SetSceneGraph(std::shared_ptr<SceneGraph> graph) { m_SceneGraph = std::move(graph); }
+};
+
+static std::unique_ptr<TestScene> create_test_scene(nvrhi::IDevice* device)
+{
+	// the skinning shader is not available here, silence the errors about it
+	donut::log::SetCallback([](donut::log::Severity, const char*) { });
+
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	ShaderFactory shaderFactory(device, fs, "/nonexistent");
+	auto scene = std::make_unique<TestScene>(device, shaderFactory, fs, nullptr, nullptr, nullptr);
+
+	donut::log::ResetCallback();
+	return scene;
+}
+
+static size_t count_instance_buffer_writes(const MockCommandList& commandList, nvrhi::IBuffer* instanceBuffer)
+{
+	size_t count = 0;
+	for (const auto& write : commandList.bufferWrites)
+	{
+		if (write.buffer == instanceBuffer)
+			++count;
+	}
+	return count;
+}
+
+void test_scene_refresh_uploads()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	auto scene = create_test_scene(device);
+
+	const int instanceCount = 1024; // a multiple of the instance array allocation granularity
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+	scene->SetSceneGraph(create_instance_row(instanceCount, nodes));
+
+	// the new structure uploads the whole instance buffer
+	MockCommandList commandList;
+	scene->Refresh(&commandList, 0);
+	nvrhi::IBuffer* instanceBuffer = scene->GetInstanceBuffer();
+	CHECK(instanceBuffer != nullptr);
+	CHECK(count_instance_buffer_writes(commandList, instanceBuffer) == 1);
+	const size_t fullSize = scene->GetInstanceBufferBytesUploaded();
+	CHECK(fullSize > 0);
+	CHECK(fullSize == instanceBuffer->getDesc().byteSize);
+	CHECK(fullSize % instanceCount == 0);
+	const size_t instanceSize = fullSize / instanceCount;
+
+	// the next frame still updates the previous transforms, after that nothing changes
+	scene->Refresh(&commandList, 1);
+	commandList.Reset();
+	scene->Refresh(&commandList, 2);
+	CHECK(scene->GetInstanceBufferBytesUploaded() == 0);
+	CHECK(count_instance_buffer_writes(commandList, instanceBuffer) == 0);
+
+	// one moved instance uploads exactly its own element
+	auto movedInstance = std::static_pointer_cast<MeshInstance>(nodes[321]->GetLeaf());
+	nodes[321]->SetTranslation(dm::double3(0.0, 5.0, 0.0));
+	commandList.Reset();
+	scene->Refresh(&commandList, 3);
+	CHECK(scene->GetInstanceBufferBytesUploaded() == instanceSize);
+	CHECK(count_instance_buffer_writes(commandList, instanceBuffer) == 1);
+	CHECK(commandList.bufferWrites.back().buffer == instanceBuffer);
+	CHECK(commandList.bufferWrites.back().destOffsetBytes == size_t(movedInstance->GetInstanceIndex()) * instanceSize);
+	CHECK(commandList.bufferWrites.back().dataSize == instanceSize);
+
+	// let the previous transform settle
+	scene->Refresh(&commandList, 4);
+	scene->Refresh(&commandList, 5);
+	CHECK(scene->GetInstanceBufferBytesUploaded() == 0);
+
+	// two scene graph refreshes before one buffer refresh upload the instances moved in both
+	auto firstInstance = std::static_pointer_cast<MeshInstance>(nodes[100]->GetLeaf());
+	auto secondInstance = std::static_pointer_cast<MeshInstance>(nodes[900]->GetLeaf());
+	nodes[100]->SetTranslation(dm::double3(0.0, 6.0, 0.0));
+	scene->RefreshSceneGraph(6);
+	nodes[900]->SetTranslation(dm::double3(0.0, 7.0, 0.0));
+	scene->RefreshSceneGraph(7);
+
+	commandList.Reset();
+	scene->RefreshBuffers(&commandList, 7);
+	CHECK(scene->GetInstanceBufferBytesUploaded() == 2 * instanceSize);
+	CHECK(count_instance_buffer_writes(commandList, instanceBuffer) == 2);
+
+	std::vector<size_t> offsets;
+	for (const auto& write : commandList.bufferWrites)
+	{
+		if (write.buffer == instanceBuffer)
+			offsets.push_back(write.destOffsetBytes);
+	}
+	CHECK(offsets[0] == size_t(firstInstance->GetInstanceIndex()) * instanceSize);
+	CHECK(offsets[1] == size_t(secondInstance->GetInstanceIndex()) * instanceSize);
+
+	// the accumulated changes are consumed by the buffer refresh
+	commandList.Reset();
+	scene->RefreshBuffers(&commandList, 7);
+	CHECK(scene->GetInstanceBufferBytesUploaded() == 0);
+}
+
+#ifdef DONUT_WITH_TASKFLOW
+void test_scene_parallel_refresh()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	auto serialScene = create_test_scene(device);
+	auto parallelScene = create_test_scene(device);
+
+	std::vector<std::shared_ptr<SceneGraphNode>> serialNodes;
+	std::vector<std::shared_ptr<SceneGraphNode>> parallelNodes;
+	serialScene->SetSceneGraph(create_instance_row(1024, serialNodes));
+	auto parallelGraph = create_instance_row(1024, parallelNodes);
+	parallelGraph->SetParallelRefreshThreshold(1);
+	parallelScene->SetSceneGraph(parallelGraph);
+
+	tf::Executor executor(4);
+	parallelScene->SetRefreshExecutor(&executor);
+
+	MockCommandList commandList;
+	for (uint32_t frame = 0; frame < 4; frame++)
+	{
+		if (frame == 2)
+		{
+			serialNodes[500]->SetTranslation(dm::double3(0.0, 5.0, 0.0));
+			parallelNodes[500]->SetTranslation(dm::double3(0.0, 5.0, 0.0));
+		}
+
+		serialScene->Refresh(&commandList, frame);
+		parallelScene->Refresh(&commandList, frame);
+
+		CHECK(parallelScene->GetInstanceBufferBytesUploaded() == serialScene->GetInstanceBufferBytesUploaded());
+		CHECK(parallelGraph->GetUpdatedMeshInstanceIndices() == serialScene->GetSceneGraph()->GetUpdatedMeshInstanceIndices());
+		CHECK(all(parallelGraph->GetRootNode()->GetGlobalBoundingBox().m_mins == serialScene->GetSceneGraph()->GetRootNode()->GetGlobalBoundingBox().m_mins));
+		CHECK(all(parallelGraph->GetRootNode()->GetGlobalBoundingBox().m_maxs == serialScene->GetSceneGraph()->GetRootNode()->GetGlobalBoundingBox().m_maxs));
+	}
+
+	parallelScene->SetRefreshExecutor(nullptr);
+}
+#endif
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_updated_instance_tracking();
+		test_buffer_element_ranges();
+		test_single_node_upload_size();
+		test_scene_refresh_uploads();
+#ifdef DONUT_WITH_TASKFLOW
+		test_scene_parallel_refresh();
+#endif
+	}
+	catch (const std::runtime_error & err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
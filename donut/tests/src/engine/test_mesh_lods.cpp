@@ -0,0 +1,335 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/MeshLods.h>
+#include <donut/engine/SceneTypes.h>
+#include <donut/engine/View.h>
+#include <donut/tests/utils.h>
+#include <algorithm>
+
+using namespace donut;
+using namespace donut::math;
+using namespace donut::engine;
+
+// A unit sphere with its triangles wound counter-clockwise when seen from outside. The first and last
+// column of every ring are at the same position, which makes a texture seam.
+static void create_sphere(int rings, int segments, std::vector<float3>& positions, std::vector<float2>& texcoords, std::vector<uint32_t>& indices)
+{
+	positions.clear();
+	texcoords.clear();
+	indices.clear();
+
+	for (int r = 0; r <= rings; r++)
+	{
+		float theta = PI_f * float(r) / float(rings);
+		float sinTheta = (r == 0 || r == rings) ? 0.f : sinf(theta);
+		for (int s = 0; s <= segments; s++)
+		{
+			float phi = 2.f * PI_f * float(s % segments) / float(segments);
+			positions.push_back(float3(sinTheta * cosf(phi), cosf(theta), sinTheta * sinf(phi)));
+			texcoords.push_back(float2(float(s) / float(segments), float(r) / float(rings)));
+		}
+	}
+
+	for (int r = 0; r < rings; r++)
+	{
+		for (int s = 0; s < segments; s++)
+		{
+			uint32_t i = uint32_t(r * (segments + 1) + s);
+			uint32_t below = i + uint32_t(segments + 1);
+			indices.insert(indices.end(), { i, i + 1, below });
+			indices.insert(indices.end(), { i + 1, below + 1, below });
+		}
+	}
+}
+
+static float3 triangle_normal(const std::vector<float3>& positions, const uint32_t* tri)
+{
+	return cross(positions[tri[1]] - positions[tri[0]], positions[tri[2]] - positions[tri[0]]);
+}
+
+static float total_area(const std::vector<float3>& positions, const std::vector<uint32_t>& indices)
+{
+	float area = 0.f;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		area += length(triangle_normal(positions, &indices[i])) * 0.5f;
+	return area;
+}
+
+// Positive when the triangles face outwards
+static float signed_volume(const std::vector<float3>& positions, const std::vector<uint32_t>& indices)
+{
+	float volume = 0.f;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		volume += dot(positions[indices[i]], cross(positions[indices[i + 1]], positions[indices[i + 2]])) / 6.f;
+	return volume;
+}
+
+void test_flat_grid()
+{
+	// a 32x32 quad grid in the XZ plane with texture coordinates that are linear over the grid
+	const int size = 32;
+	std::vector<float3> positions;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> indices;
+	for (int z = 0; z <= size; z++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			positions.push_back(float3(float(x), 0.f, float(z)));
+			texcoords.push_back(float2(float(x), float(z)) / float(size));
+		}
+	}
+	for (int z = 0; z < size; z++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			uint32_t i = uint32_t(z * (size + 1) + x);
+			uint32_t below = i + size + 1;
+			indices.insert(indices.end(), { i, below, i + 1 });
+			indices.insert(indices.end(), { i + 1, below, below + 1 });
+		}
+	}
+
+	MeshSimplifier simplifier(indices.data(), indices.size(), positions.data(), positions.size(), texcoords.data());
+	float error = simplifier.Simplify(indices.size() / 8);
+	const std::vector<uint32_t>& simplified = simplifier.GetIndices();
+
+	CHECK(simplified.size() % 3 == 0);
+	CHECK(simplified.size() <= indices.size() / 8);
+	CHECK(!simplified.empty());
+	CHECK(error < 1e-3f);
+
+	// a plane stays a plane: nothing flips, and the borders keep the area
+	for (size_t i = 0; i < simplified.size(); i += 3)
+	{
+		CHECK(simplified[i] < positions.size() && simplified[i + 1] < positions.size() && simplified[i + 2] < positions.size());
+		CHECK(triangle_normal(positions, &simplified[i]).y > 0.f);
+	}
+	CHECK(std::abs(total_area(positions, simplified) - float(size * size)) < 1e-2f);
+
+	// the corners can't move
+	for (uint32_t corner : { 0u, uint32_t(size), uint32_t(size * (size + 1)), uint32_t((size + 1) * (size + 1) - 1) })
+		CHECK(std::find(simplified.begin(), simplified.end(), corner) != simplified.end());
+}
+
+void test_sphere_chain()
+{
+	std::vector<float3> positions;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> indices;
+	create_sphere(32, 64, positions, texcoords, indices);
+
+	const float fullVolume = signed_volume(positions, indices);
+	CHECK(fullVolume > 4.f);
+
+	MeshSimplifier simplifier(indices.data(), indices.size(), positions.data(), positions.size(), texcoords.data());
+
+	size_t previousCount = simplifier.GetIndices().size();
+	float previousError = 0.f;
+	for (int level = 0; level < 4; level++)
+	{
+		float error = simplifier.Simplify(previousCount / 6 * 3);
+		size_t count = simplifier.GetIndices().size();
+		CHECK(count < previousCount);
+		CHECK(error >= previousError);
+		CHECK(error < 0.5f);
+
+		// the surface stays closed and facing outwards, so it keeps most of the volume
+		CHECK(std::abs(signed_volume(positions, simplifier.GetIndices()) - fullVolume) < fullVolume * 0.1f);
+
+		previousCount = count;
+		previousError = error;
+	}
+
+	// the error is relative to the object size; scaling by a power of 2 keeps the simplification the same
+	std::vector<float3> scaled = positions;
+	for (float3& position : scaled)
+		position *= 8.f;
+	MeshSimplifier scaledSimplifier(indices.data(), indices.size(), scaled.data(), scaled.size(), texcoords.data());
+	MeshSimplifier unitSimplifier(indices.data(), indices.size(), positions.data(), positions.size(), texcoords.data());
+	float scaledError = scaledSimplifier.Simplify(indices.size() / 4);
+	float unitError = unitSimplifier.Simplify(indices.size() / 4);
+	CHECK(unitError > 0.f);
+	CHECK(std::abs(scaledError - unitError * 8.f) <= unitError * 1e-4f);
+}
+
+void test_seams()
+{
+	std::vector<float3> positions;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> indices;
+	const int rings = 16;
+	const int segments = 32;
+	create_sphere(rings, segments, positions, texcoords, indices);
+
+	MeshSimplifier simplifier(indices.data(), indices.size(), positions.data(), positions.size(), texcoords.data());
+	simplifier.Simplify(indices.size() / 8);
+	const std::vector<uint32_t>& simplified = simplifier.GetIndices();
+
+	// the vertices on both sides of the seam share positions with another vertex, so they are locked
+	for (int r = 1; r < rings; r++)
+	{
+		uint32_t first = uint32_t(r * (segments + 1));
+		uint32_t last = first + segments;
+		CHECK(std::find(simplified.begin(), simplified.end(), first) != simplified.end());
+		CHECK(std::find(simplified.begin(), simplified.end(), last) != simplified.end());
+	}
+}
+
+static std::shared_ptr<MeshInfo> create_sphere_mesh()
+{
+	std::vector<float3> positions;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> indices;
+	create_sphere(24, 48, positions, texcoords, indices);
+
+	auto buffers = std::make_shared<BufferGroup>();
+	buffers->positionData = positions;
+	buffers->texcoord1Data = texcoords;
+	buffers->indexData = indices;
+
+	// two geometries: the upper and the lower hemisphere
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->buffers = buffers;
+	mesh->totalIndices = uint32_t(indices.size());
+	mesh->totalVertices = uint32_t(positions.size());
+	mesh->objectSpaceBounds = box3(float3(-1.f), float3(1.f));
+
+	uint32_t half = uint32_t(indices.size() / 2);
+	for (int g = 0; g < 2; g++)
+	{
+		auto geometry = std::make_shared<MeshGeometry>();
+		geometry->indexOffsetInMesh = half * g;
+		geometry->numIndices = half;
+		geometry->numVertices = uint32_t(positions.size());
+		geometry->objectSpaceBounds = box3(float3(-1.f, g == 0 ? 0.f : -1.f, -1.f), float3(1.f, g == 0 ? 1.f : 0.f, 1.f));
+		mesh->geometries.push_back(geometry);
+	}
+
+	return mesh;
+}
+
+void test_generate_mesh_lods()
+{
+	auto mesh = create_sphere_mesh();
+	size_t originalIndexCount = mesh->buffers->indexData.size();
+
+	MeshLodSettings settings;
+	CHECK(!settings.IsEnabled());
+	GenerateMeshLods(*mesh, settings);
+	CHECK(mesh->lodErrors.empty());
+	CHECK(mesh->buffers->indexData.size() == originalIndexCount);
+
+	settings.lodCount = 4;
+	GenerateMeshLods(*mesh, settings);
+	CHECK(mesh->lodErrors.size() == 3);
+	for (size_t level = 1; level < mesh->lodErrors.size(); level++)
+		CHECK(mesh->lodErrors[level] >= mesh->lodErrors[level - 1]);
+
+	const std::vector<uint32_t>& indexData = mesh->buffers->indexData;
+	for (const auto& geometry : mesh->geometries)
+	{
+		CHECK(geometry->lods.size() == 3);
+		CHECK(geometry->GetLod(0).indexOffsetInMesh == geometry->indexOffsetInMesh);
+		CHECK(geometry->GetLod(0).numIndices == geometry->numIndices);
+		CHECK(geometry->GetLod(100).numIndices == geometry->lods.back().numIndices);
+
+		uint32_t previousCount = geometry->numIndices;
+		for (uint32_t lod = 1; lod <= geometry->lods.size(); lod++)
+		{
+			MeshGeometryLod range = geometry->GetLod(lod);
+			CHECK(range.numIndices > 0 && range.numIndices % 3 == 0);
+			CHECK(range.numIndices < previousCount);
+			CHECK(size_t(mesh->indexOffset) + range.indexOffsetInMesh + range.numIndices <= indexData.size());
+			CHECK(range.indexOffsetInMesh >= originalIndexCount);
+			for (uint32_t i = 0; i < range.numIndices; i++)
+				CHECK(indexData[mesh->indexOffset + range.indexOffsetInMesh + i] < geometry->numVertices);
+			previousCount = range.numIndices;
+		}
+	}
+}
+
+void test_lod_selection()
+{
+	auto mesh = create_sphere_mesh();
+	MeshLodSettings settings;
+	settings.lodCount = 4;
+	GenerateMeshLods(*mesh, settings);
+	CHECK(mesh->lodErrors.size() == 3);
+
+	PlanarView view;
+	view.SetViewport(nvrhi::Viewport(1920.f, 1080.f));
+	view.SetMatrices(affine3::identity(), perspProjD3DStyleReverse(radians(60.f), 16.f / 9.f, 0.1f));
+	view.UpdateCache();
+
+	MeshLodSelector selector;
+	selector.SetView(view, 1.f);
+
+	// close to the camera, and with the camera inside the bounds
+	CHECK(selector.SelectLod(*mesh, translation(float3(0.f, 0.f, 3.f))) == 0);
+	CHECK(selector.SelectLod(*mesh, affine3::identity()) == 0);
+
+	// far away, everything is smaller than a pixel
+	CHECK(selector.SelectLod(*mesh, translation(float3(0.f, 0.f, 1e5f))) == 3);
+
+	// the level never gets finer with distance
+	uint32_t previousLod = 0;
+	for (float distance = 2.f; distance < 1e4f; distance *= 1.5f)
+	{
+		uint32_t lod = selector.SelectLod(*mesh, translation(float3(0.f, 0.f, distance)));
+		CHECK(lod >= previousLod);
+		previousLod = lod;
+	}
+
+	// a larger instance at the same distance needs a finer level
+	float3 position = float3(0.f, 0.f, 200.f);
+	CHECK(selector.SelectLod(*mesh, scaling(float3(10.f)) * translation(position)) <= selector.SelectLod(*mesh, translation(position)));
+
+	// a threshold of 0 disables the selection
+	selector.SetView(view, 0.f);
+	CHECK(selector.SelectLod(*mesh, translation(float3(0.f, 0.f, 1e5f))) == 0);
+
+	// meshes without levels
+	MeshInfo plainMesh;
+	plainMesh.objectSpaceBounds = box3(float3(-1.f), float3(1.f));
+	selector.SetView(view, 1.f);
+	CHECK(selector.SelectLod(plainMesh, translation(float3(0.f, 0.f, 1e5f))) == 0);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_flat_grid();
+		test_sphere_chain();
+		test_seams();
+		test_generate_mesh_lods();
+		test_lod_selection();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,232 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/MeshOptimizer.h>
+#include <donut/engine/SceneTypes.h>
+#include <donut/tests/utils.h>
+#include <algorithm>
+#include <array>
+
+using namespace donut;
+using namespace donut::math;
+using namespace donut::engine;
+
+// A grid of size x size vertices with its triangles in a scrambled order
+static void create_grid(int size, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+{
+	positions.clear();
+	indices.clear();
+
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			positions.push_back(float3(float(x), float(y), 0.f));
+
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (int y = 0; y < size - 1; y++)
+	{
+		for (int x = 0; x < size - 1; x++)
+		{
+			uint32_t i = uint32_t(y * size + x);
+			triangles.push_back({ i, i + 1, i + uint32_t(size) });
+			triangles.push_back({ i + 1, i + uint32_t(size) + 1, i + uint32_t(size) });
+		}
+	}
+
+	uint32_t seed = 7;
+	for (size_t i = triangles.size() - 1; i > 0; i--)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		std::swap(triangles[i], triangles[(seed >> 8) % (i + 1)]);
+	}
+
+	for (const auto& triangle : triangles)
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+}
+
+// The triangles as sorted lists of corner positions, rotated to start at the smallest corner
+static std::vector<std::array<float, 9>> get_triangles(const std::vector<float3>& positions, const uint32_t* indices, size_t indexCount)
+{
+	std::vector<std::array<float, 9>> triangles;
+	for (size_t t = 0; t < indexCount / 3; t++)
+	{
+		std::array<std::array<float, 3>, 3> corners;
+		for (int c = 0; c < 3; c++)
+		{
+			const float3& p = positions[indices[t * 3 + c]];
+			corners[c] = { p.x, p.y, p.z };
+		}
+		// keep the winding: rotate instead of sorting the corners
+		int first = int(std::min_element(corners.begin(), corners.end()) - corners.begin());
+		std::array<float, 9> triangle;
+		for (int c = 0; c < 3; c++)
+			std::copy(corners[(first + c) % 3].begin(), corners[(first + c) % 3].end(), triangle.begin() + c * 3);
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+void test_vertex_cache()
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	create_grid(64, positions, indices);
+
+	auto before = AnalyzeVertexCache(indices.data(), indices.size(), positions.size());
+	CHECK(before.triangles == 63 * 63 * 2);
+	CHECK(before.vertices == positions.size());
+	CHECK(before.GetACMR() > 2.f);
+
+	auto triangles = get_triangles(positions, indices.data(), indices.size());
+
+	std::vector<uint32_t> clusters;
+	std::vector<uint32_t> optimized = indices;
+	OptimizeVertexCache(optimized.data(), optimized.size(), positions.size(), c_DefaultVertexCacheSize, &clusters);
+
+	auto after = AnalyzeVertexCache(optimized.data(), optimized.size(), positions.size());
+	CHECK(after.GetACMR() < 0.8f);
+	CHECK(after.GetATVR() < 1.5f);
+	CHECK(!clusters.empty() && clusters[0] == 0);
+	CHECK(std::is_sorted(clusters.begin(), clusters.end()));
+	CHECK(get_triangles(positions, optimized.data(), optimized.size()) == triangles);
+
+	// deterministic
+	std::vector<uint32_t> again = indices;
+	OptimizeVertexCache(again.data(), again.size(), positions.size());
+	CHECK(again == optimized);
+
+	// reordering the clusters costs a little cache efficiency
+	OptimizeOverdraw(optimized.data(), optimized.size(), positions.data(), positions.size(), clusters);
+	auto afterOverdraw = AnalyzeVertexCache(optimized.data(), optimized.size(), positions.size());
+	CHECK(afterOverdraw.GetACMR() < 0.9f);
+	CHECK(get_triangles(positions, optimized.data(), optimized.size()) == triangles);
+}
+
+void test_overdraw_order()
+{
+	// two quads facing +z: one in front of the mesh center, one behind it, which is drawn first in the input
+	std::vector<float3> positions = {
+		float3(0.f, 0.f, -1.f), float3(1.f, 0.f, -1.f), float3(0.f, 1.f, -1.f), float3(1.f, 1.f, -1.f),
+		float3(0.f, 0.f, 1.f), float3(1.f, 0.f, 1.f), float3(0.f, 1.f, 1.f), float3(1.f, 1.f, 1.f)
+	};
+	std::vector<uint32_t> indices = { 0, 1, 2, 1, 3, 2, 4, 5, 6, 5, 7, 6 };
+	std::vector<uint32_t> clusters = { 0, 2 };
+
+	OptimizeOverdraw(indices.data(), indices.size(), positions.data(), positions.size(), clusters);
+	CHECK(positions[indices[0]].z == 1.f);
+	CHECK(positions[indices[3]].z == 1.f);
+	CHECK(positions[indices[6]].z == -1.f);
+	CHECK(positions[indices[9]].z == -1.f);
+}
+
+void test_vertex_fetch()
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	create_grid(16, positions, indices);
+	positions.push_back(float3(-1.f)); // unreferenced
+
+	auto triangles = get_triangles(positions, indices.data(), indices.size());
+
+	std::vector<uint32_t> remap = OptimizeVertexFetch(indices.data(), indices.size(), positions.size());
+	CHECK(remap.size() == positions.size());
+	CHECK(remap.back() == positions.size() - 1);
+
+	// the vertices appear in order of first use
+	uint32_t next = 0;
+	for (uint32_t index : indices)
+	{
+		CHECK(index <= next);
+		if (index == next)
+			++next;
+	}
+
+	std::vector<float3> remapped(positions.size());
+	for (size_t v = 0; v < positions.size(); v++)
+		remapped[remap[v]] = positions[v];
+	CHECK(get_triangles(remapped, indices.data(), indices.size()) == triangles);
+}
+
+void test_geometry_buffers()
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	create_grid(32, positions, indices);
+
+	// a second geometry after a first one of 3 vertices and 3 indices
+	BufferGroup buffers;
+	buffers.positionData = { float3(0.f), float3(1.f), float3(2.f) };
+	buffers.positionData.insert(buffers.positionData.end(), positions.begin(), positions.end());
+	buffers.indexData = { 0, 1, 2 };
+	buffers.indexData.insert(buffers.indexData.end(), indices.begin(), indices.end());
+	for (size_t v = 0; v < buffers.positionData.size(); v++)
+	{
+		buffers.texcoord1Data.push_back(buffers.positionData[v].xy() * 0.5f);
+		buffers.normalData.push_back(uint32_t(v));
+	}
+
+	auto triangles = get_triangles(positions, indices.data(), indices.size());
+
+	auto statistics = OptimizeGeometryBuffers(buffers, 3, indices.size(), 3, positions.size());
+	CHECK(statistics.before.triangles == indices.size() / 3);
+	CHECK(statistics.after.GetACMR() < statistics.before.GetACMR());
+	CHECK(statistics.after.GetATVR() < statistics.before.GetATVR());
+
+	// the first geometry is untouched
+	CHECK(buffers.indexData[0] == 0 && buffers.indexData[1] == 1 && buffers.indexData[2] == 2);
+	CHECK(all(buffers.positionData[2] == float3(2.f)));
+	CHECK(buffers.normalData[2] == 2);
+
+	std::vector<float3> optimizedPositions(buffers.positionData.begin() + 3, buffers.positionData.end());
+	CHECK(get_triangles(optimizedPositions, buffers.indexData.data() + 3, indices.size()) == triangles);
+
+	// all streams follow the positions
+	for (size_t v = 0; v < buffers.positionData.size(); v++)
+	{
+		CHECK(all(buffers.texcoord1Data[v] == buffers.positionData[v].xy() * 0.5f));
+		CHECK(v < 3 || all(positions[buffers.normalData[v] - 3] == buffers.positionData[v]));
+	}
+
+	// out of range indices leave the geometry alone
+	buffers.indexData[3] = 100000;
+	std::vector<uint32_t> brokenIndices = buffers.indexData;
+	statistics = OptimizeGeometryBuffers(buffers, 3, indices.size(), 3, positions.size());
+	CHECK(statistics.before.triangles == 0);
+	CHECK(buffers.indexData == brokenIndices);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_vertex_cache();
+		test_overdraw_order();
+		test_vertex_fetch();
+		test_geometry_buffers();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
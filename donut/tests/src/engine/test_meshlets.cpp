@@ -0,0 +1,310 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/Meshlets.h>
+#include <donut/engine/SceneTypes.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/utils.h>
+#include <algorithm>
+#include <array>
+
+using namespace donut;
+using namespace donut::math;
+using namespace donut::engine;
+
+// A unit sphere with its triangles wound counter-clockwise when seen from outside
+static void create_sphere(int rings, int segments, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+{
+	positions.clear();
+	indices.clear();
+
+	for (int r = 0; r <= rings; r++)
+	{
+		float theta = PI_f * float(r) / float(rings);
+		for (int s = 0; s <= segments; s++)
+		{
+			float phi = 2.f * PI_f * float(s) / float(segments);
+			positions.push_back(float3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+		}
+	}
+
+	for (int r = 0; r < rings; r++)
+	{
+		for (int s = 0; s < segments; s++)
+		{
+			uint32_t i = uint32_t(r * (segments + 1) + s);
+			uint32_t below = i + uint32_t(segments + 1);
+			indices.insert(indices.end(), { i, i + 1, below });
+			indices.insert(indices.end(), { i + 1, below + 1, below });
+		}
+	}
+}
+
+static std::shared_ptr<MeshInfo> create_sphere_mesh()
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	create_sphere(24, 48, positions, indices);
+
+	auto buffers = std::make_shared<BufferGroup>();
+	buffers->positionData = positions;
+	buffers->indexData = indices;
+	for (size_t v = 0; v < positions.size(); v++)
+		buffers->normalData.push_back(uint32_t(v));
+
+	// two geometries: the upper and the lower hemisphere
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->name = "sphere";
+	mesh->buffers = buffers;
+	mesh->totalIndices = uint32_t(indices.size());
+	mesh->totalVertices = uint32_t(positions.size());
+	mesh->objectSpaceBounds = box3(float3(-1.f), float3(1.f));
+
+	uint32_t half = uint32_t(indices.size() / 2);
+	for (int g = 0; g < 2; g++)
+	{
+		auto geometry = std::make_shared<MeshGeometry>();
+		geometry->material = std::make_shared<Material>();
+		geometry->material->name = g == 0 ? "upper" : "lower";
+		geometry->indexOffsetInMesh = half * g;
+		geometry->numIndices = half;
+		geometry->numVertices = uint32_t(positions.size());
+		geometry->objectSpaceBounds = box3(float3(-1.f, g == 0 ? 0.f : -1.f, -1.f), float3(1.f, g == 0 ? 1.f : 0.f, 1.f));
+		mesh->geometries.push_back(geometry);
+	}
+
+	return mesh;
+}
+
+void test_meshlet_limits()
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	create_sphere(32, 64, positions, indices);
+	indices.insert(indices.end(), { 0, 0, 1 }); // degenerate
+	indices.insert(indices.end(), { 0, 1, uint32_t(positions.size()) }); // out of range
+
+	for (uint32_t maxVertices : { 3u, 32u, 64u, 255u })
+	{
+		for (uint32_t maxTriangles : { 1u, 40u, 124u })
+		{
+			std::vector<Meshlet> meshlets;
+			std::vector<uint32_t> vertices;
+			std::vector<uint8_t> triangles;
+			size_t count = BuildMeshlets(indices.data(), indices.size(), positions.data(), positions.size(),
+				maxVertices, maxTriangles, meshlets, vertices, triangles);
+			CHECK(count == meshlets.size());
+
+			// every valid triangle is in exactly one meshlet
+			std::vector<std::array<uint32_t, 3>> meshletIndices;
+			for (const Meshlet& meshlet : meshlets)
+			{
+				CHECK(meshlet.vertexCount <= maxVertices);
+				CHECK(meshlet.triangleCount <= maxTriangles);
+				CHECK(meshlet.triangleCount > 0);
+
+				for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+				{
+					std::array<uint32_t, 3> triangle;
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						uint8_t local = triangles[meshlet.triangleOffset + t * 3 + c];
+						CHECK(local < meshlet.vertexCount);
+						triangle[c] = vertices[meshlet.vertexOffset + local];
+					}
+					meshletIndices.push_back(triangle);
+				}
+
+				// the bounding sphere contains all vertices
+				for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+				{
+					float distance = length(positions[vertices[meshlet.vertexOffset + v]] - meshlet.boundsCenter);
+					CHECK(distance <= meshlet.boundsRadius * 1.0001f);
+				}
+			}
+			std::vector<std::array<uint32_t, 3>> validIndices;
+			for (size_t t = 0; t < indices.size() / 3 - 2; t++)
+				validIndices.push_back({ indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+			std::sort(validIndices.begin(), validIndices.end());
+			std::sort(meshletIndices.begin(), meshletIndices.end());
+			CHECK(meshletIndices == validIndices);
+		}
+	}
+}
+
+void test_meshlet_cones()
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	create_sphere(24, 48, positions, indices);
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices;
+	std::vector<uint8_t> triangles;
+	BuildMeshlets(indices.data(), indices.size(), positions.data(), positions.size(),
+		c_DefaultMeshletMaxVertices, c_DefaultMeshletMaxTriangles, meshlets, vertices, triangles);
+
+	size_t culled = 0;
+	uint32_t seed = 11;
+	for (int i = 0; i < 200; i++)
+	{
+		float3 camera;
+		for (int c = 0; c < 3; c++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			camera[c] = (float(seed >> 8) / float(1 << 24)) * 8.f - 4.f;
+		}
+
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (!IsMeshletBackfacing(meshlet, camera))
+				continue;
+
+			// a culled meshlet has no triangle that faces the camera
+			++culled;
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				const uint8_t* triangle = triangles.data() + meshlet.triangleOffset + t * 3;
+				float3 p0 = positions[vertices[meshlet.vertexOffset + triangle[0]]];
+				float3 p1 = positions[vertices[meshlet.vertexOffset + triangle[1]]];
+				float3 p2 = positions[vertices[meshlet.vertexOffset + triangle[2]]];
+				CHECK(dot(cross(p1 - p0, p2 - p0), p0 - camera) >= -1e-5f);
+			}
+		}
+	}
+
+	// from outside of a sphere about half of it faces away
+	CHECK(culled > meshlets.size() * 200 / 5);
+}
+
+void test_meshlet_culling()
+{
+	auto mesh = create_sphere_mesh();
+	BuildMeshlets(*mesh);
+	const BufferGroup& buffers = *mesh->buffers;
+	CHECK(mesh->geometries[0]->meshletOffset == 0);
+	CHECK(mesh->geometries[1]->meshletOffset == mesh->geometries[0]->numMeshlets);
+	CHECK(buffers.meshletData.size() == mesh->geometries[0]->numMeshlets + mesh->geometries[1]->numMeshlets);
+
+	// the camera looks down the z axis at the sphere, which is moved to z = -10 and scaled
+	float4x4 projection = perspProjD3DStyle(radians(60.f), 1.f, 0.1f, 100.f);
+	frustum viewFrustum(projection, false);
+	affine3 transform = scaling(float3(2.f, 1.f, 1.f)) * translation(float3(0.f, 0.f, 10.f));
+	float3 camera = float3(0.f);
+
+	std::vector<uint32_t> visible;
+	size_t count = CullMeshlets(buffers.meshletData.data(), buffers.meshletData.size(), transform, viewFrustum, camera, false, visible);
+	CHECK(count == buffers.meshletData.size());
+	CHECK(visible.size() == count);
+
+	visible.clear();
+	size_t frontCount = CullMeshlets(buffers.meshletData.data(), buffers.meshletData.size(), transform, viewFrustum, camera, true, visible);
+	CHECK(frontCount < count);
+	CHECK(frontCount > 0);
+	for (uint32_t index : visible)
+		CHECK(buffers.meshletData[index].boundsCenter.z < 0.5f); // the back half faces away
+
+	// mirrored: no cone culling
+	visible.clear();
+	affine3 mirrored = scaling(float3(-1.f, 1.f, 1.f)) * translation(float3(0.f, 0.f, 10.f));
+	CHECK(CullMeshlets(buffers.meshletData.data(), buffers.meshletData.size(), mirrored, viewFrustum, camera, true, visible) == count);
+
+	// moved out of the frustum
+	visible.clear();
+	affine3 outside = translation(float3(50.f, 0.f, 10.f));
+	CHECK(CullMeshlets(buffers.meshletData.data(), buffers.meshletData.size(), outside, viewFrustum, camera, false, visible) == 0);
+
+	// partially visible: only the meshlets on the left side of the sphere pass
+	visible.clear();
+	affine3 edge = translation(float3(6.3f, 0.f, 10.f));
+	size_t edgeCount = CullMeshlets(buffers.meshletData.data(), buffers.meshletData.size(), edge, viewFrustum, camera, false, visible);
+	CHECK(edgeCount > 0 && edgeCount < count);
+	for (uint32_t index : visible)
+		CHECK(buffers.meshletData[index].boundsCenter.x < 0.5f);
+}
+
+void test_meshlet_chunks()
+{
+	auto mesh = create_sphere_mesh();
+	BuildMeshlets(*mesh, 32, 48);
+	const BufferGroup& buffers = *mesh->buffers;
+
+	std::shared_ptr<vfs::IBlob const> blob = SerializeMeshlets(*mesh);
+	CHECK(blob != nullptr);
+
+	auto loaded = DeserializeMeshlets(blob, "sphere.meshlets");
+	CHECK(loaded != nullptr);
+	CHECK(loaded->name == "sphere");
+	CHECK(loaded->geometries.size() == 2);
+	CHECK(loaded->totalVertices == mesh->totalVertices);
+	CHECK(loaded->totalIndices == mesh->totalIndices);
+
+	const BufferGroup& loadedBuffers = *loaded->buffers;
+	CHECK(loadedBuffers.positionData.size() == buffers.positionData.size());
+	CHECK(loadedBuffers.normalData == buffers.normalData);
+	CHECK(loadedBuffers.tangentData.empty());
+	CHECK(loadedBuffers.meshletVertexData == buffers.meshletVertexData);
+	CHECK(loadedBuffers.meshletTriangleData == buffers.meshletTriangleData);
+	CHECK(loadedBuffers.meshletData.size() == buffers.meshletData.size());
+	CHECK(memcmp(loadedBuffers.meshletData.data(), buffers.meshletData.data(), buffers.meshletData.size() * sizeof(Meshlet)) == 0);
+
+	// the index buffer is rebuilt from the meshlets
+	std::vector<uint32_t> meshletIndices;
+	for (const Meshlet& meshlet : buffers.meshletData)
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+			meshletIndices.push_back(buffers.meshletVertexData[meshlet.vertexOffset + buffers.meshletTriangleData[meshlet.triangleOffset + i]]);
+	CHECK(loadedBuffers.indexData == meshletIndices);
+
+	for (size_t g = 0; g < 2; g++)
+	{
+		const MeshGeometry& original = *mesh->geometries[g];
+		const MeshGeometry& geometry = *loaded->geometries[g];
+		CHECK(geometry.material->name == original.material->name);
+		CHECK(geometry.meshletOffset == original.meshletOffset);
+		CHECK(geometry.numMeshlets == original.numMeshlets);
+		CHECK(geometry.indexOffsetInMesh == original.indexOffsetInMesh);
+		CHECK(geometry.numIndices == original.numIndices);
+		CHECK(all(geometry.objectSpaceBounds.m_mins == original.objectSpaceBounds.m_mins));
+	}
+
+	// without meshlets there's nothing to write
+	mesh->geometries[0]->numMeshlets = 0;
+	mesh->geometries[1]->numMeshlets = 0;
+	CHECK(SerializeMeshlets(*mesh) == nullptr);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_meshlet_limits();
+		test_meshlet_cones();
+		test_meshlet_culling();
+		test_meshlet_chunks();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
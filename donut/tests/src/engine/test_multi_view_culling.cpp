@@ -0,0 +1,172 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/MultiViewCuller.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/utils.h>
+#include <algorithm>
+
+using namespace donut;
+using namespace donut::engine;
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+// A two-level scene: groups of instances placed around the group centers, like buildings made of parts
+static std::shared_ptr<SceneGraph> create_scene(int groupCount, int instancesPerGroup, uint32_t seed)
+{
+	auto material = std::make_shared<Material>();
+
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	for (int group = 0; group < groupCount; group++)
+	{
+		auto groupNode = std::make_shared<SceneGraphNode>();
+		graph->Attach(root, groupNode);
+		groupNode->SetTranslation(dm::double3(random_float(seed), 0.f, random_float(seed)) * 1000.0);
+
+		for (int i = 0; i < instancesPerGroup; i++)
+		{
+			auto node = graph->AttachLeafNode(groupNode, std::make_shared<MeshInstance>(mesh));
+			node->SetTranslation(dm::double3(random_float(seed), random_float(seed), random_float(seed)) * 20.0);
+		}
+	}
+
+	graph->Refresh(0);
+	return graph;
+}
+
+static std::shared_ptr<PlanarView> create_view(uint32_t& seed)
+{
+	dm::float3 eye = dm::float3(random_float(seed), 0.05f, random_float(seed)) * 1000.f;
+	dm::affine3 cameraToWorld = dm::rotation(dm::float3(0.f, 1.f, 0.f), random_float(seed) * 6.28f) * dm::translation(eye);
+
+	auto view = std::make_shared<PlanarView>();
+	view->SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(60.f), 1.f, 0.1f, 300.f));
+	view->UpdateCache();
+	return view;
+}
+
+// The same walk that InstancedOpaqueDrawStrategy does for a single view
+static std::vector<MeshInstance*> cull_single_view(SceneGraphNode* rootNode, const dm::frustum& frustum)
+{
+	const SceneContentFlags relevantContent = SceneContentFlags::OpaqueMeshes | SceneContentFlags::AlphaTestedMeshes | SceneContentFlags::BlendedMeshes;
+
+	std::vector<MeshInstance*> result;
+	SceneGraphWalker walker(rootNode);
+	while (walker)
+	{
+		bool subgraphVisible = (walker->GetSubgraphContentFlags() & relevantContent) != 0
+			&& frustum.intersectsWith(walker->GetGlobalBoundingBox());
+
+		if (subgraphVisible)
+		{
+			if (auto meshInstance = dynamic_cast<MeshInstance*>(walker->GetLeaf().get()))
+				result.push_back(meshInstance);
+		}
+
+		walker.Next(subgraphVisible);
+	}
+	return result;
+}
+
+void test_multi_view_culling_matches_single_views()
+{
+	auto graph = create_scene(200, 20, 1);
+
+	// more than 32 views to cover several traversals
+	uint32_t seed = 2;
+	CompositeView compositeView;
+	for (int i = 0; i < 40; i++)
+		compositeView.AddView(create_view(seed));
+
+	std::vector<const IView*> views;
+	MultiViewCuller::AddChildViews(compositeView, ViewType::PLANAR, views);
+	CHECK(views.size() == 40);
+
+	MultiViewCuller culler;
+	culler.Cull(graph->GetRootNode().get(), views);
+
+	size_t totalVisible = 0;
+	for (uint32_t viewIndex = 0; viewIndex < views.size(); viewIndex++)
+	{
+		const std::vector<MeshInstance*>* visible = culler.GetVisibleInstances(views[viewIndex]);
+		CHECK(visible != nullptr);
+		CHECK(visible == &culler.GetVisibleInstances(viewIndex));
+		CHECK(*visible == cull_single_view(graph->GetRootNode().get(), views[viewIndex]->GetViewFrustum()));
+		totalVisible += visible->size();
+	}
+	CHECK(totalVisible > 0);
+
+	const MultiViewCuller::Stats& stats = culler.GetStats();
+	CHECK(stats.viewCount == 40);
+	CHECK(stats.traversals == 2);
+	CHECK(stats.nodesVisited < stats.nodesVisitedWithSeparateTraversals);
+	CHECK(stats.boxTests <= stats.nodesVisitedWithSeparateTraversals);
+
+	PlanarView otherView;
+	CHECK(culler.GetVisibleInstances(&otherView) == nullptr);
+}
+
+void test_multi_view_culling_content_filter()
+{
+	auto graph = create_scene(10, 10, 3);
+
+	uint32_t seed = 4;
+	auto view = create_view(seed);
+	std::vector<const IView*> views = { view.get() };
+
+	MultiViewCuller culler;
+	culler.SetRelevantContent(SceneContentFlags::Lights);
+	culler.Cull(graph->GetRootNode().get(), views);
+	CHECK(culler.GetVisibleInstances(0u).empty());
+	CHECK(culler.GetStats().boxTests == 0);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_multi_view_culling_matches_single_views();
+		test_multi_view_culling_content_filter();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
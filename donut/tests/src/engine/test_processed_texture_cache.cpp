@@ -0,0 +1,238 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MemoryFileSystem.h>
+#include <donut/tests/utils.h>
+#include <stb_image_write.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+static std::vector<uint8_t> make_png(uint32_t width, uint32_t height, uint8_t seed)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 3);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = uint8_t(i * 7 + seed);
+
+	std::vector<uint8_t> png;
+	CHECK(stbi_write_png_to_func([](void* context, void* data, int size)
+	{
+		auto& png = *static_cast<std::vector<uint8_t>*>(context);
+		png.insert(png.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+	}, &png, int(width), int(height), 3, pixels.data(), int(width) * 3));
+	return png;
+}
+
+// All mips of the texture, as they would be uploaded
+static std::vector<uint8_t> get_texture_data(const std::shared_ptr<LoadedTexture>& loadedTexture)
+{
+	auto texture = std::static_pointer_cast<TextureData>(loadedTexture);
+	CHECK(texture->data);
+	const auto& mips = texture->dataLayout[0];
+	const uint8_t* data = static_cast<const uint8_t*>(texture->data->data());
+	return std::vector<uint8_t>(data + mips.front().dataOffset, data + mips.back().dataOffset + mips.back().dataSize);
+}
+
+static std::shared_ptr<TextureCache> make_cache(const std::shared_ptr<MemoryFileSystem>& fs, uint32_t maxTextureSize = 0)
+{
+	auto cache = std::make_shared<TextureCache>(nullptr, fs, nullptr);
+	cache->SetInfoLogSeverity(log::Severity::None);
+	cache->SetMaxTextureSize(maxTextureSize);
+	cache->EnableProcessedTextureCache("/cache");
+	CHECK(cache->IsProcessedTextureCacheEnabled());
+	return cache;
+}
+
+void test_file_invalidation()
+{
+	auto fs = std::make_shared<MemoryFileSystem>();
+	const std::filesystem::path path = "/textures/image.png";
+	fs->setFile(path, make_png(64, 32, 0));
+
+	// the first load processes the file and writes the cache entry
+	auto cache = make_cache(fs);
+	auto texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, true));
+	CHECK(texture->format == nvrhi::Format::SRGBA8_UNORM);
+	CHECK(texture->mipLevels == 7);
+	CHECK(!texture->isRenderTarget);
+	CHECK(cache->GetProcessedTextureCacheStats().misses == 1);
+	CHECK(cache->GetProcessedTextureCacheStats().hits == 0);
+	CHECK(cache->GetProcessedTextureCacheStats().processingThreadSeconds > 0.0);
+	CHECK(fs->count(".dds") == 1);
+	CHECK(fs->count(".rec") == 1);
+	CHECK(fs->get(path).reads == 1);
+	const std::vector<uint8_t> processedData = get_texture_data(texture);
+
+	// an unchanged file isn't read again
+	cache = make_cache(fs);
+	texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, true));
+	CHECK(cache->GetProcessedTextureCacheStats().hits == 1);
+	CHECK(cache->GetProcessedTextureCacheStats().misses == 0);
+	CHECK(fs->get(path).reads == 1);
+	CHECK(texture->format == nvrhi::Format::SRGBA8_UNORM);
+	CHECK(texture->mipLevels == 7);
+	CHECK(get_texture_data(texture) == processedData);
+
+	// a file with a new modification time and the same contents is hashed, and its record is updated
+	++fs->get(path).modificationTime;
+	cache = make_cache(fs);
+	texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, true));
+	CHECK(cache->GetProcessedTextureCacheStats().hits == 1);
+	CHECK(fs->get(path).reads == 2);
+	CHECK(fs->count(".dds") == 1);
+	CHECK(get_texture_data(texture) == processedData);
+
+	cache = make_cache(fs);
+	cache->LoadTextureFromFileDeferred(path, true);
+	CHECK(cache->GetProcessedTextureCacheStats().hits == 1);
+	CHECK(fs->get(path).reads == 2);
+
+	// changed contents replace the entry
+	fs->setFile(path, make_png(64, 32, 1));
+	cache = make_cache(fs);
+	texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, true));
+	CHECK(cache->GetProcessedTextureCacheStats().misses == 1);
+	CHECK(fs->count(".dds") == 1);
+	const std::vector<uint8_t> changedData = get_texture_data(texture);
+	CHECK(changedData != processedData);
+
+	// without modification times, the contents are compared
+	fs->provideFileInfo = false;
+	cache = make_cache(fs);
+	texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, true));
+	CHECK(cache->GetProcessedTextureCacheStats().hits == 1);
+	CHECK(get_texture_data(texture) == changedData);
+	fs->provideFileInfo = true;
+
+	// other settings and other load flags have their own entries
+	cache = make_cache(fs, 16);
+	texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, true));
+	CHECK(cache->GetProcessedTextureCacheStats().misses == 1);
+	CHECK(texture->width == 16);
+	CHECK(texture->height == 8);
+
+	cache = make_cache(fs);
+	texture = std::static_pointer_cast<TextureData>(cache->LoadTextureFromFileDeferred(path, false));
+	CHECK(cache->GetProcessedTextureCacheStats().misses == 1);
+	CHECK(texture->format == nvrhi::Format::RGBA8_UNORM);
+	CHECK(fs->count(".dds") == 3);
+	CHECK(fs->count(".rec") == 3);
+}
+
+void test_memory_textures()
+{
+	auto fs = std::make_shared<MemoryFileSystem>();
+	const std::vector<uint8_t> png = make_png(32, 32, 2);
+
+	auto make_blob = [&png]()
+	{
+		void* data = malloc(png.size());
+		memcpy(data, png.data(), png.size());
+		return std::make_shared<vfs::Blob>(data, png.size());
+	};
+
+	auto cache = make_cache(fs);
+	auto texture = cache->LoadTextureFromMemoryDeferred(make_blob(), "embedded", "image/png", true);
+	const std::vector<uint8_t> processedData = get_texture_data(texture);
+	CHECK(cache->GetProcessedTextureCacheStats().misses == 1);
+
+	// found by the contents, under any name
+	cache = make_cache(fs);
+	texture = cache->LoadTextureFromMemoryDeferred(make_blob(), "other", "image/png", true);
+	CHECK(cache->GetProcessedTextureCacheStats().hits == 1);
+	CHECK(get_texture_data(texture) == processedData);
+	CHECK(fs->count(".dds") == 1);
+}
+
+void test_async_load()
+{
+#ifdef DONUT_WITH_TASKFLOW
+	auto fs = std::make_shared<MemoryFileSystem>();
+	fs->setFile("/a.png", make_png(16, 16, 3));
+	fs->setFile("/b.png", make_png(16, 16, 4));
+
+	tf::Executor executor(2);
+	for (int load = 0; load < 2; load++)
+	{
+		auto cache = make_cache(fs);
+		auto a = cache->LoadTextureFromFileAsync("/a.png", true, executor);
+		auto b = cache->LoadTextureFromFileAsync("/b.png", true, executor);
+		executor.wait_for_all();
+
+		CHECK(cache->IsTextureLoaded(a));
+		CHECK(cache->IsTextureLoaded(b));
+		CHECK(cache->GetProcessedTextureCacheStats().misses == (load == 0 ? 2 : 0));
+		CHECK(cache->GetProcessedTextureCacheStats().hits == (load == 0 ? 0 : 2));
+		CHECK(std::static_pointer_cast<TextureData>(a)->mipLevels == 5);
+	}
+
+	// the sources are only read by the first load
+	CHECK(fs->get("/a.png").reads == 1);
+	CHECK(fs->get("/b.png").reads == 1);
+#endif
+}
+
+void test_uncached_load_time()
+{
+	auto fs = std::make_shared<MemoryFileSystem>();
+	auto cache = make_cache(fs);
+
+	// scenes are told apart by their paths
+	CHECK(cache->ReadUncachedLoadTime("/scenes/a.gltf") == 0.0);
+	cache->WriteUncachedLoadTime("/scenes/a.gltf", 1.5);
+	cache->WriteUncachedLoadTime("/other/a.gltf", 2.5);
+	CHECK(fs->count(".load") == 2);
+	CHECK(make_cache(fs)->ReadUncachedLoadTime("/scenes/a.gltf") == 1.5);
+	CHECK(make_cache(fs)->ReadUncachedLoadTime("/other/a.gltf") == 2.5);
+
+	// nothing is kept without the cache
+	TextureCache disabled(nullptr, fs, nullptr);
+	disabled.WriteUncachedLoadTime("/scenes/b.gltf", 1.0);
+	CHECK(fs->count(".load") == 2);
+	CHECK(disabled.ReadUncachedLoadTime("/scenes/a.gltf") == 0.0);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_file_invalidation();
+		test_memory_textures();
+		test_async_load();
+		test_uncached_load_time();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
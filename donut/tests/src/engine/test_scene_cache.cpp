@@ -0,0 +1,458 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/GltfImporter.h>
+#include <donut/engine/MeshLods.h>
+#include <donut/engine/SceneCache.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/core/log.h>
+#include <donut/tests/utils.h>
+#include <cmath>
+#include <cstring>
+
+using namespace donut;
+using namespace donut::engine;
+
+static const std::filesystem::path g_DataPath = std::filesystem::path(DONUT_TEST_BINARY_DIR) / "scene_cache_data";
+
+// A triangle with a textured material, a child camera, a point light and a translation animation
+static const char* g_GltfText = R"({
+	"asset": { "version": "2.0" },
+	"scene": 0,
+	"scenes": [ { "nodes": [ 0, 2 ] } ],
+	"nodes": [
+		{ "name": "triangle", "mesh": 0, "translation": [ 1, 2, 3 ], "children": [ 1 ] },
+		{ "name": "camera", "camera": 0, "rotation": [ 0, 0.7071068, 0, 0.7071068 ] },
+		{ "name": "light", "extensions": { "KHR_lights_punctual": { "light": 0 } } }
+	],
+	"extensionsUsed": [ "KHR_lights_punctual" ],
+	"extensions": { "KHR_lights_punctual": { "lights": [ { "type": "point", "color": [ 1, 0.5, 0.25 ], "intensity": 7, "range": 20 } ] } },
+	"cameras": [ { "type": "perspective", "perspective": { "yfov": 0.8, "znear": 0.1, "zfar": 100 } } ],
+	"meshes": [ { "name": "triangle", "primitives": [ { "attributes": { "POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 4 }, "indices": 2, "material": 0 } ] } ],
+	"materials": [ { "name": "textured", "pbrMetallicRoughness": { "baseColorTexture": { "index": 0 }, "baseColorFactor": [ 0.5, 0.6, 0.7, 1 ], "metallicFactor": 0.25, "roughnessFactor": 0.75 }, "doubleSided": true } ],
+	"textures": [ { "source": 0 } ],
+	"images": [ { "uri": "checker.tga" } ],
+	"animations": [ { "name": "move", "samplers": [ { "input": 3, "output": 5, "interpolation": "LINEAR" } ], "channels": [ { "sampler": 0, "target": { "node": 0, "path": "translation" } } ] } ],
+	"buffers": [ { "uri": "triangle.bin", "byteLength": 136 } ],
+	"bufferViews": [
+		{ "buffer": 0, "byteOffset": 0, "byteLength": 72 },
+		{ "buffer": 0, "byteOffset": 72, "byteLength": 6 },
+		{ "buffer": 0, "byteOffset": 80, "byteLength": 32 },
+		{ "buffer": 0, "byteOffset": 112, "byteLength": 24 }
+	],
+	"accessors": [
+		{ "bufferView": 0, "byteOffset": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] },
+		{ "bufferView": 0, "byteOffset": 36, "componentType": 5126, "count": 3, "type": "VEC3" },
+		{ "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" },
+		{ "bufferView": 2, "byteOffset": 0, "componentType": 5126, "count": 2, "type": "SCALAR", "min": [ 0 ], "max": [ 1 ] },
+		{ "bufferView": 3, "componentType": 5126, "count": 3, "type": "VEC2" },
+		{ "bufferView": 2, "byteOffset": 8, "componentType": 5126, "count": 2, "type": "VEC3" }
+	]
+})";
+
+static void write_model(vfs::IFileSystem& fs, float firstVertexX)
+{
+	float buffer[34] = {
+		firstVertexX, 0, 0,   1, 0, 0,   0, 1, 0, // positions
+		0, 0, 1,   0, 0, 1,   0, 0, 1,           // normals
+		0, 0,                                    // indices 0, 1, 2 and padding, written below
+		0, 1,                                    // keyframe times
+		1, 2, 3,   4, 5, 6,                      // translations
+		0, 0,   1, 0,   0, 1                     // texture coordinates
+	};
+	const uint16_t indices[4] = { 0, 1, 2, 0 };
+	memcpy(&buffer[18], indices, sizeof(indices));
+
+	CHECK(fs.writeFile(g_DataPath / "triangle.gltf", g_GltfText, strlen(g_GltfText)));
+	CHECK(fs.writeFile(g_DataPath / "triangle.bin", buffer, sizeof(buffer)));
+}
+
+// Two primitives with a wavy grid each, large enough to be simplified into levels of detail
+static void write_grid_model(vfs::IFileSystem& fs)
+{
+	const int gridSize = 24;
+	const int primitiveCount = 2;
+
+	std::vector<float> positions;
+	for (int primitive = 0; primitive < primitiveCount; primitive++)
+	{
+		for (int y = 0; y < gridSize; y++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				float u = float(x) / float(gridSize - 1);
+				float v = float(y) / float(gridSize - 1);
+				positions.insert(positions.end(), { u + float(primitive), 0.1f * sinf(u * 20.f) * cosf(v * 20.f), v });
+			}
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	for (int y = 0; y < gridSize - 1; y++)
+	{
+		for (int x = 0; x < gridSize - 1; x++)
+		{
+			uint32_t i = uint32_t(y * gridSize + x);
+			indices.insert(indices.end(), { i, i + uint32_t(gridSize), i + 1, i + 1, i + uint32_t(gridSize), i + uint32_t(gridSize) + 1 });
+		}
+	}
+
+	const size_t positionBytes = positions.size() * sizeof(float);
+	const size_t primitivePositionBytes = positionBytes / primitiveCount;
+	const size_t indexBytes = indices.size() * sizeof(uint32_t);
+	std::vector<uint8_t> buffer(positionBytes + indexBytes);
+	memcpy(buffer.data(), positions.data(), positionBytes);
+	memcpy(buffer.data() + positionBytes, indices.data(), indexBytes);
+
+	const std::string vertexCount = std::to_string(gridSize * gridSize);
+	const std::string text = R"({
+	"asset": { "version": "2.0" },
+	"scene": 0,
+	"scenes": [ { "nodes": [ 0 ] } ],
+	"nodes": [ { "name": "grid", "mesh": 0 } ],
+	"meshes": [ { "name": "grid", "primitives": [ { "attributes": { "POSITION": 0 }, "indices": 2 }, { "attributes": { "POSITION": 1 }, "indices": 2 } ] } ],
+	"buffers": [ { "uri": "grid.bin", "byteLength": )" + std::to_string(buffer.size()) + R"( } ],
+	"bufferViews": [
+		{ "buffer": 0, "byteOffset": 0, "byteLength": )" + std::to_string(primitivePositionBytes) + R"( },
+		{ "buffer": 0, "byteOffset": )" + std::to_string(primitivePositionBytes) + R"(, "byteLength": )" + std::to_string(primitivePositionBytes) + R"( },
+		{ "buffer": 0, "byteOffset": )" + std::to_string(positionBytes) + R"(, "byteLength": )" + std::to_string(indexBytes) + R"( }
+	],
+	"accessors": [
+		{ "bufferView": 0, "componentType": 5126, "count": )" + vertexCount + R"(, "type": "VEC3", "min": [ 0, -0.1, 0 ], "max": [ 1, 0.1, 1 ] },
+		{ "bufferView": 1, "componentType": 5126, "count": )" + vertexCount + R"(, "type": "VEC3", "min": [ 1, -0.1, 0 ], "max": [ 2, 0.1, 1 ] },
+		{ "bufferView": 2, "componentType": 5125, "count": )" + std::to_string(indices.size()) + R"(, "type": "SCALAR" }
+	]
+})";
+
+	CHECK(fs.writeFile(g_DataPath / "grid.gltf", text.data(), text.size()));
+	CHECK(fs.writeFile(g_DataPath / "grid.bin", buffer.data(), buffer.size()));
+}
+
+static std::vector<SceneGraphNode*> get_nodes(const std::shared_ptr<SceneGraphNode>& root)
+{
+	std::vector<SceneGraphNode*> nodes;
+	for (SceneGraphWalker walker(root.get()); walker; walker.Next(true))
+		nodes.push_back(walker.Get());
+	return nodes;
+}
+
+static void compare_results(const SceneImportResult& imported, const SceneImportResult& cached)
+{
+	auto importedNodes = get_nodes(imported.rootNode);
+	auto cachedNodes = get_nodes(cached.rootNode);
+	CHECK(importedNodes.size() == cachedNodes.size());
+
+	for (size_t i = 0; i < importedNodes.size(); i++)
+	{
+		SceneGraphNode* a = importedNodes[i];
+		SceneGraphNode* b = cachedNodes[i];
+		CHECK(a->GetName() == b->GetName());
+		CHECK(all(a->GetTranslation() == b->GetTranslation()));
+		CHECK(all(a->GetRotation() == b->GetRotation()));
+		CHECK(all(a->GetScaling() == b->GetScaling()));
+		CHECK(!a->GetLeaf() == !b->GetLeaf());
+		CHECK(!a->GetParent() == !b->GetParent());
+		if (a->GetParent())
+			CHECK(a->GetParent()->GetName() == b->GetParent()->GetName());
+
+		if (!a->GetLeaf())
+			continue;
+
+		CHECK(a->GetLeaf()->GetLeafKind() == b->GetLeaf()->GetLeafKind());
+
+		if (auto meshA = a->GetLeaf()->AsMeshInstance())
+		{
+			const auto& ma = meshA->GetMesh();
+			const auto& mb = b->GetLeaf()->AsMeshInstance()->GetMesh();
+			CHECK(ma->name == mb->name);
+			CHECK(ma->totalIndices == mb->totalIndices);
+			CHECK(ma->totalVertices == mb->totalVertices);
+			CHECK(ma->geometries.size() == mb->geometries.size());
+			CHECK(ma->buffers->indexData == mb->buffers->indexData);
+			CHECK(memcmp(ma->buffers->positionData.data(), mb->buffers->positionData.data(), ma->buffers->positionData.size() * sizeof(dm::float3)) == 0);
+			CHECK(ma->buffers->normalData == mb->buffers->normalData);
+			CHECK(ma->buffers->tangentData == mb->buffers->tangentData);
+			CHECK(ma->buffers->texcoord1Data.size() == mb->buffers->texcoord1Data.size());
+
+			const auto& materialA = ma->geometries[0]->material;
+			const auto& materialB = mb->geometries[0]->material;
+			CHECK(materialA->name == materialB->name);
+			CHECK(materialA->domain == materialB->domain);
+			CHECK(all(materialA->baseOrDiffuseColor == materialB->baseOrDiffuseColor));
+			CHECK(materialA->metalness == materialB->metalness);
+			CHECK(materialA->roughness == materialB->roughness);
+			CHECK(materialA->doubleSided == materialB->doubleSided);
+			CHECK(materialB->baseOrDiffuseTexture);
+			CHECK(materialA->baseOrDiffuseTexture->path == materialB->baseOrDiffuseTexture->path);
+		}
+
+		if (auto lightA = dynamic_cast<PointLight*>(a->GetLeaf().get()))
+		{
+			auto lightB = dynamic_cast<PointLight*>(b->GetLeaf().get());
+			CHECK(lightB);
+			CHECK(lightA->intensity == lightB->intensity);
+			CHECK(lightA->range == lightB->range);
+			CHECK(all(lightA->color == lightB->color));
+		}
+
+		if (auto cameraA = dynamic_cast<PerspectiveCamera*>(a->GetLeaf().get()))
+		{
+			auto cameraB = dynamic_cast<PerspectiveCamera*>(b->GetLeaf().get());
+			CHECK(cameraB);
+			CHECK(cameraA->verticalFov == cameraB->verticalFov);
+			CHECK(cameraA->zFar == cameraB->zFar);
+			CHECK(cameraA->aspectRatio == cameraB->aspectRatio);
+		}
+
+		if (auto animationA = a->GetLeaf()->AsAnimation())
+		{
+			auto animationB = b->GetLeaf()->AsAnimation();
+			CHECK(animationA->GetChannels().size() == animationB->GetChannels().size());
+			CHECK(animationA->GetDuration() == animationB->GetDuration());
+
+			auto targetB = animationB->GetChannels()[0]->GetTargetNode();
+			CHECK(targetB && targetB->GetName() == "triangle");
+			auto value = animationB->GetChannels()[0]->GetSampler()->Evaluate(0.5f);
+			CHECK(value.has_value() && all(value->xyz() == dm::float3(2.5f, 3.5f, 4.5f)));
+		}
+	}
+}
+
+void test_scene_cache()
+{
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	std::filesystem::create_directories(g_DataPath);
+	write_model(*fs, 0.f);
+
+	auto sceneCache = std::make_shared<SceneCache>(fs, g_DataPath);
+	std::filesystem::remove(sceneCache->GetCacheFileName(g_DataPath / "triangle.gltf"));
+
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+
+	GltfImporter plainImporter(fs, std::make_shared<SceneTypeFactory>());
+	SceneImportResult imported;
+	CHECK(plainImporter.Load(g_DataPath / "triangle.gltf", textureCache, stats, nullptr, imported));
+
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+	importer.SetSceneCache(sceneCache);
+
+	// the first load imports the model and writes the cache file
+	SceneImportResult first;
+	CHECK(importer.Load(g_DataPath / "triangle.gltf", textureCache, stats, nullptr, first));
+	CHECK(sceneCache->GetMissCount() == 1);
+	CHECK(sceneCache->GetHitCount() == 0);
+	CHECK(fs->fileExists(sceneCache->GetCacheFileName(g_DataPath / "triangle.gltf")));
+
+	SceneImportResult cached;
+	CHECK(importer.Load(g_DataPath / "triangle.gltf", textureCache, stats, nullptr, cached));
+	CHECK(sceneCache->GetHitCount() == 1);
+	compare_results(imported, cached);
+
+	// changing a source file invalidates the cache entry
+	write_model(*fs, -1.f);
+	SceneImportResult modified;
+	CHECK(importer.Load(g_DataPath / "triangle.gltf", textureCache, stats, nullptr, modified));
+	CHECK(sceneCache->GetMissCount() == 2);
+	CHECK(modified.rootNode->GetLeaf() == nullptr);
+	for (SceneGraphNode* node : get_nodes(modified.rootNode))
+	{
+		if (node->GetName() == "triangle")
+			CHECK(node->GetLeaf()->AsMeshInstance()->GetMesh()->buffers->positionData[0].x == -1.f);
+	}
+
+	SceneImportResult modifiedCached;
+	CHECK(importer.Load(g_DataPath / "triangle.gltf", textureCache, stats, nullptr, modifiedCached));
+	CHECK(sceneCache->GetHitCount() == 2);
+	compare_results(modified, modifiedCached);
+
+	// a damaged cache file is a miss, not an error
+	const char garbage[] = "not a scene cache";
+	CHECK(fs->writeFile(sceneCache->GetCacheFileName(g_DataPath / "triangle.gltf"), garbage, sizeof(garbage)));
+	SceneImportResult damaged;
+	CHECK(importer.Load(g_DataPath / "triangle.gltf", textureCache, stats, nullptr, damaged));
+	CHECK(sceneCache->GetMissCount() == 3);
+	compare_results(modified, damaged);
+}
+
+static std::shared_ptr<MeshInfo> get_mesh(const SceneImportResult& result)
+{
+	for (SceneGraphNode* node : get_nodes(result.rootNode))
+	{
+		if (node->GetLeaf() && node->GetLeaf()->AsMeshInstance())
+			return node->GetLeaf()->AsMeshInstance()->GetMesh();
+	}
+	return nullptr;
+}
+
+void test_scene_cache_lods()
+{
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	std::filesystem::create_directories(g_DataPath);
+	write_grid_model(*fs);
+
+	const std::filesystem::path modelFileName = g_DataPath / "grid.gltf";
+	auto sceneCache = std::make_shared<SceneCache>(fs, g_DataPath);
+	std::filesystem::remove(sceneCache->GetCacheFileName(modelFileName));
+
+	MeshLodSettings lodSettings;
+	lodSettings.lodCount = 3;
+
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+	importer.SetSceneCache(sceneCache);
+	importer.SetMeshLodSettings(lodSettings);
+
+	SceneImportResult imported;
+	CHECK(importer.Load(modelFileName, textureCache, stats, nullptr, imported));
+	CHECK(sceneCache->GetMissCount() == 1);
+
+	auto importedMesh = get_mesh(imported);
+	CHECK(importedMesh && importedMesh->geometries.size() == 2);
+	CHECK(importedMesh->lodErrors.size() == lodSettings.lodCount - 1);
+
+	// the LOD indices follow the full detail indices of the mesh
+	for (const auto& geometry : importedMesh->geometries)
+	{
+		CHECK(geometry->lods.size() == lodSettings.lodCount - 1);
+		for (const MeshGeometryLod& lod : geometry->lods)
+			CHECK(lod.numIndices > 0 && lod.indexOffsetInMesh >= importedMesh->totalIndices);
+	}
+
+	// every later load is a hit, and the cache file is not rewritten
+	for (size_t load = 1; load <= 2; load++)
+	{
+		SceneImportResult cached;
+		CHECK(importer.Load(modelFileName, textureCache, stats, nullptr, cached));
+		CHECK(sceneCache->GetHitCount() == load);
+		CHECK(sceneCache->GetMissCount() == 1);
+
+		auto cachedMesh = get_mesh(cached);
+		CHECK(cachedMesh && cachedMesh->geometries.size() == importedMesh->geometries.size());
+		CHECK(cachedMesh->totalIndices == importedMesh->totalIndices);
+		CHECK(cachedMesh->buffers->indexData == importedMesh->buffers->indexData);
+		CHECK(cachedMesh->lodErrors == importedMesh->lodErrors);
+
+		for (size_t geometryIndex = 0; geometryIndex < importedMesh->geometries.size(); geometryIndex++)
+		{
+			const auto& importedLods = importedMesh->geometries[geometryIndex]->lods;
+			const auto& cachedLods = cachedMesh->geometries[geometryIndex]->lods;
+			CHECK(cachedLods.size() == importedLods.size());
+			for (size_t level = 0; level < importedLods.size(); level++)
+			{
+				CHECK(cachedLods[level].indexOffsetInMesh == importedLods[level].indexOffsetInMesh);
+				CHECK(cachedLods[level].numIndices == importedLods[level].numIndices);
+			}
+		}
+	}
+}
+
+static size_t count_textures(TextureCache& textureCache)
+{
+	size_t count = 0;
+	for (auto it = textureCache.begin(); it != textureCache.end(); ++it)
+		++count;
+	return count;
+}
+
+void test_corrupt_cache_files()
+{
+	auto fs = std::make_shared<vfs::NativeFileSystem>();
+	std::filesystem::create_directories(g_DataPath);
+	write_model(*fs, 0.f);
+
+	const std::filesystem::path modelFileName = g_DataPath / "triangle.gltf";
+	auto sceneCache = std::make_shared<SceneCache>(fs, g_DataPath);
+	const std::filesystem::path cacheFileName = sceneCache->GetCacheFileName(modelFileName);
+	std::filesystem::remove(cacheFileName);
+
+	TextureCache importTextureCache(nullptr, fs, nullptr);
+	SceneLoadingStats stats;
+	GltfImporter importer(fs, std::make_shared<SceneTypeFactory>());
+	importer.SetSceneCache(sceneCache);
+	SceneImportResult imported;
+	CHECK(importer.Load(modelFileName, importTextureCache, stats, nullptr, imported));
+
+	auto blob = fs->readFile(cacheFileName);
+	CHECK(blob);
+	const std::vector<uint8_t> valid(static_cast<const uint8_t*>(blob->data()), static_cast<const uint8_t*>(blob->data()) + blob->size());
+	auto sceneTypeFactory = std::make_shared<SceneTypeFactory>();
+
+	// the chunk file and the cache report the damaged files
+	donut::log::SetCallback([](donut::log::Severity, const char*) { });
+
+	// any damaged byte either still loads, or is a miss that has not requested any textures
+	for (size_t offset = 0; offset < valid.size(); offset++)
+	{
+		for (uint8_t value : { uint8_t(valid[offset] ^ 0xff), uint8_t(0xff) })
+		{
+			std::vector<uint8_t> damaged = valid;
+			damaged[offset] = value;
+			CHECK(fs->writeFile(cacheFileName, damaged.data(), damaged.size()));
+
+			TextureCache textureCache(nullptr, fs, nullptr);
+			SceneImportResult result;
+			if (!sceneCache->Load(modelFileName, *fs, 0, sceneTypeFactory, textureCache, nullptr, result))
+				CHECK(count_textures(textureCache) == 0);
+		}
+	}
+
+	// so does a truncated file
+	for (size_t size = 0; size < valid.size(); size += 7)
+	{
+		CHECK(fs->writeFile(cacheFileName, valid.data(), size));
+
+		TextureCache textureCache(nullptr, fs, nullptr);
+		SceneImportResult result;
+		if (!sceneCache->Load(modelFileName, *fs, 0, sceneTypeFactory, textureCache, nullptr, result))
+			CHECK(count_textures(textureCache) == 0);
+	}
+
+	donut::log::ResetCallback();
+
+	// the intact file still loads
+	CHECK(fs->writeFile(cacheFileName, valid.data(), valid.size()));
+	TextureCache textureCache(nullptr, fs, nullptr);
+	SceneImportResult cached;
+	CHECK(sceneCache->Load(modelFileName, *fs, 0, sceneTypeFactory, textureCache, nullptr, cached));
+	CHECK(count_textures(textureCache) == 1);
+	compare_results(imported, cached);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_scene_cache();
+		test_scene_cache_lods();
+		test_corrupt_cache_files();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
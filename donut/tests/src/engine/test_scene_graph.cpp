@@ -0,0 +1,352 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/SceneGraph.h>
+#include <donut/tests/utils.h>
+
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+using namespace donut;
+using namespace donut::engine;
+
+struct TestGraph
+{
+	std::shared_ptr<SceneGraph> graph;
+	std::vector<std::shared_ptr<SceneGraphNode>> nodes;
+};
+
+// Deterministic pseudo-random generator, so that two graphs can be built and animated identically.
+struct Lcg
+{
+	uint32_t state;
+	uint32_t Next() { state = state * 1664525u + 1013904223u; return state >> 8; }
+	double Float() { return double(Next() & 0xffff) / 65535.0; }
+};
+
+// The first 'chainLength' nodes form a chain under the root, the rest are attached to random nodes below that chain.
+static TestGraph create_random_graph(int count, uint32_t seed, bool flat, int chainLength = 0)
+{
+	auto material = std::make_shared<Material>();
+
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->geometries.push_back(geometry);
+	mesh->objectSpaceBounds = geometry->objectSpaceBounds;
+
+	TestGraph result;
+	result.graph = std::make_shared<SceneGraph>();
+	result.graph->SetFlatHierarchyEnabled(flat);
+	auto root = std::make_shared<SceneGraphNode>();
+	result.graph->SetRootNode(root);
+	result.nodes.push_back(root);
+
+	Lcg rng{ seed };
+	for (int i = 1; i < count; i++)
+	{
+		const auto& parent = (i <= chainLength)
+			? result.nodes.back()
+			: result.nodes[chainLength + rng.Next() % (result.nodes.size() - chainLength)];
+
+		std::shared_ptr<SceneGraphNode> node;
+		if (rng.Next() % 2)
+			node = result.graph->AttachLeafNode(parent, std::make_shared<MeshInstance>(mesh));
+		else
+			node = result.graph->Attach(parent, std::make_shared<SceneGraphNode>());
+
+		if (rng.Next() % 4)
+			node->SetTranslation(dm::double3(rng.Float(), rng.Float(), rng.Float()) * 10.0);
+		if (rng.Next() % 4 == 0)
+			node->SetScaling(dm::double3(0.5 + rng.Float()));
+
+		result.nodes.push_back(node);
+	}
+
+	return result;
+}
+
+static void animate(TestGraph& test, Lcg& rng, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const auto& node = test.nodes[rng.Next() % test.nodes.size()];
+		node->SetTranslation(dm::double3(rng.Float(), rng.Float(), rng.Float()) * 10.0);
+	}
+}
+
+static void compare_graphs(const TestGraph& a, const TestGraph& b)
+{
+	CHECK(a.nodes.size() == b.nodes.size());
+
+	for (size_t i = 0; i < a.nodes.size(); i++)
+	{
+		const auto& na = a.nodes[i];
+		const auto& nb = b.nodes[i];
+		CHECK(all(na->GetLocalToWorldTransform().m_linear == nb->GetLocalToWorldTransform().m_linear));
+		CHECK(all(na->GetLocalToWorldTransform().m_translation == nb->GetLocalToWorldTransform().m_translation));
+		CHECK(all(na->GetPrevLocalToWorldTransform().m_translation == nb->GetPrevLocalToWorldTransform().m_translation));
+		CHECK(all(na->GetLocalToWorldTransformFloat().m_translation == nb->GetLocalToWorldTransformFloat().m_translation));
+		CHECK(all(na->GetGlobalBoundingBox().m_mins == nb->GetGlobalBoundingBox().m_mins));
+		CHECK(all(na->GetGlobalBoundingBox().m_maxs == nb->GetGlobalBoundingBox().m_maxs));
+		CHECK(na->GetSubgraphContentFlags() == nb->GetSubgraphContentFlags());
+	}
+
+	CHECK(a.graph->HasPendingTransformChanges() == b.graph->HasPendingTransformChanges());
+
+	CHECK(a.graph->GetUpdatedMeshInstanceIndices() == b.graph->GetUpdatedMeshInstanceIndices());
+}
+
+void test_flat_hierarchy_matches_walker()
+{
+	TestGraph walker = create_random_graph(2000, 1, false);
+	TestGraph flat = create_random_graph(2000, 1, true);
+
+	Lcg rngWalker{ 7 };
+	Lcg rngFlat{ 7 };
+
+	for (uint32_t frame = 0; frame < 20; frame++)
+	{
+		// a few frames with no changes at all, to check the dirty tracking of the previous transforms
+		int changes = (frame % 5 == 4) ? 0 : int(frame * 3);
+		animate(walker, rngWalker, changes);
+		animate(flat, rngFlat, changes);
+
+		if (frame == 10)
+		{
+			walker.nodes[0]->SetTranslation(dm::double3(1.0, 2.0, 3.0));
+			flat.nodes[0]->SetTranslation(dm::double3(1.0, 2.0, 3.0));
+		}
+
+		walker.graph->Refresh(frame);
+		flat.graph->Refresh(frame);
+		compare_graphs(walker, flat);
+	}
+}
+
+void test_flat_hierarchy_structure_changes()
+{
+	TestGraph walker = create_random_graph(500, 3, false);
+	TestGraph flat = create_random_graph(500, 3, true);
+
+	walker.graph->Refresh(0);
+	flat.graph->Refresh(0);
+	compare_graphs(walker, flat);
+
+	// detach a subtree and keep animating; the detached nodes must keep valid transforms
+	auto detachedWalker = walker.nodes[5];
+	auto detachedFlat = flat.nodes[5];
+	walker.graph->Detach(detachedWalker);
+	flat.graph->Detach(detachedFlat);
+	CHECK(all(detachedWalker->GetLocalToWorldTransform().m_translation == detachedFlat->GetLocalToWorldTransform().m_translation));
+
+	Lcg rngWalker{ 11 };
+	Lcg rngFlat{ 11 };
+	for (uint32_t frame = 1; frame < 5; frame++)
+	{
+		animate(walker, rngWalker, 20);
+		animate(flat, rngFlat, 20);
+		walker.graph->Refresh(frame);
+		flat.graph->Refresh(frame);
+	}
+
+	// the nodes in the detached subtree are no longer updated by either graph, compare only the bounds of the root
+	CHECK(all(walker.nodes[0]->GetGlobalBoundingBox().m_mins == flat.nodes[0]->GetGlobalBoundingBox().m_mins));
+	CHECK(all(walker.nodes[0]->GetGlobalBoundingBox().m_maxs == flat.nodes[0]->GetGlobalBoundingBox().m_maxs));
+	CHECK(walker.graph->GetUpdatedMeshInstanceIndices() == flat.graph->GetUpdatedMeshInstanceIndices());
+
+	// switching back to the walker keeps the results and pending changes
+	flat.graph->SetFlatHierarchyEnabled(false);
+	animate(walker, rngWalker, 20);
+	animate(flat, rngFlat, 20);
+	walker.graph->Refresh(5);
+	flat.graph->Refresh(5);
+	CHECK(all(walker.nodes[0]->GetGlobalBoundingBox().m_mins == flat.nodes[0]->GetGlobalBoundingBox().m_mins));
+	CHECK(all(walker.nodes[0]->GetGlobalBoundingBox().m_maxs == flat.nodes[0]->GetGlobalBoundingBox().m_maxs));
+}
+
+void test_flat_hierarchy_rebuilds_and_leaf_bounds()
+{
+	TestGraph walker = create_random_graph(300, 9, false);
+	TestGraph flat = create_random_graph(300, 9, true);
+
+	// each graph gets its own mesh whose bounds are changed below
+	std::shared_ptr<MeshInfo> meshes[2];
+	for (int i = 0; i < 2; i++)
+	{
+		TestGraph& test = (i == 0) ? walker : flat;
+		meshes[i] = std::make_shared<MeshInfo>();
+		meshes[i]->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+		test.nodes.push_back(test.graph->AttachLeafNode(test.nodes[3], std::make_shared<MeshInstance>(meshes[i])));
+	}
+
+	Lcg rngWalker{ 17 };
+	Lcg rngFlat{ 17 };
+	float previousRootMin = 0.f;
+	for (uint32_t frame = 0; frame < 12; frame++)
+	{
+		animate(walker, rngWalker, 10);
+		animate(flat, rngFlat, 10);
+
+		// structure changes between the frames with moving nodes rebuild the flat arrays
+		if (frame == 3 || frame == 4 || frame == 7)
+		{
+			for (TestGraph* test : { &walker, &flat })
+			{
+				auto node = test->graph->Attach(test->nodes[frame], std::make_shared<SceneGraphNode>());
+				node->SetTranslation(dm::double3(1.0, 0.0, 0.0));
+				test->nodes.push_back(node);
+			}
+		}
+
+		// grow the leaf bounds without moving the node, then again together with a move
+		if (frame == 5 || frame == 9)
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				TestGraph& test = (i == 0) ? walker : flat;
+				meshes[i]->objectSpaceBounds = dm::box3(dm::float3(-100.f * float(frame)), dm::float3(1.f));
+				if (frame == 5)
+					test.nodes[300]->InvalidateContent();
+				else
+					test.nodes[300]->SetTranslation(dm::double3(0.0, 2.0, 0.0));
+			}
+		}
+
+		walker.graph->Refresh(frame);
+		flat.graph->Refresh(frame);
+		compare_graphs(walker, flat);
+
+		// the grown leaf bounds reach the root
+		const float rootMin = walker.nodes[0]->GetGlobalBoundingBox().m_mins.x;
+		if (frame == 5 || frame == 9)
+			CHECK(rootMin < previousRootMin - 100.f);
+		previousRootMin = rootMin;
+	}
+}
+
+#ifdef DONUT_WITH_TASKFLOW
+void test_parallel_refresh_matches_serial()
+{
+	tf::Executor executor(4);
+
+	for (int chainLength : { 0, 3 })
+	{
+		TestGraph serial = create_random_graph(3000, 5, false, chainLength);
+		TestGraph parallel = create_random_graph(3000, 5, false, chainLength);
+		parallel.graph->SetParallelRefreshThreshold(0);
+
+		Lcg rngSerial{ 13 };
+		Lcg rngParallel{ 13 };
+
+		for (uint32_t frame = 0; frame < 20; frame++)
+		{
+			int changes = (frame % 5 == 4) ? 0 : int(frame * 5);
+			animate(serial, rngSerial, changes);
+			animate(parallel, rngParallel, changes);
+
+			if (frame == 10)
+			{
+				serial.nodes[0]->SetTranslation(dm::double3(1.0, 2.0, 3.0));
+				parallel.nodes[0]->SetTranslation(dm::double3(1.0, 2.0, 3.0));
+			}
+
+			serial.graph->Refresh(frame);
+			parallel.graph->Refresh(frame, &executor);
+			compare_graphs(serial, parallel);
+		}
+	}
+}
+#endif
+
+void test_leaf_kinds()
+{
+	auto mesh = std::make_shared<MeshInfo>();
+	auto meshInstance = std::make_shared<MeshInstance>(mesh);
+	auto skinnedInstance = std::make_shared<SkinnedMeshInstance>(std::make_shared<SceneTypeFactory>(), mesh);
+	auto meshReference = std::make_shared<SkinnedMeshReference>(skinnedInstance);
+	auto camera = std::make_shared<PerspectiveCamera>();
+	auto light = std::make_shared<SpotLight>();
+	auto animation = std::make_shared<SceneGraphAnimation>();
+
+	CHECK(meshInstance->GetLeafKind() == SceneGraphLeafKind::MeshInstance);
+	CHECK(meshInstance->AsMeshInstance() == meshInstance.get());
+	CHECK(meshInstance->AsSkinnedMeshInstance() == nullptr);
+	CHECK(skinnedInstance->GetLeafKind() == SceneGraphLeafKind::SkinnedMeshInstance);
+	CHECK(skinnedInstance->AsMeshInstance() == skinnedInstance.get());
+	CHECK(skinnedInstance->AsSkinnedMeshInstance() == skinnedInstance.get());
+	CHECK(meshReference->AsSkinnedMeshReference() == meshReference.get());
+	CHECK(meshReference->AsMeshInstance() == nullptr);
+	CHECK(camera->AsCamera() == camera.get());
+	CHECK(camera->AsLight() == nullptr);
+	CHECK(light->AsLight() == light.get());
+	CHECK(light->AsAnimation() == nullptr);
+	CHECK(animation->AsAnimation() == animation.get());
+	CHECK(animation->AsCamera() == nullptr);
+	CHECK(camera->Clone()->GetLeafKind() == SceneGraphLeafKind::Camera);
+	CHECK(light->Clone()->GetLeafKind() == SceneGraphLeafKind::Light);
+
+	// the graph sorts the leaves into its lists by the tags
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+	auto meshNode = graph->AttachLeafNode(root, meshInstance);
+	graph->AttachLeafNode(root, skinnedInstance);
+	graph->AttachLeafNode(root, meshReference);
+	graph->AttachLeafNode(root, camera);
+	auto lightNode = graph->AttachLeafNode(root, light);
+	graph->AttachLeafNode(root, animation);
+
+	CHECK(graph->GetMeshInstances().size() == 2);
+	CHECK(graph->GetSkinnedMeshInstances().size() == 1);
+	CHECK(graph->GetCameras().size() == 1);
+	CHECK(graph->GetLights().size() == 1);
+	CHECK(graph->GetAnimations().size() == 1);
+
+	graph->Detach(meshNode);
+	graph->Detach(lightNode);
+	CHECK(graph->GetMeshInstances().size() == 1);
+	CHECK(graph->GetLights().empty());
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_leaf_kinds();
+		test_flat_hierarchy_matches_walker();
+		test_flat_hierarchy_structure_changes();
+		test_flat_hierarchy_rebuilds_and_leaf_bounds();
+#ifdef DONUT_WITH_TASKFLOW
+		test_parallel_refresh_matches_serial();
+#endif
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,350 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureCache.h>
+#include <donut/engine/TextureMips.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MockDevice.h>
+#include <donut/tests/utils.h>
+#include <stb_image_write.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+static TextureData make_texture(nvrhi::Format format, uint32_t width, uint32_t height, uint32_t bytesPerPixel, const void* pixels)
+{
+	const size_t size = size_t(width) * height * bytesPerPixel;
+	void* data = malloc(size);
+	memcpy(data, pixels, size);
+
+	TextureData texture;
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+	texture.dimension = nvrhi::TextureDimension::Texture2D;
+	texture.data = std::make_shared<vfs::Blob>(data, size);
+	texture.dataLayout.resize(1);
+	texture.dataLayout[0].resize(1);
+	texture.dataLayout[0][0].rowPitch = size_t(width) * bytesPerPixel;
+	texture.dataLayout[0][0].dataSize = size;
+	return texture;
+}
+
+template<typename T>
+static const T* mip_data(const TextureData& texture, uint32_t mipLevel)
+{
+	return reinterpret_cast<const T*>(static_cast<const uint8_t*>(texture.data->data()) + texture.dataLayout[0][mipLevel].dataOffset);
+}
+
+static void check_layout(const TextureData& texture, uint32_t bytesPerPixel)
+{
+	CHECK(texture.dataLayout.size() == 1);
+	CHECK(texture.dataLayout[0].size() == texture.mipLevels);
+
+	size_t offset = 0;
+	for (uint32_t mipLevel = 0; mipLevel < texture.mipLevels; mipLevel++)
+	{
+		const TextureSubresourceData& layout = texture.dataLayout[0][mipLevel];
+		CHECK(layout.dataOffset == ptrdiff_t(offset));
+		CHECK(layout.rowPitch == std::max(texture.width >> mipLevel, 1u) * bytesPerPixel);
+		CHECK(layout.dataSize == layout.rowPitch * std::max(texture.height >> mipLevel, 1u));
+		offset += layout.dataSize;
+	}
+	CHECK(texture.data->size() == offset);
+	if (texture.mipLevels > 1)
+		CHECK(std::max(texture.width, texture.height) >> (texture.mipLevels - 1) == 1);
+}
+
+void test_srgb_averaging()
+{
+	// black and white checkerboard, alpha 0 and 255
+	const uint8_t pixels[] = {
+		0, 0, 0, 0,          255, 255, 255, 255,
+		255, 255, 255, 255,  0, 0, 0, 0,
+	};
+
+	for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		// averaged in linear space: 0.5 is 187.5 in sRGB
+		TextureData srgb = make_texture(nvrhi::Format::SRGBA8_UNORM, 2, 2, 4, pixels);
+		CHECK(GenerateTextureMips(srgb, filter));
+		CHECK(srgb.mipLevels == 2);
+		check_layout(srgb, 4);
+		CHECK(memcmp(mip_data<uint8_t>(srgb, 0), pixels, sizeof(pixels)) == 0);
+		const uint8_t* srgbMip = mip_data<uint8_t>(srgb, 1);
+		for (int c = 0; c < 3; c++)
+			CHECK(srgbMip[c] == 187 || srgbMip[c] == 188);
+		CHECK(srgbMip[3] == 128);
+
+		TextureData linear = make_texture(nvrhi::Format::RGBA8_UNORM, 2, 2, 4, pixels);
+		CHECK(GenerateTextureMips(linear, filter));
+		const uint8_t* linearMip = mip_data<uint8_t>(linear, 1);
+		for (int c = 0; c < 4; c++)
+			CHECK(linearMip[c] == 128);
+	}
+}
+
+void test_constant_image()
+{
+	// a constant image stays constant with any filter, odd sizes included
+	const uint32_t width = 37;
+	const uint32_t height = 19;
+	std::vector<uint8_t> pixels(width * height * 4);
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		pixels[i + 0] = 100;
+		pixels[i + 1] = 150;
+		pixels[i + 2] = 200;
+		pixels[i + 3] = 50;
+	}
+
+	for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		TextureData texture = make_texture(nvrhi::Format::SRGBA8_UNORM, width, height, 4, pixels.data());
+		CHECK(GenerateTextureMips(texture, filter));
+		CHECK(texture.mipLevels == 6);
+		check_layout(texture, 4);
+
+		for (uint32_t mipLevel = 0; mipLevel < texture.mipLevels; mipLevel++)
+		{
+			const uint8_t* data = mip_data<uint8_t>(texture, mipLevel);
+			const size_t count = texture.dataLayout[0][mipLevel].dataSize;
+			CHECK(memcmp(data, pixels.data(), count) == 0);
+		}
+	}
+}
+
+void test_downscaling()
+{
+	// a horizontal ramp
+	const uint32_t width = 1000;
+	const uint32_t height = 500;
+	std::vector<uint8_t> pixels(width * height);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			pixels[y * width + x] = uint8_t(x * 256 / width);
+
+	TextureData texture = make_texture(nvrhi::Format::R8_UNORM, width, height, 1, pixels.data());
+	CHECK(GenerateTextureMips(texture, MipFilter::Kaiser, 256));
+	CHECK(texture.width == 256);
+	CHECK(texture.height == 128);
+	CHECK(texture.mipLevels == 9);
+	check_layout(texture, 1);
+
+	// away from the edges, the ramp is kept
+	const uint8_t* top = mip_data<uint8_t>(texture, 0);
+	for (uint32_t y = 0; y < 128; y += 17)
+	{
+		for (uint32_t x = 8; x < 248; x++)
+		{
+			const float expected = (float(x) + 0.5f) * 256.f / 256.f - 0.5f;
+			CHECK(fabsf(float(top[y * 256 + x]) - expected) <= 1.f);
+		}
+	}
+
+	// downscaling only
+	TextureData single = make_texture(nvrhi::Format::R8_UNORM, width, height, 1, pixels.data());
+	CHECK(GenerateTextureMips(single, MipFilter::Box, 256, false));
+	CHECK(single.width == 256);
+	CHECK(single.height == 128);
+	CHECK(single.mipLevels == 1);
+	check_layout(single, 1);
+	CHECK(single.data->size() == 256 * 128);
+
+	// nothing to do
+	TextureData small = make_texture(nvrhi::Format::R8_UNORM, 64, 64, 1, pixels.data());
+	auto smallData = small.data;
+	CHECK(GenerateTextureMips(small, MipFilter::Box, 256, false));
+	CHECK(small.data == smallData);
+	CHECK(small.mipLevels == 1);
+}
+
+void test_float_formats()
+{
+	// one bright pixel: the box filter keeps the total energy, and Kaiser ringing doesn't go negative
+	std::vector<float> pixels(16 * 16 * 4, 0.f);
+	for (int c = 0; c < 4; c++)
+		pixels[(5 * 16 + 6) * 4 + c] = 100.f;
+
+	for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		TextureData texture = make_texture(nvrhi::Format::RGBA32_FLOAT, 16, 16, 16, pixels.data());
+		CHECK(GenerateTextureMips(texture, filter));
+		CHECK(texture.mipLevels == 5);
+		check_layout(texture, 16);
+
+		for (uint32_t mipLevel = 1; mipLevel < texture.mipLevels; mipLevel++)
+		{
+			const uint32_t size = 16 >> mipLevel;
+			const float* data = mip_data<float>(texture, mipLevel);
+			double sum = 0.0;
+			for (uint32_t i = 0; i < size * size * 4; i++)
+			{
+				CHECK(data[i] >= 0.f);
+				sum += data[i];
+			}
+
+			if (filter == MipFilter::Box)
+				CHECK(fabs(sum * double(1 << (2 * mipLevel)) - 400.0) < 0.01);
+		}
+	}
+}
+
+void test_resample_image()
+{
+	// halving with the box filter averages pairs
+	const float row[] = { 1.f, 3.f, 5.f, 7.f, 9.f, 11.f, 13.f, 15.f };
+	float result[4] = {};
+	ResampleImage(row, 8, 1, result, 4, 1, 1, MipFilter::Box);
+	for (int i = 0; i < 4; i++)
+		CHECK(result[i] == float(i * 4 + 2));
+
+	// the Kaiser filter is symmetric, so it keeps a linear ramp away from the edges
+	std::vector<float> ramp(64);
+	for (int i = 0; i < 64; i++)
+		ramp[i] = float(i);
+	std::vector<float> halved(32);
+	ResampleImage(ramp.data(), 64, 1, halved.data(), 32, 1, 1, MipFilter::Kaiser);
+	for (int i = 3; i < 29; i++)
+		CHECK(fabsf(halved[i] - (float(i) * 2.f + 0.5f)) < 1e-3f);
+
+	// unsupported formats and layouts are left alone
+	const uint8_t blocks[8] = {};
+	TextureData compressed = make_texture(nvrhi::Format::BC1_UNORM, 4, 4, 0, blocks);
+	CHECK(!GenerateTextureMips(compressed, MipFilter::Box));
+
+	TextureData mipmapped = make_texture(nvrhi::Format::R8_UNORM, 4, 4, 1, blocks);
+	mipmapped.mipLevels = 2;
+	CHECK(!GenerateTextureMips(mipmapped, MipFilter::Box));
+}
+
+void test_simd_levels()
+{
+	// the SIMD paths give the same results as the scalar code, including the values that don't fill a vector
+	uint32_t seed = 1;
+	std::vector<float> pixels(70 * 33 * 4);
+	for (float& value : pixels)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		value = float(seed >> 8) / float(1 << 24);
+	}
+
+	struct Size { uint32_t srcWidth, srcHeight, dstWidth, dstHeight; };
+	const Size sizes[] = { { 70, 32, 35, 16 }, { 64, 33, 32, 16 }, { 70, 33, 23, 11 } };
+
+	for (const Size& size : sizes)
+	{
+		for (uint32_t channels = 1; channels <= 4; channels++)
+		{
+			for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+			{
+				const size_t count = size_t(size.dstWidth) * size.dstHeight * channels;
+				std::vector<float> scalar(count);
+				ResampleImage(pixels.data(), size.srcWidth, size.srcHeight, scalar.data(), size.dstWidth, size.dstHeight, channels, filter, math::simd_level::scalar);
+
+				for (math::simd_level level : { math::simd_level::sse, math::simd_level::avx2, math::simd_level::best })
+				{
+					std::vector<float> result(count);
+					ResampleImage(pixels.data(), size.srcWidth, size.srcHeight, result.data(), size.dstWidth, size.dstHeight, channels, filter, level);
+					CHECK(memcmp(result.data(), scalar.data(), count * sizeof(float)) == 0);
+				}
+			}
+		}
+	}
+
+	// the same for a whole mip chain of an sRGB texture
+	std::vector<uint8_t> bytes(70 * 33 * 4);
+	for (size_t i = 0; i < bytes.size(); i++)
+		bytes[i] = uint8_t(pixels[i] * 255.f);
+
+	TextureData scalarTexture = make_texture(nvrhi::Format::SRGBA8_UNORM, 70, 33, 4, bytes.data());
+	CHECK(GenerateTextureMips(scalarTexture, MipFilter::Box, 0, true, math::simd_level::scalar));
+	TextureData simdTexture = make_texture(nvrhi::Format::SRGBA8_UNORM, 70, 33, 4, bytes.data());
+	CHECK(GenerateTextureMips(simdTexture, MipFilter::Box, 0, true, math::simd_level::best));
+	CHECK(scalarTexture.data->size() == simdTexture.data->size());
+	CHECK(memcmp(scalarTexture.data->data(), simdTexture.data->data(), scalarTexture.data->size()) == 0);
+}
+
+void test_texture_cache()
+{
+	// a 64x32 RGB image in a PNG file
+	std::vector<uint8_t> pixels(64 * 32 * 3);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = uint8_t(i * 7);
+
+	std::vector<uint8_t> png;
+	CHECK(stbi_write_png_to_func([](void* context, void* data, int size)
+	{
+		auto& png = *static_cast<std::vector<uint8_t>*>(context);
+		png.insert(png.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+	}, &png, 64, 32, 3, pixels.data(), 64 * 3));
+	void* pngData = malloc(png.size());
+	memcpy(pngData, png.data(), png.size());
+	auto pngBlob = std::make_shared<vfs::Blob>(pngData, png.size());
+
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TextureCache cache(device, nullptr, nullptr);
+	cache.SetCpuMipGeneration(true, MipFilter::Box);
+	cache.SetMaxTextureSize(32);
+	CHECK(cache.IsCpuMipGenerationEnabled());
+
+	auto texture = std::static_pointer_cast<TextureData>(cache.LoadTextureFromMemoryDeferred(pngBlob, "image.png", "image/png", true));
+	CHECK(texture->format == nvrhi::Format::SRGBA8_UNORM);
+	CHECK(texture->width == 32);
+	CHECK(texture->height == 16);
+	CHECK(texture->mipLevels == 6);
+	CHECK(!texture->isRenderTarget);
+	check_layout(*texture, 4);
+
+	// uploaded as it is, without render passes
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 0.f));
+	CHECK(device->texturesCreated.size() == 1);
+	CHECK(device->texturesCreated[0].width == 32);
+	CHECK(device->texturesCreated[0].mipLevels == 6);
+	CHECK(!device->texturesCreated[0].isRenderTarget);
+	CHECK(device->commandLists[0]->textureWrites.size() == 6);
+	CHECK(texture->texture != nullptr);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_srgb_averaging();
+		test_constant_image();
+		test_downscaling();
+		test_float_formats();
+		test_resample_image();
+		test_simd_levels();
+		test_texture_cache();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
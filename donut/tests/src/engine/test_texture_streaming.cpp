@@ -0,0 +1,319 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MockDevice.h>
+#include <donut/tests/utils.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Puts textures with complete mip chains directly into the finalization queue, like loading DDS files does
+class TestTextureCache : public TextureCache
+{
+public:
+	using TextureCache::TextureCache;
+
+	std::shared_ptr<TextureData> QueueTexture(uint32_t size, uint32_t mipLevels, nvrhi::Format format = nvrhi::Format::RGBA8_UNORM)
+	{
+		const bool blockCompressed = format == nvrhi::Format::BC1_UNORM;
+
+		auto texture = CreateTextureData();
+		texture->path = "texture" + std::to_string(m_TexturesRequested++);
+		texture->format = format;
+		texture->width = size;
+		texture->height = size;
+		texture->mipLevels = mipLevels;
+		texture->dimension = nvrhi::TextureDimension::Texture2D;
+
+		size_t dataSize = 0;
+		texture->dataLayout.resize(1);
+		for (uint32_t mipLevel = 0; mipLevel < mipLevels; mipLevel++)
+		{
+			uint32_t mipSize = std::max(size >> mipLevel, 1u);
+			TextureSubresourceData& layout = texture->dataLayout[0].emplace_back();
+			layout.dataOffset = ptrdiff_t(dataSize);
+			layout.rowPitch = blockCompressed ? size_t((mipSize + 3) / 4) * 8 : size_t(mipSize) * 4;
+			layout.dataSize = layout.rowPitch * (blockCompressed ? (mipSize + 3) / 4 : mipSize);
+			dataSize += layout.dataSize;
+		}
+		texture->data = std::make_shared<vfs::Blob>(calloc(dataSize, 1), dataSize);
+
+		m_TexturesToFinalize.push(texture);
+		return texture;
+	}
+};
+
+// The size of the mips from 'mipLevel' down of an RGBA8 texture
+static uint64_t mip_chain_size(uint32_t size, uint32_t mipLevel)
+{
+	uint64_t total = 0;
+	for (uint32_t mipSize = size >> mipLevel; mipSize > 0; mipSize >>= 1)
+		total += uint64_t(mipSize) * mipSize * 4;
+	return total;
+}
+
+void test_initial_residency()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	TextureStreamingSettings settings;
+	settings.minResidentSize = 64;
+	cache.EnableStreaming(settings);
+
+	auto streamed = cache.QueueTexture(1024, 11);
+	auto withoutMips = cache.QueueTexture(1024, 1);
+	auto small = cache.QueueTexture(64, 7);
+	auto compressed = cache.QueueTexture(1024, 11, nvrhi::Format::BC1_UNORM);
+	auto oddCompressed = cache.QueueTexture(1000, 10, nvrhi::Format::BC1_UNORM);
+	cache.ProcessRenderingThreadCommands(nullptr, 0.f);
+
+	// only the mips up to 64x64 are resident, and the data stays on the CPU
+	CHECK(streamed->texture->getDesc().width == 64);
+	CHECK(streamed->texture->getDesc().mipLevels == 7);
+	CHECK(cache.GetResidentMip(streamed.get()) == 4);
+	CHECK(cache.IsTextureLoaded(streamed));
+	CHECK(cache.IsTextureFinalized(streamed));
+
+	// textures without a mip chain, and ones that are small enough already, are uploaded completely
+	CHECK(withoutMips->texture->getDesc().width == 1024);
+	CHECK(!withoutMips->data);
+	CHECK(small->texture->getDesc().width == 64);
+	CHECK(small->texture->getDesc().mipLevels == 7);
+	CHECK(!small->data);
+
+	// block compressed textures are streamed when all their resident mips are whole blocks
+	CHECK(compressed->texture->getDesc().width == 64);
+	CHECK(oddCompressed->texture->getDesc().width == 1000);
+
+	const TextureStreamingStats& stats = cache.GetStreamingStats();
+	CHECK(stats.streamedTextures == 2);
+	CHECK(stats.residentBytes == mip_chain_size(1024, 4) + (16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1 + 1 + 1) * 8);
+	CHECK(cache.GetNumberOfFinalizedTextures() == 5);
+}
+
+void test_upgrade_and_eviction()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	// room for one texture at full resolution, one from 256x256, and two tails
+	TextureStreamingSettings settings;
+	settings.budgetBytes = mip_chain_size(1024, 0) + mip_chain_size(1024, 2) + 2 * mip_chain_size(1024, 4);
+	settings.maxUploadBytesPerUpdate = 0;
+	cache.EnableStreaming(settings);
+
+	std::vector<std::shared_ptr<TextureData>> textures;
+	for (int i = 0; i < 4; i++)
+		textures.push_back(cache.QueueTexture(1024, 11));
+	cache.ProcessRenderingThreadCommands(nullptr, 0.f);
+
+	auto commandList = nvrhi::RefCountPtr<MockCommandList>::Create(new MockCommandList());
+
+	// nothing reported, nothing changes
+	TextureStreamingStats stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesUpgraded == 0 && stats.texturesEvicted == 0 && stats.bytesUploaded == 0);
+
+	// an object covering 1024 pixels needs mip 0, and one covering 256 pixels needs mip 2
+	nvrhi::ITexture* previous = textures[0]->texture;
+	cache.ReportTextureUse(textures[0].get(), 1024.f);
+	cache.ReportTextureUse(textures[0].get(), 256.f);
+	cache.ReportTextureUse(textures[1].get(), 256.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesUpgraded == 2);
+	CHECK(stats.texturesEvicted == 0);
+	CHECK(cache.GetResidentMip(textures[0].get()) == 0);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 2);
+	CHECK(textures[0]->texture != previous);
+	CHECK(textures[0]->texture->getDesc().width == 1024);
+	CHECK(textures[0]->texture->getDesc().mipLevels == 11);
+	CHECK(textures[1]->texture->getDesc().width == 256);
+	CHECK(stats.bytesUploaded == mip_chain_size(1024, 0) + mip_chain_size(1024, 2));
+	CHECK(stats.residentBytes == mip_chain_size(1024, 0) + mip_chain_size(1024, 2) + 2 * mip_chain_size(1024, 4));
+
+	// texture 2 doesn't fit, and texture 0 wasn't used in this frame, so it's evicted
+	cache.ReportTextureUse(textures[1].get(), 256.f);
+	cache.ReportTextureUse(textures[2].get(), 1024.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesEvicted == 1);
+	CHECK(stats.texturesUpgraded == 1);
+	CHECK(cache.GetResidentMip(textures[0].get()) == 4);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 2);
+	CHECK(cache.GetResidentMip(textures[2].get()) == 0);
+	CHECK(stats.residentBytes <= settings.budgetBytes);
+
+	// textures 1 and 2 are both in use, so texture 3 only gets what is left
+	cache.ReportTextureUse(textures[1].get(), 256.f);
+	cache.ReportTextureUse(textures[2].get(), 1024.f);
+	cache.ReportTextureUse(textures[3].get(), 1024.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesEvicted == 0);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 2);
+	CHECK(cache.GetResidentMip(textures[2].get()) == 0);
+	CHECK(cache.GetResidentMip(textures[3].get()) == 4);
+	CHECK(stats.residentBytes == settings.budgetBytes);
+
+	// a texture used at a smaller size gives up its finer mips when the space is needed,
+	// after the textures that weren't used in this frame
+	cache.ReportTextureUse(textures[2].get(), 64.f);
+	cache.ReportTextureUse(textures[3].get(), 1024.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesEvicted == 2);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 4);
+	CHECK(cache.GetResidentMip(textures[2].get()) == 4);
+	CHECK(cache.GetResidentMip(textures[3].get()) == 0);
+	CHECK(stats.residentBytes <= settings.budgetBytes);
+
+	// reducing the budget evicts the least recently used textures
+	settings.budgetBytes = 4 * mip_chain_size(1024, 4);
+	cache.EnableStreaming(settings);
+	stats = cache.UpdateStreaming(commandList);
+	for (const auto& texture : textures)
+		CHECK(cache.GetResidentMip(texture.get()) == 4);
+	CHECK(stats.residentBytes == settings.budgetBytes);
+
+	// unloading
+	CHECK(!cache.UnloadTexture(textures[0]));
+	cache.Reset();
+	CHECK(cache.GetStreamingStats().streamedTextures == 0);
+	CHECK(cache.GetStreamingStats().residentBytes == 0);
+}
+
+static unsigned long reference_count(nvrhi::ITexture* texture)
+{
+	texture->AddRef();
+	return texture->Release();
+}
+
+void test_deferred_release()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	TextureStreamingSettings settings;
+	settings.framesInFlight = 2;
+	cache.EnableStreaming(settings);
+
+	auto texture = cache.QueueTexture(1024, 11);
+	auto other = cache.QueueTexture(1024, 11);
+	cache.ProcessRenderingThreadCommands(nullptr, 0.f);
+
+	auto commandList = nvrhi::RefCountPtr<MockCommandList>::Create(new MockCommandList());
+
+	Material material;
+	material.baseOrDiffuseTexture = texture;
+	material.normalTexture = other;
+
+	// the replaced texture is kept until the frames in flight that may read it are done
+	nvrhi::TextureHandle previous = texture->texture;
+	cache.ReportTextureUse(texture.get(), 1024.f);
+	cache.UpdateStreaming(commandList);
+	CHECK(texture->texture != previous);
+	CHECK(reference_count(previous) == 2);
+	CHECK(cache.TextureReplaced(texture.get()));
+	CHECK(!cache.TextureReplaced(other.get()));
+	CHECK(cache.MaterialTexturesReplaced(material));
+
+	cache.ReportTextureUse(texture.get(), 1024.f);
+	cache.UpdateStreaming(commandList);
+	CHECK(reference_count(previous) == 2);
+	CHECK(!cache.TextureReplaced(texture.get()));
+	CHECK(!cache.MaterialTexturesReplaced(material));
+
+	cache.ReportTextureUse(texture.get(), 1024.f);
+	cache.UpdateStreaming(commandList);
+	CHECK(reference_count(previous) == 1);
+}
+
+void test_upload_limit()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	TextureStreamingSettings settings;
+	settings.maxUploadBytesPerUpdate = mip_chain_size(1024, 0) + mip_chain_size(1024, 1);
+	cache.EnableStreaming(settings);
+
+	std::vector<std::shared_ptr<TextureData>> textures;
+	for (int i = 0; i < 3; i++)
+		textures.push_back(cache.QueueTexture(1024, 11));
+	cache.ProcessRenderingThreadCommands(nullptr, 0.f);
+
+	auto commandList = nvrhi::RefCountPtr<MockCommandList>::Create(new MockCommandList());
+
+	// the first texture goes in full, the second one at the next mip, the third one has to wait
+	for (const auto& texture : textures)
+		cache.ReportTextureUse(texture.get(), 4096.f);
+	TextureStreamingStats stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesUpgraded == 2);
+	CHECK(stats.bytesUploaded <= settings.maxUploadBytesPerUpdate);
+	CHECK(cache.GetResidentMip(textures[0].get()) == 0);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 1);
+	CHECK(cache.GetResidentMip(textures[2].get()) == 4);
+
+	// all resident mips are uploaded again when a texture is recreated
+	CHECK(commandList->textureWrites.size() == 11 + 10);
+
+	// the texture missing the most mips goes first
+	for (const auto& texture : textures)
+		cache.ReportTextureUse(texture.get(), 4096.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 1);
+	CHECK(cache.GetResidentMip(textures[2].get()) == 0);
+
+	for (const auto& texture : textures)
+		cache.ReportTextureUse(texture.get(), 4096.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesUpgraded == 1);
+	CHECK(cache.GetResidentMip(textures[1].get()) == 0);
+
+	// a single texture larger than the limit still goes in
+	settings.maxUploadBytesPerUpdate = 1024;
+	cache.EnableStreaming(settings);
+	auto large = cache.QueueTexture(2048, 12);
+	cache.ProcessRenderingThreadCommands(nullptr, 0.f);
+	cache.ReportTextureUse(large.get(), 4096.f);
+	stats = cache.UpdateStreaming(commandList);
+	CHECK(stats.texturesUpgraded == 1);
+	CHECK(cache.GetResidentMip(large.get()) == 0);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_initial_residency();
+		test_upgrade_and_eviction();
+		test_deferred_release();
+		test_upload_limit();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/engine/TextureCache.h>
+#include <donut/core/vfs/VFS.h>
+#include <donut/tests/MockDevice.h>
+#include <donut/tests/utils.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::tests;
+
+// Puts decoded textures directly into the finalization queue, like the deferred loading functions do
+class TestTextureCache : public TextureCache
+{
+public:
+	using TextureCache::TextureCache;
+
+	std::shared_ptr<TextureData> QueueTexture(uint32_t width, uint32_t height, uint32_t mipLevels = 1)
+	{
+		auto texture = CreateTextureData();
+		texture->path = "texture" + std::to_string(m_TexturesRequested++);
+		texture->format = nvrhi::Format::RGBA8_UNORM;
+		texture->width = width;
+		texture->height = height;
+		texture->mipLevels = mipLevels;
+		texture->dimension = nvrhi::TextureDimension::Texture2D;
+
+		size_t size = 0;
+		texture->dataLayout.resize(1);
+		for (uint32_t mipLevel = 0; mipLevel < mipLevels; mipLevel++)
+		{
+			TextureSubresourceData& layout = texture->dataLayout[0].emplace_back();
+			layout.dataOffset = ptrdiff_t(size);
+			layout.rowPitch = size_t(std::max(width >> mipLevel, 1u)) * 4;
+			layout.dataSize = layout.rowPitch * std::max(height >> mipLevel, 1u);
+			size += layout.dataSize;
+		}
+		texture->data = std::make_shared<vfs::Blob>(calloc(size, 1), size);
+
+		m_TexturesToFinalize.push(texture);
+		return texture;
+	}
+
+	// A texture whose loading failed
+	void QueueFailedTexture()
+	{
+		m_TexturesToFinalize.push(CreateTextureData());
+	}
+};
+
+void test_single_submission()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	std::vector<std::shared_ptr<TextureData>> textures;
+	for (int i = 0; i < 100; i++)
+		textures.push_back(cache.QueueTexture(64, 64, 7));
+	cache.QueueFailedTexture();
+
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 0.f));
+
+	const TextureUploadStats& stats = cache.GetLastUploadStats();
+	CHECK(stats.textures == 100);
+	CHECK(stats.submissions == 1);
+	CHECK(stats.bytes == 100 * (64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1) * 4);
+	CHECK(cache.GetNumberOfFinalizedTextures() == 100);
+
+	// one command list, executed once
+	CHECK(device->commandLists.size() == 1);
+	CHECK(device->commandLists[0]->getDesc().uploadChunkSize == cache.GetUploadBudget());
+	CHECK(device->commandLists[0]->textureWrites.size() == 700);
+	CHECK(device->numExecutions == 1);
+	CHECK(device->numGarbageCollections == 1);
+	CHECK(device->texturesCreated.size() == 100);
+
+	for (const auto& texture : textures)
+	{
+		CHECK(texture->texture != nullptr);
+		CHECK(!texture->data);
+	}
+
+	// nothing left to do
+	CHECK(!cache.ProcessRenderingThreadCommands(nullptr, 0.f));
+	CHECK(cache.GetLastUploadStats().submissions == 0);
+	CHECK(device->numExecutions == 1);
+}
+
+void test_byte_budget()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	// 64 KB per texture, 4 textures per batch
+	const size_t textureSize = 128 * 128 * 4;
+	cache.SetUploadBudget(textureSize * 4);
+	for (int i = 0; i < 10; i++)
+		cache.QueueTexture(128, 128);
+
+	// without a time limit, the whole queue is processed in batches
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 0.f));
+	CHECK(cache.GetLastUploadStats().textures == 10);
+	CHECK(cache.GetLastUploadStats().bytes == textureSize * 10);
+	CHECK(cache.GetLastUploadStats().submissions == 3);
+	CHECK(device->numExecutions == 3);
+	CHECK(device->commandLists.size() == 1);
+	CHECK(device->commandLists[0]->getDesc().uploadChunkSize == textureSize * 4);
+
+	// with a time limit, one batch per call
+	for (int i = 0; i < 10; i++)
+		cache.QueueTexture(128, 128);
+	uint32_t calls = 0;
+	while (cache.ProcessRenderingThreadCommands(nullptr, 1000.f))
+	{
+		++calls;
+		CHECK(cache.GetLastUploadStats().submissions == 1);
+		CHECK(cache.GetLastUploadStats().bytes <= textureSize * 4);
+	}
+	CHECK(calls == 3);
+	CHECK(cache.GetNumberOfFinalizedTextures() == 20);
+
+	// a texture over the budget goes alone
+	cache.QueueTexture(512, 512);
+	cache.QueueTexture(16, 16);
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 1000.f));
+	CHECK(cache.GetLastUploadStats().textures == 1);
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 1000.f));
+	CHECK(cache.GetLastUploadStats().textures == 1);
+
+	// changing the budget recreates the command list with the new upload chunk size
+	cache.SetUploadBudget(0);
+	for (int i = 0; i < 10; i++)
+		cache.QueueTexture(512, 512);
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 0.f));
+	CHECK(cache.GetLastUploadStats().submissions == 1);
+	CHECK(device->commandLists.size() == 2);
+	CHECK(device->commandLists[1]->getDesc().uploadChunkSize == nvrhi::CommandListParameters().uploadChunkSize);
+}
+
+void test_time_limit()
+{
+	auto device = nvrhi::RefCountPtr<MockDevice>::Create(new MockDevice());
+	TestTextureCache cache(device, nullptr, nullptr);
+
+	for (int i = 0; i < 10; i++)
+		cache.QueueTexture(16, 16);
+
+	// a tiny time limit still finalizes at least one texture
+	CHECK(cache.ProcessRenderingThreadCommands(nullptr, 1e-6f));
+	CHECK(cache.GetLastUploadStats().textures >= 1);
+	CHECK(cache.GetLastUploadStats().submissions == 1);
+
+	uint32_t finalized = cache.GetLastUploadStats().textures;
+	while (cache.ProcessRenderingThreadCommands(nullptr, 1e-6f))
+	{
+		CHECK(cache.GetLastUploadStats().submissions == 1);
+		finalized += cache.GetLastUploadStats().textures;
+	}
+	CHECK(finalized == 10);
+	CHECK(device->numExecutions <= 10);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_single_submission();
+		test_byte_budget();
+		test_time_limit();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
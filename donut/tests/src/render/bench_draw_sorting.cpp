@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/render/DrawStrategy.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/benchmark.h>
+#include <donut/tests/MockCommandList.h>
+#include <donut/tests/RenderTestScene.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::render;
+using namespace donut::tests;
+
+// Renders a procedurally generated scene into a recording command list with the chunk-sorted
+// InstancedOpaqueDrawStrategy and the globally sorted SortedOpaqueDrawStrategy, and compares
+// the number of state changes and draw calls along with the CPU time.
+// Usage: bench_draw_sorting [instance count]
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+int main(int argc, char** argv)
+{
+	int instanceCount = (argc > 1) ? atoi(argv[1]) : 50000;
+	const int meshCount = 200;
+	const int materialCount = 50;
+	const int bufferGroupCount = 4;
+
+	std::vector<std::shared_ptr<Material>> materials;
+	for (int i = 0; i < materialCount; i++)
+	{
+		auto material = std::make_shared<Material>();
+		material->doubleSided = (i % 5) == 0;
+		materials.push_back(material);
+	}
+
+	std::vector<std::shared_ptr<BufferGroup>> bufferGroups;
+	for (int i = 0; i < bufferGroupCount; i++)
+		bufferGroups.push_back(std::make_shared<BufferGroup>());
+
+	uint32_t seed = 1;
+	std::vector<std::shared_ptr<MeshInfo>> meshes;
+	for (int i = 0; i < meshCount; i++)
+	{
+		auto mesh = std::make_shared<MeshInfo>();
+		mesh->buffers = bufferGroups[i % bufferGroupCount];
+		mesh->indexOffset = uint32_t(i) * 3000;
+		int geometryCount = 1 + i % 3;
+		for (int j = 0; j < geometryCount; j++)
+		{
+			auto geometry = std::make_shared<MeshGeometry>();
+			geometry->material = materials[uint32_t(random_float(seed) * materialCount) % materialCount];
+			geometry->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+			geometry->indexOffsetInMesh = uint32_t(j) * 1000;
+			geometry->numIndices = 1000;
+			mesh->geometries.push_back(geometry);
+		}
+		mesh->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+		meshes.push_back(mesh);
+	}
+
+	// instances of the same mesh are added together, so they get consecutive instance indices,
+	// but they are spread over the whole field
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	const float fieldSize = 20.f * sqrtf(float(instanceCount));
+	for (int i = 0; i < instanceCount; i++)
+	{
+		const auto& mesh = meshes[size_t(i) * meshCount / instanceCount];
+		auto node = graph->AttachLeafNode(root, std::make_shared<MeshInstance>(mesh));
+		node->SetTranslation(dm::double3(random_float(seed), random_float(seed) * 0.05f, random_float(seed)) * double(fieldSize));
+	}
+	graph->Refresh(0);
+
+	// look at the field from above so that everything is visible
+	PlanarView view;
+	dm::float3 center = dm::float3(0.5f, 0.f, 0.5f) * fieldSize;
+	dm::affine3 cameraToWorld = dm::rotation(dm::float3(1.f, 0.f, 0.f), dm::radians(90.f)) * dm::translation(center + dm::float3(0.f, fieldSize, 0.f));
+	view.SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(90.f), 1.f, 0.1f, fieldSize * 4.f));
+	view.UpdateCache();
+
+	printf("%d instances of %d meshes, %d materials, %d buffer groups\n", instanceCount, meshCount, materialCount, bufferGroupCount);
+
+	MockCommandList commandList;
+	NullGeometryPass pass;
+	GeometryPassContext passContext;
+	const int iterations = 10;
+
+	auto run = [&](const char* name, IDrawStrategy& strategy)
+	{
+		double time = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			commandList.Reset();
+			strategy.PrepareForView(root, view);
+			RenderView(&commandList, &view, nullptr, nullptr, strategy, pass, passContext);
+		});
+
+		PrintBenchmarkResult(name, time);
+		printf("    setGraphicsState: %u, drawIndexed: %u, instances: %llu\n",
+			commandList.numSetGraphicsState, commandList.numDraws, (unsigned long long)commandList.numInstancesDrawn);
+	};
+
+	InstancedOpaqueDrawStrategy chunkedStrategy;
+	run("InstancedOpaqueDrawStrategy (128-item chunks)", chunkedStrategy);
+	uint64_t chunkedInstances = commandList.numInstancesDrawn;
+
+	SortedOpaqueDrawStrategy sortedStrategy;
+	run("SortedOpaqueDrawStrategy", sortedStrategy);
+
+	if (commandList.numInstancesDrawn != chunkedInstances)
+		printf("WARNING: the strategies drew a different number of instances\n");
+
+	return 0;
+}
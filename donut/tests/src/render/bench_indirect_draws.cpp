@@ -0,0 +1,159 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/render/IndirectDrawing.h>
+#include <donut/render/DrawStrategy.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/benchmark.h>
+#include <donut/tests/MockCommandList.h>
+#include <donut/tests/RenderTestScene.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::render;
+using namespace donut::tests;
+
+// Compares the CPU cost of recording a view with one drawIndexed call per instanced run (RenderView)
+// against packing the same runs into indirect arguments and recording one drawIndexedIndirect per material
+// (IndirectDrawPacker + RenderViewIndirect). The scene has many unique meshes, so that instancing doesn't help.
+// Both paths use SortedOpaqueDrawStrategy and a recording command list; the times include the culling and sorting.
+// Usage: bench_indirect_draws [mesh count]
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+int main(int argc, char** argv)
+{
+	int meshCount = (argc > 1) ? atoi(argv[1]) : 20000;
+	const int materialCount = 32;
+
+	std::vector<std::shared_ptr<Material>> materials;
+	for (int i = 0; i < materialCount; i++)
+		materials.push_back(std::make_shared<Material>());
+
+	auto buffers = std::make_shared<BufferGroup>();
+
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	const float fieldSize = 20.f * sqrtf(float(meshCount));
+	uint32_t seed = 1;
+	uint32_t indexOffset = 0;
+	for (int i = 0; i < meshCount; i++)
+	{
+		auto mesh = std::make_shared<MeshInfo>();
+		mesh->buffers = buffers;
+		mesh->indexOffset = indexOffset;
+		mesh->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+		for (int j = 0; j < 2; j++)
+		{
+			auto geometry = std::make_shared<MeshGeometry>();
+			geometry->material = materials[uint32_t(random_float(seed) * materialCount) % materialCount];
+			geometry->objectSpaceBounds = mesh->objectSpaceBounds;
+			geometry->indexOffsetInMesh = uint32_t(j) * 600;
+			geometry->numIndices = 600;
+			mesh->geometries.push_back(geometry);
+		}
+		indexOffset += 1200;
+
+		auto node = graph->AttachLeafNode(root, std::make_shared<MeshInstance>(mesh));
+		node->SetTranslation(dm::double3(random_float(seed), random_float(seed) * 0.05f, random_float(seed)) * double(fieldSize));
+	}
+	graph->Refresh(0);
+
+	// look at the field from above so that everything is visible
+	PlanarView view;
+	dm::float3 center = dm::float3(0.5f, 0.f, 0.5f) * fieldSize;
+	dm::affine3 cameraToWorld = dm::rotation(dm::float3(1.f, 0.f, 0.f), dm::radians(90.f)) * dm::translation(center + dm::float3(0.f, fieldSize, 0.f));
+	view.SetMatrices(inverse(cameraToWorld), dm::perspProjD3DStyle(dm::radians(90.f), 1.f, 0.1f, fieldSize * 4.f));
+	view.UpdateCache();
+
+	printf("%d unique meshes with 2 geometries each, %d materials\n", meshCount, materialCount);
+
+	MockCommandList commandList;
+	NullGeometryPass pass;
+	GeometryPassContext passContext;
+	SortedOpaqueDrawStrategy strategy;
+	const int iterations = 10;
+
+	double time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		commandList.Reset();
+		strategy.PrepareForView(root, view);
+		RenderView(&commandList, &view, nullptr, nullptr, strategy, pass, passContext);
+	});
+	PrintBenchmarkResult("RenderView (drawIndexed per run)", time);
+	printf("    setGraphicsState: %u, drawIndexed: %u\n", commandList.numSetGraphicsState, commandList.numDraws);
+	const uint32_t directDraws = commandList.numDraws;
+
+	IndirectDrawPacker packer;
+	nvrhi::BufferDesc bufferDesc;
+	bufferDesc.byteSize = size_t(meshCount) * 2 * sizeof(nvrhi::DrawIndexedIndirectArguments);
+	bufferDesc.isDrawIndirectArgs = true;
+	packer.SetArgumentBuffer(nvrhi::BufferHandle::Create(new MockBuffer(bufferDesc)));
+
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		commandList.Reset();
+		strategy.PrepareForView(root, view);
+		packer.Clear();
+		packer.AddItems(strategy);
+		packer.Upload(&commandList);
+		RenderViewIndirect(&commandList, &view, nullptr, nullptr, packer, pass, passContext);
+	});
+	PrintBenchmarkResult("RenderViewIndirect (drawIndexedIndirect per bucket)", time);
+	printf("    setGraphicsState: %u, drawIndexedIndirect: %u, records: %u, bytes uploaded: %d\n",
+		commandList.numSetGraphicsState, commandList.numIndirectDraws, commandList.numIndirectDrawRecords, int(commandList.GetBytesWritten()));
+
+	// the recording alone, from items that are already culled, sorted and packed
+	std::vector<DrawItem> items;
+	strategy.PrepareForView(root, view);
+	while (const DrawItem* item = strategy.GetNextItem())
+		items.push_back(*item);
+
+	PassthroughDrawStrategy passthrough;
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		commandList.Reset();
+		passthrough.SetData(items.data(), items.size());
+		RenderView(&commandList, &view, nullptr, nullptr, passthrough, pass, passContext);
+	});
+	PrintBenchmarkResult("recording only: RenderView", time);
+
+	time = MeasureMedianMilliseconds(iterations, [&]()
+	{
+		commandList.Reset();
+		RenderViewIndirect(&commandList, &view, nullptr, nullptr, packer, pass, passContext);
+	});
+	PrintBenchmarkResult("recording only: RenderViewIndirect", time);
+
+	if (commandList.numIndirectDrawRecords != directDraws)
+		printf("WARNING: the paths produced a different number of draws\n");
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/render/DrawStrategy.h>
+#include <donut/engine/MeshLods.h>
+#include <donut/engine/SceneGraph.h>
+#include <donut/engine/View.h>
+#include <donut/tests/benchmark.h>
+#include <donut/tests/MockCommandList.h>
+#include <donut/tests/RenderTestScene.h>
+#include <cstdlib>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::render;
+using namespace donut::tests;
+
+// Renders a field of sphere instances that recedes from the camera into a recording command list,
+// once with full detail and once with the levels of detail selected by the draw strategy,
+// and compares the number of triangles submitted along with the CPU time.
+// Usage: bench_lod_selection [instance count]
+
+static float random_float(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return float(seed >> 8) / float(1 << 24);
+}
+
+static std::shared_ptr<MeshInfo> create_sphere_mesh(int rings, int segments, const std::shared_ptr<Material>& material)
+{
+	auto buffers = std::make_shared<BufferGroup>();
+	for (int r = 0; r <= rings; r++)
+	{
+		float theta = dm::PI_f * float(r) / float(rings);
+		float sinTheta = (r == 0 || r == rings) ? 0.f : sinf(theta);
+		for (int s = 0; s <= segments; s++)
+		{
+			float phi = 2.f * dm::PI_f * float(s % segments) / float(segments);
+			buffers->positionData.push_back(dm::float3(sinTheta * cosf(phi), cosf(theta), sinTheta * sinf(phi)));
+			buffers->texcoord1Data.push_back(dm::float2(float(s) / float(segments), float(r) / float(rings)));
+		}
+	}
+	for (int r = 0; r < rings; r++)
+	{
+		for (int s = 0; s < segments; s++)
+		{
+			uint32_t i = uint32_t(r * (segments + 1) + s);
+			uint32_t below = i + uint32_t(segments + 1);
+			buffers->indexData.insert(buffers->indexData.end(), { i, i + 1, below });
+			buffers->indexData.insert(buffers->indexData.end(), { i + 1, below + 1, below });
+		}
+	}
+
+	auto mesh = std::make_shared<MeshInfo>();
+	mesh->buffers = buffers;
+	mesh->totalIndices = uint32_t(buffers->indexData.size());
+	mesh->totalVertices = uint32_t(buffers->positionData.size());
+	mesh->objectSpaceBounds = dm::box3(dm::float3(-1.f), dm::float3(1.f));
+
+	auto geometry = std::make_shared<MeshGeometry>();
+	geometry->material = material;
+	geometry->objectSpaceBounds = mesh->objectSpaceBounds;
+	geometry->numIndices = mesh->totalIndices;
+	geometry->numVertices = mesh->totalVertices;
+	mesh->geometries.push_back(geometry);
+
+	return mesh;
+}
+
+int main(int argc, char** argv)
+{
+	int instanceCount = (argc > 1) ? atoi(argv[1]) : 10000;
+	const int meshCount = 4;
+
+	auto material = std::make_shared<Material>();
+
+	MeshLodSettings settings;
+	settings.lodCount = 6;
+
+	std::vector<std::shared_ptr<MeshInfo>> meshes;
+	double lodTime = MeasureMedianMilliseconds(1, [&]()
+	{
+		for (int i = 0; i < meshCount; i++)
+		{
+			auto mesh = create_sphere_mesh(32 + i * 16, 64 + i * 32, material);
+			GenerateMeshLods(*mesh, settings);
+			meshes.push_back(mesh);
+		}
+	});
+	PrintBenchmarkResult("GenerateMeshLods", lodTime);
+
+	for (const auto& mesh : meshes)
+	{
+		printf("    %u triangles, levels:", mesh->geometries[0]->numIndices / 3);
+		for (const MeshGeometryLod& lod : mesh->geometries[0]->lods)
+			printf(" %u", lod.numIndices / 3);
+		printf("\n");
+	}
+
+	// a field in front of the camera that goes from 5 to 1000 units away
+	auto graph = std::make_shared<SceneGraph>();
+	auto root = std::make_shared<SceneGraphNode>();
+	graph->SetRootNode(root);
+
+	uint32_t seed = 1;
+	for (int i = 0; i < instanceCount; i++)
+	{
+		auto node = graph->AttachLeafNode(root, std::make_shared<MeshInstance>(meshes[i % meshCount]));
+		float distance = 5.f + random_float(seed) * 995.f;
+		float side = (random_float(seed) - 0.5f) * distance;
+		node->SetTranslation(dm::double3(side, (random_float(seed) - 0.5f) * distance * 0.5f, distance));
+	}
+	graph->Refresh(0);
+
+	PlanarView view;
+	view.SetViewport(nvrhi::Viewport(1920.f, 1080.f));
+	view.SetMatrices(dm::affine3::identity(), dm::perspProjD3DStyleReverse(dm::radians(90.f), 16.f / 9.f, 0.1f));
+	view.UpdateCache();
+
+	printf("%d instances of %d meshes with up to %u levels of detail\n", instanceCount, meshCount, settings.lodCount);
+
+	MockCommandList commandList;
+	NullGeometryPass pass;
+	GeometryPassContext passContext;
+	const int iterations = 10;
+
+	auto run = [&](const char* name, IDrawStrategy& strategy)
+	{
+		double time = MeasureMedianMilliseconds(iterations, [&]()
+		{
+			commandList.Reset();
+			strategy.PrepareForView(root, view);
+			RenderView(&commandList, &view, nullptr, nullptr, strategy, pass, passContext);
+		});
+
+		PrintBenchmarkResult(name, time);
+		printf("    drawIndexed: %u, instances: %llu, triangles: %llu\n",
+			commandList.numDraws, (unsigned long long)commandList.numInstancesDrawn, (unsigned long long)commandList.numTrianglesDrawn);
+	};
+
+	InstancedOpaqueDrawStrategy fullDetailStrategy;
+	fullDetailStrategy.SetLodPixelThreshold(0.f);
+	run("InstancedOpaqueDrawStrategy, full detail", fullDetailStrategy);
+	uint64_t fullDetailTriangles = commandList.numTrianglesDrawn;
+
+	for (float threshold : { 0.5f, 1.f, 2.f })
+	{
+		InstancedOpaqueDrawStrategy lodStrategy;
+		lodStrategy.SetLodPixelThreshold(threshold);
+		char name[64];
+		snprintf(name, sizeof(name), "InstancedOpaqueDrawStrategy, %.1f pixel LOD error", threshold);
+		run(name, lodStrategy);
+		printf("    %.1f%% of the full detail triangles\n", 100.0 * double(commandList.numTrianglesDrawn) / double(std::max<uint64_t>(fullDetailTriangles, 1)));
+	}
+
+	SortedOpaqueDrawStrategy sortedStrategy;
+	run("SortedOpaqueDrawStrategy, 1.0 pixel LOD error", sortedStrategy);
+
+	return 0;
+}
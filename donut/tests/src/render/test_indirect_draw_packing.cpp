@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/render/IndirectDrawing.h>
+#include <donut/render/DrawStrategy.h>
+#include <donut/tests/MockCommandList.h>
+#include <donut/tests/RenderTestScene.h>
+#include <donut/tests/utils.h>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::render;
+using namespace donut::tests;
+
+void test_packing_merges_instances_into_buckets()
+{
+	RenderTestScene scene = CreateRenderTestScene(2, 2, 10);
+	PlanarView view = CreateViewOfEverything();
+
+	SortedOpaqueDrawStrategy strategy;
+	strategy.PrepareForView(scene.graph->GetRootNode(), view);
+	CHECK(strategy.GetItemCount() == 40);
+
+	IndirectDrawPacker packer;
+	packer.AddItems(strategy);
+
+	// one bucket per material, one record per geometry with all 10 instances
+	const auto& buckets = packer.GetBuckets();
+	const auto& arguments = packer.GetArguments();
+	CHECK(buckets.size() == 2);
+	CHECK(arguments.size() == 4);
+
+	uint32_t totalInstances = 0;
+	for (const auto& bucket : buckets)
+	{
+		CHECK(bucket.drawCount == 2);
+		CHECK(bucket.buffers == scene.buffers.get());
+
+		for (uint32_t draw = bucket.firstDraw; draw < bucket.firstDraw + bucket.drawCount; draw++)
+		{
+			const auto& args = arguments[draw];
+			CHECK(args.instanceCount == 10);
+			CHECK(args.indexCount == 300);
+			CHECK(args.startInstanceLocation == 0 || args.startInstanceLocation == 10);
+
+			// the offsets come from the mesh of the first instance in the run
+			const MeshInfo* mesh = scene.meshes[args.startInstanceLocation / 10].get();
+			const MeshGeometry* geometry = (bucket.material == scene.materials[0].get()) ? mesh->geometries[0].get() : mesh->geometries[1].get();
+			CHECK(args.startIndexLocation == mesh->indexOffset + geometry->indexOffsetInMesh);
+			CHECK(args.baseVertexLocation == int32_t(mesh->vertexOffset + geometry->vertexOffsetInMesh));
+			totalInstances += args.instanceCount;
+		}
+	}
+	CHECK(totalInstances == 40);
+
+	// a gap in the instance indices splits the run
+	packer.Clear();
+	const auto& instances = scene.graph->GetMeshInstances();
+	for (int i : { 0, 1, 3 })
+	{
+		DrawItem item{};
+		item.instance = instances[i].get();
+		item.mesh = instances[i]->GetMesh().get();
+		item.geometry = item.mesh->geometries[0].get();
+		item.material = item.geometry->material.get();
+		item.buffers = item.mesh->buffers.get();
+		item.cullMode = nvrhi::RasterCullMode::Back;
+		packer.AddItem(item);
+	}
+	CHECK(packer.GetBuckets().size() == 1);
+	CHECK(packer.GetArguments().size() == 2);
+	CHECK(packer.GetArguments()[0].instanceCount == 2);
+	CHECK(packer.GetArguments()[1].startInstanceLocation == 3);
+}
+
+void test_indirect_recording()
+{
+	RenderTestScene scene = CreateRenderTestScene(2, 2, 10);
+	PlanarView view = CreateViewOfEverything();
+
+	SortedOpaqueDrawStrategy strategy;
+	strategy.PrepareForView(scene.graph->GetRootNode(), view);
+
+	IndirectDrawPacker packer;
+	packer.AddItems(strategy);
+
+	nvrhi::BufferDesc bufferDesc;
+	bufferDesc.byteSize = 1024;
+	bufferDesc.isDrawIndirectArgs = true;
+	nvrhi::BufferHandle buffer = nvrhi::BufferHandle::Create(new MockBuffer(bufferDesc));
+	packer.SetArgumentBuffer(buffer);
+
+	MockCommandList commandList;
+	packer.Upload(&commandList);
+	CHECK(commandList.bufferWrites.size() == 1);
+	CHECK(commandList.bufferWrites[0].buffer == buffer.Get());
+	CHECK(commandList.GetBytesWritten() == 4 * sizeof(nvrhi::DrawIndexedIndirectArguments));
+
+	NullGeometryPass pass;
+	GeometryPassContext passContext;
+	RenderViewIndirect(&commandList, &view, nullptr, nullptr, packer, pass, passContext);
+
+	CHECK(commandList.numDraws == 0);
+	CHECK(commandList.numIndirectDraws == 2);
+	CHECK(commandList.numIndirectDrawRecords == 4);
+	CHECK(commandList.numSetGraphicsState == 2);
+	CHECK(pass.numMaterialSetups == 2);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_packing_merges_instances_into_buckets();
+		test_indirect_recording();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
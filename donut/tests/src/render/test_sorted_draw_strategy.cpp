@@ -0,0 +1,160 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <donut/render/DrawStrategy.h>
+#include <donut/tests/MockCommandList.h>
+#include <donut/tests/RenderTestScene.h>
+#include <donut/tests/utils.h>
+#include <set>
+#include <tuple>
+
+using namespace donut;
+using namespace donut::engine;
+using namespace donut::render;
+using namespace donut::tests;
+
+static std::vector<const DrawItem*> get_items(IDrawStrategy& strategy)
+{
+	std::vector<const DrawItem*> items;
+	while (const DrawItem* item = strategy.GetNextItem())
+		items.push_back(item);
+	return items;
+}
+
+// The items come out ordered by material, geometry, LOD and instance, with a single buffer group in the scene.
+// Materials without an ID come after the others.
+static void check_order(const std::vector<const DrawItem*>& items)
+{
+	auto getKey = [](const DrawItem* item)
+	{
+		const int materialID = item->material->materialID;
+		return std::make_tuple(materialID < 0 ? 1 : 0, uint32_t(materialID), item->geometry->globalGeometryIndex, item->lod, item->instance->GetInstanceIndex());
+	};
+
+	// materials without an ID are ordered by their first appearance
+	for (size_t i = 1; i < items.size(); i++)
+	{
+		const bool unassigned = items[i - 1]->material->materialID < 0 && items[i]->material->materialID < 0;
+		CHECK(getKey(items[i - 1]) <= getKey(items[i]) || (unassigned && items[i - 1]->material != items[i]->material));
+	}
+
+	// every material is drawn in one run
+	std::set<const Material*> finished;
+	for (size_t i = 1; i < items.size(); i++)
+	{
+		if (items[i]->material != items[i - 1]->material)
+		{
+			finished.insert(items[i - 1]->material);
+			CHECK(finished.count(items[i]->material) == 0);
+		}
+	}
+}
+
+static void check_draws(IDrawStrategy& strategy, const RenderTestScene& scene, const PlanarView& view, int instancesPerMesh)
+{
+	MockCommandList commandList;
+	NullGeometryPass pass;
+	GeometryPassContext passContext;
+	strategy.PrepareForView(scene.graph->GetRootNode(), view);
+	RenderView(&commandList, &view, nullptr, nullptr, strategy, pass, passContext);
+
+	// the instances of a geometry are merged into one draw, and each material sets the state once
+	CHECK(commandList.numDraws == 9);
+	CHECK(commandList.numInstancesDrawn == uint64_t(9 * instancesPerMesh));
+	CHECK(commandList.numSetGraphicsState == 3);
+}
+
+void test_key_order_and_instance_runs()
+{
+	RenderTestScene scene = CreateRenderTestScene(3, 3, 10);
+	PlanarView view = CreateViewOfEverything();
+
+	SortedOpaqueDrawStrategy strategy;
+	strategy.PrepareForView(scene.graph->GetRootNode(), view);
+	CHECK(strategy.GetItemCount() == 90);
+
+	std::vector<const DrawItem*> items = get_items(strategy);
+	CHECK(items.size() == 90);
+	check_order(items);
+	CHECK(items.front()->material->materialID == 0);
+
+	check_draws(strategy, scene, view, 10);
+}
+
+void test_wide_keys()
+{
+	RenderTestScene scene = CreateRenderTestScene(3, 3, 10);
+	PlanarView view = CreateViewOfEverything();
+
+	// 31 bits of material and 31 bits of geometry, with the instance bits over 64, use the comparison sort
+	scene.materials[1]->materialID = 0x7fffffff;
+	for (const auto& mesh : scene.meshes)
+		for (const auto& geometry : mesh->geometries)
+			geometry->globalGeometryIndex += 0x40000000;
+
+	SortedOpaqueDrawStrategy strategy;
+	strategy.PrepareForView(scene.graph->GetRootNode(), view);
+
+	std::vector<const DrawItem*> items = get_items(strategy);
+	CHECK(items.size() == 90);
+	check_order(items);
+	CHECK(items.back()->material == scene.materials[1].get());
+
+	check_draws(strategy, scene, view, 10);
+}
+
+void test_unassigned_materials()
+{
+	RenderTestScene scene = CreateRenderTestScene(3, 3, 4);
+	PlanarView view = CreateViewOfEverything();
+
+	// two materials without an ID don't share the key of material 0, or each other's
+	for (const auto& material : scene.materials)
+		material->materialID = (material == scene.materials[0]) ? 0 : -1;
+
+	SortedOpaqueDrawStrategy strategy;
+	strategy.PrepareForView(scene.graph->GetRootNode(), view);
+
+	std::vector<const DrawItem*> items = get_items(strategy);
+	CHECK(items.size() == 36);
+	check_order(items);
+	for (size_t i = 0; i < 12; i++)
+		CHECK(items[i]->material == scene.materials[0].get());
+
+	check_draws(strategy, scene, view, 4);
+}
+
+int main(int, char** argv)
+{
+	try
+	{
+		test_key_order_and_instance_runs();
+		test_wide_keys();
+		test_unassigned_materials();
+	}
+	catch (const std::runtime_error& err)
+	{
+		fprintf(stderr, "%s", err.what());
+		return 1;
+	}
+	return 0;
+}
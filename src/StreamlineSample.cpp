@@ -77,8 +77,19 @@ StreamlineSample::StreamlineSample(DeviceManager* deviceManager, UIData& ui, con
     m_RootFs->mount("/shaders/donut", frameworkShaderPath);
     m_RootFs->mount("/native", nativeFS);
 
+    // Scene switches reload the same glTF and binary files, keep up to 64 MB of them in system memory.
+    // Textures bypass this cache: the texture cache already keeps every loaded texture resident.
+    m_CachingFs = std::make_shared<CachingFileSystem>(m_RootFs, size_t(64) << 20);
+    m_CachingFs->setValidateFiles(true);
+
     m_TextureCache = std::make_shared<TextureCache>(GetDevice(), m_RootFs, nullptr);
 
+    // processed models are stored next to the executable, so that later runs skip the glTF import
+    std::filesystem::path sceneCachePath = app::GetDirectoryWithExecutable() / "scenecache";
+    std::error_code error;
+    std::filesystem::create_directories(sceneCachePath, error);
+    m_SceneCache = std::make_shared<SceneCache>(nativeFS, sceneCachePath);
+
     m_ShaderFactory = std::make_shared<ShaderFactory>(GetDevice(), m_RootFs, "/shaders");
     m_CommonPasses = std::make_shared<CommonRenderPasses>(GetDevice(), m_ShaderFactory);
 
@@ -866,7 +877,7 @@ void StreamlineSample::SetCurrentSceneName(const std::string& sceneName)
 
     m_CurrentSceneName = sceneName;
 
-    BeginLoadingScene(m_RootFs, m_CurrentSceneName);
+    BeginLoadingScene(m_CachingFs, m_CurrentSceneName);
 }
 
 bool StreamlineSample::KeyboardUpdate(int key, int scancode, int action, int mods)
@@ -944,6 +955,7 @@ bool StreamlineSample::LoadScene(std::shared_ptr<IFileSystem> fs, const std::fil
     using namespace std::chrono;
 
     Scene* scene = new Scene(GetDevice(), *m_ShaderFactory, fs, m_TextureCache, nullptr, nullptr);
+    scene->SetSceneCache(m_SceneCache);
 
     auto startTime = high_resolution_clock::now();
 
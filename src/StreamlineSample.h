@@ -42,10 +42,12 @@
 
 // From Donut
 #include <donut/core/vfs/VFS.h>
+#include <donut/core/vfs/CachingFileSystem.h>
 #include <donut/core/log.h>
 #include <donut/engine/CommonRenderPasses.h>
 #include <donut/engine/FramebufferFactory.h>
 #include <donut/engine/Scene.h>
+#include <donut/engine/SceneCache.h>
 #include <donut/engine/ShaderFactory.h>
 #include <donut/engine/TextureCache.h>
 #include <donut/render/BloomPass.h>
@@ -132,6 +134,8 @@ private:
 
     // Filesystem and scene
     std::shared_ptr<RootFileSystem>                 m_RootFs;
+    std::shared_ptr<CachingFileSystem>              m_CachingFs;
+    std::shared_ptr<SceneCache>                     m_SceneCache;
     std::vector<std::string>                        m_SceneFilesAvailable;
     std::string                                     m_CurrentSceneName;
     std::shared_ptr<Scene>				            m_Scene;